@@ -27,7 +27,10 @@ target_link_libraries(mana-engine
         implot
         assimp
         sndfile
-        cryptopp)
+        cryptopp
+        lz4
+        zstd
+        xxhash)
 
 
 if (BUILD_ENGINE_SCRIPT_MONO)
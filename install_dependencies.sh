@@ -14,7 +14,10 @@ debian_11()
   	libbox2d-dev libbox2d2.3.0 \
   	libfreetype-dev libfreetype6 \
   	mono-complete \
-    libcrypto++-dev
+    libcrypto++-dev \
+    liblz4-dev \
+    libzstd-dev \
+    libxxhash-dev
 }
 
 #Assumes /etc/os-release is present
@@ -21,6 +21,9 @@
 
 #include <fstream>
 
+#include "asset/texturecooker.hpp"
+#include "io/pakbuilder.hpp"
+
 ProjectCompiler &ProjectCompiler::setSettings(const BuildSettings &settings) {
     buildSettings = settings;
     return *this;
@@ -28,8 +31,13 @@ ProjectCompiler &ProjectCompiler::setSettings(const BuildSettings &settings) {
 
 void ProjectCompiler::compile() {
     // Package assets
+    auto cookedDir = buildSettings.outputDir + "/cooked";
+    engine::TextureCooker::cookDirectory(buildSettings.assetDir, cookedDir);
 
     // Copy Packaged assets to output dir
+    engine::PakBuilder builder;
+    builder.addDirectory(cookedDir);
+    builder.build(buildSettings.outputDir + "/assets");
 
     // Create the CMakeLists.txt file
     auto cmSrc = getCMakeSource();
@@ -73,6 +73,17 @@ namespace engine {
             }
         }
 
+        template<typename T>
+        bool has(const std::string &name = "") const {
+            auto it = assets.find(std::type_index(typeid(T)));
+            if (it == assets.end() || it->second.empty())
+                return false;
+            if (name.empty())
+                return true;
+            auto assetIt = it->second.find(name);
+            return assetIt != it->second.end() && !assetIt->second.empty();
+        }
+
         template<typename T>
         void add(const std::string &name, const T &asset) {
             auto index = std::type_index(typeid(T));
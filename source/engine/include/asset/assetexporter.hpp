@@ -21,6 +21,7 @@
 #define MANA_ASSETEXPORTER_HPP
 
 #include "asset/image.hpp"
+#include "asset/compressedimage.hpp"
 #include "color.hpp"
 
 #include <ostream>
@@ -28,6 +29,17 @@
 namespace engine {
     namespace AssetExporter {
         MANA_EXPORT void exportImage(std::ostream &stream, const Image <ColorRGBA> &image);
+
+        /**
+         * Write the compressed image including all mip levels to the stream in the binary ctex format.
+         *
+         * The format consists of the magic, version, format, width, height and level count followed by
+         * the size and data of each level. All integers are stored in little endian byte order.
+         *
+         * @param stream
+         * @param image
+         */
+        MANA_EXPORT void exportCompressedImage(std::ostream &stream, const CompressedImage &image);
     }
 }
 
@@ -23,8 +23,11 @@
 #include "math/transform.hpp"
 #include "math/matrix.hpp"
 #include "math/matrixmath.hpp"
+#include "math/rotation.hpp"
 
 #include <stdexcept>
+#include <cmath>
+#include <limits>
 
 namespace engine {
     enum CameraType {
@@ -66,6 +69,27 @@ namespace engine {
             }
         }
 
+        /**
+         * Estimate the size in pixels of the projection of a sphere.
+         *
+         * @param center The world space center of the sphere
+         * @param radius The world space radius of the sphere
+         * @param screenHeight The height of the viewport in pixels
+         * @return The projected diameter of the sphere in pixels
+         */
+        float projectedSize(const Vec3f &center, float radius, float screenHeight) const {
+            if (type == ORTHOGRAPHIC) {
+                return radius * 2 / (top - bottom) * screenHeight;
+            }
+
+            auto offset = center - transform.getPosition();
+            float distance = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+            if (distance <= radius)
+                return std::numeric_limits<float>::max();
+
+            return radius / (distance * std::tan(degreesToRadians(fov) / 2)) * screenHeight;
+        }
+
         CameraType type = PERSPECTIVE;
 
         Transform transform;
@@ -0,0 +1,83 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_COMPRESSEDIMAGE_HPP
+#define MANA_COMPRESSEDIMAGE_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#include "platform/graphics/texturebuffer.hpp"
+
+namespace engine {
+    static const std::string COMPRESSED_IMAGE_MAGIC = "\xa9" "ctex\xff";
+    static const uint32_t COMPRESSED_IMAGE_VERSION = 1;
+
+    /**
+     * Block compressed image data with a precomputed mip chain.
+     *
+     * Each level stores the blocks of the level in row major order, the block dimensions are always 4x4 pixels.
+     */
+    struct MANA_EXPORT CompressedImage {
+        TextureBuffer::ColorFormat format = TextureBuffer::BC1;
+        Vec2i size; // The size of mip level 0
+        std::vector<std::vector<char>> levels; // The mip levels ordered from largest (0) to smallest
+
+        static bool isBlockCompressed(TextureBuffer::ColorFormat format) {
+            return format >= TextureBuffer::BC1 && format <= TextureBuffer::BC7;
+        }
+
+        /**
+         * @param format
+         * @return The number of bytes used to store a single 4x4 block in the given format.
+         */
+        static size_t getBlockSize(TextureBuffer::ColorFormat format) {
+            switch (format) {
+                case TextureBuffer::BC1:
+                    return 8;
+                case TextureBuffer::BC3:
+                case TextureBuffer::BC5:
+                case TextureBuffer::BC7:
+                    return 16;
+                default:
+                    throw std::runtime_error("Not a block compressed format");
+            }
+        }
+
+        /**
+         * @param format
+         * @param size
+         * @return The number of bytes required to store an image of the given size in the given format.
+         */
+        static size_t getDataSize(TextureBuffer::ColorFormat format, Vec2i size) {
+            size_t blocksX = (size.x + 3) / 4;
+            size_t blocksY = (size.y + 3) / 4;
+            return blocksX * blocksY * getBlockSize(format);
+        }
+
+        Vec2i getLevelSize(int level) const {
+            return {std::max(1, size.x >> level), std::max(1, size.y >> level)};
+        }
+    };
+}
+
+#endif //MANA_COMPRESSEDIMAGE_HPP
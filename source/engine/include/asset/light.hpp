@@ -20,6 +20,10 @@
 #ifndef MANA_LIGHT_HPP
 #define MANA_LIGHT_HPP
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "math/transform.hpp"
 
 #include "asset/asset.hpp"
@@ -60,6 +64,26 @@ namespace engine {
         float constant = 1;
         float linear = 0.09;
         float quadratic = 0.032;
+
+        bool castShadows = false;
+
+        //Directional: the view distance up to which shadows are rendered
+        //Point / Spot: the shadow range of lights without attenuation
+        float shadowDistance = 100;
+
+        /**
+         * @param threshold The attenuation below which the light is considered to have no visible effect
+         * @return The distance at which the attenuation of a point or spot light falls below the threshold
+         */
+        float getRange(float threshold = 1.0f / 256) const {
+            // Solve constant + linear * d + quadratic * d^2 = 1 / threshold
+            float c = constant - 1 / threshold;
+            if (quadratic > 0)
+                return (-linear + std::sqrt(linear * linear - 4 * quadratic * c)) / (2 * quadratic);
+            if (linear > 0)
+                return std::max(0.0f, -c / linear);
+            return std::numeric_limits<float>::infinity();
+        }
     };
 }
 
@@ -23,12 +23,24 @@
 #include <typeindex>
 
 #include "assetmanager.hpp"
+#include "texturestreamer.hpp"
 #include "asset/shader.hpp"
 #include "asset/texture.hpp"
+#include "asset/compressedimage.hpp"
+#include "asset/vertexpacking.hpp"
 
 #include "platform/graphics/renderallocator.hpp"
 
 namespace engine {
+    /**
+     * A mesh buffer in the VertexPacking::COMPACT layout and the parameters to dequantize its positions.
+     */
+    struct MANA_EXPORT PackedMeshBuffer {
+        std::unique_ptr<MeshBuffer> buffer;
+        Vec3f positionOffset;
+        Vec3f positionScale = Vec3f(1);
+    };
+
     /**
      * Handles allocation of render objects on the main thread.
      */
@@ -47,8 +59,16 @@ namespace engine {
                 throw std::runtime_error("Bundle reference counter underflow");
             auto ref = --objectRefCount[path];
             if (ref == 0) {
-                unloadObject<T>(path);
-                objects.erase(path);
+                // Each loaded render object holds one reference on the asset
+                if (objects.find(path) != objects.end()) {
+                    unloadObject<T>(path);
+                    objects.erase(path);
+                }
+                if (packedMeshes.find(path) != packedMeshes.end()) {
+                    assetManager.decrementRef(path);
+                    packedMeshes.erase(path);
+                }
+                textureStreamer.remove(path);
                 objectRefCount.erase(path);
             }
         }
@@ -61,6 +81,38 @@ namespace engine {
             return dynamic_cast<T &>(*objects.at(path));
         }
 
+        /**
+         * Get the mesh buffer of the mesh in the VertexPacking::COMPACT layout which can be drawn with instance buffers.
+         *
+         * Used by the passes which draw meshes with their own vertex shaders to reduce the vertex fetch bandwidth,
+         * the buffer returned by get<MeshBuffer> keeps the default layout for user shaders.
+         *
+         * @param path
+         * @return
+         */
+        PackedMeshBuffer &getPackedMesh(const AssetPath &path) {
+            auto it = packedMeshes.find(path);
+            if (it == packedMeshes.end()) {
+                auto packed = VertexPacking::pack(assetManager.getAsset<Mesh>(path), VertexPacking::COMPACT);
+                auto definition = packed.getDefinition();
+                definition.instanced = true;
+
+                PackedMeshBuffer buffer;
+                buffer.buffer = renderAllocator.createCustomMeshBuffer(definition);
+                buffer.positionOffset = packed.positionOffset;
+                buffer.positionScale = packed.positionScale;
+
+                // Released in decrementRef like the reference of a loaded render object
+                assetManager.incrementRef(path);
+                it = packedMeshes.emplace(path, std::move(buffer)).first;
+            }
+            return it->second;
+        }
+
+        TextureStreamer &getTextureStreamer() {
+            return textureStreamer;
+        }
+
     private:
         template<typename T>
         void loadObject(const AssetPath &path) {
@@ -91,7 +143,13 @@ namespace engine {
                                        assetManager.getAsset<Image<ColorRGBA>>(texture.images.at(i)));
                     }
                 } else {
-                    texbuf->upload(assetManager.getAsset<Image<ColorRGBA>>(texture.images.at(0)));
+                    auto &imagePath = texture.images.at(0);
+                    auto &bundle = assetManager.getBundle(imagePath.bundle);
+                    if (bundle.has<CompressedImage>(imagePath.asset)) {
+                        textureStreamer.add(path, *texbuf, bundle.get<CompressedImage>(imagePath.asset));
+                    } else {
+                        texbuf->upload(bundle.get<Image<ColorRGBA>>(imagePath.asset));
+                    }
                 }
 
                 objects[path] = std::move(texbuf);
@@ -116,7 +174,10 @@ namespace engine {
         RenderAllocator &renderAllocator;
 
         std::map<AssetPath, std::unique_ptr<RenderObject>> objects;
+        std::map<AssetPath, PackedMeshBuffer> packedMeshes;
         std::map<AssetPath, uint> objectRefCount;
+
+        TextureStreamer textureStreamer;
     };
 }
 
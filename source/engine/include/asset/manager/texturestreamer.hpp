@@ -0,0 +1,284 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_TEXTURESTREAMER_HPP
+#define MANA_TEXTURESTREAMER_HPP
+
+#include <map>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "asset/assetpath.hpp"
+#include "asset/compressedimage.hpp"
+
+#include "platform/graphics/texturebuffer.hpp"
+
+namespace engine {
+    /**
+     * Manages the resident mip levels of block compressed textures.
+     *
+     * Textures are made resident with their low resolution mip levels first.
+     * Each frame the passes report the projected size in pixels at which a texture is sampled
+     * and update() makes the required levels resident, while keeping the total size of the resident
+     * levels below the memory budget.
+     *
+     * Textures fall back to less detailed levels only after they were requested at a smaller size
+     * for a number of consecutive frames, so that textures which are briefly not drawn keep their levels.
+     * Dropped levels are released by reallocating the texture with the remaining levels,
+     * so the memory budget applies to the bytes actually allocated.
+     */
+    class MANA_EXPORT TextureStreamer {
+    public:
+        TextureStreamer() = default;
+
+        /**
+         * Register a texture and upload its low resolution mip levels.
+         *
+         * The image must stay valid until remove is called.
+         *
+         * @param path
+         * @param buffer
+         * @param image
+         */
+        void add(const AssetPath &path, TextureBuffer &buffer, const CompressedImage &image) {
+            Entry entry;
+            entry.buffer = &buffer;
+            entry.image = &image;
+            entry.lowLevel = getLowLevel(image);
+            if (enabled) {
+                entry.residentLevel = entry.lowLevel;
+            } else {
+                entry.residentLevel = 0;
+            }
+            buffer.uploadMipLevels(image, entry.residentLevel);
+            textures[path] = entry;
+        }
+
+        void remove(const AssetPath &path) {
+            textures.erase(path);
+        }
+
+        /**
+         * Report the projected size in pixels at which the texture is displayed in this frame.
+         *
+         * The largest requested size of a frame is used.
+         *
+         * @param path
+         * @param pixels
+         */
+        void request(const AssetPath &path, float pixels) {
+            auto it = textures.find(path);
+            if (it == textures.end())
+                return;
+            it->second.requestedPixels = std::max(it->second.requestedPixels, pixels);
+        }
+
+        /**
+         * Update the resident levels of all textures from the requests of the last frame and reset the requests.
+         *
+         * Must be called on the render thread.
+         */
+        void update() {
+            if (!enabled) {
+                for (auto &pair: textures) {
+                    setResidentLevel(pair.second, 0);
+                    pair.second.requestedPixels = 0;
+                }
+                return;
+            }
+
+            size_t totalSize = 0;
+            for (auto &pair: textures) {
+                auto &entry = pair.second;
+                entry.desiredLevel = getDesiredLevel(entry);
+                if (entry.desiredLevel > entry.residentLevel) {
+                    if (++entry.droppedFrames < hysteresis) {
+                        entry.desiredLevel = entry.residentLevel;
+                    }
+                } else {
+                    entry.droppedFrames = 0;
+                }
+                totalSize += getResidentSize(*entry.image, entry.desiredLevel);
+            }
+
+            // Drop the most detailed level of the texture which has the most texels per displayed pixel
+            // until the budget is met.
+            while (memoryBudget > 0 && totalSize > memoryBudget) {
+                Entry *candidate = nullptr;
+                float candidateRatio = 0;
+                for (auto &pair: textures) {
+                    auto &entry = pair.second;
+                    if (entry.desiredLevel >= entry.lowLevel)
+                        continue;
+                    auto size = entry.image->getLevelSize(entry.desiredLevel);
+                    float ratio = static_cast<float>(std::max(size.x, size.y)) / std::max(1.0f, entry.requestedPixels);
+                    if (candidate == nullptr || ratio > candidateRatio) {
+                        candidate = &entry;
+                        candidateRatio = ratio;
+                    }
+                }
+                if (candidate == nullptr)
+                    break;
+                totalSize -= CompressedImage::getDataSize(candidate->image->format,
+                                                          candidate->image->getLevelSize(candidate->desiredLevel));
+                candidate->desiredLevel++;
+            }
+
+            size_t uploadSize = 0;
+            for (auto &pair: textures) {
+                auto &entry = pair.second;
+                if (entry.desiredLevel > entry.residentLevel) {
+                    setResidentLevel(entry, entry.desiredLevel);
+                } else if (entry.desiredLevel < entry.residentLevel
+                           && (uploadBudget == 0 || uploadSize < uploadBudget)) {
+                    // Stream in one level per frame to spread the upload cost over multiple frames.
+                    int level = entry.residentLevel - 1;
+                    uploadSize += CompressedImage::getDataSize(entry.image->format, entry.image->getLevelSize(level));
+                    setResidentLevel(entry, level);
+                }
+                entry.requestedPixels = 0;
+            }
+        }
+
+        /**
+         * @return The total size in bytes of all resident mip levels, which are the allocated levels.
+         */
+        size_t getResidentSize() const {
+            size_t ret = 0;
+            for (auto &pair: textures) {
+                ret += getResidentSize(*pair.second.image, pair.second.residentLevel);
+            }
+            return ret;
+        }
+
+        /**
+         * @param bytes The maximum size of all resident mip levels, 0 = unlimited
+         */
+        void setMemoryBudget(size_t bytes) {
+            memoryBudget = bytes;
+        }
+
+        size_t getMemoryBudget() const {
+            return memoryBudget;
+        }
+
+        /**
+         * @param bytes The maximum number of bytes to upload per update, 0 = unlimited
+         */
+        void setUploadBudget(size_t bytes) {
+            uploadBudget = bytes;
+        }
+
+        size_t getUploadBudget() const {
+            return uploadBudget;
+        }
+
+        /**
+         * @param size The largest dimension of the levels which are made resident when a texture is added.
+         */
+        void setLowResolution(int size) {
+            lowResolution = size;
+        }
+
+        int getLowResolution() const {
+            return lowResolution;
+        }
+
+        /**
+         * If streaming is disabled all levels are kept resident.
+         *
+         * @param value
+         */
+        void setEnabled(bool value) {
+            enabled = value;
+        }
+
+        bool isEnabled() const {
+            return enabled;
+        }
+
+        /**
+         * @param frames The number of consecutive frames for which a texture must require less detailed levels
+         *                  before the resident levels are dropped.
+         */
+        void setHysteresis(int frames) {
+            hysteresis = frames;
+        }
+
+        int getHysteresis() const {
+            return hysteresis;
+        }
+
+    private:
+        struct Entry {
+            TextureBuffer *buffer = nullptr;
+            const CompressedImage *image = nullptr;
+            int lowLevel = 0;
+            int residentLevel = 0;
+            int desiredLevel = 0;
+            float requestedPixels = 0;
+            int droppedFrames = 0;
+        };
+
+        int getLowLevel(const CompressedImage &image) const {
+            int level = 0;
+            while (level < static_cast<int>(image.levels.size()) - 1) {
+                auto size = image.getLevelSize(level);
+                if (std::max(size.x, size.y) <= lowResolution)
+                    break;
+                level++;
+            }
+            return level;
+        }
+
+        static int getDesiredLevel(const Entry &entry) {
+            if (entry.requestedPixels <= 0)
+                return entry.lowLevel;
+            auto size = std::max(entry.image->size.x, entry.image->size.y);
+            auto level = static_cast<int>(std::floor(std::log2(static_cast<float>(size) / entry.requestedPixels)));
+            return std::clamp(level, 0, entry.lowLevel);
+        }
+
+        static size_t getResidentSize(const CompressedImage &image, int baseLevel) {
+            size_t ret = 0;
+            for (int i = baseLevel; i < static_cast<int>(image.levels.size()); i++) {
+                ret += CompressedImage::getDataSize(image.format, image.getLevelSize(i));
+            }
+            return ret;
+        }
+
+        static void setResidentLevel(Entry &entry, int level) {
+            if (entry.residentLevel == level)
+                return;
+            entry.buffer->uploadMipLevels(*entry.image, level);
+            entry.residentLevel = level;
+        }
+
+        std::map<AssetPath, Entry> textures;
+
+        bool enabled = true;
+        size_t memoryBudget = 0;
+        size_t uploadBudget = 0;
+        int lowResolution = 128;
+        int hysteresis = 60;
+    };
+}
+
+#endif //MANA_TEXTURESTREAMER_HPP
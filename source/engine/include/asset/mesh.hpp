@@ -21,9 +21,11 @@
 #define MANA_MESH_HPP
 
 #include <vector>
+#include <cmath>
 
 #include "math/vector3.hpp"
 #include "math/vector2.hpp"
+#include "math/bounds.hpp"
 #include "asset/vertex.hpp"
 
 namespace engine {
@@ -40,6 +42,10 @@ namespace engine {
         std::vector<Vertex> vertices;
         std::vector<uint> indices;
 
+        // The model space bounds of the vertex positions, computed by computeBounds
+        AABB bounds;
+        BoundingSphere boundingSphere;
+
         size_t polyCount() const {
             if (indexed)
                 return indices.size() / primitive;
@@ -47,6 +53,31 @@ namespace engine {
                 return vertices.size() / primitive;
         }
 
+        /**
+         * Compute the bounding box and sphere from the vertex positions.
+         *
+         * Has to be called again when the vertex positions are modified.
+         */
+        void computeBounds() {
+            bounds = {};
+            for (auto &vertex: vertices) {
+                bounds.extend(vertex.position());
+            }
+
+            if (bounds.empty()) {
+                boundingSphere = {};
+                return;
+            }
+
+            auto center = bounds.center();
+            float radius = 0;
+            for (auto &vertex: vertices) {
+                auto offset = vertex.position() - center;
+                radius = std::max(radius, offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+            }
+            boundingSphere = {center, std::sqrt(radius)};
+        }
+
         Mesh() = default;
 
         Mesh(bool indexed, Primitive primitive, std::vector<Vertex> vertices,
@@ -54,13 +85,19 @@ namespace engine {
                 indexed(indexed),
                 primitive(primitive),
                 vertices(std::move(vertices)),
-                indices(std::move(indices)) {}
+                indices(std::move(indices)) {
+            computeBounds();
+        }
 
         Mesh(Primitive primitive, std::vector<Vertex> vertices, std::vector<uint> indices) :
-                indexed(true), primitive(primitive), vertices(std::move(vertices)), indices(std::move(indices)) {}
+                indexed(true), primitive(primitive), vertices(std::move(vertices)), indices(std::move(indices)) {
+            computeBounds();
+        }
 
         Mesh(Primitive primitive, std::vector<Vertex> vertices) :
-                indexed(false), primitive(primitive), vertices(std::move(vertices)), indices() {}
+                indexed(false), primitive(primitive), vertices(std::move(vertices)), indices() {
+            computeBounds();
+        }
     };
 }
 
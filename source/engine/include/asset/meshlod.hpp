@@ -0,0 +1,66 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_MESHLOD_HPP
+#define MANA_MESHLOD_HPP
+
+#include <string>
+#include <vector>
+
+namespace engine {
+    /**
+     * The level of detail chain of a mesh.
+     *
+     * The chain is stored in the bundle under the name of the source mesh,
+     * the simplified meshes are stored in the same bundle with the names returned by getLevelName.
+     */
+    struct MANA_EXPORT MeshLod {
+        float radius = 0; // The radius of the bounding sphere of the source mesh around the origin
+        std::vector<float> errors; // The simplification error of each level relative to the radius, starting at level 1
+
+        static std::string getLevelName(const std::string &mesh, int level) {
+            if (level == 0)
+                return mesh;
+            return mesh + "_lod" + std::to_string(level);
+        }
+
+        int getLevelCount() const {
+            return static_cast<int>(errors.size()) + 1;
+        }
+
+        /**
+         * Select the lowest detail level whose error is not visible at the given size.
+         *
+         * @param projectedSize The projected diameter of the bounding sphere in pixels
+         * @param maxPixelError The maximum allowed error in pixels
+         * @return The selected level, 0 = source mesh
+         */
+        int selectLevel(float projectedSize, float maxPixelError = 1) const {
+            int ret = 0;
+            for (size_t i = 0; i < errors.size(); i++) {
+                if (errors[i] * projectedSize / 2 > maxPixelError)
+                    break;
+                ret = static_cast<int>(i) + 1;
+            }
+            return ret;
+        }
+    };
+}
+
+#endif //MANA_MESHLOD_HPP
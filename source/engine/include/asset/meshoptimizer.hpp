@@ -0,0 +1,99 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_MESHOPTIMIZER_HPP
+#define MANA_MESHOPTIMIZER_HPP
+
+#include "asset/mesh.hpp"
+
+namespace engine {
+    /**
+     * Offline optimizations of triangle meshes which reorder the index and vertex data for faster rendering.
+     *
+     * The optimizations do not change the rendered result, they only change the order of the triangles and vertices.
+     */
+    namespace MeshOptimizer {
+        struct MANA_EXPORT Statistics {
+            size_t verticesBefore = 0;
+            size_t verticesAfter = 0;
+            float acmrBefore = 0; // The average cache miss ratio before optimization
+            float acmrAfter = 0; // The average cache miss ratio after optimization
+        };
+
+        /**
+         * Compute the average cache miss ratio (Transformed vertices per triangle) of the mesh
+         * for a simulated fifo post transform vertex cache.
+         *
+         * @param mesh
+         * @param cacheSize
+         * @return The ratio in the range 0.5 (Best case) - 3 (Every vertex is transformed for each triangle)
+         */
+        MANA_EXPORT float computeACMR(const Mesh &mesh, int cacheSize = 16);
+
+        /**
+         * Merge vertices with identical attributes and convert the mesh to an indexed mesh.
+         *
+         * @param mesh
+         * @return The number of removed vertices
+         */
+        MANA_EXPORT size_t weldVertices(Mesh &mesh);
+
+        /**
+         * Reorder the triangles to maximize the post transform vertex cache hit rate.
+         *
+         * Implements the linear speed vertex cache optimization by Tom Forsyth.
+         *
+         * @param mesh An indexed triangle mesh
+         */
+        MANA_EXPORT void optimizeVertexCache(Mesh &mesh);
+
+        /**
+         * Reorder clusters of triangles to draw outward facing clusters first, which reduces overdraw.
+         *
+         * The mesh should be cache optimized first, the clusters are split at the points where the
+         * vertex cache is flushed and at points where the local cache miss ratio is at most threshold times
+         * the cache miss ratio of the cluster.
+         *
+         * @param mesh An indexed triangle mesh
+         * @param threshold The allowed vertex cache degradation, 1 = No degradation
+         */
+        MANA_EXPORT void optimizeOverdraw(Mesh &mesh, float threshold = 1.05f);
+
+        /**
+         * Reorder the vertices in the order of first use by the indices to improve the vertex fetch locality.
+         *
+         * Vertices which are not referenced by any index are removed.
+         *
+         * @param mesh An indexed mesh
+         */
+        MANA_EXPORT void optimizeVertexFetch(Mesh &mesh);
+
+        /**
+         * Run all optimizations on the mesh.
+         *
+         * Meshes which are not triangle meshes are returned unchanged.
+         *
+         * @param mesh
+         * @return The statistics of the optimization
+         */
+        MANA_EXPORT Statistics optimize(Mesh &mesh);
+    }
+}
+
+#endif //MANA_MESHOPTIMIZER_HPP
@@ -0,0 +1,73 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_MESHSIMPLIFIER_HPP
+#define MANA_MESHSIMPLIFIER_HPP
+
+#include <vector>
+
+#include "asset/mesh.hpp"
+#include "asset/meshlod.hpp"
+
+namespace engine {
+    /**
+     * Mesh simplification by quadric error metric edge collapses (Garland and Heckbert).
+     *
+     * Vertices are only collapsed onto existing vertices so no vertex attributes have to be interpolated.
+     * Vertices on open borders and attribute seams are never removed which keeps the simplified mesh free of cracks.
+     */
+    namespace MeshSimplifier {
+        struct MANA_EXPORT LodTarget {
+            float ratio; // The target triangle count relative to the source mesh
+            float error; // The maximum simplification error relative to the mesh radius
+        };
+
+        /**
+         * The default lod targets used by the importer.
+         */
+        MANA_EXPORT std::vector<LodTarget> getDefaultTargets();
+
+        /**
+         * Simplify the mesh until the target triangle count is reached or no collapse below the target error remains.
+         *
+         * @param mesh An indexed triangle mesh
+         * @param targetTriangles
+         * @param targetError The maximum error in world units
+         * @param resultError Is set to the largest error of the performed collapses in world units
+         * @return The simplified mesh
+         */
+        MANA_EXPORT Mesh simplify(const Mesh &mesh, size_t targetTriangles, float targetError, float *resultError = nullptr);
+
+        /**
+         * Generate a lod chain for the mesh.
+         *
+         * Generation stops at the first target which does not reduce the triangle count.
+         *
+         * @param mesh An indexed triangle mesh
+         * @param targets
+         * @param levels The simplified meshes starting at level 1
+         * @return The lod chain description
+         */
+        MANA_EXPORT MeshLod generateLods(const Mesh &mesh,
+                                         const std::vector<LodTarget> &targets,
+                                         std::vector<Mesh> &levels);
+    }
+}
+
+#endif //MANA_MESHSIMPLIFIER_HPP
@@ -27,6 +27,8 @@
 #include "asset/shader.hpp"
 #include "asset/assethandle.hpp"
 
+#include "math/bounds.hpp"
+
 #include "platform/graphics/rendercommand.hpp"
 
 namespace engine {
@@ -45,6 +47,10 @@ namespace engine {
             AssetHandle<Mesh> mesh;
             AssetHandle<Material> material;
 
+            // The model space bounds of the mesh used for culling, empty bounds are never culled
+            AABB bounds;
+            BoundingSphere boundingSphere;
+
             bool outline = false;
             ColorRGBA outlineColor;
             float outlineScale = 1.1f;
@@ -57,6 +63,34 @@ namespace engine {
             AssetHandle<Shader> shader;
             std::vector<AssetHandle<Texture>> textures;
             RenderProperties properties;
+
+            // The model space bounds of the mesh used for culling, empty bounds are never culled
+            AABB bounds;
+            BoundingSphere boundingSphere;
+        };
+
+        // A mesh which casts shadows, collected independently of the view frustum
+        struct MANA_EXPORT ShadowCasterNode {
+            int id = -1; // Identifies the caster across frames so that the shadow maps can be cached
+            Transform transform;
+            AssetHandle<Mesh> mesh;
+
+            // The model space bounds of the mesh, casters with empty bounds are included in every shadow map
+            AABB bounds;
+        };
+
+        // A shadow map in the shadow atlas, filled by the ShadowPass
+        struct MANA_EXPORT ShadowTile {
+            Mat4f matrix; // Maps world space positions to atlas texture coordinates and depth
+            Vec4f bounds; // The atlas texture coordinate rectangle of the tile as (min x, min y, max x, max y)
+            float texelSize; // The world space size of a texel, at unit distance from the light for perspective tiles
+            bool perspective;
+        };
+
+        // A run of deferred draw nodes sharing mesh and material which is drawn with a single instanced command
+        struct MANA_EXPORT DeferredBatch {
+            size_t offset; // The index of the first instance in deferredInstances and deferredBatchNodes
+            size_t count;
         };
 
         Camera camera;
@@ -66,6 +100,20 @@ namespace engine {
         std::vector<DeferredDrawNode> deferred;
         std::vector<ForwardDrawNode> forward;
 
+        // The batches of the deferred nodes, filled by the DeferredRenderer before the passes are run
+        std::vector<DeferredBatch> deferredBatches;
+        std::vector<size_t> deferredBatchNodes; // The deferred node indices in instance order
+        InstanceBuffer *deferredInstances = nullptr; // The model matrices of the deferred nodes in instance order
+
+        std::vector<ShadowCasterNode> shadowCasters;
+
+        // The shadow maps of the lights, filled by the ShadowPass before the shading passes are run.
+        // A light with shadows references its first tile, directional cascades and point light cube faces
+        // (+x, -x, +y, -y, +z, -z) occupy consecutive tiles.
+        std::vector<ShadowTile> shadowTiles;
+        std::vector<int> lightShadows; // The index of the first tile of each light or -1
+        std::vector<float> shadowCascadeSplits; // The view depths at which the directional cascades end
+
         Skybox skybox;
     };
 }
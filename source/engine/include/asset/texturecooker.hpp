@@ -0,0 +1,75 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_TEXTURECOOKER_HPP
+#define MANA_TEXTURECOOKER_HPP
+
+#include <string>
+#include <vector>
+
+#include "asset/image.hpp"
+#include "asset/compressedimage.hpp"
+
+namespace engine {
+    /**
+     * Offline conversion of source images to gpu ready block compressed images with precomputed mip chains.
+     *
+     * The output is intended to be written with AssetExporter::exportCompressedImage at build time so that
+     * no compression or mipmap generation has to happen when the texture is loaded.
+     */
+    namespace TextureCooker {
+        /**
+         * Generate the full mip chain of the image using a 2x2 box filter.
+         *
+         * @param image
+         * @return The mip levels ordered from largest to smallest, the first element is a copy of the passed image.
+         */
+        MANA_EXPORT std::vector<Image<ColorRGBA>> generateMipChain(const Image<ColorRGBA> &image);
+
+        /**
+         * Compress the image and optionally its mip chain.
+         *
+         * @param image
+         * @param format One of BC1, BC3, BC5 or BC7
+         * @param mipmaps If true the full mip chain is generated and compressed, otherwise only level 0 is stored.
+         * @return
+         */
+        MANA_EXPORT CompressedImage cook(const Image<ColorRGBA> &image,
+                                         TextureBuffer::ColorFormat format,
+                                         bool mipmaps = true);
+
+        /**
+         * Copy the files of the source directory recursively to the output directory and replace the images
+         * with the cooked images in the ctex format.
+         *
+         * The cooked images keep the path of their source image so that references to them stay valid,
+         * the importer detects the ctex format independently of the file extension.
+         *
+         * @param sourceDirectory
+         * @param outputDirectory
+         * @param format The block compressed format of the cooked images
+         * @return The number of cooked images
+         */
+        MANA_EXPORT size_t cookDirectory(const std::string &sourceDirectory,
+                                         const std::string &outputDirectory,
+                                         TextureBuffer::ColorFormat format = TextureBuffer::BC7);
+    }
+}
+
+#endif //MANA_TEXTURECOOKER_HPP
@@ -0,0 +1,113 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_VERTEXPACKING_HPP
+#define MANA_VERTEXPACKING_HPP
+
+#include <cstdint>
+
+#include "asset/mesh.hpp"
+
+#include "platform/graphics/renderallocator.hpp"
+
+namespace engine {
+    /**
+     * Conversion of meshes into compact quantized vertex layouts for drawing with custom mesh buffers.
+     *
+     * The shader side decoding functions are available in the "vertexpacking.glsl" shader include.
+     */
+    namespace VertexPacking {
+        enum Layout {
+            /**
+             * 16 Bytes per vertex, for geometry which only requires position and uv such as screen quads.
+             *
+             *  layout (location = 0) in vec3 position; // float3
+             *  layout (location = 2) in vec2 uv; // half2
+             *
+             * The locations match the default mesh buffer layout.
+             */
+            POSITION_UV,
+
+            /**
+             * 20 Bytes per vertex.
+             *
+             *  layout (location = 0) in vec4 position; // unorm16x4, xyz quantized to the mesh bounds, w = bitangent sign
+             *  layout (location = 1) in vec2 normal; // snorm16x2, octahedral encoded
+             *  layout (location = 2) in vec2 uv; // half2
+             *  layout (location = 3) in vec2 tangent; // snorm16x2, octahedral encoded
+             *
+             * The position is dequantized with the per mesh position offset and scale,
+             * the bitangent is reconstructed as cross(normal, tangent) * (position.w * 2 - 1).
+             *
+             * The mesh assets are drawn in this layout by the deferred geometry and shadow passes,
+             * see AssetRenderManager::getPackedMesh.
+             */
+            COMPACT
+        };
+
+        struct MANA_EXPORT PackedMesh {
+            Layout layout = COMPACT;
+            Mesh::Primitive primitive = Mesh::TRI;
+
+            std::vector<char> data;
+            std::vector<RenderAllocator::CustomMeshDefinition::Attribute> attributes;
+
+            bool indexed = false;
+            std::vector<uint> indices;
+
+            // The dequantized position is positionOffset + position.xyz * positionScale
+            Vec3f positionOffset;
+            Vec3f positionScale = Vec3f(1);
+
+            size_t getVertexCount() const;
+
+            /**
+             * @return The definition to pass to RenderAllocator::createCustomMeshBuffer, points into the data of this mesh.
+             */
+            RenderAllocator::CustomMeshDefinition getDefinition();
+        };
+
+        MANA_EXPORT size_t getVertexSize(Layout layout);
+
+        /**
+         * Convert the value to an IEEE 754 half precision float with round to nearest even.
+         */
+        MANA_EXPORT uint16_t floatToHalf(float value);
+
+        MANA_EXPORT float halfToFloat(uint16_t value);
+
+        /**
+         * Map the unit vector onto the octahedron and unfold it into the square [-1, 1].
+         */
+        MANA_EXPORT Vec2f octEncode(const Vec3f &vector);
+
+        MANA_EXPORT Vec3f octDecode(const Vec2f &value);
+
+        /**
+         * Pack the vertices of the mesh into the given layout.
+         *
+         * @param mesh
+         * @param layout
+         * @return
+         */
+        MANA_EXPORT PackedMesh pack(const Mesh &mesh, Layout layout = COMPACT);
+    }
+}
+
+#endif //MANA_VERTEXPACKING_HPP
@@ -30,6 +30,7 @@
 
 #include "render/deferred/passes/skyboxpass.hpp"
 #include "render/deferred/passes/prepass.hpp"
+#include "render/deferred/passes/shadowpass.hpp"
 #include "render/deferred/passes/phongshadepass.hpp"
 
 namespace engine {
@@ -51,6 +52,7 @@ namespace engine {
             ren = std::make_unique<DeferredRenderer>(*renderDevice, *assetRenderManager);
             ren->addRenderPass(std::make_unique<SkyboxPass>(*renderDevice));
             ren->addRenderPass(std::make_unique<PrePass>(*renderDevice));
+            ren->addRenderPass(std::make_unique<ShadowPass>(*renderDevice));
             ren->addRenderPass(std::make_unique<PhongShadePass>(*renderDevice));
             ren->getCompositor().setLayers({Compositor::Layer("Skybox", SkyboxPass::COLOR, ""),
                                             Compositor::Layer("Phong", PhongShadePass::COMBINED, "")});
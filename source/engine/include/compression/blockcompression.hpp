@@ -0,0 +1,67 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_BLOCKCOMPRESSION_HPP
+#define MANA_BLOCKCOMPRESSION_HPP
+
+#include <vector>
+
+#include "asset/image.hpp"
+#include "platform/graphics/texturebuffer.hpp"
+
+namespace engine {
+    /**
+     * Encoders for the gpu block compression formats.
+     *
+     * The encoders favor speed over quality, the endpoints of each block are fitted along the principal axis of the block colors.
+     * Images with dimensions which are not a multiple of 4 are padded by repeating the edge pixels.
+     */
+    namespace BlockCompression {
+        /**
+         * Encode the rgb channels of the image as BC1, alpha is discarded.
+         */
+        MANA_EXPORT std::vector<char> compressBC1(const Image<ColorRGBA> &image);
+
+        /**
+         * Encode the image as BC3 with interpolated alpha.
+         */
+        MANA_EXPORT std::vector<char> compressBC3(const Image<ColorRGBA> &image);
+
+        /**
+         * Encode the red and green channels of the image as BC5, suitable for tangent space normal maps.
+         */
+        MANA_EXPORT std::vector<char> compressBC5(const Image<ColorRGBA> &image);
+
+        /**
+         * Encode the image as BC7 using only mode 6 (Single subset rgba with 4 bit indices).
+         */
+        MANA_EXPORT std::vector<char> compressBC7(const Image<ColorRGBA> &image);
+
+        /**
+         * Encode the image in the given block compressed format.
+         *
+         * @param image
+         * @param format One of BC1, BC3, BC5 or BC7
+         * @return The encoded blocks in row major order
+         */
+        MANA_EXPORT std::vector<char> compress(const Image<ColorRGBA> &image, TextureBuffer::ColorFormat format);
+    }
+}
+
+#endif //MANA_BLOCKCOMPRESSION_HPP
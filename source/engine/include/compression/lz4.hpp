@@ -0,0 +1,46 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_LZ4_HPP
+#define MANA_LZ4_HPP
+
+#include <string>
+#include <vector>
+
+namespace engine {
+    /**
+     * LZ4 block compression, optimized for decompression speed.
+     *
+     * The compressed blocks do not store the decompressed size, it has to be passed to decompress.
+     */
+    namespace LZ4 {
+        /**
+         * Compress the data with the high compression mode, which does not affect the decompression speed.
+         */
+        std::vector<char> compress(const char *data, size_t length);
+
+        std::vector<char> decompress(const char *data, size_t length, size_t decompressedSize);
+
+        std::vector<char> compress(const std::vector<char> &data);
+
+        std::vector<char> decompress(const std::vector<char> &data, size_t decompressedSize);
+    }
+}
+
+#endif //MANA_LZ4_HPP
@@ -0,0 +1,79 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_ZSTD_HPP
+#define MANA_ZSTD_HPP
+
+#include <string>
+#include <vector>
+
+namespace engine {
+    /**
+     * Zstandard compression with optional trained dictionaries for small inputs.
+     */
+    namespace ZStd {
+        static const int DEFAULT_LEVEL = 15;
+
+        std::vector<char> compress(const char *data, size_t length, int level = DEFAULT_LEVEL);
+
+        std::vector<char> decompress(const char *data, size_t length);
+
+        std::vector<char> compress(const std::vector<char> &data, int level = DEFAULT_LEVEL);
+
+        std::vector<char> decompress(const std::vector<char> &data);
+
+        /**
+         * Train a dictionary from the samples.
+         *
+         * @param samples
+         * @param capacity The maximum size of the dictionary in bytes
+         * @return The dictionary or an empty vector if the samples are not suitable for training.
+         */
+        std::vector<char> trainDictionary(const std::vector<std::vector<char>> &samples, size_t capacity);
+
+        /**
+         * A digested dictionary which can be used concurrently from multiple threads.
+         */
+        class MANA_EXPORT Dictionary {
+        public:
+            explicit Dictionary(const std::vector<char> &data, int level = DEFAULT_LEVEL);
+
+            ~Dictionary();
+
+            Dictionary(const Dictionary &) = delete;
+
+            Dictionary &operator=(const Dictionary &) = delete;
+
+            std::vector<char> compress(const char *data, size_t length) const;
+
+            std::vector<char> decompress(const char *data, size_t length) const;
+
+            const std::vector<char> &getData() const {
+                return data;
+            }
+
+        private:
+            std::vector<char> data;
+            void *cdict;
+            void *ddict;
+        };
+    }
+}
+
+#endif //MANA_ZSTD_HPP
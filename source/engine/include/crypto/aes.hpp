@@ -38,6 +38,28 @@ namespace engine {
         std::vector<char> encrypt(const Key &key, const InitializationVector &iv, const std::vector<char> &plaintext);
 
         std::vector<char> decrypt(const Key &key, const InitializationVector &iv, const std::vector<char> &ciphertext);
+
+        /**
+         * Encrypt or decrypt the data in place using AES in counter mode.
+         *
+         * The key stream is positioned at offset bytes from the beginning of the ciphertext,
+         * which allows any range of a ciphertext to be decrypted independently of the preceding bytes.
+         * The ciphertext has the same length as the plaintext.
+         * Large buffers are processed in parallel on the engine thread pool.
+         *
+         * @param key
+         * @param iv The initial counter block
+         * @param offset The offset of data in the ciphertext
+         * @param data
+         * @param length
+         * @param parallel False when the caller already runs in parallel
+         */
+        void ctr(const Key &key,
+                 const InitializationVector &iv,
+                 size_t offset,
+                 char *data,
+                 size_t length,
+                 bool parallel = true);
     }
 }
 
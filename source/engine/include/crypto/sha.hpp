@@ -22,9 +22,27 @@
 
 #include <string>
 #include <vector>
+#include <array>
 
 namespace engine {
     namespace SHA {
+        static const size_t SHA256_DIGEST_SIZE = 32;
+
+        typedef std::array<char, SHA256_DIGEST_SIZE> Digest256;
+
+        /**
+         * @return The binary sha256 digest of the data
+         */
+        Digest256 sha256Digest(const char *data, size_t length);
+
+        /**
+         * @return The binary sha256 digest of the tag byte followed by the data, for domain separated hashing
+         */
+        Digest256 sha256Digest(char tag, const char *data, size_t length);
+
+        /**
+         * @return The upper case hex encoded sha256 digest of the data
+         */
         std::string sha256(const char *data, size_t length);
 
         std::string sha256(const std::string &data);
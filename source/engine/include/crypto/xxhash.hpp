@@ -0,0 +1,47 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_XXHASH_HPP
+#define MANA_XXHASH_HPP
+
+#include <array>
+#include <cstddef>
+
+namespace engine {
+    /**
+     * Non cryptographic hashing, for integrity checks where speed matters more than tamper resistance.
+     */
+    namespace XXHash {
+        static const size_t XXH3_128_DIGEST_SIZE = 16;
+
+        typedef std::array<char, XXH3_128_DIGEST_SIZE> Digest128;
+
+        /**
+         * @return The 128 bit xxh3 digest of the data in canonical (big endian) byte order
+         */
+        Digest128 xxh3(const char *data, size_t length);
+
+        /**
+         * @return The 128 bit xxh3 digest of the tag byte followed by the data, for domain separated hashing
+         */
+        Digest128 xxh3(char tag, const char *data, size_t length);
+    }
+}
+
+#endif //MANA_XXHASH_HPP
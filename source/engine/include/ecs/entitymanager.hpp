@@ -59,6 +59,10 @@ namespace engine {
             return entityNamesReverse.at(entity);
         }
 
+        bool hasName(const Entity &entity) const {
+            return entityNamesReverse.find(entity) != entityNamesReverse.end();
+        }
+
         Entity getByName(const std::string &name) {
             return entityNames.at(name);
         }
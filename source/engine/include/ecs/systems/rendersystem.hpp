@@ -26,9 +26,12 @@
 #include "ecs/system.hpp"
 #include "ecs/components/meshrendercomponent.hpp"
 #include "ecs/components/skyboxcomponent.hpp"
+#include "ecs/components/transformcomponent.hpp"
+#include "ecs/components/lightcomponent.hpp"
 #include "render/deferred/deferredrenderer.hpp"
 #include "io/archive.hpp"
 #include "asset/assetimporter.hpp"
+#include "math/dynamicbvh.hpp"
 
 #include "platform/display/window.hpp"
 
@@ -39,7 +42,9 @@ namespace engine {
 
     class MANA_EXPORT RenderSystem : public System,
                                      ComponentPool<MeshRenderComponent>::Listener,
-                                     ComponentPool<SkyboxComponent>::Listener {
+                                     ComponentPool<SkyboxComponent>::Listener,
+                                     ComponentPool<TransformComponent>::Listener,
+                                     ComponentPool<LightComponent>::Listener {
     public:
         RenderSystem(RenderTarget &screen,
                      RenderDevice &device,
@@ -59,6 +64,30 @@ namespace engine {
 
         size_t getPolyCount() const { return polyCount; }
 
+        /**
+         * @return The number of draw nodes removed by frustum culling in the last update
+         */
+        size_t getCulledCount() const { return culledCount; }
+
+        /**
+         * @param pixels The maximum simplification error in pixels when selecting the mesh level of detail
+         */
+        void setLodPixelError(float pixels) { lodPixelError = pixels; }
+
+        float getLodPixelError() const { return lodPixelError; }
+
+        /**
+         * The world space bounds of the enabled mesh render components, the user data of a proxy is the entity id.
+         *
+         * The tree is brought up to date with the transform changes at the start of each update.
+         */
+        const DynamicBVH &getMeshBVH() const { return meshBVH; }
+
+        /**
+         * The world space bounds of the enabled point and spot lights, the user data of a proxy is the entity id.
+         */
+        const DynamicBVH &getLightBVH() const { return lightBVH; }
+
         template<typename T>
         T &getRenderPass() {
             return ren->getRenderPass<T>();
@@ -81,6 +110,27 @@ namespace engine {
                                const SkyboxComponent &oldValue,
                                const SkyboxComponent &newValue) override;
 
+        void onComponentCreate(const Entity &entity, const TransformComponent &component) override;
+
+        void onComponentDestroy(const Entity &entity, const TransformComponent &component) override;
+
+        void onComponentUpdate(const Entity &entity,
+                               const TransformComponent &oldValue,
+                               const TransformComponent &newValue) override;
+
+        void onComponentCreate(const Entity &entity, const LightComponent &component) override;
+
+        void onComponentDestroy(const Entity &entity, const LightComponent &component) override;
+
+        void onComponentUpdate(const Entity &entity,
+                               const LightComponent &oldValue,
+                               const LightComponent &newValue) override;
+
+        // Mark the bounds of the entity and its children for update
+        void markDirty(const Entity &entity);
+
+        void updateBounds(const Entity &entity);
+
         std::unique_ptr<DeferredRenderer> ren;
 
         RenderDevice &device;
@@ -91,6 +141,19 @@ namespace engine {
         AssetRenderManager assetRenderManager;
 
         size_t polyCount{};
+        size_t culledCount{};
+
+        float lodPixelError = 1;
+
+        EntityManager *entityManager = nullptr;
+
+        DynamicBVH meshBVH;
+        DynamicBVH lightBVH;
+        std::map<Entity, int> meshProxies;
+        std::map<Entity, int> lightProxies;
+        std::set<Entity> unboundedMeshes; // Enabled meshes without bounds which are never culled
+        std::set<Entity> dirtyEntities;
+        std::map<std::string, std::set<Entity>> childEntities; // The entities by the name of their parent
     };
 }
 
@@ -95,6 +95,9 @@
 #include "platform/graphics/shadercompiler.hpp"
 #include "platform/graphics/renderer.hpp"
 #include "platform/graphics/meshbuffer.hpp"
+#include "platform/graphics/instancebuffer.hpp"
+#include "platform/graphics/shaderbuffer.hpp"
+#include "platform/graphics/storagebuffer.hpp"
 #include "platform/graphics/texturebuffer.hpp"
 #include "platform/graphics/shaderlanguage.hpp"
 #include "platform/graphics/shaderstage.hpp"
@@ -115,11 +118,17 @@
 #include "math/matrix.hpp"
 #include "math/rectangle.hpp"
 #include "math/vector4.hpp"
+#include "math/bounds.hpp"
+#include "math/frustum.hpp"
+#include "math/dynamicbvh.hpp"
 #include "io/message.hpp"
 #include "io/archive.hpp"
 #include "io/protocol.hpp"
 #include "io/protocol/jsonprotocol.hpp"
 #include "io/archive/pakarchive.hpp"
+#include "io/archive/layeredarchive.hpp"
+#include "io/memorystreambuf.hpp"
+#include "io/pakbuilder.hpp"
 #include "io/archive/directoryarchive.hpp"
 #include "crypto/aes.hpp"
 #include "crypto/sha.hpp"
@@ -141,6 +150,9 @@
 #include "render/deferred/passes/debugpass.hpp"
 #include "render/forward/forwardrenderer.hpp"
 #include "render/shader/shaderinclude.hpp"
+#include "render/frustumculling.hpp"
+#include "render/drawsort.hpp"
+#include "render/lightclustering.hpp"
 #include "asset/assetbundle.hpp"
 #include "asset/skybox.hpp"
 #include "asset/assetexporter.hpp"
@@ -22,6 +22,8 @@
 
 #include <iostream>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace engine {
     /**
@@ -34,6 +36,16 @@ namespace engine {
         virtual bool exists(const std::string &name) = 0;
 
         virtual std::unique_ptr<std::istream> open(const std::string &name) = 0;
+
+        /**
+         * List the entries of archives with a fixed set of entries.
+         *
+         * @param names The entry names are appended
+         * @return False if the archive does not list its entries, eg. because they can change at any time
+         */
+        virtual bool listEntries(std::vector<std::string> &names) {
+            return false;
+        }
     };
 }
 
@@ -0,0 +1,78 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_LAYEREDARCHIVE_HPP
+#define MANA_LAYEREDARCHIVE_HPP
+
+#include <vector>
+#include <unordered_map>
+
+#include "io/archive.hpp"
+
+namespace engine {
+    /**
+     * An archive which mounts several archives on top of each other.
+     *
+     * Entries of archives with a higher priority hide the entries with the same name of archives with a lower priority,
+     * which allows shipping a patch pak containing only the changed entries (See PakBuilder::removeUnchanged)
+     * or overriding pak entries with a directory during development.
+     *
+     * The entries of archives which list their entries (eg. PakArchive) are merged into a single index
+     * when mounting, so lookups only query the archives which cannot list their entries.
+     *
+     * Mounting is not thread safe, exists and open may be called concurrently if the mounted archives allow it.
+     */
+    class MANA_EXPORT LayeredArchive : public Archive {
+    public:
+        LayeredArchive() = default;
+
+        ~LayeredArchive() override = default;
+
+        /**
+         * Mount the archive.
+         *
+         * @param archive
+         * @param priority Archives with a higher priority are searched first, archives with equal priority
+         * are searched in reverse mount order so that later mounted archives override earlier ones.
+         */
+        void mount(std::unique_ptr<Archive> archive, int priority = 0);
+
+        bool exists(const std::string &name) override;
+
+        std::unique_ptr<std::istream> open(const std::string &name) override;
+
+        bool listEntries(std::vector<std::string> &names) override;
+
+    private:
+        struct Layer {
+            std::unique_ptr<Archive> archive;
+            int priority;
+            bool indexed;
+        };
+
+        void rebuildIndex();
+
+        Archive *find(const std::string &name);
+
+        std::vector<Layer> layers; // Sorted by descending priority
+        std::unordered_map<std::string, size_t> index; // The first indexed layer containing the entry
+    };
+}
+
+#endif //MANA_LAYEREDARCHIVE_HPP
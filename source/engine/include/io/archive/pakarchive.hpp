@@ -22,7 +22,11 @@
 
 #include <fstream>
 #include <vector>
+#include <string>
+#include <set>
+#include <unordered_map>
 #include <mutex>
+#include <atomic>
 
 #include "io/archive.hpp"
 #include "io/pak.hpp"
@@ -39,16 +43,86 @@ namespace engine {
                             const AES::Key &key = {},
                             const AES::InitializationVector &iv = {});
 
+        /**
+         * Open the pak from the ordered chunk files.
+         *
+         * The chunk files are read with positional reads, which allows concurrent open calls to read
+         * and decompress different entries without blocking each other.
+         *
+         * @param paths
+         * @param verifyHashes
+         * @param key
+         * @param iv
+         */
+        explicit PakArchive(const std::vector<std::string> &paths,
+                            bool verifyHashes = true,
+                            const AES::Key &key = {},
+                            const AES::InitializationVector &iv = {});
+
         ~PakArchive() override = default;
 
         bool exists(const std::string &path) override;
 
         std::unique_ptr<std::istream> open(const std::string &path) override;
 
+        bool listEntries(std::vector<std::string> &names) override;
+
+        const Pak &getPak() const {
+            return pak;
+        }
+
+        /**
+         * Start recording the order in which entries are opened, each path is recorded at its first access.
+         *
+         * The recorded trace can be passed to PakBuilder::setOrder to store entries in the order they are loaded
+         * and to setReadAhead of the archive opening the rebuilt pak.
+         */
+        void startTrace();
+
+        /**
+         * Stop recording and return the recorded access order.
+         *
+         * @return
+         */
+        std::vector<std::string> stopTrace();
+
+        /**
+         * Prefetch the entries which are expected to be opened next.
+         *
+         * When an entry contained in the trace is opened the following entries of the trace are prefetched,
+         * which turns the loading of entries stored in trace order into sequential reads ahead of the requests.
+         *
+         * @param trace The access order recorded in a previous session
+         * @param count The number of entries to prefetch ahead of the opened entry, 0 disables read ahead
+         *
+         * Must not be called concurrently with open.
+         */
+        void setReadAhead(std::vector<std::string> trace, size_t count = 8);
+
+        /**
+         * Write the trace as one path per line.
+         */
+        static void writeTrace(std::ostream &stream, const std::vector<std::string> &trace);
+
+        static std::vector<std::string> readTrace(std::istream &stream);
+
     private:
-        std::mutex mutex;
+        void recordAccess(const std::string &path);
+
+        void readAhead(const std::string &path);
+
         Pak pak;
         bool verifyHashes;
+
+        std::atomic<bool> tracing{false};
+        std::mutex traceMutex;
+        std::vector<std::string> trace;
+        std::set<std::string> tracedPaths;
+
+        std::vector<std::string> readAheadTrace;
+        std::unordered_map<std::string, size_t> readAheadIndex;
+        size_t readAheadCount = 0;
+        std::atomic<size_t> prefetchedEnd{0}; // The trace index following the last prefetched entry
     };
 }
 
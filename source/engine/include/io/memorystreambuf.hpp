@@ -0,0 +1,74 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_MEMORYSTREAMBUF_HPP
+#define MANA_MEMORYSTREAMBUF_HPP
+
+#include <streambuf>
+#include <istream>
+#include <vector>
+
+namespace engine {
+    /**
+     * A seekable read only stream buffer over a contiguous range of bytes.
+     *
+     * The whole range is exposed as the get area, reads are served without virtual calls per character and
+     * without copying the data into an intermediate buffer.
+     * The data is either borrowed, in which case it has to outlive the buffer, or owned by the buffer.
+     */
+    class MANA_EXPORT MemoryStreamBuf : public std::streambuf {
+    public:
+        MemoryStreamBuf(const char *data, size_t size);
+
+        explicit MemoryStreamBuf(std::vector<char> data);
+
+        MemoryStreamBuf(const MemoryStreamBuf &) = delete;
+
+        MemoryStreamBuf &operator=(const MemoryStreamBuf &) = delete;
+
+    protected:
+        std::streamsize showmanyc() override;
+
+        std::streamsize xsgetn(char_type *s, std::streamsize count) override;
+
+        pos_type seekoff(off_type off,
+                         std::ios_base::seekdir dir,
+                         std::ios_base::openmode which = std::ios_base::in) override;
+
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) override;
+
+    private:
+        std::vector<char> data;
+    };
+
+    /**
+     * An input stream over a MemoryStreamBuf.
+     */
+    class MANA_EXPORT MemoryStream : public std::istream {
+    public:
+        MemoryStream(const char *data, size_t size);
+
+        explicit MemoryStream(std::vector<char> data);
+
+    private:
+        MemoryStreamBuf buffer;
+    };
+}
+
+#endif //MANA_MEMORYSTREAMBUF_HPP
@@ -6,22 +6,121 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <cstdint>
 
 #include "crypto/aes.hpp"
 
+#include "io/pakchunk.hpp"
+
+#include "compression/zstd.hpp"
+
 namespace engine {
-    static const std::string PAK_FORMAT_VERSION = "00";
+    static const std::string PAK_FORMAT_VERSION = "02";
     static const std::string PAK_HEADER_MAGIC = "\xa9pak\xff" + PAK_FORMAT_VERSION + "\xa9";
 
+    // The magic of version 01 which has no per entry codecs, all entries are gzip compressed if PAK_FLAG_COMPRESSED is set
+    static const std::string PAK_HEADER_MAGIC_V1 = "\xa9pak\xff" "01" "\xa9";
+
+    // The magic of the legacy format which stores the header as gzip + base64 encoded json
+    static const std::string PAK_HEADER_MAGIC_LEGACY = "\xa9pak\xff" "00" "\xa9";
+
     /**
      * The pak file format
+     *
+     * All integers are stored little endian.
+     *
+     * Header (72 Bytes):
+     *  char[8] magic
+     *  uint32 flags (PAK_FLAG_*)
+     *  uint32 record size
+     *  uint64 chunk size (0 = Not chunked)
+     *  uint64 entry count
+     *  uint64 index size (The number of bytes stored for the index, including encryption padding)
+     *  uint64 data offset (The global offset of the first data byte)
+     *  uint64 dictionary offset (Relative to the data offset)
+     *  uint64 dictionary size (The number of bytes stored for the zstd dictionary, 0 = No dictionary)
+     *  uint64 nonce (Random per pak, the upper half of the aes ctr counter blocks)
+     *
+     * Index:
+     *  Records sorted by path hash and path, each record is record size bytes:
+     *      uint64 path hash (FNV-1a 64)
+     *      uint64 offset (Relative to the data offset)
+     *      uint64 size
+     *      uint32 path offset (Relative to the beginning of the path table)
+     *      uint32 path length
+     *      uint8[32] hash of the uncompressed data (Pak::HashType, zero padded)
+     *      uint64 decompressed size
+     *      uint16 codec (Pak::Codec)
+     *      uint16 entry flags (PAK_ENTRY_FLAG_*)
+     *      uint32 block size (0 = Not split into blocks)
+     *  Path table:
+     *      The concatenated entry paths
+     *
+     * Data:
+     *  The zstd dictionary and the entry data, compressed with the codec of the entry.
+     *
+     *  Entries with a block size are split into blocks of block size decompressed bytes (The last block may be smaller),
+     *  each block is compressed independently so that a range of the entry can be read without decoding
+     *  the whole entry:
+     *      uint64 table size
+     *      uint64[] table, the end offset of each stored block relative to the first block
+     *      The stored blocks
+     *
+     * Encryption:
+     *  If PAK_FLAG_CTR is set all bytes following the header are encrypted with aes ctr,
+     *  the counter block of each byte is the nonce of the pak followed by the big endian global offset / 16,
+     *  so paks encrypted with the same key do not share the key stream.
+     *  This allows decrypting any range in place without padding, so partial reads of stored entries stay direct.
+     *  Otherwise the index, the dictionary and each entry or block and block table are encrypted separately with aes cbc.
+     *
+     * Hashing:
+     *  The entry hashes are sha256, or xxh3 128 if PAK_FLAG_HASH_XXH3 is set.
+     *  If PAK_FLAG_TREE_HASH is set entries larger than the hash leaf size (1 MiB) are split into leaves,
+     *  the stored hash is the hash of the concatenated leaf hashes and the uint64 entry size,
+     *  which allows hashing the leaves in parallel.
+     *  The leaf inputs are prefixed with the byte 0 and the root input with the byte 1.
+     *
+     * The header and index are read with two reads and entries are looked up directly in the index buffer.
+     * The pak may be split into chunks of chunk size bytes, the offsets are global offsets into the concatenated chunks.
+     *
+     * Version 01 uses a 48 byte header without the dictionary and nonce fields and 64 byte records without the codec fields.
      */
+    static const size_t PAK_HEADER_SIZE = 72;
+    static const size_t PAK_RECORD_SIZE = 80;
+
+    static const size_t PAK_HEADER_SIZE_V1 = 48;
+    static const size_t PAK_RECORD_SIZE_V1 = 64;
+
+    static const uint32_t PAK_FLAG_COMPRESSED = 1u << 0; // Version 01 only
+    static const uint32_t PAK_FLAG_ENCRYPTED = 1u << 1;
+    static const uint32_t PAK_FLAG_CTR = 1u << 2; // Encrypted with aes ctr instead of per section aes cbc
+    static const uint32_t PAK_FLAG_HASH_XXH3 = 1u << 3;
+    static const uint32_t PAK_FLAG_TREE_HASH = 1u << 4;
+
+    static const uint32_t PAK_ENTRY_FLAG_VERIFY = 1u << 0; // The hash is verified on every load
+
     class MANA_EXPORT Pak {
     public:
+        enum Codec {
+            STORE = 0,
+            GZIP = 1,
+            LZ4 = 2, // Fast decompression, used for large entries
+            ZSTD = 3 // Used with the trained pak dictionary for small entries
+        };
+
+        enum HashType {
+            SHA256 = 0, // For signed releases
+            XXH3 = 1 // Several times faster, detects corruption but not tampering
+        };
+
         struct HeaderEntry {
             size_t offset;
             size_t size;
-            std::string hash;
+            std::string hash; // The binary digest, zero padded to 32 bytes
+            Codec codec = STORE;
+            size_t decompressedSize = 0;
+            size_t blockSize = 0;
+            bool verify = false;
         };
 
         static std::map<std::string, std::vector<char>> readEntries(const std::string &path, bool recursive = true);
@@ -29,8 +128,16 @@ namespace engine {
         /**
          * Create a pak buffer from the passed entries and return it.
          *
+         * When compressing the codec is selected per entry by the measured ratio:
+         * Small entries are compressed with a zstd dictionary trained on the entries if it saves clearly more than lz4,
+         * large entries are compressed with lz4, entries which do not compress well (eg. png, ogg) are stored.
+         * Large entries are split into independently compressed blocks which can be read partially.
+         *
+         * The entries and the output are held in memory, use PakBuilder to stream large paks to files.
+         *
          * @param entries
          * @param chunkSize The maximum number of bytes stored in a single pak chunk
+         * @param compressData If false all entries are stored uncompressed
          * @return The ordered pak chunks
          */
         static std::vector<std::vector<char>> createPak(const std::map<std::string, std::vector<char>> &entries,
@@ -39,12 +146,12 @@ namespace engine {
 
         /**
          * Create a pak buffer from the passed entries and return it.
-         * Additionally apply aes encryption to the asset data using the supplied key and initialization vector.
+         * Additionally encrypt the index and data with aes ctr using the supplied key and a random nonce.
          *
          * @param entries
          * @param chunkSize
          * @param key
-         * @param iv
+         * @param iv Unused by aes ctr, kept for the paks encrypted with aes cbc
          * @return The ordered pak chunks
          */
         static std::vector<std::vector<char>> createPak(const std::map<std::string, std::vector<char>> &entries,
@@ -58,6 +165,8 @@ namespace engine {
         /**
          * Load a pak buffer from stream.
          *
+         * Reads from streams are serialized per stream, use the file paths constructor for concurrent reads.
+         *
          * @param streams
          * @param key
          * @param iv
@@ -67,32 +176,158 @@ namespace engine {
                      AES::InitializationVector iv = {});
 
         /**
-         * Load the pak entry from the stream, and optionally verify its hash.
+         * Load a pak from the ordered chunks.
+         *
+         * @param chunks
+         * @param key
+         * @param iv
+         */
+        explicit Pak(std::vector<std::unique_ptr<PakChunk>> chunks,
+                     AES::Key key = {},
+                     AES::InitializationVector iv = {});
+
+        /**
+         * Load a pak from the ordered chunk files using positional reads.
+         *
+         * @param paths
+         * @param key
+         * @param iv
+         */
+        explicit Pak(const std::vector<std::string> &paths,
+                     AES::Key key = {},
+                     AES::InitializationVector iv = {});
+
+        /**
+         * Load the pak entry from the chunks, and optionally verify its hash.
+         *
+         * Entries which were marked for verification when building the pak are always verified.
+         * The leaves of large tree hashed entries are hashed in parallel.
+         *
+         * Safe to call concurrently from multiple threads.
          *
          * @param path The path of the entry
          * @param verifyHash If true the hash of the returned data is checked against a hash stored in the pak header and an exception is thrown on mismatch.
          * @return The entry data
          */
-        std::vector<char> get(const std::string &path, bool verifyHash = false);
+        std::vector<char> get(const std::string &path, bool verifyHash = false) const;
+
+        /**
+         * Read a range of the decompressed entry data.
+         *
+         * For entries stored in blocks only the blocks overlapping the range are read and decoded,
+         * uncompressed and unencrypted entries are read directly, other entries are decoded as a whole.
+         * The hash cannot be verified for partial reads.
+         *
+         * Safe to call concurrently from multiple threads.
+         *
+         * @param path The path of the entry
+         * @param offset The offset into the decompressed entry data
+         * @param length The number of bytes to read
+         * @return The requested bytes, an exception is thrown if the range exceeds the entry.
+         */
+        std::vector<char> read(const std::string &path, size_t offset, size_t length) const;
 
-        bool exists(const std::string &path) {
-            return entries.find(path) != entries.end();
+        /**
+         * @param path
+         * @return The size of the decompressed entry data
+         */
+        size_t getSize(const std::string &path) const;
+
+        /**
+         * Hint that the entry will be read soon, the stored bytes are fetched in the background if the chunks support it.
+         *
+         * @param path
+         */
+        void prefetch(const std::string &path) const;
+
+        bool exists(const std::string &path) const;
+
+        /**
+         * @param path
+         * @return The binary hash stored for the entry or an empty string if the entry does not exist
+         */
+        std::string getHash(const std::string &path) const;
+
+        /**
+         * Hash the data in the same way as the entries of this pak.
+         *
+         * @param data
+         * @param parallel False when the caller already runs in parallel
+         * @return The binary hash which can be compared to the result of getHash
+         */
+        std::string computeHash(const std::vector<char> &data, bool parallel = true) const;
+
+        HashType getHashType() const {
+            return hashType;
+        }
+
+        /**
+         * @return The paths of all entries in index order
+         */
+        std::vector<std::string> getPaths() const;
+
+        size_t getEntryCount() const {
+            return entryCount;
         }
 
     private:
         void loadHeader();
 
-        size_t getRelativeOffset(size_t globalOffset);
+        void loadLegacyHeader();
+
+        /**
+         * Lookup the entry in the index.
+         *
+         * @param path
+         * @param entry The entry with a global offset
+         * @return False if the path does not exist
+         */
+        bool findEntry(const std::string &path, HeaderEntry &entry) const;
+
+        /**
+         * Read bytes starting at the global offset, crossing chunk boundaries as required.
+         */
+        void readData(size_t globalOffset, char *buffer, size_t length) const;
+
+        /**
+         * Read bytes starting at the global offset and decrypt them if the pak uses aes ctr.
+         */
+        void readDecrypted(size_t globalOffset, char *buffer, size_t length) const;
+
+        /**
+         * Check that the records are sorted and the paths lie inside the path table.
+         */
+        bool validateIndex() const;
+
+        /**
+         * Decrypt and decompress the stored data of the entry or of one of its blocks.
+         */
+        std::vector<char> decode(const HeaderEntry &entry, std::vector<char> data, size_t decompressedSize) const;
+
+        /**
+         * Read and decode the blocks of a block entry which overlap the range.
+         */
+        std::vector<char> readBlocks(const HeaderEntry &entry, size_t offset, size_t length) const;
+
+        size_t getRelativeOffset(size_t globalOffset) const;
 
-        std::istream &getStreamForOffset(size_t globalOffset);
+        PakChunk &getChunkForOffset(size_t globalOffset) const;
 
-        std::vector<std::unique_ptr<std::istream>> streams;
-        std::map<std::string, HeaderEntry> entries; // The header entries with global offsets
+        std::vector<std::unique_ptr<PakChunk>> chunks;
+        std::vector<char> index; // The sorted index records followed by the path table
+        size_t entryCount{};
+        size_t recordSize{};
+        size_t dataOffset{};
         long chunkSize{};
         bool encrypted{};
+        bool ctr{};
         bool compressed{};
+        HashType hashType = SHA256;
+        bool treeHash{};
+        std::unique_ptr<ZStd::Dictionary> dictionary;
         AES::Key key{};
         AES::InitializationVector iv{};
+        AES::InitializationVector counter{}; // The initial aes ctr counter block built from the nonce of the pak
     };
 }
 
@@ -0,0 +1,205 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_PAKBUILDER_HPP
+#define MANA_PAKBUILDER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <ostream>
+#include <thread>
+#include <algorithm>
+
+#include "io/pak.hpp"
+
+namespace engine {
+    /**
+     * Streaming pak writer which reads, hashes and compresses entries in parallel and writes them
+     * directly to the chunk streams.
+     *
+     * Entries are loaded on demand by the worker threads and the number of bytes held in memory is bounded
+     * by the buffer limit (plus the size of the largest single entry), so paks larger than the available
+     * memory can be built.
+     *
+     * The output only depends on the entries and settings and not on thread scheduling:
+     * entries are written in path order, or in the order set with setOrder.
+     */
+    class MANA_EXPORT PakBuilder {
+    public:
+        struct Progress {
+            size_t entries; // The number of entries written
+            size_t totalEntries;
+            size_t bytes; // The number of uncompressed entry bytes written
+            size_t totalBytes;
+        };
+
+        typedef std::function<void(const Progress &)> ProgressCallback;
+
+        // Returns the uncompressed entry data, called from the worker threads.
+        typedef std::function<std::vector<char>()> EntryLoader;
+
+        // Returns the stream for the chunk with the passed index, the stream must support seekp.
+        typedef std::function<std::unique_ptr<std::ostream>(size_t)> ChunkOpener;
+
+        /**
+         * @param chunkSize The maximum number of bytes stored in a single pak chunk
+         * @param compressData If false all entries are stored uncompressed
+         */
+        explicit PakBuilder(long chunkSize = -1, bool compressData = true);
+
+        /**
+         * Additionally encrypt the index and data with aes ctr using the supplied key and a random nonce per build.
+         *
+         * @param chunkSize
+         * @param compressData
+         * @param key
+         * @param iv Unused by aes ctr, kept for the paks encrypted with aes cbc
+         */
+        PakBuilder(long chunkSize, bool compressData, AES::Key key, AES::InitializationVector iv);
+
+        /**
+         * Add an entry which is loaded by the loader during the build.
+         *
+         * @param path The path of the entry in the pak
+         * @param size The size of the uncompressed data returned by the loader
+         * @param loader
+         */
+        void addEntry(const std::string &path, size_t size, EntryLoader loader);
+
+        void addEntry(const std::string &path, std::vector<char> data);
+
+        /**
+         * Add a file which is read during the build.
+         *
+         * @param path The path of the entry in the pak
+         * @param filePath
+         */
+        void addFile(const std::string &path, const std::string &filePath);
+
+        /**
+         * Add all files in the directory, the entry paths are relative to the directory and start with a slash.
+         *
+         * @param directory
+         * @param recursive
+         */
+        void addDirectory(const std::string &directory, bool recursive = true);
+
+        /**
+         * Mark the entry to have its hash verified on every load, regardless of the verification setting of the reader.
+         *
+         * @param path
+         * @param verify
+         */
+        void setVerify(const std::string &path, bool verify = true);
+
+        /**
+         * @param type SHA256 (default) for releases which have to detect tampering, XXH3 for fast integrity checks
+         */
+        void setHashType(Pak::HashType type);
+
+        /**
+         * Set the order in which the entries are stored, entries which are read together should be stored together.
+         * Pass the access trace recorded with PakArchive::startTrace to store the entries in load order.
+         *
+         * Entries which are not contained in the order are stored after the ordered entries in path order,
+         * paths in the order which are not added are ignored.
+         *
+         * @param paths
+         */
+        void setOrder(std::vector<std::string> paths);
+
+        /**
+         * Remove the entries which are stored with identical data in the base pak.
+         *
+         * Used to build a patch pak which is mounted on top of the base pak with a LayeredArchive,
+         * only the added and changed entries are stored in the patch.
+         * The entries are loaded and hashed in parallel, the data is not kept in memory.
+         *
+         * @param base
+         * @return The number of removed entries
+         */
+        size_t removeUnchanged(const Pak &base);
+
+        /**
+         * @param threads The number of worker tasks queued on the engine thread pool
+         */
+        void setThreadCount(unsigned int threads);
+
+        /**
+         * @param bytes The maximum number of loaded or compressed bytes waiting to be written
+         */
+        void setBufferLimit(size_t bytes);
+
+        /**
+         * @param callback Invoked on the calling thread of build after each written entry
+         */
+        void setProgressCallback(ProgressCallback callback);
+
+        size_t getEntryCount() const {
+            return entries.size();
+        }
+
+        /**
+         * Write the pak to the streams returned by the opener.
+         *
+         * The header and index are written last by seeking back to the beginning of the first chunk,
+         * all streams are kept open until the pak is complete.
+         *
+         * @param openChunk
+         * @return The number of written chunks
+         */
+        size_t build(const ChunkOpener &openChunk) const;
+
+        /**
+         * Write the pak to the files prefix + "." + chunk index + ".pak".
+         *
+         * @param prefix
+         * @return The paths of the written chunk files
+         */
+        std::vector<std::string> build(const std::string &prefix) const;
+
+    private:
+        struct Entry {
+            size_t size;
+            EntryLoader loader;
+            bool verify;
+        };
+
+        std::vector<std::string> getOrderedPaths() const;
+
+        std::map<std::string, Entry> entries;
+        std::vector<std::string> order;
+
+        long chunkSize;
+        bool compressData;
+        bool encrypt;
+        Pak::HashType hashType = Pak::SHA256;
+        AES::Key key{};
+        AES::InitializationVector iv{};
+
+        unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+        size_t bufferLimit = 256 * 1024 * 1024;
+        ProgressCallback progressCallback;
+    };
+}
+
+#endif //MANA_PAKBUILDER_HPP
@@ -0,0 +1,113 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_PAKCHUNK_HPP
+#define MANA_PAKCHUNK_HPP
+
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace engine {
+    /**
+     * A single chunk of a pak, read with positional reads.
+     *
+     * Implementations must support concurrent reads from multiple threads.
+     */
+    class MANA_EXPORT PakChunk {
+    public:
+        virtual ~PakChunk() = default;
+
+        /**
+         * Read up to length bytes starting at offset.
+         *
+         * @param offset The offset relative to the beginning of the chunk
+         * @param buffer
+         * @param length
+         * @return The number of bytes read, less than length only when the end of the chunk is reached.
+         */
+        virtual size_t read(size_t offset, char *buffer, size_t length) = 0;
+
+        /**
+         * @return The size of the chunk in bytes
+         */
+        virtual size_t getSize() = 0;
+
+        /**
+         * Hint that the range will be read soon so that the storage can fetch it in the background.
+         *
+         * Must not block on the read, the default implementation does nothing.
+         *
+         * @param offset
+         * @param length
+         */
+        virtual void prefetch(size_t offset, size_t length) {}
+    };
+
+    /**
+     * A pak chunk reading from a std::istream.
+     *
+     * Reads are serialized because the stream has a single cursor.
+     */
+    class MANA_EXPORT StreamPakChunk : public PakChunk {
+    public:
+        explicit StreamPakChunk(std::unique_ptr<std::istream> stream);
+
+        size_t read(size_t offset, char *buffer, size_t length) override;
+
+        size_t getSize() override;
+
+    private:
+        std::mutex mutex;
+        std::unique_ptr<std::istream> stream;
+    };
+
+    /**
+     * A pak chunk reading from a file with positional reads (pread / overlapped ReadFile).
+     *
+     * There is no shared file cursor so concurrent reads do not block each other.
+     */
+    class MANA_EXPORT FilePakChunk : public PakChunk {
+    public:
+        explicit FilePakChunk(const std::string &path);
+
+        ~FilePakChunk() override;
+
+        FilePakChunk(const FilePakChunk &) = delete;
+
+        FilePakChunk &operator=(const FilePakChunk &) = delete;
+
+        size_t read(size_t offset, char *buffer, size_t length) override;
+
+        size_t getSize() override;
+
+        void prefetch(size_t offset, size_t length) override;
+
+    private:
+#ifdef _WIN32
+        void *handle;
+#else
+        int fd;
+#endif
+        size_t size;
+    };
+}
+
+#endif //MANA_PAKCHUNK_HPP
@@ -23,72 +23,95 @@
 #include <cassert>
 #include <streambuf>
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
-//https://stackoverflow.com/a/7657367
-
-class substreambuf : public std::streambuf
-{
+/**
+ * A read only view of the range [start, start + len) of another stream buffer.
+ *
+ * Reads from the underlying buffer in blocks of bufferSize bytes with a single sgetn call,
+ * seeking inside the current block does not touch the underlying buffer.
+ * The underlying buffer is repositioned before each block read so it may be shared with other readers
+ * as long as they are not used concurrently.
+ */
+class substreambuf : public std::streambuf {
 public:
-
-    substreambuf(std::streambuf *sbuf, std::size_t start, std::size_t len) : m_sbuf(sbuf), m_start(start), m_len(len), m_pos(0)
-    {
-        std::streampos p = m_sbuf->pubseekpos(start);
-        assert(p != std::streampos(-1));
-        setbuf(NULL, 0);
+    substreambuf(std::streambuf *sbuf, std::size_t start, std::size_t len, std::size_t bufferSize = 64 * 1024)
+            : m_sbuf(sbuf), m_start(start), m_len(len), m_next(0), m_buffer(std::max<std::size_t>(bufferSize, 1)) {
+        assert(m_sbuf != nullptr);
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
     }
 
 protected:
+    int_type underflow() override {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
 
-    int underflow()
-    {
-        if (m_pos + std::streamsize(1) >= m_len)
+        if (m_next >= m_len)
+            return traits_type::eof();
+
+        auto count = std::min<std::size_t>(m_buffer.size(), m_len - m_next);
+        if (m_sbuf->pubseekpos(static_cast<std::streamoff>(m_start + m_next), std::ios_base::in) == pos_type(off_type(-1)))
             return traits_type::eof();
-        return m_sbuf->sgetc();
-    }
 
-    int uflow()
-    {
-        if (m_pos + std::streamsize(1) > m_len)
+        auto read = m_sbuf->sgetn(m_buffer.data(), static_cast<std::streamsize>(count));
+        if (read <= 0)
             return traits_type::eof();
-        m_pos += std::streamsize(1);
-        return m_sbuf->sbumpc();
+
+        m_next += static_cast<std::size_t>(read);
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + read);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    std::streamsize showmanyc() override {
+        auto ret = static_cast<std::streamsize>(m_len - getPosition());
+        return ret > 0 ? ret : -1;
     }
 
-    std::streampos seekoff(std::streamoff off, std::ios_base::seekdir way, std::ios_base::openmode which = std::ios_base::in | std::ios_base::out)
-    {
-        std::streampos cursor;
+    pos_type seekoff(off_type off,
+                     std::ios_base::seekdir way,
+                     std::ios_base::openmode which = std::ios_base::in) override {
+        if (which & std::ios_base::out)
+            return pos_type(off_type(-1));
 
+        off_type base;
         if (way == std::ios_base::beg)
-            cursor = off;
+            base = 0;
         else if (way == std::ios_base::cur)
-            cursor = m_pos + off;
-        else if (way == std::ios_base::end)
-            cursor = m_len - off;
+            base = static_cast<off_type>(getPosition());
+        else
+            base = static_cast<off_type>(m_len);
 
-        if (cursor < 0 || cursor >= m_len)
-            return std::streampos(-1);
-        m_pos = cursor;
-        if (m_sbuf->pubseekpos(m_start + m_pos) == std::streampos(-1))
-            return std::streampos(-1);
+        auto position = base + off;
+        if (position < 0 || position > static_cast<off_type>(m_len))
+            return pos_type(off_type(-1));
 
-        return m_pos;
+        // Keep the buffered block if the position lies inside it
+        auto blockBegin = static_cast<off_type>(m_next) - (egptr() - eback());
+        if (position >= blockBegin && position < static_cast<off_type>(m_next)) {
+            setg(eback(), eback() + (position - blockBegin), egptr());
+        } else {
+            m_next = static_cast<std::size_t>(position);
+            setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+        }
+
+        return pos_type(position);
     }
 
-    std::streampos seekpos(std::streampos sp, std::ios_base::openmode which = std::ios_base::in | std::ios_base::out)
-    {
-        if (sp < 0 || sp >= m_len)
-            return std::streampos(-1);
-        m_pos = sp;
-        if (m_sbuf->pubseekpos(m_start + m_pos) == std::streampos(-1))
-            return std::streampos(-1);
-        return m_pos;
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which = std::ios_base::in) override {
+        return seekoff(off_type(sp), std::ios_base::beg, which);
     }
 
 private:
+    std::size_t getPosition() const {
+        return m_next - static_cast<std::size_t>(egptr() - gptr());
+    }
+
     std::streambuf *m_sbuf;
-    std::streampos m_start;
-    std::streamsize m_len;
-    std::streampos m_pos;
+    std::size_t m_start;
+    std::size_t m_len;
+    std::size_t m_next; // The range offset following the buffered block
+    std::vector<char> m_buffer;
 };
 
 #endif //MANA_SUBSTREAMBUF_HPP
@@ -0,0 +1,180 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_BOUNDS_HPP
+#define MANA_BOUNDS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "math/vector3.hpp"
+#include "math/matrix.hpp"
+
+namespace engine {
+    /**
+     * An axis aligned bounding box.
+     *
+     * A default constructed box is empty, empty boxes are treated as unbounded by the culling code.
+     */
+    struct MANA_EXPORT AABB {
+        Vec3f min = Vec3f(std::numeric_limits<float>::max());
+        Vec3f max = Vec3f(std::numeric_limits<float>::lowest());
+
+        AABB() = default;
+
+        AABB(const Vec3f &min, const Vec3f &max) : min(min), max(max) {}
+
+        bool empty() const {
+            return min.x > max.x || min.y > max.y || min.z > max.z;
+        }
+
+        Vec3f center() const {
+            return Vec3f((min.x + max.x) / 2, (min.y + max.y) / 2, (min.z + max.z) / 2);
+        }
+
+        Vec3f extent() const {
+            return Vec3f((max.x - min.x) / 2, (max.y - min.y) / 2, (max.z - min.z) / 2);
+        }
+
+        float surfaceArea() const {
+            if (empty())
+                return 0;
+            auto d = max - min;
+            return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+
+        bool contains(const AABB &other) const {
+            return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+                   && max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+        }
+
+        bool intersects(const AABB &other) const {
+            return min.x <= other.max.x && min.y <= other.max.y && min.z <= other.max.z
+                   && max.x >= other.min.x && max.y >= other.min.y && max.z >= other.min.z;
+        }
+
+        static AABB merge(const AABB &a, const AABB &b) {
+            return {Vec3f(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+                    Vec3f(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z))};
+        }
+
+        void extend(const Vec3f &point) {
+            min = Vec3f(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+            max = Vec3f(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+        }
+
+        /**
+         * @param model The affine matrix to transform the box with
+         * @return The box enclosing the transformed box
+         */
+        AABB transform(const Mat4f &model) const {
+            if (empty())
+                return *this;
+
+            auto c = center();
+            auto e = extent();
+
+            Vec3f worldCenter;
+            Vec3f worldExtent;
+            for (int row = 0; row < 3; row++) {
+                float cv = model.get(0, row) * c.x + model.get(1, row) * c.y + model.get(2, row) * c.z
+                           + model.get(3, row);
+                float ev = std::abs(model.get(0, row)) * e.x
+                           + std::abs(model.get(1, row)) * e.y
+                           + std::abs(model.get(2, row)) * e.z;
+                switch (row) {
+                    case 0:
+                        worldCenter.x = cv;
+                        worldExtent.x = ev;
+                        break;
+                    case 1:
+                        worldCenter.y = cv;
+                        worldExtent.y = ev;
+                        break;
+                    default:
+                        worldCenter.z = cv;
+                        worldExtent.z = ev;
+                        break;
+                }
+            }
+
+            return {worldCenter - worldExtent, worldCenter + worldExtent};
+        }
+    };
+
+    /**
+     * A bounding sphere, a negative radius marks the sphere as empty.
+     */
+    struct MANA_EXPORT BoundingSphere {
+        Vec3f center;
+        float radius = -1;
+
+        BoundingSphere() = default;
+
+        BoundingSphere(const Vec3f &center, float radius) : center(center), radius(radius) {}
+
+        bool empty() const {
+            return radius < 0;
+        }
+
+        AABB bounds() const {
+            if (empty())
+                return {};
+            return {center - Vec3f(radius), center + Vec3f(radius)};
+        }
+
+        bool intersects(const AABB &box) const {
+            // Squared distance from the center to the closest point of the box
+            float x = std::max(box.min.x - center.x, std::max(0.0f, center.x - box.max.x));
+            float y = std::max(box.min.y - center.y, std::max(0.0f, center.y - box.max.y));
+            float z = std::max(box.min.z - center.z, std::max(0.0f, center.z - box.max.z));
+            return x * x + y * y + z * z <= radius * radius;
+        }
+
+        /**
+         * @param model The affine matrix to transform the sphere with
+         * @return The sphere enclosing the transformed sphere
+         */
+        BoundingSphere transform(const Mat4f &model) const {
+            if (empty())
+                return *this;
+
+            Vec3f worldCenter(
+                    model.get(0, 0) * center.x + model.get(1, 0) * center.y + model.get(2, 0) * center.z
+                    + model.get(3, 0),
+                    model.get(0, 1) * center.x + model.get(1, 1) * center.y + model.get(2, 1) * center.z
+                    + model.get(3, 1),
+                    model.get(0, 2) * center.x + model.get(1, 2) * center.y + model.get(2, 2) * center.z
+                    + model.get(3, 2));
+
+            // The largest column length is the largest scale applied by the matrix
+            float scale = 0;
+            for (int col = 0; col < 3; col++) {
+                scale = std::max(scale, model.get(col, 0) * model.get(col, 0)
+                                        + model.get(col, 1) * model.get(col, 1)
+                                        + model.get(col, 2) * model.get(col, 2));
+            }
+
+            return {worldCenter, radius * std::sqrt(scale)};
+        }
+    };
+}
+
+#endif //MANA_BOUNDS_HPP
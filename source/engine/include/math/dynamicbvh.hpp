@@ -0,0 +1,151 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_DYNAMICBVH_HPP
+#define MANA_DYNAMICBVH_HPP
+
+#include <vector>
+#include <functional>
+
+#include "math/bounds.hpp"
+#include "math/frustum.hpp"
+
+namespace engine {
+    /**
+     * A dynamic bounding volume hierarchy of axis aligned boxes.
+     *
+     * Leaves store a fattened box so that small movements do not change the tree,
+     * leaves which move out of their fattened box are reinserted with a surface area heuristic
+     * and the tree is kept balanced with rotations.
+     * When the reinsertions have degraded the tree quality the tree is rebuilt top down.
+     *
+     * Proxies returned by insert stay valid until they are removed.
+     */
+    class MANA_EXPORT DynamicBVH {
+    public:
+        static const int NULL_NODE = -1;
+
+        /**
+         * @param margin The distance by which the boxes of the leaves are fattened
+         */
+        explicit DynamicBVH(float margin = 0.1f);
+
+        /**
+         * @param bounds The bounds of the object, must not be empty
+         * @param userData The data returned by getUserData for the created proxy
+         * @return The proxy of the object
+         */
+        int insert(const AABB &bounds, size_t userData);
+
+        void remove(int proxy);
+
+        /**
+         * Update the bounds of an object.
+         *
+         * @return True if the leaf had to be moved in the tree
+         */
+        bool update(int proxy, const AABB &bounds);
+
+        /**
+         * Rebuild the tree top down from the current leaves.
+         */
+        void rebuild();
+
+        void clear();
+
+        size_t getUserData(int proxy) const;
+
+        /**
+         * @return The fattened bounds stored for the proxy
+         */
+        const AABB &getBounds(int proxy) const;
+
+        size_t size() const { return leafCount; }
+
+        /**
+         * @return The sum of the surface areas of the internal nodes, lower is better
+         */
+        float getCost() const;
+
+        void queryAABB(const AABB &bounds, const std::function<void(int)> &callback) const;
+
+        void querySphere(const BoundingSphere &sphere, const std::function<void(int)> &callback) const;
+
+        void queryFrustum(const Frustum &frustum, const std::function<void(int)> &callback) const;
+
+        /**
+         * Traverse the leaves whose bounds are hit by a ray.
+         *
+         * The callback receives the proxy and the distance at which the ray enters the leaf bounds
+         * and returns the new maximum distance, returning the distance of an exact hit
+         * restricts the remaining traversal to closer leaves.
+         *
+         * @param origin The origin of the ray
+         * @param direction The direction of the ray, the distances are in multiples of its length
+         * @param maxDistance The maximum distance along the ray
+         * @param callback The callback invoked for each leaf hit by the ray
+         */
+        void queryRay(const Vec3f &origin,
+                      const Vec3f &direction,
+                      float maxDistance,
+                      const std::function<float(int, float)> &callback) const;
+
+    private:
+        struct Node {
+            AABB bounds;
+            size_t userData = 0;
+            int parent = NULL_NODE; // The next free node while the node is unused
+            int left = NULL_NODE;
+            int right = NULL_NODE;
+            int height = 0; // -1 while the node is unused
+
+            bool isLeaf() const { return left == NULL_NODE; }
+        };
+
+        std::vector<Node> nodes;
+        int root = NULL_NODE;
+        int freeList = NULL_NODE;
+        size_t leafCount = 0;
+
+        float margin;
+
+        size_t changesSinceRebuild = 0;
+        float rebuildCost = 0;
+
+        int allocateNode();
+
+        void freeNode(int node);
+
+        void insertLeaf(int leaf);
+
+        void removeLeaf(int leaf);
+
+        void refitAncestors(int node);
+
+        int balance(int node);
+
+        int buildTopDown(std::vector<int> &leaves, size_t begin, size_t end);
+
+        void checkRebuild();
+
+        void reportLeaves(int node, const std::function<void(int)> &callback) const;
+    };
+}
+
+#endif //MANA_DYNAMICBVH_HPP
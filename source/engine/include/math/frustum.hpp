@@ -0,0 +1,106 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_FRUSTUM_HPP
+#define MANA_FRUSTUM_HPP
+
+#include <cmath>
+
+#include "math/vector4.hpp"
+#include "math/matrix.hpp"
+#include "math/bounds.hpp"
+
+namespace engine {
+    /**
+     * The six clipping planes of a view projection matrix.
+     *
+     * The planes are stored as (normal, distance) with the normals pointing into the frustum.
+     */
+    struct MANA_EXPORT Frustum {
+        Vec4f planes[6]; // Left, right, bottom, top, near, far
+
+        Frustum() = default;
+
+        /**
+         * Extract the planes from an OpenGL style (-w <= z <= w) view projection matrix.
+         *
+         * @param viewProjection The matrix to extract the planes from, eg. camera.projection() * camera.view()
+         */
+        explicit Frustum(const Mat4f &viewProjection) {
+            for (int i = 0; i < 3; i++) {
+                planes[i * 2] = row(viewProjection, 3) + row(viewProjection, i);
+                planes[i * 2 + 1] = row(viewProjection, 3) - row(viewProjection, i);
+            }
+            for (auto &plane: planes) {
+                float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+                if (length > 0)
+                    plane = Vec4f(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+            }
+        }
+
+        bool intersects(const BoundingSphere &sphere) const {
+            if (sphere.empty())
+                return true;
+            for (auto &plane: planes) {
+                if (plane.x * sphere.center.x + plane.y * sphere.center.y + plane.z * sphere.center.z + plane.w
+                    < -sphere.radius)
+                    return false;
+            }
+            return true;
+        }
+
+        bool intersects(const AABB &box) const {
+            if (box.empty())
+                return true;
+            for (auto &plane: planes) {
+                // Test the corner furthest along the plane normal
+                float x = plane.x >= 0 ? box.max.x : box.min.x;
+                float y = plane.y >= 0 ? box.max.y : box.min.y;
+                float z = plane.z >= 0 ? box.max.z : box.min.z;
+                if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0)
+                    return false;
+            }
+            return true;
+        }
+
+        /**
+         * @return True if the box lies completely inside the frustum
+         */
+        bool contains(const AABB &box) const {
+            if (box.empty())
+                return false;
+            for (auto &plane: planes) {
+                // Test the corner closest along the plane normal
+                float x = plane.x >= 0 ? box.min.x : box.max.x;
+                float y = plane.y >= 0 ? box.min.y : box.max.y;
+                float z = plane.z >= 0 ? box.min.z : box.max.z;
+                if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0)
+                    return false;
+            }
+            return true;
+        }
+
+    private:
+        static Vec4f row(const Mat4f &matrix, int index) {
+            return {matrix.get(0, index), matrix.get(1, index), matrix.get(2, index), matrix.get(3, index)};
+        }
+    };
+}
+
+#endif //MANA_FRUSTUM_HPP
@@ -0,0 +1,52 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_INSTANCEBUFFER_HPP
+#define MANA_INSTANCEBUFFER_HPP
+
+#include <vector>
+
+#include "renderobject.hpp"
+#include "math/matrix.hpp"
+
+namespace engine {
+    /**
+     * A buffer of per instance model matrices which is rewritten every frame.
+     *
+     * Render commands reference a range of the buffer to draw a mesh buffer once per matrix in the range,
+     * the matrices are fed to the instance matrix attributes of the mesh buffer.
+     */
+    class MANA_EXPORT InstanceBuffer : public RenderObject {
+    public:
+        ~InstanceBuffer() override = default;
+
+        /**
+         * Replace the contents of the buffer.
+         *
+         * Draws which were issued with the previous contents are not affected.
+         *
+         * @param matrices The model matrices
+         */
+        virtual void upload(const std::vector<Mat4f> &matrices) = 0;
+
+        virtual size_t getCount() const = 0;
+    };
+}
+
+#endif //MANA_INSTANCEBUFFER_HPP
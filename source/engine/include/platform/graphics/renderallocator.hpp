@@ -21,10 +21,14 @@
 #define MANA_RENDERALLOCATOR_HPP
 
 #include <memory>
+#include <stdexcept>
 
 #include "rendertarget.hpp"
 #include "texturebuffer.hpp"
 #include "meshbuffer.hpp"
+#include "instancebuffer.hpp"
+#include "shaderbuffer.hpp"
+#include "storagebuffer.hpp"
 #include "shaderprogram.hpp"
 #include "shadersource.hpp"
 
@@ -75,6 +79,31 @@ namespace engine {
         virtual std::unique_ptr<MeshBuffer> createInstancedMeshBuffer(const Mesh &mesh,
                                                                       const std::vector<Transform> &offsets) = 0;
 
+        /**
+         * Create an empty instance buffer.
+         *
+         * The matrices of the buffer are fed to the instance matrix attributes of mesh buffers
+         * created by createMeshBuffer when a render command references the buffer.
+         *
+         * @return
+         */
+        virtual std::unique_ptr<InstanceBuffer> createInstanceBuffer() = 0;
+
+        /**
+         * Create an empty shader buffer which can be bound to the uniform blocks of shader programs.
+         *
+         * @return
+         */
+        virtual std::unique_ptr<ShaderBuffer> createShaderBuffer() = 0;
+
+        /**
+         * Create an empty storage buffer.
+         *
+         * @param format The format of the buffer elements
+         * @return
+         */
+        virtual std::unique_ptr<StorageBuffer> createStorageBuffer(StorageBuffer::Format format) = 0;
+
         struct MANA_EXPORT CustomMeshDefinition {
             enum AttributeType {
                 UNSIGNED_BYTE, // 1 Byte unsigned
@@ -82,12 +111,60 @@ namespace engine {
                 UNSIGNED_INT, // 4 Byte unsigned
                 SIGNED_INT, // 4 Byte signed
                 FLOAT, // 4 Byte float
-                DOUBLE // 8 Byte double
+                DOUBLE, // 8 Byte double
+                UNSIGNED_SHORT, // 2 Byte unsigned
+                SIGNED_SHORT, // 2 Byte signed
+                HALF_FLOAT // 2 Byte IEEE 754 half precision float
             };
 
-            char *data; // A pointer pointing to a buffer containing the mesh data in the specified format.
-            size_t dataLength; // The length of the buffer pointed at by the data pointer.
-            std::vector<std::pair<int, AttributeType>> vertex; //The count and type of the components of a vertex.
+            struct MANA_EXPORT Attribute {
+                int count; // The number of components (1 - 4)
+                AttributeType type; // The type of each component
+                bool normalized; // If true integer components are mapped to [0, 1] (unsigned) or [-1, 1] (signed) floats.
+                int location; // The shader input location or -1 to use the location following the previous attribute.
+
+                Attribute(int count, AttributeType type, bool normalized = false, int location = -1)
+                        : count(count), type(type), normalized(normalized), location(location) {}
+            };
+
+            Mesh::Primitive primitive = Mesh::TRI;
+
+            char *data = nullptr; // A pointer pointing to a buffer containing the mesh data in the specified format.
+            size_t dataLength = 0; // The length of the buffer pointed at by the data pointer.
+            std::vector<Attribute> vertex; //The count and type of the components of a vertex.
+
+            bool indexed = false;
+            std::vector<uint> indices;
+
+            // If true the instance matrix attributes are allocated at locations 5 - 8 so that the mesh can be drawn
+            // with instance buffers, the vertex attributes must not use these locations.
+            bool instanced = false;
+
+            static size_t getTypeSize(AttributeType type) {
+                switch (type) {
+                    case UNSIGNED_BYTE:
+                    case SIGNED_BYTE:
+                        return 1;
+                    case UNSIGNED_SHORT:
+                    case SIGNED_SHORT:
+                    case HALF_FLOAT:
+                        return 2;
+                    case UNSIGNED_INT:
+                    case SIGNED_INT:
+                    case FLOAT:
+                        return 4;
+                    case DOUBLE:
+                        return 8;
+                }
+                throw std::runtime_error("Invalid attribute type");
+            }
+
+            size_t getVertexSize() const {
+                size_t ret = 0;
+                for (auto &attr: vertex)
+                    ret += attr.count * getTypeSize(attr.type);
+                return ret;
+            }
         };
 
         /**
@@ -108,9 +185,17 @@ namespace engine {
          *
          * GLSL:
          *  layout (location = 0) in vec3 attr0;
-         *  layout (location = 1) in vec2ui attr1;
+         *  layout (location = 1) in uvec2 attr1;
          *  layout (location = 2) in int attr2;
          *
+         * Integer attributes which are not normalized are passed to the shader as integers,
+         * all other attributes are converted to floats.
+         *
+         * Attributes with an explicit location allow compact buffers to be drawn with shaders written
+         * for the default layout, eg { 3, FLOAT, false, 0 }, { 2, HALF_FLOAT, false, 2 } feeds position and uv.
+         *
+         * Custom mesh buffers do not bind the instance matrix attributes.
+         *
          * @return
          */
         virtual std::unique_ptr<MeshBuffer> createCustomMeshBuffer(const CustomMeshDefinition &mesh) = 0;
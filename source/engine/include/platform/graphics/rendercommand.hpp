@@ -24,6 +24,8 @@
 #include <memory>
 
 #include "meshbuffer.hpp"
+#include "instancebuffer.hpp"
+#include "storagebuffer.hpp"
 #include "texturebuffer.hpp"
 #include "shaderprogram.hpp"
 
@@ -118,7 +120,13 @@ namespace engine {
         std::reference_wrapper<ShaderProgram> shader;
         std::reference_wrapper<MeshBuffer> mesh;
         std::vector<std::reference_wrapper<TextureBuffer>> textures;
+        std::vector<std::reference_wrapper<StorageBuffer>> storageBuffers; // Bound to the slots following the textures
         RenderProperties properties;
+
+        // If set the mesh is drawn once for each of the instanceCount matrices starting at instanceOffset
+        InstanceBuffer *instances = nullptr;
+        size_t instanceOffset = 0;
+        size_t instanceCount = 0;
     };
 }
 
@@ -0,0 +1,70 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_SHADERBUFFER_HPP
+#define MANA_SHADERBUFFER_HPP
+
+#include <map>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+
+#include "renderobject.hpp"
+
+namespace engine {
+    /**
+     * The memory layout of a uniform block as reported by the shader program.
+     */
+    struct MANA_EXPORT ShaderBufferLayout {
+        size_t size = 0; // The size of the block in bytes, 0 if the program does not declare the block
+
+        // The byte offsets of the block members by name eg. "POINT_LIGHTS[0].position"
+        std::map<std::string, size_t> offsets;
+
+        size_t getOffset(const std::string &member) const {
+            auto it = offsets.find(member);
+            if (it == offsets.end())
+                throw std::runtime_error("Invalid shader buffer member: " + member);
+            return it->second;
+        }
+    };
+
+    /**
+     * A buffer holding the data of a uniform block.
+     *
+     * The data is written on the cpu according to the layout returned by ShaderProgram::getShaderBufferLayout
+     * and uploaded as a single block.
+     */
+    class MANA_EXPORT ShaderBuffer : public RenderObject {
+    public:
+        ~ShaderBuffer() override = default;
+
+        /**
+         * Replace the contents of the buffer.
+         *
+         * @param data The block data
+         * @param size The size of the data in bytes
+         */
+        virtual void upload(const uint8_t *data, size_t size) = 0;
+
+        virtual size_t getSize() const = 0;
+    };
+}
+
+#endif //MANA_SHADERBUFFER_HPP
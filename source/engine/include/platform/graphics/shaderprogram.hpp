@@ -25,6 +25,7 @@
 #include "math/matrix.hpp"
 
 #include "renderobject.hpp"
+#include "shaderbuffer.hpp"
 
 namespace engine {
     class MANA_EXPORT ShaderProgram : public RenderObject {
@@ -122,6 +123,27 @@ namespace engine {
         virtual bool setMat3(int location, const Mat3f &value) = 0;
 
         virtual bool setMat4(int location, const Mat4f &value) = 0;
+
+        /**
+         * Query the layout of a uniform block declared in the program.
+         *
+         * Blocks should be declared with the std140 layout so that the layout does not depend on the driver.
+         *
+         * @param name The name of the uniform block
+         * @return The layout of the block, with a size of 0 if the program does not declare the block.
+         */
+        virtual ShaderBufferLayout getShaderBufferLayout(const std::string &name) = 0;
+
+        /**
+         * Bind the buffer to the uniform block with the given name.
+         *
+         * @param name The name of the uniform block
+         * @param buffer The buffer containing the block data
+         * @param binding The binding point to use, programs which are used together should not share binding points
+         * for different buffers.
+         * @return False if the program does not declare the block
+         */
+        virtual bool setShaderBuffer(const std::string &name, ShaderBuffer &buffer, int binding) = 0;
     };
 }
 
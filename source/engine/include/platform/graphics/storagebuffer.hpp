@@ -0,0 +1,57 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_STORAGEBUFFER_HPP
+#define MANA_STORAGEBUFFER_HPP
+
+#include <cstdint>
+
+#include "renderobject.hpp"
+
+namespace engine {
+    /**
+     * A large array of typed elements which shaders read by index.
+     *
+     * Storage buffers are attached to render commands and bound to the texture slots following the command textures.
+     * In glsl they are accessed as samplerBuffer / usamplerBuffer with texelFetch.
+     */
+    class MANA_EXPORT StorageBuffer : public RenderObject {
+    public:
+        enum Format {
+            R32UI, // One 32 bit unsigned integer per element
+            RGBA32F // Four 32 bit floats per element
+        };
+
+        ~StorageBuffer() override = default;
+
+        /**
+         * Replace the contents of the buffer.
+         *
+         * @param data The element data
+         * @param size The size of the data in bytes
+         */
+        virtual void upload(const uint8_t *data, size_t size) = 0;
+
+        virtual size_t getSize() const = 0;
+
+        virtual Format getFormat() const = 0;
+    };
+}
+
+#endif //MANA_STORAGEBUFFER_HPP
@@ -24,6 +24,8 @@
 #include "renderobject.hpp"
 
 namespace engine {
+    struct CompressedImage;
+
     /**
      * A texture buffer.
      * The texture type, size and format is changed when calling the upload methods.
@@ -60,6 +62,12 @@ namespace engine {
             RGB_COMPRESSED,
             RGBA_COMPRESSED,
 
+            //Block compressed formats, only produced by uploading a CompressedImage
+            BC1, // RGB, 4 bits per pixel
+            BC3, // RGBA, 8 bits per pixel
+            BC5, // RG, 8 bits per pixel
+            BC7, // RGBA, 8 bits per pixel
+
             //Sized normalized float
             R8,
             RG8,
@@ -168,6 +176,27 @@ namespace engine {
 
         virtual void upload(const Image<unsigned char> &buffer) = 0;
 
+        /**
+         * Upload a block compressed image including all of its mip levels.
+         *
+         * The mip levels stored in the image are used as is and no mipmaps are generated by the implementation.
+         *
+         * @param image
+         */
+        virtual void upload(const CompressedImage &image) = 0;
+
+        /**
+         * Upload the mip levels of a block compressed image starting at baseLevel.
+         *
+         * Levels below baseLevel are not resident and are not sampled.
+         * If the texture already contains levels of the same image only the missing levels are uploaded,
+         * raising the base level releases the memory of the levels below it.
+         *
+         * @param image
+         * @param baseLevel The most detailed level to make resident
+         */
+        virtual void uploadMipLevels(const CompressedImage &image, int baseLevel) = 0;
+
         virtual Image <ColorRGBA> download() = 0;
 
         virtual void upload(CubeMapFace face, const Image <ColorRGBA> &buffer) = 0;
@@ -77,6 +77,11 @@ namespace engine {
          */
         void setProjection(const Rectf &projection);
 
+        /**
+         * Draw the texture with a custom shader.
+         *
+         * The drawn mesh only provides the position (POSITION0 / location 0) and uv (TEXCOORD0 / location 2) attributes.
+         */
         void draw(Rectf srcRect,
                   Rectf dstRect,
                   TextureBuffer &texture,
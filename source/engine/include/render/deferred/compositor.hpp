@@ -81,10 +81,18 @@ namespace engine {
                        GeometryBuffer &buffer,
                        const Layer &layer);
 
+        // Resolve the multisampled buffers of the layers once so that each layer samples a single texel per pixel
+        void resolveBuffers(GeometryBuffer &buffer, const std::vector<Layer> &pLayers);
+
+        TextureBuffer &getResolvedBuffer(GeometryBuffer &buffer, const std::string &name);
+
         ColorRGB clearColor{0, 0, 0};
         RenderDevice &device;
         std::vector<Layer> layers;
         std::unique_ptr<ShaderProgram> shader;
+
+        std::unique_ptr<RenderTarget> resolveTarget;
+        std::map<std::string, std::unique_ptr<TextureBuffer>> resolvedBuffers;
     };
 }
 
@@ -23,6 +23,7 @@
 #include <utility>
 #include <map>
 #include <typeindex>
+#include <unordered_map>
 
 #include "platform/graphics/renderer.hpp"
 #include "platform/graphics/renderdevice.hpp"
@@ -71,6 +72,20 @@ namespace engine {
         Compositor compositor;
 
         AssetRenderManager &assetRenderManager;
+
+        std::unique_ptr<InstanceBuffer> instanceBuffer;
+        std::vector<Mat4f> instanceMatrices;
+        std::vector<size_t> nodeBatches;
+        std::unordered_map<AssetPath, uint32_t, AssetPath::Hash> meshIds;
+        std::unordered_map<AssetPath, uint32_t, AssetPath::Hash> materialIds;
+        std::unordered_map<uint64_t, size_t> batchIds;
+
+        /**
+         * Group the deferred nodes of the scene by mesh and material and upload their model matrices.
+         *
+         * @param scene
+         */
+        void batchDeferredNodes(Scene &scene);
     };
 }
 
@@ -21,6 +21,7 @@
 #define MANA_GEOMETRYBUFFER_HPP
 
 #include <memory>
+#include <set>
 
 #include "platform/graphics/renderdevice.hpp"
 #include "platform/graphics/texturebuffer.hpp"
@@ -61,6 +62,17 @@ namespace engine {
 
         void addBuffer(const std::string &name, TextureBuffer::ColorFormat format);
 
+        /**
+         * Add a buffer with fixed attributes which is not reallocated when the size or samples change.
+         *
+         * Fixed buffers cannot be attached to the render target of the geometry buffer,
+         * they are used to pass data like shadow maps between the passes.
+         *
+         * @param name
+         * @param attributes
+         */
+        void addBuffer(const std::string &name, const TextureBuffer::Attributes &attributes);
+
         TextureBuffer &getBuffer(const std::string &name);
 
         /**
@@ -95,6 +107,7 @@ namespace engine {
 
         std::map<std::string, TextureBuffer::ColorFormat> formats;
         std::map<std::string, std::unique_ptr<TextureBuffer>> buffers;
+        std::set<std::string> fixedBuffers;
 
         std::vector<std::string> currentColor;
         std::string currentDepthStencil;
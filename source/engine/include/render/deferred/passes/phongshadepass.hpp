@@ -21,6 +21,7 @@
 #define MANA_PHONGSHADEPASS_HPP
 
 #include "render/deferred/renderpass.hpp"
+#include "render/lightclustering.hpp"
 
 namespace engine {
     class MANA_EXPORT PhongShadePass : public RenderPass {
@@ -45,6 +46,32 @@ namespace engine {
 
         ShaderSource vertexShader;
         ShaderSource fragmentShader;
+
+        // Marks the pixels with differing samples in the stencil buffer, only these are shaded per sample
+        std::unique_ptr<ShaderProgram> edgeShader;
+        ShaderSource edgeFragmentShader;
+
+        // The offsets of the members of a directional light in the MANA_LIGHTS block
+        struct LightOffsets {
+            size_t direction = 0;
+            size_t ambient = 0;
+            size_t diffuse = 0;
+            size_t specular = 0;
+        };
+
+        std::unique_ptr<ShaderBuffer> lightBuffer;
+        std::vector<uint8_t> lightData;
+
+        std::vector<LightOffsets> directionalOffsets;
+        size_t directionalCountOffset = 0;
+
+        LightClustering clustering;
+        std::unique_ptr<StorageBuffer> lightStorage;
+        std::unique_ptr<StorageBuffer> clusterStorage;
+
+        std::unique_ptr<TextureBuffer> defaultShadowAtlas;
+        std::unique_ptr<StorageBuffer> shadowTileStorage;
+        std::vector<float> shadowTileData;
     };
 }
 
@@ -20,26 +20,27 @@
 #ifndef MANA_PREPASS_HPP
 #define MANA_PREPASS_HPP
 
+#include <array>
+#include <unordered_map>
+
 #include "render/deferred/renderpass.hpp"
+#include "render/drawsort.hpp"
 
 namespace engine {
     /**
      * The PrePass creates buffers which are accessed by the deferred passes.
      *
-     * It executes a drawCall for each deferred command in the scene and stores the data in textures.
+     * It executes an instanced drawCall for each deferred batch in the scene and stores the data in textures.
+     * The world space position is not stored, it is reconstructed from the depth and the inverse view projection.
+     * The buffers are encoded by the functions of the "gbuffer.glsl" shader include.
      */
     class MANA_EXPORT PrePass : public RenderPass {
     public:
         static const char *DEPTH;
 
-        static const char *POSITION; // The world space position
-        static const char *NORMAL; // The vertex normal
-        static const char *TANGENT; // The vertex tangent
-        static const char *TEXTURE_NORMAL; // The texture normal in tangent space
+        static const char *NORMAL; // RG16, the octahedral encoded world space normal with the normal map applied
         static const char *DIFFUSE;
-        static const char *AMBIENT;
-        static const char *SPECULAR;
-        static const char *SHININESS_ID; //x = shininess, y = id
+        static const char *MATERIAL; // rgb = specular, a = encoded shininess
 
         explicit PrePass(RenderDevice &device);
 
@@ -58,6 +59,23 @@ namespace engine {
         std::unique_ptr<ShaderProgram> shader;
 
         std::unique_ptr<TextureBuffer> defaultTexture; //1 pixel texture with value (0, 0, 0, 0)
+
+        std::map<AssetPath, float> meshRadius; // The cached bounding sphere radius of the drawn meshes
+
+        // The per frame state identifiers of a batch, used to detect state transitions in the sorted draws
+        struct DrawState {
+            uint32_t textureSet;
+            uint32_t material;
+        };
+
+        std::vector<DrawSort::DrawItem> drawItems;
+        std::vector<DrawSort::DrawItem> drawScratch;
+        std::vector<DrawState> drawStates;
+        std::unordered_map<std::array<AssetPath, 6>, uint32_t, AssetPath::HashArray<6>> textureSetIds;
+        std::unordered_map<AssetPath, uint32_t, AssetPath::Hash> materialIds;
+        std::unordered_map<AssetPath, uint32_t, AssetPath::Hash> meshIds;
+
+        float getMeshRadius(AssetHandle<Mesh> &mesh);
     };
 }
 
@@ -17,19 +17,144 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+
 #ifndef MANA_SHADOWPASS_HPP
 #define MANA_SHADOWPASS_HPP
 
+#include <unordered_map>
+
 #include "render/deferred/renderpass.hpp"
+#include "math/dynamicbvh.hpp"
 
 namespace engine {
+    /**
+     * The ShadowPass renders the shadow maps of the lights which cast shadows into a shared depth atlas.
+     *
+     * The left half of the atlas holds the cascades of the first shadow casting directional light,
+     * the right half holds the tiles of the point and spot lights. A spot light uses one tile and a point light six.
+     * Lights which do not fit into the atlas are not shadowed.
+     *
+     * Casters which did not change for STATIC_FRAMES frames are static and are rendered into a cache atlas,
+     * a tile is only redrawn when its static casters or its light matrix change.
+     * The remaining dynamic casters are drawn on top of a copy of the cached tile.
+     *
+     * The tiles are published in the scene (Scene::shadowTiles) and the atlas in the geometry buffer (SHADOW_ATLAS),
+     * the pass has to run before the PhongShadePass.
+     */
     class MANA_EXPORT ShadowPass : public RenderPass {
     public:
-        ~ShadowPass() override = default;
+        static const char *SHADOW_ATLAS;
+
+        static const int CASCADE_COUNT;
+        static const int LOCAL_TILE_COUNT;
+
+        // The distance towards a directional light up to which casters outside of the view cast shadows into it
+        static const float CASTER_DISTANCE;
+
+        static const int STATIC_FRAMES;
+
+        /**
+         * @param device
+         * @param cascadeSize The size of a cascade tile, the atlas is 4 * cascadeSize by 2 * cascadeSize texels
+         */
+        explicit ShadowPass(RenderDevice &device, int cascadeSize = 1024);
+
+        ~ShadowPass() override;
 
         void prepareBuffer(GeometryBuffer &gBuffer) override;
 
         void render(GeometryBuffer &gBuffer, Scene &scene, AssetRenderManager &assetRenderManager) override;
+
+        /**
+         * The world space bounds of the casters which can shadow the view of the camera for a directional light.
+         */
+        static AABB getDirectionalCasterBounds(const Camera &camera, const Light &light);
+
+        /**
+         * @return The number of tiles redrawn in the last frame, tiles which were reused from the cache are not counted
+         */
+        size_t getRenderedTileCount() const { return renderedTiles; }
+
+    private:
+        struct Caster {
+            int proxy = -1; // The proxy in the caster tree or -1 if the caster has no bounds
+            Mat4f model;
+            AssetPath mesh;
+            int unchangedFrames = 0;
+            size_t node = 0; // The index of the node in the shadow casters of the current frame
+            size_t frame = 0; // The last frame in which the caster was part of the scene
+        };
+
+        struct TileCache {
+            bool valid = false;
+            size_t staticHash = 0; // Identifies the light matrix and the static casters drawn into the cache atlas
+            bool hasDynamic = false; // The atlas tile contains dynamic casters on top of the cached tile
+        };
+
+        struct ShadowView {
+            Mat4f viewProjection;
+            size_t key; // The hash of the view projection matrix
+            int tile; // The atlas tile, cascades use the tiles [0, CASCADE_COUNT)
+        };
+
+        // An instanced draw of the casters sharing a mesh
+        struct CasterDraw {
+            size_t view;
+            size_t node; // The first caster node of the draw, which supplies the mesh
+            size_t offset;
+            size_t count;
+        };
+
+        RenderDevice &renderDevice;
+
+        int cascadeSize;
+        Vec2i atlasSize;
+
+        ShaderSource casterVertexShader;
+        ShaderSource casterFragmentShader;
+        ShaderSource tileVertexShader;
+        ShaderSource tileFragmentShader;
+
+        std::unique_ptr<ShaderProgram> casterShader;
+        std::unique_ptr<ShaderProgram> tileShader; // Clears a tile or copies the cached tile into the atlas
+
+        std::unique_ptr<TextureBuffer> staticAtlas;
+        std::unique_ptr<RenderTarget> renderTarget;
+        std::unique_ptr<InstanceBuffer> instanceBuffer;
+
+        DynamicBVH casterTree;
+        std::unordered_map<int, Caster> casters;
+        std::vector<size_t> unboundedCasters;
+        size_t frame = 0;
+
+        std::vector<TileCache> tileCaches;
+        std::unordered_map<size_t, int> localTiles; // The local tiles of the last frame by view key
+
+        std::vector<ShadowView> views;
+        std::vector<CasterDraw> staticDraws;
+        std::vector<CasterDraw> dynamicDraws;
+        std::vector<Mat4f> instanceMatrices;
+
+        size_t renderedTiles = 0;
+
+        void updateCasters(Scene &scene);
+
+        void addViews(Scene &scene);
+
+        void addDraws(Scene &scene, size_t view, std::vector<size_t> &nodes, std::vector<CasterDraw> &draws);
+
+        // Draw the casters of a view into the tile of the attached atlas, the tile is cleared or copied from the cache first
+        void renderTile(Scene &scene,
+                        AssetRenderManager &assetRenderManager,
+                        MeshBuffer &screenQuad,
+                        size_t view,
+                        bool copyStatic,
+                        const std::vector<CasterDraw> &draws,
+                        size_t &drawIndex);
+
+        Vec2i getTileOffset(int tile) const;
+
+        int getTileSize(int tile) const;
     };
 }
 
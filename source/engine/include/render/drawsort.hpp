@@ -0,0 +1,65 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_DRAWSORT_HPP
+#define MANA_DRAWSORT_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace engine {
+    /**
+     * Sort keys for ordering draws by their state to minimize state changes.
+     *
+     * The key packs from the most to the least significant bits:
+     * shader (6 bits), texture set (16 bits), material (10 bits), mesh (16 bits) and depth bucket (16 bits).
+     * Identifiers which do not fit into their field are clamped, which only affects the quality of the ordering.
+     */
+    namespace DrawSort {
+        struct MANA_EXPORT DrawItem {
+            uint64_t key;
+            uint32_t index; // The index of the draw in the unsorted draw list
+        };
+
+        MANA_EXPORT uint64_t makeKey(uint32_t shader,
+                                     uint32_t textureSet,
+                                     uint32_t material,
+                                     uint32_t mesh,
+                                     uint32_t depthBucket);
+
+        /**
+         * Quantize a view depth logarithmically so that the resolution is highest near the camera.
+         *
+         * @return The bucket in the range [0, 65535]
+         */
+        MANA_EXPORT uint32_t getDepthBucket(float depth, float nearClip, float farClip);
+
+        /**
+         * Stable least significant digit radix sort of the items by key.
+         *
+         * Byte positions which are equal in all keys are skipped.
+         *
+         * @param items The items to sort
+         * @param scratch Storage for the sort passes, reused across calls to avoid allocations
+         */
+        MANA_EXPORT void sort(std::vector<DrawItem> &items, std::vector<DrawItem> &scratch);
+    }
+}
+
+#endif //MANA_DRAWSORT_HPP
@@ -0,0 +1,59 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_FRUSTUMCULLING_HPP
+#define MANA_FRUSTUMCULLING_HPP
+
+#include <cstdint>
+
+#include "asset/scene.hpp"
+#include "async/threadpool.hpp"
+#include "math/frustum.hpp"
+
+namespace engine {
+    namespace FrustumCulling {
+        /**
+         * Remove the deferred and forward draw nodes whose bounds lie outside the view frustum of the scene camera.
+         *
+         * The nodes are tested in batches on the thread pool, the order of the remaining nodes is preserved.
+         *
+         * @param scene The scene to cull
+         * @param pool The pool to run the batches on
+         * @return The number of removed nodes
+         */
+        MANA_EXPORT size_t cull(Scene &scene, ThreadPool &pool);
+
+        /**
+         * Test world space bounding spheres against the planes of the frustum.
+         *
+         * The spheres are passed as separate component arrays so that the plane tests can be vectorized.
+         *
+         * @param visible Receives 1 for each sphere which intersects the frustum and 0 otherwise
+         */
+        MANA_EXPORT void testSpheres(const Frustum &frustum,
+                                     const float *x,
+                                     const float *y,
+                                     const float *z,
+                                     const float *radius,
+                                     size_t count,
+                                     uint8_t *visible);
+    }
+}
+
+#endif //MANA_FRUSTUMCULLING_HPP
@@ -0,0 +1,99 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_LIGHTCLUSTERING_HPP
+#define MANA_LIGHTCLUSTERING_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "asset/camera.hpp"
+#include "asset/light.hpp"
+#include "async/threadpool.hpp"
+#include "math/bounds.hpp"
+#include "math/vector2.hpp"
+
+namespace engine {
+    /**
+     * Assigns point and spot lights to the clusters of a view frustum grid.
+     *
+     * The frustum is divided into screen space tiles and logarithmically distributed depth slices.
+     * A cluster with tile (x, y) in slice z has the index (z * TILES_Y + y) * TILES_X + x,
+     * the tile origin is the bottom left corner of the viewport.
+     *
+     * The cluster data contains an (offset, count) pair for each cluster followed by the light indices,
+     * the offsets are absolute indices into the cluster data.
+     *
+     * The light data contains LIGHT_TEXELS rgba texels for each light:
+     * (world position, type), (direction, cos cutOff), (constant, linear, quadratic, cos outerCutOff),
+     * ambient, diffuse, specular and (first shadow tile, 0, 0, 0).
+     * The type is 0 for point and 1 for spot lights, the shadow tile is -1 for lights without shadows.
+     *
+     * Directional lights affect every fragment and are not clustered.
+     */
+    class MANA_EXPORT LightClustering {
+    public:
+        static const int TILES_X;
+        static const int TILES_Y;
+        static const int SLICES;
+        static const int CLUSTER_COUNT;
+        static const size_t MAX_LIGHTS_PER_CLUSTER; // Lights exceeding the capacity of a cluster are ignored
+        static const size_t LIGHT_TEXELS;
+
+        /**
+         * Rebuild the cluster assignment, the slices are tested in parallel on the pool.
+         *
+         * @param lightShadows The first shadow tile of each light as in Scene::lightShadows, may be empty
+         */
+        void update(const Camera &camera,
+                    const std::vector<Light> &lights,
+                    const std::vector<int> &lightShadows,
+                    ThreadPool &pool);
+
+        const std::vector<float> &getLightData() const { return lightData; }
+
+        const std::vector<uint32_t> &getClusterData() const { return clusterData; }
+
+        size_t getLightCount() const { return lightCount; }
+
+        /**
+         * @return The scale and bias which map a view depth d to the slice floor(log(d) * scale - bias)
+         */
+        Vec2f getSliceParameters() const { return sliceParameters; }
+
+    private:
+        void assignSlice(int slice, const Mat4f &projection);
+
+        std::vector<float> lightData;
+        std::vector<uint32_t> clusterData;
+        size_t lightCount = 0;
+        Vec2f sliceParameters;
+
+        std::vector<float> sliceDepths; // The view depths of the slice boundaries
+
+        // The view space bounding spheres of the clustered lights
+        std::vector<BoundingSphere> lightBounds;
+
+        // Scratch storage of MAX_LIGHTS_PER_CLUSTER indices per cluster, written by the slice tasks
+        std::vector<uint32_t> clusterLights;
+        std::vector<uint32_t> clusterCounts;
+    };
+}
+
+#endif //MANA_LIGHTCLUSTERING_HPP
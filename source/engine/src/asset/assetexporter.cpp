@@ -26,6 +26,27 @@ void streamWriteFunc(void *context, void *data, int size) {
     stream.write(static_cast<char *>(data), size);
 }
 
+static void writeUInt(std::ostream &stream, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        stream.put(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+static uint32_t getCompressedFormatId(engine::TextureBuffer::ColorFormat format) {
+    switch (format) {
+        case engine::TextureBuffer::BC1:
+            return 1;
+        case engine::TextureBuffer::BC3:
+            return 3;
+        case engine::TextureBuffer::BC5:
+            return 5;
+        case engine::TextureBuffer::BC7:
+            return 7;
+        default:
+            throw std::runtime_error("Not a block compressed format");
+    }
+}
+
 namespace engine {
     void AssetExporter::exportImage(std::ostream &stream, const Image<ColorRGBA> &image) {
         int r = stbi_write_png_to_func(&streamWriteFunc,
@@ -39,4 +60,20 @@ namespace engine {
             throw std::runtime_error("Failed to write image");
         }
     }
-}
\ No newline at end of file
+
+    void AssetExporter::exportCompressedImage(std::ostream &stream, const CompressedImage &image) {
+        stream.write(COMPRESSED_IMAGE_MAGIC.data(), COMPRESSED_IMAGE_MAGIC.size());
+        writeUInt(stream, COMPRESSED_IMAGE_VERSION, 4);
+        writeUInt(stream, getCompressedFormatId(image.format), 4);
+        writeUInt(stream, image.size.x, 4);
+        writeUInt(stream, image.size.y, 4);
+        writeUInt(stream, image.levels.size(), 4);
+        for (auto &level: image.levels) {
+            writeUInt(stream, level.size(), 8);
+            stream.write(level.data(), level.size());
+        }
+        if (!stream) {
+            throw std::runtime_error("Failed to write compressed image");
+        }
+    }
+}
@@ -32,6 +32,9 @@
 
 #include "async/threadpool.hpp"
 #include "asset/mesh.hpp"
+#include "asset/compressedimage.hpp"
+#include "asset/meshoptimizer.hpp"
+#include "asset/meshsimplifier.hpp"
 
 #include "platform/audio/audioformat.hpp"
 
@@ -99,6 +102,65 @@ namespace engine {
         }
     }
 
+    static bool isCompressedImage(const std::string &buffer) {
+        return buffer.compare(0, COMPRESSED_IMAGE_MAGIC.size(), COMPRESSED_IMAGE_MAGIC) == 0;
+    }
+
+    static uint64_t readUInt(const std::string &buffer, size_t &offset, int bytes) {
+        if (offset + bytes > buffer.size())
+            throw std::runtime_error("Unexpected end of compressed image data");
+        uint64_t ret = 0;
+        for (int i = 0; i < bytes; i++) {
+            ret |= static_cast<uint64_t>(static_cast<uint8_t>(buffer[offset + i])) << (i * 8);
+        }
+        offset += bytes;
+        return ret;
+    }
+
+    static CompressedImage readCompressedImage(const std::string &buffer) {
+        if (!isCompressedImage(buffer))
+            throw std::runtime_error("Invalid compressed image magic");
+
+        size_t offset = COMPRESSED_IMAGE_MAGIC.size();
+        auto version = readUInt(buffer, offset, 4);
+        if (version != COMPRESSED_IMAGE_VERSION)
+            throw std::runtime_error("Unsupported compressed image version " + std::to_string(version));
+
+        CompressedImage ret;
+        auto format = readUInt(buffer, offset, 4);
+        switch (format) {
+            case 1:
+                ret.format = TextureBuffer::BC1;
+                break;
+            case 3:
+                ret.format = TextureBuffer::BC3;
+                break;
+            case 5:
+                ret.format = TextureBuffer::BC5;
+                break;
+            case 7:
+                ret.format = TextureBuffer::BC7;
+                break;
+            default:
+                throw std::runtime_error("Unsupported compressed image format " + std::to_string(format));
+        }
+
+        ret.size.x = static_cast<int>(readUInt(buffer, offset, 4));
+        ret.size.y = static_cast<int>(readUInt(buffer, offset, 4));
+
+        auto levelCount = readUInt(buffer, offset, 4);
+        for (uint64_t i = 0; i < levelCount; i++) {
+            auto size = readUInt(buffer, offset, 8);
+            if (size != CompressedImage::getDataSize(ret.format, ret.getLevelSize(static_cast<int>(i)))
+                || offset + size > buffer.size())
+                throw std::runtime_error("Invalid compressed image level size");
+            ret.levels.emplace_back(buffer.begin() + offset, buffer.begin() + offset + size);
+            offset += size;
+        }
+
+        return ret;
+    }
+
     static Texture readJsonTexture(std::istream &stream, Archive &archive) {
         std::string buffer((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
         nlohmann::json j = nlohmann::json::parse(buffer);
@@ -123,6 +185,20 @@ namespace engine {
         return texture;
     }
 
+    static void addMeshLods(AssetBundle &bundle,
+                            const std::string &name,
+                            const Mesh &mesh,
+                            const std::vector<MeshSimplifier::LodTarget> &targets) {
+        std::vector<Mesh> levels;
+        auto lod = MeshSimplifier::generateLods(mesh, targets, levels);
+        if (levels.empty())
+            return;
+        for (int i = 0; i < levels.size(); i++) {
+            bundle.add<Mesh>(MeshLod::getLevelName(name, i + 1), levels.at(i));
+        }
+        bundle.add<MeshLod>(name, lod);
+    }
+
     static AssetBundle readJsonBundle(std::istream &stream, Archive &archive, ThreadPool &pool) {
         std::string buffer((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
         nlohmann::json j = nlohmann::json::parse(buffer);
@@ -162,7 +238,41 @@ namespace engine {
                 std::string bundle = element["bundle"];
                 std::string asset = element["asset"];
 
-                ret.add<Mesh>(name, refBundles.at(bundle).get<Mesh>(asset));
+                auto &refBundle = refBundles.at(bundle);
+                auto mesh = refBundle.get<Mesh>(asset);
+
+                //Reordering the mesh data for vertex cache, overdraw and vertex fetch efficiency is opt in
+                //because it runs on every load of the bundle
+                if (element.value("optimize", false)) {
+                    MeshOptimizer::optimize(mesh);
+                }
+
+                ret.add<Mesh>(name, mesh);
+
+                auto lodIterator = element.find("lods");
+                if (lodIterator != element.end()) {
+                    //Generating the lod chain is opt in because it runs on every load of the bundle,
+                    //true selects the default targets and an array specifies the targets
+                    std::vector<MeshSimplifier::LodTarget> targets;
+                    if (lodIterator->is_boolean()) {
+                        if (lodIterator->get<bool>())
+                            targets = MeshSimplifier::getDefaultTargets();
+                    } else {
+                        for (auto &target: *lodIterator) {
+                            targets.emplace_back(MeshSimplifier::LodTarget{target["ratio"].get<float>(),
+                                                                           target["error"].get<float>()});
+                        }
+                    }
+                    if (!targets.empty())
+                        addMeshLods(ret, name, mesh, targets);
+                } else if (!asset.empty() && refBundle.has<MeshLod>(asset)) {
+                    auto &lod = refBundle.get<MeshLod>(asset);
+                    for (int i = 1; i < lod.getLevelCount(); i++) {
+                        ret.add<Mesh>(MeshLod::getLevelName(name, i),
+                                      refBundle.get<Mesh>(MeshLod::getLevelName(asset, i)));
+                    }
+                    ret.add<MeshLod>(name, lod);
+                }
             }
         }
 
@@ -244,7 +354,11 @@ namespace engine {
                 std::string bundle = element["bundle"];
                 std::string asset = element.value("asset", "");
 
-                ret.add<Image<ColorRGBA>>(name, refBundles.at(bundle).get<Image<ColorRGBA>>(asset));
+                auto &refBundle = refBundles.at(bundle);
+                if (refBundle.has<CompressedImage>(asset))
+                    ret.add<CompressedImage>(name, refBundle.get<CompressedImage>(asset));
+                else
+                    ret.add<Image<ColorRGBA>>(name, refBundle.get<Image<ColorRGBA>>(asset));
             }
         }
 
@@ -290,6 +404,8 @@ namespace engine {
             ret.vertices.emplace_back(Vertex(pos, norm, uv, tangent, bitangent));
         }
 
+        ret.computeBounds();
+
         return ret;
     }
 
@@ -340,7 +456,8 @@ namespace engine {
         for (auto i = 0; i < scene.mNumMeshes; i++) {
             const auto &mesh = dynamic_cast<const aiMesh &>(*scene.mMeshes[i]);
             std::string name = mesh.mName.C_Str();
-            ret.add<Mesh>(name, convertMesh(mesh));
+            auto converted = convertMesh(mesh);
+            ret.add<Mesh>(name, converted);
         }
 
         for (auto i = 0; i < scene.mNumMaterials; i++) {
@@ -477,6 +594,12 @@ namespace engine {
         if (hint.empty()) {
             std::string buffer((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
 
+            if (isCompressedImage(buffer)) {
+                AssetBundle ret;
+                ret.add<CompressedImage>("0", readCompressedImage(buffer));
+                return ret;
+            }
+
             try {
                 //Try to read source as image
                 int x, y, n;
@@ -515,6 +638,11 @@ namespace engine {
             if (hint == ".json") {
                 //Try to read source as json
                 return readJsonBundle(stream, *archive, ThreadPool::getPool());
+            } else if (hint == ".ctex") {
+                std::string buffer((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+                AssetBundle ret;
+                ret.add<CompressedImage>("0", readCompressedImage(buffer));
+                return ret;
             } else {
                 Assimp::Importer importer;
                 if (importer.IsExtensionSupported(hint)) {
@@ -524,6 +652,13 @@ namespace engine {
                 } else {
                     std::string buffer((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
 
+                    //Cooked images keep the path of their source image
+                    if (isCompressedImage(buffer)) {
+                        AssetBundle ret;
+                        ret.add<CompressedImage>("0", readCompressedImage(buffer));
+                        return ret;
+                    }
+
                     try {
                         //Try to read source as image
 
@@ -0,0 +1,443 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "asset/meshoptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace engine {
+    namespace MeshOptimizer {
+        // The cache size which the vertex cache optimization is tuned for
+        static const int OPTIMIZER_CACHE_SIZE = 32;
+
+        struct VertexHash {
+            size_t operator()(const Vertex &vertex) const {
+                // FNV-1a over the vertex bytes
+                size_t hash = 14695981039346656037ULL;
+                auto *bytes = reinterpret_cast<const unsigned char *>(vertex.data);
+                for (size_t i = 0; i < sizeof(vertex.data); i++) {
+                    hash ^= bytes[i];
+                    hash *= 1099511628211ULL;
+                }
+                return hash;
+            }
+        };
+
+        struct VertexEqual {
+            bool operator()(const Vertex &lhs, const Vertex &rhs) const {
+                return std::memcmp(lhs.data, rhs.data, sizeof(lhs.data)) == 0;
+            }
+        };
+
+        static bool isTriangleMesh(const Mesh &mesh) {
+            return mesh.primitive == Mesh::TRI && mesh.indexed && mesh.indices.size() % 3 == 0;
+        }
+
+        float computeACMR(const Mesh &mesh, int cacheSize) {
+            if (mesh.primitive != Mesh::TRI)
+                throw std::runtime_error("Mesh is not a triangle mesh");
+
+            if (!mesh.indexed)
+                return mesh.vertices.empty() ? 0 : 3;
+
+            if (mesh.indices.empty())
+                return 0;
+
+            std::deque<uint> cache;
+            size_t misses = 0;
+            for (auto index: mesh.indices) {
+                if (std::find(cache.begin(), cache.end(), index) == cache.end()) {
+                    misses++;
+                    cache.push_back(index);
+                    if (cache.size() > cacheSize)
+                        cache.pop_front();
+                }
+            }
+
+            return static_cast<float>(misses) / static_cast<float>(mesh.indices.size() / 3);
+        }
+
+        size_t weldVertices(Mesh &mesh) {
+            std::unordered_map<Vertex, uint, VertexHash, VertexEqual> uniqueVertices;
+            std::vector<Vertex> vertices;
+            std::vector<uint> remap(mesh.vertices.size());
+
+            for (size_t i = 0; i < mesh.vertices.size(); i++) {
+                auto &vertex = mesh.vertices.at(i);
+                auto it = uniqueVertices.find(vertex);
+                if (it == uniqueVertices.end()) {
+                    auto index = static_cast<uint>(vertices.size());
+                    uniqueVertices[vertex] = index;
+                    vertices.emplace_back(vertex);
+                    remap[i] = index;
+                } else {
+                    remap[i] = it->second;
+                }
+            }
+
+            if (mesh.indexed) {
+                for (auto &index: mesh.indices) {
+                    index = remap.at(index);
+                }
+            } else {
+                mesh.indices = std::move(remap);
+                mesh.indexed = true;
+            }
+
+            size_t ret = mesh.vertices.size() - vertices.size();
+            mesh.vertices = std::move(vertices);
+            return ret;
+        }
+
+        static float getVertexScore(int cachePosition, int remainingTriangles) {
+            if (remainingTriangles == 0)
+                return -1;
+
+            float score = 0;
+            if (cachePosition >= 0) {
+                if (cachePosition < 3) {
+                    // The vertices of the last triangle get a fixed score to avoid favoring a strip order
+                    score = 0.75f;
+                } else {
+                    float scale = 1.0f / (OPTIMIZER_CACHE_SIZE - 3);
+                    score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scale, 1.5f);
+                }
+            }
+
+            // Boost vertices with few remaining triangles to finish them off early
+            score += 2.0f * std::pow(static_cast<float>(remainingTriangles), -0.5f);
+
+            return score;
+        }
+
+        void optimizeVertexCache(Mesh &mesh) {
+            if (!isTriangleMesh(mesh))
+                throw std::runtime_error("Mesh is not a indexed triangle mesh");
+
+            auto &indices = mesh.indices;
+            size_t triangleCount = indices.size() / 3;
+            size_t vertexCount = mesh.vertices.size();
+
+            if (triangleCount == 0)
+                return;
+
+            // Build the vertex to triangle adjacency
+            std::vector<int> remaining(vertexCount, 0);
+            for (auto index: indices) {
+                remaining.at(index)++;
+            }
+
+            std::vector<size_t> offsets(vertexCount + 1, 0);
+            for (size_t i = 0; i < vertexCount; i++) {
+                offsets[i + 1] = offsets[i] + remaining[i];
+            }
+
+            std::vector<uint> adjacency(indices.size());
+            std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < triangleCount; i++) {
+                for (int v = 0; v < 3; v++) {
+                    adjacency[fill[indices[i * 3 + v]]++] = static_cast<uint>(i);
+                }
+            }
+
+            std::vector<int> cachePosition(vertexCount, -1);
+            std::vector<float> vertexScore(vertexCount);
+            for (size_t i = 0; i < vertexCount; i++) {
+                vertexScore[i] = getVertexScore(-1, remaining[i]);
+            }
+
+            std::vector<float> triangleScore(triangleCount);
+            std::vector<bool> emitted(triangleCount, false);
+            for (size_t i = 0; i < triangleCount; i++) {
+                triangleScore[i] = vertexScore[indices[i * 3]]
+                                   + vertexScore[indices[i * 3 + 1]]
+                                   + vertexScore[indices[i * 3 + 2]];
+            }
+
+            std::vector<uint> output;
+            output.reserve(indices.size());
+
+            std::vector<uint> cache;
+            std::vector<uint> newCache;
+            cache.reserve(OPTIMIZER_CACHE_SIZE + 3);
+            newCache.reserve(OPTIMIZER_CACHE_SIZE + 3);
+
+            size_t scanPosition = 0;
+            long bestTriangle = -1;
+
+            for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+                if (bestTriangle < 0) {
+                    // No candidate in the cache, find the best remaining triangle
+                    float bestScore = -1;
+                    for (size_t i = scanPosition; i < triangleCount; i++) {
+                        if (!emitted[i] && triangleScore[i] > bestScore) {
+                            bestScore = triangleScore[i];
+                            bestTriangle = static_cast<long>(i);
+                        }
+                    }
+                    while (scanPosition < triangleCount && emitted[scanPosition]) {
+                        scanPosition++;
+                    }
+                }
+
+                auto triangle = static_cast<size_t>(bestTriangle);
+                emitted[triangle] = true;
+
+                // Emit the triangle and remove it from the adjacency of its vertices
+                for (int v = 0; v < 3; v++) {
+                    auto vertex = indices[triangle * 3 + v];
+                    output.emplace_back(vertex);
+
+                    auto begin = adjacency.begin() + static_cast<long>(offsets[vertex]);
+                    auto end = begin + remaining[vertex];
+                    auto it = std::find(begin, end, static_cast<uint>(triangle));
+                    std::iter_swap(it, end - 1);
+                    remaining[vertex]--;
+                }
+
+                // Move the vertices of the triangle to the front of the lru cache
+                newCache.clear();
+                for (int v = 0; v < 3; v++) {
+                    newCache.emplace_back(indices[triangle * 3 + v]);
+                }
+                for (auto vertex: cache) {
+                    if (std::find(newCache.begin(), newCache.begin() + 3, vertex) == newCache.begin() + 3) {
+                        newCache.emplace_back(vertex);
+                    }
+                }
+                std::swap(cache, newCache);
+
+                for (size_t i = 0; i < cache.size(); i++) {
+                    auto vertex = cache[i];
+                    cachePosition[vertex] = i < OPTIMIZER_CACHE_SIZE ? static_cast<int>(i) : -1;
+                    vertexScore[vertex] = getVertexScore(cachePosition[vertex], remaining[vertex]);
+                }
+
+                // Update the scores of the triangles adjacent to the cached vertices and select the next candidate
+                bestTriangle = -1;
+                float bestScore = -1;
+                for (auto vertex: cache) {
+                    auto begin = offsets[vertex];
+                    for (size_t i = begin; i < begin + remaining[vertex]; i++) {
+                        auto t = adjacency[i];
+                        triangleScore[t] = vertexScore[indices[t * 3]]
+                                           + vertexScore[indices[t * 3 + 1]]
+                                           + vertexScore[indices[t * 3 + 2]];
+                        if (triangleScore[t] > bestScore) {
+                            bestScore = triangleScore[t];
+                            bestTriangle = t;
+                        }
+                    }
+                }
+
+                if (cache.size() > OPTIMIZER_CACHE_SIZE)
+                    cache.resize(OPTIMIZER_CACHE_SIZE);
+            }
+
+            indices = std::move(output);
+        }
+
+        static Vec3f getTriangleNormal(const Mesh &mesh, size_t triangle, float &area) {
+            auto a = mesh.vertices.at(mesh.indices.at(triangle * 3)).position();
+            auto b = mesh.vertices.at(mesh.indices.at(triangle * 3 + 1)).position();
+            auto c = mesh.vertices.at(mesh.indices.at(triangle * 3 + 2)).position();
+            auto u = b - a;
+            auto v = c - a;
+            Vec3f normal(u.y * v.z - u.z * v.y,
+                         u.z * v.x - u.x * v.z,
+                         u.x * v.y - u.y * v.x);
+            area = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z) / 2;
+            return normal;
+        }
+
+        void optimizeOverdraw(Mesh &mesh, float threshold) {
+            if (!isTriangleMesh(mesh))
+                throw std::runtime_error("Mesh is not a indexed triangle mesh");
+
+            size_t triangleCount = mesh.indices.size() / 3;
+            if (triangleCount == 0)
+                return;
+
+            // Split the triangles into clusters at the hard boundaries where every vertex of a triangle misses the cache
+            std::vector<size_t> hardBoundaries;
+            std::vector<int> misses(triangleCount);
+            {
+                std::deque<uint> cache;
+                for (size_t i = 0; i < triangleCount; i++) {
+                    misses[i] = 0;
+                    for (int v = 0; v < 3; v++) {
+                        auto index = mesh.indices[i * 3 + v];
+                        if (std::find(cache.begin(), cache.end(), index) == cache.end()) {
+                            misses[i]++;
+                            cache.push_back(index);
+                            if (cache.size() > OPTIMIZER_CACHE_SIZE)
+                                cache.pop_front();
+                        }
+                    }
+                    if (i == 0 || misses[i] == 3)
+                        hardBoundaries.emplace_back(i);
+                }
+                hardBoundaries.emplace_back(triangleCount);
+            }
+
+            // Split clusters further at soft boundaries where the local cache miss ratio is low enough
+            std::vector<size_t> boundaries;
+            for (size_t c = 0; c + 1 < hardBoundaries.size(); c++) {
+                auto begin = hardBoundaries[c];
+                auto end = hardBoundaries[c + 1];
+
+                int clusterMisses = 0;
+                for (size_t i = begin; i < end; i++) {
+                    clusterMisses += misses[i];
+                }
+                float clusterAcmr = static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+                boundaries.emplace_back(begin);
+                int localMisses = 0;
+                size_t localBegin = begin;
+                for (size_t i = begin; i < end; i++) {
+                    localMisses += misses[i];
+                    float localAcmr = static_cast<float>(localMisses) / static_cast<float>(i + 1 - localBegin);
+                    // Splitting resets the cache, so require a few triangles per cluster
+                    if (i + 1 < end && i + 1 - localBegin >= 8 && localAcmr <= clusterAcmr * threshold) {
+                        boundaries.emplace_back(i + 1);
+                        localBegin = i + 1;
+                        localMisses = 0;
+                    }
+                }
+            }
+            boundaries.emplace_back(triangleCount);
+
+            // Compute the area weighted centroid of the mesh and of each cluster
+            struct Cluster {
+                size_t begin;
+                size_t end;
+                float sortKey;
+            };
+
+            std::vector<Vec3f> clusterCentroids;
+            std::vector<Vec3f> clusterNormals;
+            Vec3f meshCentroid;
+            float meshArea = 0;
+
+            for (size_t c = 0; c + 1 < boundaries.size(); c++) {
+                Vec3f centroid;
+                Vec3f normal;
+                float clusterArea = 0;
+                for (size_t i = boundaries[c]; i < boundaries[c + 1]; i++) {
+                    float area;
+                    auto n = getTriangleNormal(mesh, i, area);
+                    normal += n;
+
+                    auto a = mesh.vertices.at(mesh.indices.at(i * 3)).position();
+                    auto b = mesh.vertices.at(mesh.indices.at(i * 3 + 1)).position();
+                    auto d = mesh.vertices.at(mesh.indices.at(i * 3 + 2)).position();
+                    centroid += (a + b + d) * (area / 3.0f);
+                    clusterArea += area;
+                }
+
+                meshCentroid += centroid;
+                meshArea += clusterArea;
+
+                if (clusterArea > 0)
+                    centroid = centroid * (1.0f / clusterArea);
+
+                clusterCentroids.emplace_back(centroid);
+                clusterNormals.emplace_back(normal);
+            }
+
+            if (meshArea > 0)
+                meshCentroid = meshCentroid * (1.0f / meshArea);
+
+            std::vector<Cluster> clusters;
+            for (size_t c = 0; c + 1 < boundaries.size(); c++) {
+                auto offset = clusterCentroids[c] - meshCentroid;
+                auto &normal = clusterNormals[c];
+                float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+                float key = 0;
+                if (length > 0) {
+                    key = (offset.x * normal.x + offset.y * normal.y + offset.z * normal.z) / length;
+                }
+                clusters.emplace_back(Cluster{boundaries[c], boundaries[c + 1], key});
+            }
+
+            // Outward facing clusters occlude the inward facing clusters, so draw them first
+            std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &lhs, const Cluster &rhs) {
+                return lhs.sortKey > rhs.sortKey;
+            });
+
+            std::vector<uint> output;
+            output.reserve(mesh.indices.size());
+            for (auto &cluster: clusters) {
+                output.insert(output.end(),
+                              mesh.indices.begin() + static_cast<long>(cluster.begin * 3),
+                              mesh.indices.begin() + static_cast<long>(cluster.end * 3));
+            }
+            mesh.indices = std::move(output);
+        }
+
+        void optimizeVertexFetch(Mesh &mesh) {
+            if (!mesh.indexed)
+                throw std::runtime_error("Mesh is not indexed");
+
+            const uint unassigned = std::numeric_limits<uint>::max();
+            std::vector<uint> remap(mesh.vertices.size(), unassigned);
+            std::vector<Vertex> vertices;
+            vertices.reserve(mesh.vertices.size());
+
+            for (auto &index: mesh.indices) {
+                auto &target = remap.at(index);
+                if (target == unassigned) {
+                    target = static_cast<uint>(vertices.size());
+                    vertices.emplace_back(mesh.vertices[index]);
+                }
+                index = target;
+            }
+
+            mesh.vertices = std::move(vertices);
+        }
+
+        Statistics optimize(Mesh &mesh) {
+            Statistics ret;
+            ret.verticesBefore = mesh.vertices.size();
+            ret.verticesAfter = mesh.vertices.size();
+
+            if (mesh.primitive != Mesh::TRI || (mesh.indexed && mesh.indices.size() % 3 != 0))
+                return ret;
+
+            ret.acmrBefore = computeACMR(mesh);
+
+            weldVertices(mesh);
+            optimizeVertexCache(mesh);
+            optimizeOverdraw(mesh);
+            optimizeVertexFetch(mesh);
+
+            ret.verticesAfter = mesh.vertices.size();
+            ret.acmrAfter = computeACMR(mesh);
+
+            return ret;
+        }
+    }
+}
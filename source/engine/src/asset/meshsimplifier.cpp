@@ -0,0 +1,417 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "asset/meshsimplifier.hpp"
+#include "asset/meshoptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace engine {
+    namespace MeshSimplifier {
+        // Symmetric 4x4 matrix storing the weighted sum of squared distances to a set of planes
+        struct Quadric {
+            double a2 = 0, ab = 0, ac = 0, ad = 0;
+            double b2 = 0, bc = 0, bd = 0;
+            double c2 = 0, cd = 0;
+            double d2 = 0;
+            double weight = 0; // The sum of the plane weights
+
+            static Quadric fromPlane(double a, double b, double c, double d, double weight) {
+                Quadric ret;
+                ret.a2 = a * a * weight;
+                ret.ab = a * b * weight;
+                ret.ac = a * c * weight;
+                ret.ad = a * d * weight;
+                ret.b2 = b * b * weight;
+                ret.bc = b * c * weight;
+                ret.bd = b * d * weight;
+                ret.c2 = c * c * weight;
+                ret.cd = c * d * weight;
+                ret.d2 = d * d * weight;
+                ret.weight = weight;
+                return ret;
+            }
+
+            Quadric &operator+=(const Quadric &other) {
+                a2 += other.a2;
+                ab += other.ab;
+                ac += other.ac;
+                ad += other.ad;
+                b2 += other.b2;
+                bc += other.bc;
+                bd += other.bd;
+                c2 += other.c2;
+                cd += other.cd;
+                d2 += other.d2;
+                weight += other.weight;
+                return *this;
+            }
+
+            double evaluate(const Vec3f &p) const {
+                double x = p.x, y = p.y, z = p.z;
+                return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                       + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                       + c2 * z * z + 2 * cd * z
+                       + d2;
+            }
+
+            // The weighted mean of the squared distances to the planes, which is independent of the plane weights
+            double evaluateMean(const Vec3f &p) const {
+                if (weight <= 0)
+                    return 0;
+                return std::max(0.0, evaluate(p) / weight);
+            }
+        };
+
+        struct Collapse {
+            double cost;
+            uint from;
+            uint to;
+            uint fromVersion;
+            uint toVersion;
+
+            bool operator>(const Collapse &other) const {
+                return cost > other.cost;
+            }
+        };
+
+        struct PositionHash {
+            size_t operator()(const Vec3f &p) const {
+                uint32_t bits[3];
+                std::memcpy(bits, &p.x, sizeof(float));
+                std::memcpy(bits + 1, &p.y, sizeof(float));
+                std::memcpy(bits + 2, &p.z, sizeof(float));
+                return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+            }
+        };
+
+        struct PositionEqual {
+            bool operator()(const Vec3f &lhs, const Vec3f &rhs) const {
+                return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+            }
+        };
+
+        static Vec3f cross(const Vec3f &u, const Vec3f &v) {
+            return {u.y * v.z - u.z * v.y,
+                    u.z * v.x - u.x * v.z,
+                    u.x * v.y - u.y * v.x};
+        }
+
+        static float dot(const Vec3f &u, const Vec3f &v) {
+            return u.x * v.x + u.y * v.y + u.z * v.z;
+        }
+
+        std::vector<LodTarget> getDefaultTargets() {
+            return {{0.5f,   0.005f},
+                    {0.25f,  0.01f},
+                    {0.125f, 0.02f},
+                    {0.05f,  0.05f}};
+        }
+
+        Mesh simplify(const Mesh &mesh, size_t targetTriangles, float targetError, float *resultError) {
+            if (mesh.primitive != Mesh::TRI || !mesh.indexed || mesh.indices.size() % 3 != 0)
+                throw std::runtime_error("Mesh is not a indexed triangle mesh");
+
+            auto triangles = mesh.indices;
+            size_t triangleCount = triangles.size() / 3;
+            std::vector<bool> alive(triangleCount, true);
+            size_t aliveCount = triangleCount;
+
+            // Vertices with identical positions are treated as one position in the topology
+            std::unordered_map<Vec3f, uint, PositionHash, PositionEqual> positionIds;
+            std::vector<uint> vertexPosition(mesh.vertices.size());
+            std::vector<Vec3f> positions;
+            std::vector<uint> positionVertex;
+            std::vector<bool> locked;
+
+            for (size_t i = 0; i < mesh.vertices.size(); i++) {
+                auto p = mesh.vertices[i].position();
+                auto it = positionIds.find(p);
+                if (it == positionIds.end()) {
+                    auto id = static_cast<uint>(positions.size());
+                    positionIds[p] = id;
+                    positions.emplace_back(p);
+                    positionVertex.emplace_back(static_cast<uint>(i));
+                    locked.emplace_back(false);
+                    vertexPosition[i] = id;
+                } else {
+                    vertexPosition[i] = it->second;
+                }
+            }
+
+            std::vector<std::vector<uint>> positionTriangles(positions.size());
+            std::map<std::pair<uint, uint>, int> edgeUse;
+            std::vector<Quadric> quadrics(positions.size());
+
+            for (size_t t = 0; t < triangleCount; t++) {
+                uint p[3];
+                for (int v = 0; v < 3; v++) {
+                    auto vertex = triangles[t * 3 + v];
+                    p[v] = vertexPosition.at(vertex);
+                    positionTriangles[p[v]].emplace_back(static_cast<uint>(t));
+
+                    // Positions which are shared by vertices with different attributes are seams
+                    if (positionVertex[p[v]] != vertex)
+                        locked[p[v]] = true;
+                }
+
+                for (int e = 0; e < 3; e++) {
+                    auto a = p[e];
+                    auto b = p[(e + 1) % 3];
+                    edgeUse[{std::min(a, b), std::max(a, b)}]++;
+                }
+
+                auto normal = cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+                float length = std::sqrt(dot(normal, normal));
+                if (length > 0) {
+                    normal = normal * (1.0f / length);
+                    double d = -dot(normal, positions[p[0]]);
+                    auto quadric = Quadric::fromPlane(normal.x, normal.y, normal.z, d, length / 2);
+                    for (auto id: p) {
+                        quadrics[id] += quadric;
+                    }
+                }
+            }
+
+            // Positions on open borders or non manifold edges are never removed
+            for (auto &pair: edgeUse) {
+                if (pair.second != 2) {
+                    locked[pair.first.first] = true;
+                    locked[pair.first.second] = true;
+                }
+            }
+
+            std::vector<uint> versions(positions.size(), 0);
+            std::vector<bool> removed(positions.size(), false);
+            std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> queue;
+
+            auto pushCollapse = [&](uint from, uint to) {
+                if (locked[from])
+                    return;
+                Quadric q = quadrics[from];
+                q += quadrics[to];
+                queue.push(Collapse{q.evaluateMean(positions[to]), from, to, versions[from], versions[to]});
+            };
+
+            auto pushTriangleEdges = [&](uint t) {
+                for (int e = 0; e < 3; e++) {
+                    auto a = vertexPosition[triangles[t * 3 + e]];
+                    auto b = vertexPosition[triangles[t * 3 + (e + 1) % 3]];
+                    pushCollapse(a, b);
+                    pushCollapse(b, a);
+                }
+            };
+
+            for (uint t = 0; t < triangleCount; t++) {
+                pushTriangleEdges(t);
+            }
+
+            auto containsPosition = [&](uint t, uint position) {
+                for (int v = 0; v < 3; v++) {
+                    if (vertexPosition[triangles[t * 3 + v]] == position)
+                        return true;
+                }
+                return false;
+            };
+
+            auto collectNeighbours = [&](uint position, std::vector<uint> &out) {
+                out.clear();
+                for (auto t: positionTriangles[position]) {
+                    if (!alive[t])
+                        continue;
+                    for (int v = 0; v < 3; v++) {
+                        auto p = vertexPosition[triangles[t * 3 + v]];
+                        if (p != position && std::find(out.begin(), out.end(), p) == out.end())
+                            out.emplace_back(p);
+                    }
+                }
+            };
+
+            // The cost is the area weighted mean squared distance, so it compares to the squared error in world units
+            double maxCost = static_cast<double>(targetError) * targetError;
+            double resultCost = 0;
+
+            std::vector<uint> fromNeighbours;
+            std::vector<uint> toNeighbours;
+
+            while (aliveCount > targetTriangles && !queue.empty()) {
+                auto collapse = queue.top();
+                queue.pop();
+
+                if (removed[collapse.from] || removed[collapse.to]
+                    || versions[collapse.from] != collapse.fromVersion
+                    || versions[collapse.to] != collapse.toVersion)
+                    continue;
+
+                if (collapse.cost > maxCost)
+                    break;
+
+                // Find the vertex of the target position used by the triangles of the edge.
+                // The remaining triangles of the source position are rewired to it because they lie on the same
+                // side of any seam through the target position. If the edge triangles use different vertices
+                // the edge itself is a seam and the collapse is rejected.
+                long toVertex = -1;
+                bool seam = false;
+                for (auto t: positionTriangles[collapse.from]) {
+                    if (!alive[t])
+                        continue;
+                    for (int v = 0; v < 3; v++) {
+                        auto vertex = triangles[t * 3 + v];
+                        if (vertexPosition[vertex] != collapse.to)
+                            continue;
+                        if (toVertex >= 0 && toVertex != vertex)
+                            seam = true;
+                        toVertex = vertex;
+                    }
+                }
+                if (toVertex < 0 || seam)
+                    continue;
+
+                // The edge must be shared by exactly two triangles to keep the mesh manifold
+                collectNeighbours(collapse.from, fromNeighbours);
+                collectNeighbours(collapse.to, toNeighbours);
+                int sharedNeighbours = 0;
+                for (auto p: fromNeighbours) {
+                    if (std::find(toNeighbours.begin(), toNeighbours.end(), p) != toNeighbours.end())
+                        sharedNeighbours++;
+                }
+                if (sharedNeighbours > 2)
+                    continue;
+
+                // Reject collapses which flip the remaining triangles
+                bool flipped = false;
+                for (auto t: positionTriangles[collapse.from]) {
+                    if (!alive[t] || containsPosition(t, collapse.to))
+                        continue;
+                    Vec3f before[3];
+                    Vec3f after[3];
+                    for (int v = 0; v < 3; v++) {
+                        auto p = vertexPosition[triangles[t * 3 + v]];
+                        before[v] = positions[p];
+                        after[v] = p == collapse.from ? positions[collapse.to] : positions[p];
+                    }
+                    auto normalBefore = cross(before[1] - before[0], before[2] - before[0]);
+                    auto normalAfter = cross(after[1] - after[0], after[2] - after[0]);
+                    if (dot(normalBefore, normalAfter) <= 0) {
+                        flipped = true;
+                        break;
+                    }
+                }
+                if (flipped)
+                    continue;
+
+                // Collapse the edge
+                auto fromVertex = positionVertex[collapse.from];
+                for (auto t: positionTriangles[collapse.from]) {
+                    if (!alive[t])
+                        continue;
+                    if (containsPosition(t, collapse.to)) {
+                        alive[t] = false;
+                        aliveCount--;
+                    } else {
+                        for (int v = 0; v < 3; v++) {
+                            if (triangles[t * 3 + v] == fromVertex)
+                                triangles[t * 3 + v] = static_cast<uint>(toVertex);
+                        }
+                        positionTriangles[collapse.to].emplace_back(t);
+                    }
+                }
+
+                quadrics[collapse.to] += quadrics[collapse.from];
+                removed[collapse.from] = true;
+                versions[collapse.from]++;
+                versions[collapse.to]++;
+                resultCost = std::max(resultCost, collapse.cost);
+
+                for (auto t: positionTriangles[collapse.to]) {
+                    if (alive[t])
+                        pushTriangleEdges(t);
+                }
+            }
+
+            if (resultError != nullptr)
+                *resultError = static_cast<float>(std::sqrt(resultCost));
+
+            Mesh ret;
+            ret.primitive = Mesh::TRI;
+            ret.indexed = true;
+            ret.vertices = mesh.vertices;
+            // Keep the bounds of the source mesh so that all levels are culled the same way
+            ret.bounds = mesh.bounds;
+            ret.boundingSphere = mesh.boundingSphere;
+            ret.indices.reserve(aliveCount * 3);
+            for (size_t t = 0; t < triangleCount; t++) {
+                if (alive[t]) {
+                    ret.indices.insert(ret.indices.end(),
+                                       triangles.begin() + static_cast<long>(t * 3),
+                                       triangles.begin() + static_cast<long>(t * 3 + 3));
+                }
+            }
+
+            return ret;
+        }
+
+        MeshLod generateLods(const Mesh &mesh, const std::vector<LodTarget> &targets, std::vector<Mesh> &levels) {
+            MeshLod ret;
+            for (auto &vertex: mesh.vertices) {
+                auto p = vertex.position();
+                ret.radius = std::max(ret.radius, dot(p, p));
+            }
+            ret.radius = std::sqrt(ret.radius);
+
+            levels.clear();
+
+            if (ret.radius <= 0)
+                return ret;
+
+            size_t sourceTriangles = mesh.indices.size() / 3;
+            size_t previousTriangles = sourceTriangles;
+            float previousError = 0;
+
+            for (auto &target: targets) {
+                auto targetTriangles = static_cast<size_t>(static_cast<float>(sourceTriangles) * target.ratio);
+
+                float error = 0;
+                auto level = simplify(mesh, targetTriangles, target.error * ret.radius, &error);
+
+                size_t triangles = level.indices.size() / 3;
+                if (triangles == 0 || triangles >= previousTriangles)
+                    break;
+
+                MeshOptimizer::optimizeVertexCache(level);
+                MeshOptimizer::optimizeVertexFetch(level);
+
+                // Keep the errors monotonic so that the level selection can stop at the first visible error
+                previousError = std::max(previousError, error / ret.radius);
+                previousTriangles = triangles;
+
+                ret.errors.emplace_back(previousError);
+                levels.emplace_back(std::move(level));
+            }
+
+            return ret;
+        }
+    }
+}
@@ -0,0 +1,123 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "asset/texturecooker.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <set>
+
+#include "asset/assetimporter.hpp"
+#include "asset/assetexporter.hpp"
+#include "compression/blockcompression.hpp"
+
+namespace engine {
+    static Image<ColorRGBA> downsample(const Image<ColorRGBA> &image) {
+        Vec2i size(std::max(1, image.getWidth() / 2), std::max(1, image.getHeight() / 2));
+        Image<ColorRGBA> ret(size);
+        for (int y = 0; y < size.y; y++) {
+            for (int x = 0; x < size.x; x++) {
+                int x0 = std::min(x * 2, image.getWidth() - 1);
+                int x1 = std::min(x * 2 + 1, image.getWidth() - 1);
+                int y0 = std::min(y * 2, image.getHeight() - 1);
+                int y1 = std::min(y * 2 + 1, image.getHeight() - 1);
+
+                ColorRGBA color;
+                for (int c = 0; c < 4; c++) {
+                    int sum = image.getPixel(x0, y0).data[c]
+                              + image.getPixel(x1, y0).data[c]
+                              + image.getPixel(x0, y1).data[c]
+                              + image.getPixel(x1, y1).data[c];
+                    color.data[c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+                ret.setPixel(x, y, color);
+            }
+        }
+        return ret;
+    }
+
+    std::vector<Image<ColorRGBA>> TextureCooker::generateMipChain(const Image<ColorRGBA> &image) {
+        std::vector<Image<ColorRGBA>> ret;
+        ret.emplace_back(image);
+        while (ret.back().getWidth() > 1 || ret.back().getHeight() > 1) {
+            auto level = downsample(ret.back());
+            ret.emplace_back(std::move(level));
+        }
+        return ret;
+    }
+
+    CompressedImage TextureCooker::cook(const Image<ColorRGBA> &image,
+                                        TextureBuffer::ColorFormat format,
+                                        bool mipmaps) {
+        if (!CompressedImage::isBlockCompressed(format))
+            throw std::runtime_error("Not a block compressed format");
+        if (image.empty())
+            throw std::runtime_error("Cannot cook empty image");
+
+        CompressedImage ret;
+        ret.format = format;
+        ret.size = image.getSize();
+
+        if (mipmaps) {
+            for (auto &level: generateMipChain(image)) {
+                ret.levels.emplace_back(BlockCompression::compress(level, format));
+            }
+        } else {
+            ret.levels.emplace_back(BlockCompression::compress(image, format));
+        }
+
+        return ret;
+    }
+
+    size_t TextureCooker::cookDirectory(const std::string &sourceDirectory,
+                                        const std::string &outputDirectory,
+                                        TextureBuffer::ColorFormat format) {
+        static const std::set<std::string> imageExtensions = {".png", ".jpg", ".jpeg", ".tga", ".bmp"};
+
+        size_t ret = 0;
+        for (auto &file: std::filesystem::recursive_directory_iterator(sourceDirectory)) {
+            if (!file.is_regular_file())
+                continue;
+
+            auto output = std::filesystem::path(outputDirectory)
+                          / std::filesystem::relative(file.path(), sourceDirectory);
+            std::filesystem::create_directories(output.parent_path());
+
+            auto extension = file.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (imageExtensions.find(extension) == imageExtensions.end()) {
+                std::filesystem::copy_file(file.path(), output, std::filesystem::copy_options::overwrite_existing);
+                continue;
+            }
+
+            std::ifstream input(file.path(), std::ios::binary);
+            if (!input)
+                throw std::runtime_error("Failed to open " + file.path().string());
+            auto bundle = AssetImporter::import(input, extension);
+
+            std::ofstream stream(output, std::ios::binary | std::ios::trunc);
+            if (!stream)
+                throw std::runtime_error("Failed to open " + output.string());
+            AssetExporter::exportCompressedImage(stream, cook(bundle.get<Image<ColorRGBA>>("0"), format));
+            ret++;
+        }
+        return ret;
+    }
+}
@@ -0,0 +1,281 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "asset/vertexpacking.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace engine {
+    namespace VertexPacking {
+        typedef RenderAllocator::CustomMeshDefinition Definition;
+
+        static uint16_t quantizeUnorm16(float value) {
+            value = std::max(0.0f, std::min(1.0f, value));
+            return static_cast<uint16_t>(std::lround(value * 65535.0f));
+        }
+
+        static int16_t quantizeSnorm16(float value) {
+            value = std::max(-1.0f, std::min(1.0f, value));
+            return static_cast<int16_t>(std::lround(value * 32767.0f));
+        }
+
+        template<typename T>
+        static void write(char *&dst, T value) {
+            std::memcpy(dst, &value, sizeof(T));
+            dst += sizeof(T);
+        }
+
+        static Vec3f normalize(const Vec3f &v) {
+            float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+            if (length <= 0)
+                return {0, 0, 1};
+            return {v.x / length, v.y / length, v.z / length};
+        }
+
+        size_t PackedMesh::getVertexCount() const {
+            return data.size() / getVertexSize(layout);
+        }
+
+        Definition PackedMesh::getDefinition() {
+            Definition ret;
+            ret.primitive = primitive;
+            ret.data = data.data();
+            ret.dataLength = data.size();
+            ret.vertex = attributes;
+            ret.indexed = indexed;
+            ret.indices = indices;
+            return ret;
+        }
+
+        size_t getVertexSize(Layout layout) {
+            switch (layout) {
+                case POSITION_UV:
+                    return 3 * sizeof(float) + 2 * sizeof(uint16_t);
+                case COMPACT:
+                    return 4 * sizeof(uint16_t) + 2 * sizeof(int16_t) + 2 * sizeof(uint16_t) + 2 * sizeof(int16_t);
+            }
+            throw std::runtime_error("Invalid layout");
+        }
+
+        uint16_t floatToHalf(float value) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(float));
+
+            uint32_t sign = (bits >> 16) & 0x8000u;
+            uint32_t exponent = (bits >> 23) & 0xffu;
+            uint32_t mantissa = bits & 0x7fffffu;
+
+            if (exponent == 0xff) {
+                // Inf / NaN
+                return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x200u : 0));
+            }
+
+            int halfExponent = static_cast<int>(exponent) - 127 + 15;
+            if (halfExponent >= 31) {
+                // Overflow
+                return static_cast<uint16_t>(sign | 0x7c00u);
+            } else if (halfExponent <= 0) {
+                // Subnormal or zero
+                if (halfExponent < -10)
+                    return static_cast<uint16_t>(sign);
+                mantissa |= 0x800000u;
+                uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+                uint32_t half = mantissa >> shift;
+                uint32_t remainder = mantissa & ((1u << shift) - 1);
+                uint32_t halfway = 1u << (shift - 1);
+                if (remainder > halfway || (remainder == halfway && (half & 1u)))
+                    half++;
+                return static_cast<uint16_t>(sign | half);
+            } else {
+                uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+                uint32_t remainder = mantissa & 0x1fffu;
+                // Rounding may carry into the exponent which correctly rounds up to the next power of two or inf
+                if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+                    half++;
+                return static_cast<uint16_t>(sign | half);
+            }
+        }
+
+        float halfToFloat(uint16_t value) {
+            uint32_t sign = (value & 0x8000u) << 16;
+            uint32_t exponent = (value >> 10) & 0x1fu;
+            uint32_t mantissa = value & 0x3ffu;
+
+            uint32_t bits;
+            if (exponent == 0) {
+                if (mantissa == 0) {
+                    bits = sign;
+                } else {
+                    // Normalize the subnormal value
+                    int e = -1;
+                    do {
+                        e++;
+                        mantissa <<= 1;
+                    } while ((mantissa & 0x400u) == 0);
+                    bits = sign | (static_cast<uint32_t>(127 - 15 - e) << 23) | ((mantissa & 0x3ffu) << 13);
+                }
+            } else if (exponent == 31) {
+                bits = sign | 0x7f800000u | (mantissa << 13);
+            } else {
+                bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+            }
+
+            float ret;
+            std::memcpy(&ret, &bits, sizeof(float));
+            return ret;
+        }
+
+        Vec2f octEncode(const Vec3f &vector) {
+            Vec3f n = normalize(vector);
+            float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+            float x = n.x / sum;
+            float y = n.y / sum;
+            if (n.z < 0) {
+                // Fold the lower hemisphere over the diagonals
+                float fx = (1 - std::abs(y)) * (x >= 0 ? 1.0f : -1.0f);
+                float fy = (1 - std::abs(x)) * (y >= 0 ? 1.0f : -1.0f);
+                x = fx;
+                y = fy;
+            }
+            return {x, y};
+        }
+
+        Vec3f octDecode(const Vec2f &value) {
+            Vec3f n(value.x, value.y, 1 - std::abs(value.x) - std::abs(value.y));
+            float t = std::max(-n.z, 0.0f);
+            n.x += n.x >= 0 ? -t : t;
+            n.y += n.y >= 0 ? -t : t;
+            return normalize(n);
+        }
+
+        /**
+         * Quantize the encoded vector and pick the rounding of the two components which gives the smallest
+         * angular error after decoding.
+         */
+        static void writeOct(char *&dst, const Vec3f &vector) {
+            Vec3f n = normalize(vector);
+            Vec2f encoded = octEncode(n);
+
+            int16_t best[2] = {quantizeSnorm16(encoded.x), quantizeSnorm16(encoded.y)};
+            float bestDot = -2;
+            for (int i = 0; i < 4; i++) {
+                float x = (i & 1 ? std::ceil(encoded.x * 32767.0f) : std::floor(encoded.x * 32767.0f)) / 32767.0f;
+                float y = (i & 2 ? std::ceil(encoded.y * 32767.0f) : std::floor(encoded.y * 32767.0f)) / 32767.0f;
+                Vec3f decoded = octDecode({x, y});
+                float dot = decoded.x * n.x + decoded.y * n.y + decoded.z * n.z;
+                if (dot > bestDot) {
+                    bestDot = dot;
+                    best[0] = quantizeSnorm16(x);
+                    best[1] = quantizeSnorm16(y);
+                }
+            }
+
+            write(dst, best[0]);
+            write(dst, best[1]);
+        }
+
+        PackedMesh pack(const Mesh &mesh, Layout layout) {
+            PackedMesh ret;
+            ret.layout = layout;
+            ret.primitive = mesh.primitive;
+            ret.indexed = mesh.indexed;
+            ret.indices = mesh.indices;
+
+            ret.data.resize(mesh.vertices.size() * getVertexSize(layout));
+            char *dst = ret.data.data();
+
+            switch (layout) {
+                case POSITION_UV: {
+                    ret.attributes = {
+                            Definition::Attribute(3, Definition::FLOAT, false, 0),
+                            Definition::Attribute(2, Definition::HALF_FLOAT, false, 2)
+                    };
+                    for (auto &vertex: mesh.vertices) {
+                        auto position = vertex.position();
+                        auto uv = vertex.uv();
+                        write(dst, position.x);
+                        write(dst, position.y);
+                        write(dst, position.z);
+                        write(dst, floatToHalf(uv.x));
+                        write(dst, floatToHalf(uv.y));
+                    }
+                    break;
+                }
+                case COMPACT: {
+                    ret.attributes = {
+                            Definition::Attribute(4, Definition::UNSIGNED_SHORT, true, 0),
+                            Definition::Attribute(2, Definition::SIGNED_SHORT, true, 1),
+                            Definition::Attribute(2, Definition::HALF_FLOAT, false, 2),
+                            Definition::Attribute(2, Definition::SIGNED_SHORT, true, 3)
+                    };
+
+                    if (!mesh.vertices.empty()) {
+                        Vec3f min = mesh.vertices.at(0).position();
+                        Vec3f max = min;
+                        for (auto &vertex: mesh.vertices) {
+                            auto position = vertex.position();
+                            min.x = std::min(min.x, position.x);
+                            min.y = std::min(min.y, position.y);
+                            min.z = std::min(min.z, position.z);
+                            max.x = std::max(max.x, position.x);
+                            max.y = std::max(max.y, position.y);
+                            max.z = std::max(max.z, position.z);
+                        }
+                        ret.positionOffset = min;
+                        // Flat axes get a scale of 1 to avoid dividing by zero
+                        ret.positionScale = Vec3f(max.x > min.x ? max.x - min.x : 1,
+                                                  max.y > min.y ? max.y - min.y : 1,
+                                                  max.z > min.z ? max.z - min.z : 1);
+                    }
+
+                    for (auto &vertex: mesh.vertices) {
+                        auto position = vertex.position();
+                        auto normal = vertex.normal();
+                        auto tangent = vertex.tangent();
+                        auto bitangent = vertex.bitangent();
+                        auto uv = vertex.uv();
+
+                        // The sign of the bitangent relative to cross(normal, tangent), mirrored uvs give a negative sign.
+                        Vec3f cross(normal.y * tangent.z - normal.z * tangent.y,
+                                    normal.z * tangent.x - normal.x * tangent.z,
+                                    normal.x * tangent.y - normal.y * tangent.x);
+                        float handedness = cross.x * bitangent.x + cross.y * bitangent.y + cross.z * bitangent.z;
+
+                        write(dst, quantizeUnorm16((position.x - ret.positionOffset.x) / ret.positionScale.x));
+                        write(dst, quantizeUnorm16((position.y - ret.positionOffset.y) / ret.positionScale.y));
+                        write(dst, quantizeUnorm16((position.z - ret.positionOffset.z) / ret.positionScale.z));
+                        write(dst, static_cast<uint16_t>(handedness < 0 ? 0 : 65535));
+                        writeOct(dst, normal);
+                        write(dst, floatToHalf(uv.x));
+                        write(dst, floatToHalf(uv.y));
+                        writeOct(dst, tangent);
+                    }
+                    break;
+                }
+                default:
+                    throw std::runtime_error("Invalid layout");
+            }
+
+            return ret;
+        }
+    }
+}
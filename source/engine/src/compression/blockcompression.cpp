@@ -0,0 +1,412 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "compression/blockcompression.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace engine {
+    namespace BlockCompression {
+        typedef ColorRGBA Block[16];
+
+        static void readBlock(const Image<ColorRGBA> &image, int blockX, int blockY, Block &block) {
+            for (int y = 0; y < 4; y++) {
+                for (int x = 0; x < 4; x++) {
+                    int px = std::min(blockX * 4 + x, image.getWidth() - 1);
+                    int py = std::min(blockY * 4 + y, image.getHeight() - 1);
+                    block[y * 4 + x] = image.getPixel(px, py);
+                }
+            }
+        }
+
+        static uint16_t packRGB565(int r, int g, int b) {
+            return static_cast<uint16_t>(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+        }
+
+        static void unpackRGB565(uint16_t v, int &r, int &g, int &b) {
+            r = (v >> 11) & 31;
+            g = (v >> 5) & 63;
+            b = v & 31;
+            r = (r << 3) | (r >> 2);
+            g = (g << 2) | (g >> 4);
+            b = (b << 3) | (b >> 2);
+        }
+
+        static void writeLE(char *out, uint64_t value, int bytes) {
+            for (int i = 0; i < bytes; i++) {
+                out[i] = static_cast<char>((value >> (i * 8)) & 0xFF);
+            }
+        }
+
+        /**
+         * Select the endpoints of the block along the principal axis of the block colors.
+         *
+         * @param block
+         * @param channels The number of channels to consider, starting at red
+         * @param start
+         * @param end
+         */
+        static void fitEndpoints(const Block &block, int channels, int (&start)[4], int (&end)[4]) {
+            float mean[4] = {0, 0, 0, 0};
+            for (auto &pixel : block) {
+                for (int c = 0; c < channels; c++) {
+                    mean[c] += pixel.data[c] / 16.0f;
+                }
+            }
+
+            float covariance[4][4] = {};
+            for (auto &pixel : block) {
+                for (int i = 0; i < channels; i++) {
+                    for (int j = 0; j < channels; j++) {
+                        covariance[i][j] += (pixel.data[i] - mean[i]) * (pixel.data[j] - mean[j]);
+                    }
+                }
+            }
+
+            // Power iteration, starting from the covariance row with the largest norm.
+            // The diagonal is not used as the seed because it is orthogonal to the axis of anti-correlated channels.
+            float axis[4] = {0, 0, 0, 0};
+            float seedNorm = 0;
+            float trace = 0;
+            for (int i = 0; i < channels; i++) {
+                float norm = 0;
+                for (int j = 0; j < channels; j++) {
+                    norm += covariance[i][j] * covariance[i][j];
+                }
+                if (norm > seedNorm) {
+                    seedNorm = norm;
+                    for (int j = 0; j < channels; j++) {
+                        axis[j] = covariance[i][j];
+                    }
+                }
+                trace += covariance[i][i];
+            }
+
+            float length = 0;
+            for (int iteration = 0; iteration < 8; iteration++) {
+                float next[4] = {0, 0, 0, 0};
+                length = 0;
+                for (int i = 0; i < channels; i++) {
+                    for (int j = 0; j < channels; j++) {
+                        next[i] += covariance[i][j] * axis[j];
+                    }
+                    length = std::max(length, std::abs(next[i]));
+                }
+                if (length <= 0)
+                    break;
+                for (int c = 0; c < channels; c++) {
+                    axis[c] = next[c] / length;
+                }
+            }
+
+            // The axis is normalized to a largest component of 1 so length approximates the largest eigenvalue,
+            // if it vanishes the iteration did not find the axis and the bounding box diagonal is used instead
+            if (length <= trace * 1e-4f) {
+                for (int c = 0; c < channels; c++) {
+                    int minValue = 255;
+                    int maxValue = 0;
+                    for (auto &pixel : block) {
+                        minValue = std::min(minValue, static_cast<int>(pixel.data[c]));
+                        maxValue = std::max(maxValue, static_cast<int>(pixel.data[c]));
+                    }
+                    axis[c] = static_cast<float>(maxValue - minValue);
+                }
+            }
+
+            float minProjection = 0;
+            float maxProjection = 0;
+            float axisLength = 0;
+            for (int c = 0; c < channels; c++) {
+                axisLength += axis[c] * axis[c];
+            }
+            if (axisLength > 0) {
+                axisLength = std::sqrt(axisLength);
+                for (int c = 0; c < channels; c++) {
+                    axis[c] /= axisLength;
+                }
+                minProjection = std::numeric_limits<float>::max();
+                maxProjection = std::numeric_limits<float>::lowest();
+                for (auto &pixel : block) {
+                    float projection = 0;
+                    for (int c = 0; c < channels; c++) {
+                        projection += (pixel.data[c] - mean[c]) * axis[c];
+                    }
+                    minProjection = std::min(minProjection, projection);
+                    maxProjection = std::max(maxProjection, projection);
+                }
+            }
+
+            for (int c = 0; c < 4; c++) {
+                if (c < channels) {
+                    start[c] = std::clamp(static_cast<int>(std::lround(mean[c] + axis[c] * minProjection)), 0, 255);
+                    end[c] = std::clamp(static_cast<int>(std::lround(mean[c] + axis[c] * maxProjection)), 0, 255);
+                } else {
+                    start[c] = 255;
+                    end[c] = 255;
+                }
+            }
+        }
+
+        static void encodeBC1Block(const Block &block, char *out) {
+            int start[4];
+            int end[4];
+            fitEndpoints(block, 3, start, end);
+
+            uint16_t color0 = packRGB565(end[0], end[1], end[2]);
+            uint16_t color1 = packRGB565(start[0], start[1], start[2]);
+            if (color0 < color1) {
+                std::swap(color0, color1);
+            }
+
+            uint32_t indices = 0;
+            if (color0 != color1) {
+                // color0 > color1 selects the opaque four color mode
+                int palette[4][3];
+                unpackRGB565(color0, palette[0][0], palette[0][1], palette[0][2]);
+                unpackRGB565(color1, palette[1][0], palette[1][1], palette[1][2]);
+                for (int c = 0; c < 3; c++) {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+
+                for (int i = 0; i < 16; i++) {
+                    int bestIndex = 0;
+                    int bestError = INT32_MAX;
+                    for (int p = 0; p < 4; p++) {
+                        int error = 0;
+                        for (int c = 0; c < 3; c++) {
+                            int d = block[i].data[c] - palette[p][c];
+                            error += d * d;
+                        }
+                        if (error < bestError) {
+                            bestError = error;
+                            bestIndex = p;
+                        }
+                    }
+                    indices |= static_cast<uint32_t>(bestIndex) << (i * 2);
+                }
+            }
+
+            writeLE(out, color0, 2);
+            writeLE(out + 2, color1, 2);
+            writeLE(out + 4, indices, 4);
+        }
+
+        static void encodeBC4Block(const Block &block, int channel, char *out) {
+            int min = 255;
+            int max = 0;
+            for (auto &pixel : block) {
+                min = std::min(min, static_cast<int>(pixel.data[channel]));
+                max = std::max(max, static_cast<int>(pixel.data[channel]));
+            }
+
+            uint64_t indices = 0;
+            if (max != min) {
+                // alpha0 > alpha1 selects the eight value mode
+                int palette[8];
+                palette[0] = max;
+                palette[1] = min;
+                for (int i = 1; i < 7; i++) {
+                    palette[i + 1] = ((7 - i) * max + i * min) / 7;
+                }
+
+                for (int i = 0; i < 16; i++) {
+                    int bestIndex = 0;
+                    int bestError = INT32_MAX;
+                    for (int p = 0; p < 8; p++) {
+                        int error = std::abs(block[i].data[channel] - palette[p]);
+                        if (error < bestError) {
+                            bestError = error;
+                            bestIndex = p;
+                        }
+                    }
+                    indices |= static_cast<uint64_t>(bestIndex) << (i * 3);
+                }
+            }
+
+            out[0] = static_cast<char>(max);
+            out[1] = static_cast<char>(min);
+            writeLE(out + 2, indices, 6);
+        }
+
+        class BitWriter {
+        public:
+            explicit BitWriter(char *out) : out(out), position(0) {
+                std::memset(out, 0, 16);
+            }
+
+            void write(uint32_t value, int bits) {
+                for (int i = 0; i < bits; i++, position++) {
+                    if ((value >> i) & 1) {
+                        out[position / 8] = static_cast<char>(out[position / 8] | (1 << (position % 8)));
+                    }
+                }
+            }
+
+        private:
+            char *out;
+            int position;
+        };
+
+        /**
+         * Quantize an 8 bit endpoint to 7 bits and a shared p-bit, choosing the p-bit with the lowest error.
+         */
+        static void quantizeEndpoint(const int (&value)[4], int (&quantized)[4], int &pBit) {
+            int bestError = INT32_MAX;
+            for (int p = 0; p < 2; p++) {
+                int error = 0;
+                int candidate[4];
+                for (int c = 0; c < 4; c++) {
+                    candidate[c] = std::clamp((value[c] - p + 1) >> 1, 0, 127);
+                    int d = value[c] - ((candidate[c] << 1) | p);
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    pBit = p;
+                    std::copy(candidate, candidate + 4, quantized);
+                }
+            }
+        }
+
+        static void encodeBC7Block(const Block &block, char *out) {
+            static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+            int start[4];
+            int end[4];
+            fitEndpoints(block, 4, start, end);
+
+            int endpoints[2][4];
+            int pBits[2];
+            quantizeEndpoint(start, endpoints[0], pBits[0]);
+            quantizeEndpoint(end, endpoints[1], pBits[1]);
+
+            int palette[16][4];
+            for (int i = 0; i < 16; i++) {
+                for (int c = 0; c < 4; c++) {
+                    int e0 = (endpoints[0][c] << 1) | pBits[0];
+                    int e1 = (endpoints[1][c] << 1) | pBits[1];
+                    palette[i][c] = ((64 - weights[i]) * e0 + weights[i] * e1 + 32) >> 6;
+                }
+            }
+
+            int indices[16];
+            for (int i = 0; i < 16; i++) {
+                int bestIndex = 0;
+                int bestError = INT32_MAX;
+                for (int p = 0; p < 16; p++) {
+                    int error = 0;
+                    for (int c = 0; c < 4; c++) {
+                        int d = block[i].data[c] - palette[p][c];
+                        error += d * d;
+                    }
+                    if (error < bestError) {
+                        bestError = error;
+                        bestIndex = p;
+                    }
+                }
+                indices[i] = bestIndex;
+            }
+
+            // The most significant bit of the anchor index is implicitly zero
+            if (indices[0] & 8) {
+                std::swap(endpoints[0], endpoints[1]);
+                std::swap(pBits[0], pBits[1]);
+                for (auto &index : indices) {
+                    index = 15 - index;
+                }
+            }
+
+            BitWriter writer(out);
+            writer.write(1 << 6, 7);
+            for (int c = 0; c < 4; c++) {
+                writer.write(endpoints[0][c], 7);
+                writer.write(endpoints[1][c], 7);
+            }
+            writer.write(pBits[0], 1);
+            writer.write(pBits[1], 1);
+            writer.write(indices[0], 3);
+            for (int i = 1; i < 16; i++) {
+                writer.write(indices[i], 4);
+            }
+        }
+
+        template<typename F>
+        static std::vector<char> compressBlocks(const Image<ColorRGBA> &image, size_t blockSize, F encode) {
+            int blocksX = (image.getWidth() + 3) / 4;
+            int blocksY = (image.getHeight() + 3) / 4;
+            std::vector<char> ret(blocksX * blocksY * blockSize);
+            Block block;
+            for (int by = 0; by < blocksY; by++) {
+                for (int bx = 0; bx < blocksX; bx++) {
+                    readBlock(image, bx, by, block);
+                    encode(block, ret.data() + (by * blocksX + bx) * blockSize);
+                }
+            }
+            return ret;
+        }
+
+        std::vector<char> compressBC1(const Image<ColorRGBA> &image) {
+            return compressBlocks(image, 8, [](const Block &block, char *out) {
+                encodeBC1Block(block, out);
+            });
+        }
+
+        std::vector<char> compressBC3(const Image<ColorRGBA> &image) {
+            return compressBlocks(image, 16, [](const Block &block, char *out) {
+                encodeBC4Block(block, 3, out);
+                encodeBC1Block(block, out + 8);
+            });
+        }
+
+        std::vector<char> compressBC5(const Image<ColorRGBA> &image) {
+            return compressBlocks(image, 16, [](const Block &block, char *out) {
+                encodeBC4Block(block, 0, out);
+                encodeBC4Block(block, 1, out + 8);
+            });
+        }
+
+        std::vector<char> compressBC7(const Image<ColorRGBA> &image) {
+            return compressBlocks(image, 16, [](const Block &block, char *out) {
+                encodeBC7Block(block, out);
+            });
+        }
+
+        std::vector<char> compress(const Image<ColorRGBA> &image, TextureBuffer::ColorFormat format) {
+            switch (format) {
+                case TextureBuffer::BC1:
+                    return compressBC1(image);
+                case TextureBuffer::BC3:
+                    return compressBC3(image);
+                case TextureBuffer::BC5:
+                    return compressBC5(image);
+                case TextureBuffer::BC7:
+                    return compressBC7(image);
+                default:
+                    throw std::runtime_error("Unsupported block compression format");
+            }
+        }
+    }
+}
@@ -0,0 +1,64 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "compression/lz4.hpp"
+
+#include <limits>
+#include <stdexcept>
+
+#include <lz4.h>
+#include <lz4hc.h>
+
+namespace engine {
+    std::vector<char> LZ4::compress(const char *data, size_t length) {
+        if (length > LZ4_MAX_INPUT_SIZE)
+            throw std::runtime_error("LZ4 input too large");
+        std::vector<char> ret(LZ4_compressBound(static_cast<int>(length)));
+        auto size = LZ4_compress_HC(data,
+                                    ret.data(),
+                                    static_cast<int>(length),
+                                    static_cast<int>(ret.size()),
+                                    LZ4HC_CLEVEL_DEFAULT);
+        if (size <= 0 && length > 0)
+            throw std::runtime_error("LZ4 compression failed");
+        ret.resize(size);
+        return ret;
+    }
+
+    std::vector<char> LZ4::decompress(const char *data, size_t length, size_t decompressedSize) {
+        if (length > std::numeric_limits<int>::max() || decompressedSize > std::numeric_limits<int>::max())
+            throw std::runtime_error("LZ4 input too large");
+        std::vector<char> ret(decompressedSize);
+        auto size = LZ4_decompress_safe(data,
+                                        ret.data(),
+                                        static_cast<int>(length),
+                                        static_cast<int>(ret.size()));
+        if (size < 0 || static_cast<size_t>(size) != decompressedSize)
+            throw std::runtime_error("LZ4 decompression failed");
+        return ret;
+    }
+
+    std::vector<char> LZ4::compress(const std::vector<char> &data) {
+        return compress(data.data(), data.size());
+    }
+
+    std::vector<char> LZ4::decompress(const std::vector<char> &data, size_t decompressedSize) {
+        return decompress(data.data(), data.size(), decompressedSize);
+    }
+}
@@ -0,0 +1,136 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "compression/zstd.hpp"
+
+#include <memory>
+#include <stdexcept>
+
+#include <zstd.h>
+#include <zdict.h>
+
+namespace engine {
+    static size_t getDecompressedSize(const char *data, size_t length) {
+        auto size = ZSTD_getFrameContentSize(data, length);
+        if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN)
+            throw std::runtime_error("Invalid zstd frame");
+        return static_cast<size_t>(size);
+    }
+
+    static void checkResult(size_t result, const std::string &operation) {
+        if (ZSTD_isError(result))
+            throw std::runtime_error(operation + " failed: " + ZSTD_getErrorName(result));
+    }
+
+    std::vector<char> ZStd::compress(const char *data, size_t length, int level) {
+        std::vector<char> ret(ZSTD_compressBound(length));
+        auto size = ZSTD_compress(ret.data(), ret.size(), data, length, level);
+        checkResult(size, "ZStd compression");
+        ret.resize(size);
+        return ret;
+    }
+
+    std::vector<char> ZStd::decompress(const char *data, size_t length) {
+        std::vector<char> ret(getDecompressedSize(data, length));
+        auto size = ZSTD_decompress(ret.data(), ret.size(), data, length);
+        checkResult(size, "ZStd decompression");
+        if (size != ret.size())
+            throw std::runtime_error("ZStd decompression failed: Invalid size");
+        return ret;
+    }
+
+    std::vector<char> ZStd::compress(const std::vector<char> &data, int level) {
+        return compress(data.data(), data.size(), level);
+    }
+
+    std::vector<char> ZStd::decompress(const std::vector<char> &data) {
+        return decompress(data.data(), data.size());
+    }
+
+    std::vector<char> ZStd::trainDictionary(const std::vector<std::vector<char>> &samples, size_t capacity) {
+        std::vector<char> buffer;
+        std::vector<size_t> sizes;
+        for (auto &sample: samples) {
+            buffer.insert(buffer.end(), sample.begin(), sample.end());
+            sizes.emplace_back(sample.size());
+        }
+
+        std::vector<char> ret(capacity);
+        auto size = ZDICT_trainFromBuffer(ret.data(),
+                                          ret.size(),
+                                          buffer.data(),
+                                          sizes.data(),
+                                          static_cast<unsigned>(sizes.size()));
+        if (ZDICT_isError(size))
+            return {};
+        ret.resize(size);
+        return ret;
+    }
+
+    ZStd::Dictionary::Dictionary(const std::vector<char> &data, int level)
+            : data(data) {
+        cdict = ZSTD_createCDict(this->data.data(), this->data.size(), level);
+        ddict = ZSTD_createDDict(this->data.data(), this->data.size());
+        if (cdict == nullptr || ddict == nullptr) {
+            ZSTD_freeCDict(static_cast<ZSTD_CDict *>(cdict));
+            ZSTD_freeDDict(static_cast<ZSTD_DDict *>(ddict));
+            throw std::runtime_error("Failed to create zstd dictionary");
+        }
+    }
+
+    ZStd::Dictionary::~Dictionary() {
+        ZSTD_freeCDict(static_cast<ZSTD_CDict *>(cdict));
+        ZSTD_freeDDict(static_cast<ZSTD_DDict *>(ddict));
+    }
+
+    std::vector<char> ZStd::Dictionary::compress(const char *src, size_t length) const {
+        auto *context = ZSTD_createCCtx();
+        if (context == nullptr)
+            throw std::runtime_error("Failed to create zstd context");
+        std::vector<char> ret(ZSTD_compressBound(length));
+        auto size = ZSTD_compress_usingCDict(context,
+                                             ret.data(),
+                                             ret.size(),
+                                             src,
+                                             length,
+                                             static_cast<const ZSTD_CDict *>(cdict));
+        ZSTD_freeCCtx(context);
+        checkResult(size, "ZStd compression");
+        ret.resize(size);
+        return ret;
+    }
+
+    std::vector<char> ZStd::Dictionary::decompress(const char *src, size_t length) const {
+        // The decompression context is reused per thread because decompression is on the load path
+        thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+        if (context == nullptr)
+            throw std::runtime_error("Failed to create zstd context");
+        std::vector<char> ret(getDecompressedSize(src, length));
+        auto size = ZSTD_decompress_usingDDict(context.get(),
+                                               ret.data(),
+                                               ret.size(),
+                                               src,
+                                               length,
+                                               static_cast<const ZSTD_DDict *>(ddict));
+        checkResult(size, "ZStd decompression");
+        if (size != ret.size())
+            throw std::runtime_error("ZStd decompression failed: Invalid size");
+        return ret;
+    }
+}
@@ -19,6 +19,10 @@
 
 #include "crypto/aes.hpp"
 
+#include <algorithm>
+
+#include "async/threadpool.hpp"
+
 #include "cryptopp/aes.h"
 #include "cryptopp/filters.h"
 #include "cryptopp/modes.h"
@@ -42,53 +46,126 @@ namespace engine {
         return iv;
     }
 
-    std::string AES::encrypt(const std::string &inKey,
-                             const std::array<char, BLOCKSIZE> &inIv,
-                             const std::string &plaintext) {
-        std::string ciphertext;
+    // Buffers larger than this are split across pool tasks when processing in counter mode
+    static const size_t CTR_PARALLEL_MIN_SEGMENT = 1024 * 1024;
 
+    template<typename T>
+    static T encryptCbc(const std::string &inKey,
+                        const std::array<char, AES::BLOCKSIZE> &inIv,
+                        const char *plaintext,
+                        size_t length) {
         auto key = parseKey(inKey);
         auto iv = parseIv(inIv);
 
         CryptoPP::AES::Encryption aesEncryption(key.data(), key.size());
         CryptoPP::CBC_Mode_ExternalCipher::Encryption cbcEncryption(aesEncryption, iv.data());
 
-        CryptoPP::StreamTransformationFilter stfEncryptor(cbcEncryption, new CryptoPP::StringSink(ciphertext));
-        stfEncryptor.Put(reinterpret_cast<const unsigned char *>(plaintext.c_str()), plaintext.length());
+        // Pkcs padding adds between 1 and BLOCKSIZE bytes
+        T ciphertext(length + CryptoPP::AES::BLOCKSIZE - length % CryptoPP::AES::BLOCKSIZE, 0);
+
+        auto *sink = new CryptoPP::ArraySink(reinterpret_cast<CryptoPP::byte *>(ciphertext.data()), ciphertext.size());
+        CryptoPP::StreamTransformationFilter stfEncryptor(cbcEncryption, sink);
+        stfEncryptor.Put(reinterpret_cast<const CryptoPP::byte *>(plaintext), length);
         stfEncryptor.MessageEnd();
 
+        ciphertext.resize(sink->TotalPutLength());
         return ciphertext;
     }
 
-    std::string AES::decrypt(const std::string &inKey,
-                             const std::array<char, BLOCKSIZE> &inIv,
-                             const std::string &ciphertext) {
-        std::string plaintext;
-
+    template<typename T>
+    static T decryptCbc(const std::string &inKey,
+                        const std::array<char, AES::BLOCKSIZE> &inIv,
+                        const char *ciphertext,
+                        size_t length) {
         auto key = parseKey(inKey);
         auto iv = parseIv(inIv);
 
         CryptoPP::AES::Decryption aesDecryption(key.data(), key.size());
         CryptoPP::CBC_Mode_ExternalCipher::Decryption cbcDecryption(aesDecryption, iv.data());
 
-        CryptoPP::StreamTransformationFilter stfDecryptor(cbcDecryption, new CryptoPP::StringSink(plaintext));
-        stfDecryptor.Put(reinterpret_cast<const unsigned char *>(ciphertext.c_str()), ciphertext.size());
+        // The plaintext is never longer than the ciphertext
+        T plaintext(length, 0);
+
+        auto *sink = new CryptoPP::ArraySink(reinterpret_cast<CryptoPP::byte *>(plaintext.data()), plaintext.size());
+        CryptoPP::StreamTransformationFilter stfDecryptor(cbcDecryption, sink);
+        stfDecryptor.Put(reinterpret_cast<const CryptoPP::byte *>(ciphertext), length);
         stfDecryptor.MessageEnd();
 
+        plaintext.resize(sink->TotalPutLength());
         return plaintext;
     }
 
+    static void processCtr(const std::vector<CryptoPP::byte> &key,
+                           const std::array<CryptoPP::byte, CryptoPP::AES::BLOCKSIZE> &iv,
+                           size_t offset,
+                           char *data,
+                           size_t length) {
+        CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption ctr;
+        ctr.SetKeyWithIV(key.data(), key.size(), iv.data(), iv.size());
+        ctr.Seek(offset);
+        auto *bytes = reinterpret_cast<CryptoPP::byte *>(data);
+        ctr.ProcessData(bytes, bytes, length);
+    }
+
+    std::string AES::encrypt(const std::string &inKey,
+                             const std::array<char, BLOCKSIZE> &inIv,
+                             const std::string &plaintext) {
+        return encryptCbc<std::string>(inKey, inIv, plaintext.data(), plaintext.size());
+    }
+
+    std::string AES::decrypt(const std::string &inKey,
+                             const std::array<char, BLOCKSIZE> &inIv,
+                             const std::string &ciphertext) {
+        return decryptCbc<std::string>(inKey, inIv, ciphertext.data(), ciphertext.size());
+    }
+
     std::vector<char> AES::encrypt(const std::string &key,
                                    const std::array<char, BLOCKSIZE> &iv,
                                    const std::vector<char> &plaintext) {
-        auto ret = encrypt(key, iv, std::string(plaintext.begin(), plaintext.end()));
-        return {ret.begin(), ret.end()};
+        return encryptCbc<std::vector<char>>(key, iv, plaintext.data(), plaintext.size());
     }
 
     std::vector<char> AES::decrypt(const std::string &key,
                                    const std::array<char, BLOCKSIZE> &iv,
                                    const std::vector<char> &ciphertext) {
-        auto ret = decrypt(key, iv, std::string(ciphertext.begin(), ciphertext.end()));
-        return {ret.begin(), ret.end()};
+        return decryptCbc<std::vector<char>>(key, iv, ciphertext.data(), ciphertext.size());
+    }
+
+    void AES::ctr(const Key &inKey,
+                  const InitializationVector &inIv,
+                  size_t offset,
+                  char *data,
+                  size_t length,
+                  bool parallel) {
+        auto key = parseKey(inKey);
+        auto iv = parseIv(inIv);
+
+        size_t taskCount = 1;
+        if (parallel) {
+            taskCount = std::max(1u, std::thread::hardware_concurrency());
+            taskCount = std::min(taskCount, length / CTR_PARALLEL_MIN_SEGMENT);
+        }
+        if (taskCount <= 1) {
+            processCtr(key, iv, offset, data, length);
+            return;
+        }
+
+        // Each task seeks the key stream to the beginning of its segment
+        auto segmentSize = (length + taskCount - 1) / taskCount;
+
+        auto &pool = ThreadPool::getPool();
+        std::vector<std::shared_ptr<Task>> tasks;
+        for (size_t begin = segmentSize; begin < length; begin += segmentSize) {
+            auto count = std::min(segmentSize, length - begin);
+            tasks.emplace_back(pool.addTask([&key, &iv, offset, data, begin, count]() {
+                processCtr(key, iv, offset + begin, data + begin, count);
+            }));
+        }
+
+        // The calling thread handles the first segment instead of waiting idle
+        processCtr(key, iv, offset, data, std::min(segmentSize, length));
+
+        for (auto &task: tasks)
+            task->wait();
     }
-}
\ No newline at end of file
+}
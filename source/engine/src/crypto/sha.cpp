@@ -22,18 +22,34 @@
 #include "cryptopp/filters.h"
 #include "cryptopp/cryptlib.h"
 #include "cryptopp/sha.h"
-#include "cryptopp/hex.h"
 
 namespace engine{
     std::string SHA::sha256(const char *data, size_t length) {
-        std::string tmp;
-        std::string ret;
+        static const char *digits = "0123456789ABCDEF";
+        auto digest = sha256Digest(data, length);
+        std::string ret(digest.size() * 2, 0);
+        for (size_t i = 0; i < digest.size(); i++) {
+            auto c = static_cast<unsigned char>(digest[i]);
+            ret[i * 2] = digits[c >> 4];
+            ret[i * 2 + 1] = digits[c & 0xf];
+        }
+        return ret;
+    }
+
+    SHA::Digest256 SHA::sha256Digest(const char *data, size_t length) {
+        Digest256 ret{};
+        CryptoPP::SHA256 hash;
+        hash.Update(reinterpret_cast<const CryptoPP::byte *>(data), length);
+        hash.Final(reinterpret_cast<CryptoPP::byte *>(ret.data()));
+        return ret;
+    }
+
+    SHA::Digest256 SHA::sha256Digest(char tag, const char *data, size_t length) {
+        Digest256 ret{};
         CryptoPP::SHA256 hash;
-        CryptoPP::HexEncoder encoder(new CryptoPP::StringSink(ret));
-        hash.Update((const CryptoPP::byte *) data, length);
-        tmp.resize(hash.DigestSize());
-        hash.Final((CryptoPP::byte *) &tmp[0]);
-        CryptoPP::StringSource(tmp, true, new CryptoPP::Redirector(encoder));
+        hash.Update(reinterpret_cast<const CryptoPP::byte *>(&tag), 1);
+        hash.Update(reinterpret_cast<const CryptoPP::byte *>(data), length);
+        hash.Final(reinterpret_cast<CryptoPP::byte *>(ret.data()));
         return ret;
     }
 
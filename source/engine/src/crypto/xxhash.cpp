@@ -0,0 +1,52 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "crypto/xxhash.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <xxhash.h>
+
+namespace engine {
+    XXHash::Digest128 XXHash::xxh3(const char *data, size_t length) {
+        XXH128_canonical_t canonical;
+        XXH128_canonicalFromHash(&canonical, XXH3_128bits(data, length));
+        Digest128 ret{};
+        std::memcpy(ret.data(), canonical.digest, ret.size());
+        return ret;
+    }
+
+    XXHash::Digest128 XXHash::xxh3(char tag, const char *data, size_t length) {
+        auto *state = XXH3_createState();
+        if (state == nullptr)
+            throw std::runtime_error("Failed to allocate xxh3 state");
+        XXH3_128bits_reset(state);
+        XXH3_128bits_update(state, &tag, 1);
+        XXH3_128bits_update(state, data, length);
+        auto hash = XXH3_128bits_digest(state);
+        XXH3_freeState(state);
+
+        XXH128_canonical_t canonical;
+        XXH128_canonicalFromHash(&canonical, hash);
+        Digest128 ret{};
+        std::memcpy(ret.data(), canonical.digest, ret.size());
+        return ret;
+    }
+}
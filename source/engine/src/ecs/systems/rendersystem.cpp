@@ -18,6 +18,7 @@
  */
 
 #include <algorithm>
+#include <cmath>
 #include <filesystem>
 
 #include "ecs/systems/rendersystem.hpp"
@@ -29,10 +30,34 @@
 #include "render/deferred/passes/forwardpass.hpp"
 #include "render/deferred/passes/debugpass.hpp"
 #include "render/deferred/passes/skyboxpass.hpp"
+#include "render/deferred/passes/shadowpass.hpp"
+#include "render/frustumculling.hpp"
 
 #include "asset/assetimporter.hpp"
+#include "asset/meshlod.hpp"
 
 namespace engine {
+    static void updateProxy(DynamicBVH &bvh, std::map<Entity, int> &proxies, const Entity &entity, const AABB &bounds) {
+        auto it = proxies.find(entity);
+        if (bounds.empty()) {
+            if (it != proxies.end()) {
+                bvh.remove(it->second);
+                proxies.erase(it);
+            }
+        } else if (it == proxies.end()) {
+            proxies[entity] = bvh.insert(bounds, static_cast<size_t>(entity.id));
+        } else {
+            bvh.update(it->second, bounds);
+        }
+    }
+
+    static const MeshLod *getMeshLod(AssetManager &assetManager, const AssetPath &mesh) {
+        auto &bundle = assetManager.getBundle(mesh.bundle);
+        if (mesh.asset.empty() || !bundle.has<MeshLod>(mesh.asset))
+            return nullptr;
+        return &bundle.get<MeshLod>(mesh.asset);
+    }
+
     RenderSystem::RenderSystem(RenderTarget &screen,
                                RenderDevice &device,
                                Archive &archive,
@@ -52,13 +77,43 @@ namespace engine {
     RenderSystem::~RenderSystem() = default;
 
     void RenderSystem::start(EntityManager &entityManager) {
-        entityManager.getComponentManager().getPool<MeshRenderComponent>().addListener(this);
-        entityManager.getComponentManager().getPool<SkyboxComponent>().addListener(this);
+        this->entityManager = &entityManager;
+
+        auto &componentManager = entityManager.getComponentManager();
+        componentManager.getPool<MeshRenderComponent>().addListener(this);
+        componentManager.getPool<SkyboxComponent>().addListener(this);
+        componentManager.getPool<TransformComponent>().addListener(this);
+        componentManager.getPool<LightComponent>().addListener(this);
+
+        //Index the components which were created before the system was started
+        for (auto &pair: componentManager.getPool<TransformComponent>()) {
+            if (!pair.second.parent.empty())
+                childEntities[pair.second.parent].insert(pair.first);
+        }
+        for (auto &pair: componentManager.getPool<MeshRenderComponent>()) {
+            markDirty(pair.first);
+        }
+        for (auto &pair: componentManager.getPool<LightComponent>()) {
+            markDirty(pair.first);
+        }
     }
 
     void RenderSystem::stop(EntityManager &entityManager) {
-        entityManager.getComponentManager().getPool<MeshRenderComponent>().removeListener(this);
-        entityManager.getComponentManager().getPool<SkyboxComponent>().removeListener(this);
+        auto &componentManager = entityManager.getComponentManager();
+        componentManager.getPool<MeshRenderComponent>().removeListener(this);
+        componentManager.getPool<SkyboxComponent>().removeListener(this);
+        componentManager.getPool<TransformComponent>().removeListener(this);
+        componentManager.getPool<LightComponent>().removeListener(this);
+
+        meshBVH.clear();
+        lightBVH.clear();
+        meshProxies.clear();
+        lightProxies.clear();
+        unboundedMeshes.clear();
+        dirtyEntities.clear();
+        childEntities.clear();
+
+        this->entityManager = nullptr;
     }
 
     void RenderSystem::update(float deltaTime, EntityManager &entityManager) {
@@ -68,34 +123,13 @@ namespace engine {
 
         polyCount = 0;
 
-        //TODO: Culling
-        //Create deferred draw nodes
-        for (auto &pair: componentManager.getPool<MeshRenderComponent>()) {
-            auto &transform = componentManager.lookup<TransformComponent>(pair.first);
-            if (!transform.enabled)
-                continue;
-
-            auto &render = pair.second;
-            if (!render.enabled)
-                continue;
-
-            auto mesh = AssetHandle<Mesh>(render.mesh, assetManager, &assetRenderManager);
-            auto material = AssetHandle<Material>(render.material, assetManager);
-
-            polyCount += mesh.get().polyCount();
-
-            //TODO: Change transform walking / scene creation to allow model matrix caching
-            scene.deferred.emplace_back(Scene::DeferredDrawNode(
-                    TransformComponent::walkHierarchy(transform, entityManager),
-                    mesh,
-                    material));
-        }
+        auto screenHeight = static_cast<float>(screenTarget.getSize().y);
 
-        //Get Skybox
-        for (auto &pair: componentManager.getPool<SkyboxComponent>()) {
-            auto &comp = pair.second;
-            scene.skybox = comp.skybox;
+        //Apply the transform and component changes to the bounding volume hierarchies
+        for (auto &entity: dirtyEntities) {
+            updateBounds(entity);
         }
+        dirtyEntities.clear();
 
         //Get Camera
         for (auto &pair: componentManager.getPool<CameraComponent>()) {
@@ -112,6 +146,66 @@ namespace engine {
             break;
         }
 
+        //Query the meshes and lights intersecting the view frustum
+        Frustum frustum(scene.camera.projection() * scene.camera.view());
+
+        std::vector<Entity> visibleMeshes(unboundedMeshes.begin(), unboundedMeshes.end());
+        meshBVH.queryFrustum(frustum, [this, &visibleMeshes](int proxy) {
+            visibleMeshes.emplace_back(static_cast<int>(meshBVH.getUserData(proxy)));
+        });
+        //Keep the draw order of the component pool
+        std::sort(visibleMeshes.begin(), visibleMeshes.end());
+
+        std::set<Entity> visibleLights;
+        lightBVH.queryFrustum(frustum, [this, &visibleLights](int proxy) {
+            visibleLights.insert(Entity(static_cast<int>(lightBVH.getUserData(proxy))));
+        });
+
+        //Create deferred draw nodes
+        for (auto &entity: visibleMeshes) {
+            auto &transform = componentManager.lookup<TransformComponent>(entity);
+            auto &render = componentManager.lookup<MeshRenderComponent>(entity);
+
+            //TODO: Change transform walking / scene creation to allow model matrix caching
+            auto worldTransform = TransformComponent::walkHierarchy(transform, entityManager);
+
+            //Select the level of detail from the projected size of the mesh
+            auto meshPath = render.mesh;
+            auto *lod = getMeshLod(assetManager, render.mesh);
+            if (lod != nullptr) {
+                auto &scale = worldTransform.getScale();
+                float radius = lod->radius
+                               * std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+                float projectedSize = scene.camera.projectedSize(worldTransform.getPosition(), radius, screenHeight);
+                meshPath.asset = MeshLod::getLevelName(render.mesh.asset, lod->selectLevel(projectedSize,
+                                                                                            lodPixelError));
+            }
+
+            auto mesh = AssetHandle<Mesh>(meshPath, assetManager, &assetRenderManager);
+            auto material = AssetHandle<Material>(render.material, assetManager);
+
+            auto &meshData = mesh.get();
+
+            Scene::DeferredDrawNode node(worldTransform, mesh, material);
+            node.bounds = meshData.bounds;
+            node.boundingSphere = meshData.boundingSphere;
+
+            scene.deferred.emplace_back(std::move(node));
+        }
+
+        culledCount = meshProxies.size() + unboundedMeshes.size() - visibleMeshes.size();
+        culledCount += FrustumCulling::cull(scene, ThreadPool::getPool());
+
+        for (auto &node: scene.deferred) {
+            polyCount += node.mesh.get().polyCount();
+        }
+
+        //Get Skybox
+        for (auto &pair: componentManager.getPool<SkyboxComponent>()) {
+            auto &comp = pair.second;
+            scene.skybox = comp.skybox;
+        }
+
         //Get lights
         for (auto &pair: componentManager.getPool<LightComponent>()) {
             auto &lightComponent = pair.second;
@@ -123,11 +217,53 @@ namespace engine {
             if (!tcomp.enabled)
                 continue;
 
+            //Lights without a proxy have an unbounded range
+            if (lightProxies.find(pair.first) != lightProxies.end()
+                && visibleLights.find(pair.first) == visibleLights.end())
+                continue;
+
             lightComponent.light.transform = tcomp.transform;
 
             scene.lights.emplace_back(lightComponent.light);
         }
 
+        //Get the meshes which can cast a shadow into the view of a shadow casting light
+        std::set<Entity> shadowCasters;
+        auto addCaster = [this, &shadowCasters](int proxy) {
+            shadowCasters.insert(Entity(static_cast<int>(meshBVH.getUserData(proxy))));
+        };
+        for (auto &light: scene.lights) {
+            if (!light.castShadows)
+                continue;
+
+            shadowCasters.insert(unboundedMeshes.begin(), unboundedMeshes.end());
+
+            if (light.type == LIGHT_DIRECTIONAL) {
+                meshBVH.queryAABB(ShadowPass::getDirectionalCasterBounds(scene.camera, light), addCaster);
+            } else {
+                auto range = light.getRange();
+                if (!std::isfinite(range))
+                    range = light.shadowDistance;
+                meshBVH.querySphere(BoundingSphere(light.transform.getPosition(), range), addCaster);
+            }
+        }
+
+        for (auto &entity: shadowCasters) {
+            auto &transform = componentManager.lookup<TransformComponent>(entity);
+            auto &render = componentManager.lookup<MeshRenderComponent>(entity);
+
+            if (!render.castShadows)
+                continue;
+
+            Scene::ShadowCasterNode node;
+            node.id = entity.id;
+            node.transform = TransformComponent::walkHierarchy(transform, entityManager);
+            node.mesh = AssetHandle<Mesh>(render.mesh, assetManager, &assetRenderManager);
+            node.bounds = node.mesh.get().bounds;
+
+            scene.shadowCasters.emplace_back(std::move(node));
+        }
+
         //Render
         ren->render(screenTarget, scene);
     }
@@ -137,6 +273,8 @@ namespace engine {
     }
 
     void RenderSystem::onComponentCreate(const Entity &entity, const MeshRenderComponent &component) {
+        markDirty(entity);
+
         assetManager.incrementRef(component.mesh);
         assetManager.incrementRef(component.material);
 
@@ -144,6 +282,15 @@ namespace engine {
 
         assetRenderManager.incrementRef(component.mesh);
 
+        //Keep the render objects of the lod levels alive while the component exists
+        auto *lod = getMeshLod(assetManager, component.mesh);
+        if (lod != nullptr) {
+            for (int i = 1; i < lod->getLevelCount(); i++) {
+                assetRenderManager.incrementRef({component.mesh.bundle,
+                                                 MeshLod::getLevelName(component.mesh.asset, i)});
+            }
+        }
+
         if (!material.diffuseTexture.empty()) {
             assetRenderManager.incrementRef(material.diffuseTexture);
         }
@@ -165,7 +312,16 @@ namespace engine {
     }
 
     void RenderSystem::onComponentDestroy(const Entity &entity, const MeshRenderComponent &component) {
+        markDirty(entity);
+
         assetRenderManager.decrementRef<Mesh>(component.mesh);
+        auto *lod = getMeshLod(assetManager, component.mesh);
+        if (lod != nullptr) {
+            for (int i = 1; i < lod->getLevelCount(); i++) {
+                assetRenderManager.decrementRef<Mesh>({component.mesh.bundle,
+                                                       MeshLod::getLevelName(component.mesh.asset, i)});
+            }
+        }
         auto material = assetManager.getAsset<Material>(component.material);
         if (!material.diffuseTexture.empty()) {
             assetRenderManager.decrementRef<Texture>(material.diffuseTexture);
@@ -214,4 +370,96 @@ namespace engine {
         onComponentDestroy(entity, oldValue);
         onComponentCreate(entity, newValue);
     }
-}
\ No newline at end of file
+
+    void RenderSystem::onComponentCreate(const Entity &entity, const TransformComponent &component) {
+        if (!component.parent.empty())
+            childEntities[component.parent].insert(entity);
+        markDirty(entity);
+    }
+
+    void RenderSystem::onComponentDestroy(const Entity &entity, const TransformComponent &component) {
+        if (!component.parent.empty()) {
+            auto it = childEntities.find(component.parent);
+            if (it != childEntities.end()) {
+                it->second.erase(entity);
+                if (it->second.empty())
+                    childEntities.erase(it);
+            }
+        }
+        markDirty(entity);
+    }
+
+    void RenderSystem::onComponentUpdate(const Entity &entity,
+                                         const TransformComponent &oldValue,
+                                         const TransformComponent &newValue) {
+        if (oldValue.parent != newValue.parent) {
+            onComponentDestroy(entity, oldValue);
+            onComponentCreate(entity, newValue);
+        } else {
+            markDirty(entity);
+        }
+    }
+
+    void RenderSystem::onComponentCreate(const Entity &entity, const LightComponent &component) {
+        markDirty(entity);
+    }
+
+    void RenderSystem::onComponentDestroy(const Entity &entity, const LightComponent &component) {
+        markDirty(entity);
+    }
+
+    void RenderSystem::onComponentUpdate(const Entity &entity,
+                                         const LightComponent &oldValue,
+                                         const LightComponent &newValue) {
+        markDirty(entity);
+    }
+
+    void RenderSystem::markDirty(const Entity &entity) {
+        if (!dirtyEntities.insert(entity).second)
+            return;
+
+        //The world transform of the children depends on the transform of the entity
+        if (entityManager == nullptr || !entityManager->hasName(entity))
+            return;
+        auto it = childEntities.find(entityManager->getName(entity));
+        if (it == childEntities.end())
+            return;
+        for (auto &child: it->second) {
+            markDirty(child);
+        }
+    }
+
+    void RenderSystem::updateBounds(const Entity &entity) {
+        auto &componentManager = entityManager->getComponentManager();
+        auto &transforms = componentManager.getPool<TransformComponent>();
+        auto &renders = componentManager.getPool<MeshRenderComponent>();
+        auto &lights = componentManager.getPool<LightComponent>();
+
+        bool enabled = transforms.check(entity) && transforms.lookup(entity).enabled;
+
+        AABB meshBounds;
+        bool drawn = enabled && renders.check(entity) && renders.lookup(entity).enabled;
+        if (drawn) {
+            auto &render = renders.lookup(entity);
+            auto worldTransform = TransformComponent::walkHierarchy(transforms.lookup(entity), *entityManager);
+            meshBounds = assetManager.getAsset<Mesh>(render.mesh).bounds.transform(worldTransform.model());
+        }
+        updateProxy(meshBVH, meshProxies, entity, meshBounds);
+        if (drawn && meshBounds.empty())
+            unboundedMeshes.insert(entity);
+        else
+            unboundedMeshes.erase(entity);
+
+        //Directional lights and lights with an infinite range are not inserted and never culled
+        AABB lightBounds;
+        if (enabled && lights.check(entity)) {
+            auto &light = lights.lookup(entity);
+            if (light.enabled && light.light.type != LIGHT_DIRECTIONAL) {
+                auto range = light.light.getRange();
+                if (std::isfinite(range))
+                    lightBounds = BoundingSphere(transforms.lookup(entity).transform.getPosition(), range).bounds();
+            }
+        }
+        updateProxy(lightBVH, lightProxies, entity, lightBounds);
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "io/archive/layeredarchive.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace engine {
+    void LayeredArchive::mount(std::unique_ptr<Archive> archive, int priority) {
+        if (archive == nullptr)
+            throw std::runtime_error("Cannot mount null archive");
+
+        // Insert before the archives with equal priority so that it is searched first
+        auto it = std::find_if(layers.begin(), layers.end(), [priority](const Layer &layer) {
+            return layer.priority <= priority;
+        });
+        layers.insert(it, Layer{std::move(archive), priority, false});
+
+        rebuildIndex();
+    }
+
+    bool LayeredArchive::exists(const std::string &name) {
+        return find(name) != nullptr;
+    }
+
+    std::unique_ptr<std::istream> LayeredArchive::open(const std::string &name) {
+        auto *archive = find(name);
+        if (archive == nullptr)
+            throw std::runtime_error("Entry not found in mounted archives: " + name);
+        return archive->open(name);
+    }
+
+    bool LayeredArchive::listEntries(std::vector<std::string> &names) {
+        for (auto &layer: layers) {
+            if (!layer.indexed)
+                return false;
+        }
+        for (auto &pair: index)
+            names.emplace_back(pair.first);
+        return true;
+    }
+
+    void LayeredArchive::rebuildIndex() {
+        index.clear();
+        std::vector<std::string> names;
+        // Iterate from the lowest priority so that higher priority layers overwrite the entries
+        for (auto i = layers.size(); i > 0; i--) {
+            auto &layer = layers.at(i - 1);
+            names.clear();
+            layer.indexed = layer.archive->listEntries(names);
+            for (auto &name: names)
+                index[name] = i - 1;
+        }
+    }
+
+    Archive *LayeredArchive::find(const std::string &name) {
+        auto it = index.find(name);
+        auto indexedLayer = it == index.end() ? layers.size() : it->second;
+
+        // Only layers which cannot be indexed and have a higher priority than the indexed match need to be queried
+        for (size_t i = 0; i < indexedLayer; i++) {
+            auto &layer = layers.at(i);
+            if (!layer.indexed && layer.archive->exists(name))
+                return layer.archive.get();
+        }
+
+        if (it == index.end())
+            return nullptr;
+        return layers.at(indexedLayer).archive.get();
+    }
+}
@@ -20,8 +20,10 @@
 #include "io/archive/pakarchive.hpp"
 
 #include <filesystem>
-#include <sstream>
 #include <utility>
+#include <algorithm>
+
+#include "io/memorystreambuf.hpp"
 
 namespace engine {
     PakArchive::PakArchive(std::vector<std::unique_ptr<std::istream>> streams,
@@ -30,15 +32,96 @@ namespace engine {
                            const AES::InitializationVector &iv)
             : pak(std::move(streams), key, iv), verifyHashes(verifyHashes) {}
 
+    PakArchive::PakArchive(const std::vector<std::string> &paths,
+                           bool verifyHashes,
+                           const AES::Key &key,
+                           const AES::InitializationVector &iv)
+            : pak(paths, key, iv), verifyHashes(verifyHashes) {}
+
     bool PakArchive::exists(const std::string &path) {
         return pak.exists(path);
     }
 
     std::unique_ptr<std::istream> PakArchive::open(const std::string &path) {
-        std::lock_guard<std::mutex> guard(mutex);
-        auto data = pak.get(path, verifyHashes);
-        auto ret = std::make_unique<std::stringstream>(std::string(data.begin(), data.end()));
+        if (tracing)
+            recordAccess(path);
+        if (readAheadCount > 0)
+            readAhead(path);
+
+        auto ret = std::make_unique<MemoryStream>(pak.get(path, verifyHashes));
         std::noskipws(*ret);
-        return std::move(ret);
+        return ret;
+    }
+
+    bool PakArchive::listEntries(std::vector<std::string> &names) {
+        auto paths = pak.getPaths();
+        names.insert(names.end(), paths.begin(), paths.end());
+        return true;
+    }
+
+    void PakArchive::startTrace() {
+        std::lock_guard<std::mutex> guard(traceMutex);
+        trace.clear();
+        tracedPaths.clear();
+        tracing = true;
+    }
+
+    std::vector<std::string> PakArchive::stopTrace() {
+        std::lock_guard<std::mutex> guard(traceMutex);
+        tracing = false;
+        tracedPaths.clear();
+        return std::move(trace);
+    }
+
+    void PakArchive::setReadAhead(std::vector<std::string> readTrace, size_t count) {
+        readAheadTrace = std::move(readTrace);
+        readAheadIndex.clear();
+        for (size_t i = 0; i < readAheadTrace.size(); i++)
+            readAheadIndex.emplace(readAheadTrace.at(i), i);
+        readAheadCount = count;
+        prefetchedEnd = 0;
+    }
+
+    void PakArchive::writeTrace(std::ostream &stream, const std::vector<std::string> &trace) {
+        for (auto &path: trace)
+            stream << path << "\n";
+    }
+
+    std::vector<std::string> PakArchive::readTrace(std::istream &stream) {
+        std::vector<std::string> ret;
+        std::string line;
+        while (std::getline(stream, line)) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!line.empty())
+                ret.emplace_back(line);
+        }
+        return ret;
+    }
+
+    void PakArchive::recordAccess(const std::string &path) {
+        std::lock_guard<std::mutex> guard(traceMutex);
+        if (tracing && tracedPaths.insert(path).second)
+            trace.emplace_back(path);
+    }
+
+    void PakArchive::readAhead(const std::string &path) {
+        auto it = readAheadIndex.find(path);
+        if (it == readAheadIndex.end())
+            return;
+
+        auto begin = it->second + 1;
+        auto end = std::min(begin + readAheadCount, readAheadTrace.size());
+
+        // Skip the entries which were already prefetched when the accesses follow the trace
+        auto prefetched = prefetchedEnd.load();
+        if (prefetched > begin && prefetched <= end)
+            begin = prefetched;
+        if (begin >= end)
+            return;
+        prefetchedEnd = end;
+
+        for (auto i = begin; i < end; i++)
+            pak.prefetch(readAheadTrace.at(i));
     }
-}
\ No newline at end of file
+}
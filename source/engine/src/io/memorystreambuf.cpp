@@ -0,0 +1,88 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "io/memorystreambuf.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace engine {
+    MemoryStreamBuf::MemoryStreamBuf(const char *data, size_t size) {
+        // The get area is never written to
+        auto *begin = const_cast<char *>(data);
+        setg(begin, begin, begin + size);
+    }
+
+    MemoryStreamBuf::MemoryStreamBuf(std::vector<char> data)
+            : data(std::move(data)) {
+        auto *begin = this->data.data();
+        setg(begin, begin, begin + this->data.size());
+    }
+
+    std::streamsize MemoryStreamBuf::showmanyc() {
+        auto ret = egptr() - gptr();
+        return ret > 0 ? ret : -1;
+    }
+
+    std::streamsize MemoryStreamBuf::xsgetn(char_type *s, std::streamsize count) {
+        auto ret = std::min<std::streamsize>(count, egptr() - gptr());
+        if (ret > 0) {
+            std::memcpy(s, gptr(), static_cast<size_t>(ret));
+            // gbump takes an int which cannot advance past 2 GiB
+            setg(eback(), gptr() + ret, egptr());
+        }
+        return ret;
+    }
+
+    MemoryStreamBuf::pos_type MemoryStreamBuf::seekoff(off_type off,
+                                                       std::ios_base::seekdir dir,
+                                                       std::ios_base::openmode which) {
+        if (which & std::ios_base::out)
+            return pos_type(off_type(-1));
+
+        off_type base;
+        if (dir == std::ios_base::beg)
+            base = 0;
+        else if (dir == std::ios_base::cur)
+            base = gptr() - eback();
+        else
+            base = egptr() - eback();
+
+        auto position = base + off;
+        if (position < 0 || position > egptr() - eback())
+            return pos_type(off_type(-1));
+
+        setg(eback(), eback() + position, egptr());
+        return pos_type(position);
+    }
+
+    MemoryStreamBuf::pos_type MemoryStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+    MemoryStream::MemoryStream(const char *data, size_t size)
+            : std::istream(nullptr), buffer(data, size) {
+        rdbuf(&buffer);
+    }
+
+    MemoryStream::MemoryStream(std::vector<char> data)
+            : std::istream(nullptr), buffer(std::move(data)) {
+        rdbuf(&buffer);
+    }
+}
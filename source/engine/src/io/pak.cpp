@@ -21,15 +21,25 @@
 
 #include <utility>
 #include <filesystem>
+#include <algorithm>
+#include <limits>
+#include <sstream>
 
 #include "json.hpp"
 #include "base64.hpp"
 
 #include "io/readfile.hpp"
+#include "io/pakbuilder.hpp"
 #include "compression/gzip.hpp"
+#include "compression/lz4.hpp"
+#include "compression/zstd.hpp"
 #include "crypto/sha.hpp"
 
+#include "pakformat.hpp"
+
 namespace engine {
+    using namespace PakFormat;
+
     std::map<std::string, std::vector<char>> Pak::readEntries(const std::string &directory, bool recursive) {
         std::map<std::string, std::vector<char>> ret;
         for (auto &file: std::filesystem::recursive_directory_iterator(directory)) {
@@ -43,96 +53,32 @@ namespace engine {
     }
 
     static std::vector<std::vector<char>> createPakInternal(const std::map<std::string, std::vector<char>> &entries,
-                                                            long chunkSize,
-                                                            bool compress,
-                                                            bool encrypt,
-                                                            const AES::Key &key,
-                                                            const AES::InitializationVector &iv) {
-        std::vector<char> data;
-        size_t currentOffset = 0;
-
-        std::map<std::string, Pak::HeaderEntry> headerEntries;
+                                                            PakBuilder &builder) {
         for (auto &pair: entries) {
-            auto d = pair.second;
-
-            if (compress) {
-                d = GZip::compress(d);
-            }
-
-            if (encrypt) {
-                d = AES::encrypt(key, iv, d);
-            }
-
-            headerEntries[pair.first].offset = currentOffset;
-            headerEntries[pair.first].size = d.size();
-            headerEntries[pair.first].hash = SHA::sha256(pair.second);
-
-            currentOffset += d.size();
-
-            data.insert(data.begin() + static_cast<long>(data.size()), d.begin(), d.end());
+            auto *data = &pair.second;
+            builder.addEntry(pair.first, data->size(), [data]() { return *data; });
         }
 
-        nlohmann::json headerJson;
-        headerJson["chunkSize"] = chunkSize;
-        headerJson["compressed"] = compress;
-        for (auto &pair: headerEntries) {
-            auto &element = headerJson["entries"][pair.first];
-            element["offset"] = pair.second.offset;
-            element["size"] = pair.second.size;
-            element["hash"] = pair.second.hash;
-        }
-
-        auto headerStr = headerJson.dump();
-        headerStr = GZip::compress(headerStr);
-
-        if (encrypt) {
-            headerStr = AES::encrypt(key, iv, headerStr);
-        }
-
-        nlohmann::json outHeaderJson;
-        outHeaderJson["encrypted"] = encrypt;
-        outHeaderJson["data"] = base64_encode(headerStr);
-
-        auto outHeaderStr = outHeaderJson.dump();
-
-        auto hdr = PAK_HEADER_MAGIC + outHeaderStr;
-
-        if (chunkSize > 0) {
-            auto totalSize = hdr.size() + data.size();
-            auto totalWholeChunks = totalSize / chunkSize;
-            auto totalRemainder = totalSize % chunkSize;
-
-            auto totalChunks = totalWholeChunks;
-            if (totalRemainder != 0)
-                totalChunks += 1;
-
-            std::vector<std::vector<char>> ret(totalChunks);
-
-            size_t chunkIndex = 0;
-            for (auto i = 0; i < totalSize; i++) {
-                auto &chunk = ret.at(chunkIndex);
-
-                if (i < hdr.size()) {
-                    chunk.emplace_back(hdr.at(i));
-                } else {
-                    chunk.emplace_back(data.at(i - hdr.size()));
-                }
-
-                if (chunk.size() == chunkSize)
-                    chunkIndex++;
-            }
-
-            return ret;
-        } else {
-            data.insert(data.begin(), hdr.begin(), hdr.end());
-            return {data};
+        // The buffers outlive the streams which are destroyed by the builder
+        std::vector<std::unique_ptr<std::stringbuf>> buffers;
+        builder.build([&buffers](size_t) {
+            buffers.emplace_back(std::make_unique<std::stringbuf>(std::ios::out | std::ios::binary));
+            return std::make_unique<std::ostream>(buffers.back().get());
+        });
+
+        std::vector<std::vector<char>> ret;
+        for (auto &buffer: buffers) {
+            auto str = buffer->str();
+            ret.emplace_back(str.begin(), str.end());
         }
+        return ret;
     }
 
     std::vector<std::vector<char>> Pak::createPak(const std::map<std::string, std::vector<char>> &entries,
                                                   long chunkSize,
                                                   bool compressData) {
-        return createPakInternal(entries, chunkSize, compressData, false, {}, {});
+        PakBuilder builder(chunkSize, compressData);
+        return createPakInternal(entries, builder);
     }
 
     std::vector<std::vector<char>> Pak::createPak(const std::map<std::string, std::vector<char>> &entries,
@@ -140,155 +86,331 @@ namespace engine {
                                                   bool compressData,
                                                   const AES::Key &key,
                                                   const AES::InitializationVector &iv) {
-        return createPakInternal(entries, chunkSize, compressData, true, key, iv);
+        PakBuilder builder(chunkSize, compressData, key, iv);
+        return createPakInternal(entries, builder);
+    }
+
+    static std::vector<std::unique_ptr<PakChunk>> createStreamChunks(std::vector<std::unique_ptr<std::istream>> streams) {
+        std::vector<std::unique_ptr<PakChunk>> ret;
+        for (auto &stream: streams)
+            ret.emplace_back(std::make_unique<StreamPakChunk>(std::move(stream)));
+        return ret;
+    }
+
+    static std::vector<std::unique_ptr<PakChunk>> createFileChunks(const std::vector<std::string> &paths) {
+        std::vector<std::unique_ptr<PakChunk>> ret;
+        for (auto &path: paths)
+            ret.emplace_back(std::make_unique<FilePakChunk>(path));
+        return ret;
     }
 
     Pak::Pak(std::vector<std::unique_ptr<std::istream>> streams, AES::Key key, AES::InitializationVector iv)
-            : streams(std::move(streams)),
+            : Pak(createStreamChunks(std::move(streams)), std::move(key), iv) {}
+
+    Pak::Pak(const std::vector<std::string> &paths, AES::Key key, AES::InitializationVector iv)
+            : Pak(createFileChunks(paths), std::move(key), iv) {}
+
+    Pak::Pak(std::vector<std::unique_ptr<PakChunk>> chunks, AES::Key key, AES::InitializationVector iv)
+            : chunks(std::move(chunks)),
               key(std::move(key)),
               iv(iv) {
         loadHeader();
     }
 
-    std::vector<char> Pak::get(const std::string &path, bool verifyHash) {
+    std::vector<char> Pak::get(const std::string &path, bool verifyHash) const {
+        HeaderEntry hEntry;
+        if (!findEntry(path, hEntry))
+            throw std::runtime_error("Pak entry not found: " + path);
+
         std::vector<char> ret;
-        auto hEntry = entries.at(path);
-
-        /*
-        // Simple but slow, read each character sequentially.
-        for (auto i = 0; i < hEntry.size; i++) {
-            auto pos = hEntry.offset + i;
-            auto relOff = getRelativeOffset(pos); // The offset relative to the stream
-            auto &stream = getStreamForOffset(pos); // The stream which provides the offset
-            stream.seekg(static_cast<std::streamoff>(relOff));
-            stream.read(&ret.at(i), static_cast<std::streamoff>(1));
-            if (stream.gcount() != 1)
-                throw std::runtime_error("Invalid pak entry data length");
+        if (hEntry.blockSize > 0) {
+            ret = readBlocks(hEntry, 0, hEntry.decompressedSize);
+        } else {
+            ret.resize(hEntry.size);
+            readDecrypted(hEntry.offset, ret.data(), ret.size());
+            ret = decode(hEntry, std::move(ret), hEntry.decompressedSize);
         }
-        */
 
-        auto beginOffset = hEntry.offset % chunkSize; // The offset into the first chunk stream
-        auto beginCount = chunkSize - beginOffset; // The number of bytes in the first chunk stream
-
-        if (hEntry.size < beginCount) {
-            beginCount = hEntry.size;
+        if (verifyHash || hEntry.verify) {
+            if (computeHash(ret) != hEntry.hash) {
+                throw std::runtime_error("Pak entry data hash mismatch");
+            }
         }
 
-        auto remainingCount = static_cast<int>(hEntry.size - beginCount); // The number of remaining bytes
+        return ret;
+    }
 
-        auto remainChunks = remainingCount / chunkSize; // The number of full chunks that the remaining bytes fill
+    std::vector<char> Pak::read(const std::string &path, size_t offset, size_t length) const {
+        HeaderEntry hEntry;
+        if (!findEntry(path, hEntry))
+            throw std::runtime_error("Pak entry not found: " + path);
+
+        if (hEntry.blockSize > 0) {
+            if (offset > hEntry.decompressedSize || length > hEntry.decompressedSize - offset)
+                throw std::runtime_error("Pak read out of range: " + path);
+            return readBlocks(hEntry, offset, length);
+        } else if (hEntry.codec == STORE && (!encrypted || ctr)) {
+            if (offset > hEntry.size || length > hEntry.size - offset)
+                throw std::runtime_error("Pak read out of range: " + path);
+            std::vector<char> ret(length);
+            readDecrypted(hEntry.offset + offset, ret.data(), ret.size());
+            return ret;
+        } else {
+            // Small entries are decoded as a whole
+            auto data = get(path);
+            if (offset > data.size() || length > data.size() - offset)
+                throw std::runtime_error("Pak read out of range: " + path);
+            return {data.begin() + static_cast<long>(offset), data.begin() + static_cast<long>(offset + length)};
+        }
+    }
 
-        auto lastCount = remainingCount %
-                         chunkSize; // The number of bytes in the last partial chunk stream. If the data size matches chunk size a "middle" chunk is the end.
+    size_t Pak::getSize(const std::string &path) const {
+        HeaderEntry hEntry;
+        if (!findEntry(path, hEntry))
+            throw std::runtime_error("Pak entry not found: " + path);
+        if (hEntry.codec == STORE && hEntry.blockSize == 0 && (!encrypted || ctr))
+            return hEntry.size;
+        if (hEntry.decompressedSize > 0 || hEntry.size == 0)
+            return hEntry.decompressedSize;
+        // Versions before 02 do not store the decompressed size
+        return get(path).size();
+    }
 
-        // Read first chunk
-        if (beginCount > 0) {
-            auto &firstStream = getStreamForOffset(hEntry.offset);
-            std::vector<char> tmp(beginCount);
-            firstStream.seekg(static_cast<std::streamoff>(beginOffset));
-            firstStream.read(tmp.data(), static_cast<std::streamoff>(beginCount));
-            if (firstStream.gcount() != beginCount)
-                throw std::runtime_error("Failed to read pak entry");
-            ret.insert(ret.begin(), tmp.begin(), tmp.end());
+    std::vector<char> Pak::decode(const HeaderEntry &entry, std::vector<char> data, size_t decompressedSize) const {
+        if (encrypted && !ctr) {
+            data = AES::decrypt(key, iv, data);
         }
 
-        if (remainChunks > 0) {
-            //Read full chunks
-            for (int i = 0; i < remainChunks; i++) {
-                std::vector<char> chunk(chunkSize);
-                auto gOffset = hEntry.offset + beginCount + (i * chunkSize);
-                auto &stream = getStreamForOffset(gOffset);
-                stream.seekg(0);
-                stream.read(chunk.data(), static_cast<std::streamoff>(chunk.size()));
-                if (stream.gcount() != chunk.size())
-                    throw std::runtime_error("Failed to read pak chunk");
-                ret.insert(ret.end(), chunk.begin(), chunk.end());
-            }
+        switch (entry.codec) {
+            case STORE:
+                return data;
+            case GZIP:
+                return GZip::decompress(data);
+            case LZ4:
+                return LZ4::decompress(data, decompressedSize);
+            case ZSTD:
+                if (dictionary != nullptr)
+                    return dictionary->decompress(data.data(), data.size());
+                else
+                    return ZStd::decompress(data);
+            default:
+                throw std::runtime_error("Invalid pak entry codec");
         }
+    }
 
-        if (lastCount > 0) {
-            // Read last partial chunk
-            std::vector<char> lastChunk(lastCount);
-            auto gOffset = hEntry.offset + beginCount + (remainChunks * chunkSize);
-            auto &lastStream = getStreamForOffset(gOffset);
-            lastStream.seekg(0);
-            lastStream.read(lastChunk.data(), static_cast<std::streamoff>(lastChunk.size()));
-
-            if (lastStream.gcount() != lastChunk.size())
-                throw std::runtime_error("Failed to read pak chunk");
-
-            ret.insert(ret.begin()
-                       + static_cast<std::streamoff>(beginCount)
-                       + static_cast<std::streamoff>(remainChunks) * chunkSize,
-                       lastChunk.begin(),
-                       lastChunk.end());
+    std::vector<char> Pak::readBlocks(const HeaderEntry &entry, size_t offset, size_t length) const {
+        if (length == 0)
+            return {};
+
+        char tableSizeData[8];
+        if (entry.size < sizeof(tableSizeData))
+            throw std::runtime_error("Invalid pak block table size");
+        readDecrypted(entry.offset, tableSizeData, sizeof(tableSizeData));
+        auto tableSize = readUInt64(tableSizeData);
+        if (tableSize > entry.size - sizeof(tableSizeData))
+            throw std::runtime_error("Invalid pak block table size");
+
+        std::vector<char> table(tableSize);
+        readDecrypted(entry.offset + sizeof(tableSizeData), table.data(), table.size());
+        if (encrypted && !ctr) {
+            table = AES::decrypt(key, iv, table);
         }
 
-        if (encrypted) {
-            ret = AES::decrypt(key, iv, ret);
-        }
+        auto blockCount = (entry.decompressedSize + entry.blockSize - 1) / entry.blockSize;
+        if (table.size() < blockCount * 8)
+            throw std::runtime_error("Invalid pak block table size");
 
-        if (compressed) {
-            ret = GZip::decompress(ret);
-        }
+        auto firstBlock = offset / entry.blockSize;
+        auto lastBlock = (offset + length - 1) / entry.blockSize;
 
-        if (verifyHash) {
-            auto hash = SHA::sha256(ret);
-            if (hEntry.hash != hash) {
-                throw std::runtime_error("Pak entry data hash mismatch");
-            }
+        // Read the stored bytes of all required blocks at once
+        size_t storedBegin = firstBlock == 0 ? 0 : readUInt64(table.data() + (firstBlock - 1) * 8);
+        size_t storedEnd = readUInt64(table.data() + lastBlock * 8);
+        auto blocksOffset = entry.offset + sizeof(tableSizeData) + tableSize;
+        if (storedBegin > storedEnd || blocksOffset + storedEnd > entry.offset + entry.size)
+            throw std::runtime_error("Invalid pak block table");
+
+        std::vector<char> stored(storedEnd - storedBegin);
+        readDecrypted(blocksOffset + storedBegin, stored.data(), stored.size());
+
+        std::vector<char> ret;
+        ret.reserve(length);
+        auto end = offset + length;
+        size_t blockBegin = storedBegin;
+        for (auto i = firstBlock; i <= lastBlock; i++) {
+            size_t blockEnd = readUInt64(table.data() + i * 8);
+            if (blockEnd < blockBegin || blockEnd > storedEnd)
+                throw std::runtime_error("Invalid pak block table");
+
+            auto dataBegin = i * entry.blockSize;
+            auto dataLength = std::min(entry.blockSize, entry.decompressedSize - dataBegin);
+
+            auto block = decode(entry,
+                                std::vector<char>(stored.begin() + static_cast<long>(blockBegin - storedBegin),
+                                                  stored.begin() + static_cast<long>(blockEnd - storedBegin)),
+                                dataLength);
+            if (block.size() != dataLength)
+                throw std::runtime_error("Invalid pak block size");
+
+            auto copyBegin = std::max(offset, dataBegin) - dataBegin;
+            auto copyEnd = std::min(end, dataBegin + dataLength) - dataBegin;
+            ret.insert(ret.end(),
+                       block.begin() + static_cast<long>(copyBegin),
+                       block.begin() + static_cast<long>(copyEnd));
+
+            blockBegin = blockEnd;
         }
 
         return ret;
     }
 
     void Pak::loadHeader() {
-        size_t dataBegin;
-        std::string headerStr;
-        int scope = -1;
-        char c;
-        int streamIndex = 0;
-        auto calChunkSize = 0;
-        for (auto i = 0; i < std::numeric_limits<size_t>::max(); i++) {
-            auto &s = *streams.at(streamIndex);
-            auto offset = i - ((calChunkSize) * streamIndex);
+        if (chunks.empty())
+            throw std::runtime_error("No pak chunks");
+
+        std::string hdr(PAK_HEADER_SIZE, 0);
+
+        auto &chunk = *chunks.at(0);
+        if (chunk.read(0, &hdr[0], PAK_HEADER_MAGIC.size()) != PAK_HEADER_MAGIC.size())
+            throw std::runtime_error("Failed to load header (Invalid length)");
+
+        size_t headerSize;
+        size_t minRecordSize;
+        if (hdr.compare(0, PAK_HEADER_MAGIC_LEGACY.size(), PAK_HEADER_MAGIC_LEGACY) == 0) {
+            loadLegacyHeader();
+            return;
+        } else if (hdr.compare(0, PAK_HEADER_MAGIC_V1.size(), PAK_HEADER_MAGIC_V1) == 0) {
+            headerSize = PAK_HEADER_SIZE_V1;
+            minRecordSize = PAK_RECORD_SIZE_V1;
+        } else if (hdr.compare(0, PAK_HEADER_MAGIC.size(), PAK_HEADER_MAGIC) == 0) {
+            headerSize = PAK_HEADER_SIZE;
+            minRecordSize = PAK_RECORD_SIZE;
+        } else {
+            throw std::runtime_error("Invalid pak header magic");
+        }
 
-            s.seekg(static_cast<std::streamoff>(offset));
-            s.read(&c, 1);
+        auto remainder = headerSize - PAK_HEADER_MAGIC.size();
+        if (chunk.read(PAK_HEADER_MAGIC.size(), &hdr[PAK_HEADER_MAGIC.size()], remainder) != remainder)
+            throw std::runtime_error("Failed to load header (Invalid length)");
+
+        auto *ptr = hdr.data() + PAK_HEADER_MAGIC.size();
+        auto flags = readUInt32(ptr);
+        recordSize = readUInt32(ptr + 4);
+        auto storedChunkSize = readUInt64(ptr + 8);
+        entryCount = readUInt64(ptr + 16);
+        auto indexSize = readUInt64(ptr + 24);
+        dataOffset = readUInt64(ptr + 32);
+
+        size_t dictionaryOffset = 0;
+        size_t dictionarySize = 0;
+        if (headerSize >= PAK_HEADER_SIZE) {
+            dictionaryOffset = readUInt64(ptr + 40);
+            dictionarySize = readUInt64(ptr + 48);
+            counter = getCounterBlock(readUInt64(ptr + 56));
+        }
 
-            if (s.eof()) {
-                if (calChunkSize == 0)
-                    calChunkSize = i;
+        compressed = flags & PAK_FLAG_COMPRESSED;
+        encrypted = flags & PAK_FLAG_ENCRYPTED;
+        ctr = encrypted && (flags & PAK_FLAG_CTR);
+        hashType = flags & PAK_FLAG_HASH_XXH3 ? XXH3 : SHA256;
+        treeHash = flags & PAK_FLAG_TREE_HASH;
+        chunkSize = storedChunkSize > 0 ? static_cast<long>(storedChunkSize) : -1;
 
-                streamIndex++;
+        if (recordSize < minRecordSize)
+            throw std::runtime_error("Invalid pak record size");
 
-                offset = i - ((calChunkSize) * streamIndex);
+        index.resize(indexSize);
+        readDecrypted(headerSize, index.data(), index.size());
 
-                auto &tmp = *streams.at(streamIndex);
-                tmp.seekg(static_cast<std::streamoff>(offset));
-                tmp.read(&c, 1);
-            } else if (s.gcount() == 0) {
-                throw std::runtime_error("Failed to load header (Invalid length)");
+        if (encrypted && !ctr) {
+            try {
+                index = AES::decrypt(key, iv, index);
+            } catch (const std::exception &e) {
+                std::string error = "Failed to decrypt pak header (Wrong Key?): " + std::string(e.what());
+                throw std::runtime_error(error);
             }
+        }
 
-            if (i < PAK_HEADER_MAGIC.size())
-                continue;
+        if (dictionarySize > 0) {
+            std::vector<char> dictionaryData(dictionarySize);
+            readDecrypted(dataOffset + dictionaryOffset, dictionaryData.data(), dictionaryData.size());
+            if (encrypted && !ctr) {
+                dictionaryData = AES::decrypt(key, iv, dictionaryData);
+            }
+            dictionary = std::make_unique<ZStd::Dictionary>(dictionaryData);
+        }
 
-            headerStr += c;
+        if (index.size() < entryCount * recordSize)
+            throw std::runtime_error("Invalid pak index size");
 
-            if (c == '{') {
-                if (scope == -1)
-                    scope = 1;
-                else
-                    scope++;
-            } else if (c == '}') {
-                scope--;
-            }
+        // Counter mode has no padding to detect a wrong key, a wrongly decrypted index fails the validation
+        if (!validateIndex()) {
+            if (encrypted)
+                throw std::runtime_error("Failed to decrypt pak header (Wrong Key?)");
+            else
+                throw std::runtime_error("Invalid pak index");
+        }
+    }
 
-            if (scope == 0) {
-                dataBegin = i + 1;
-                break;
+    bool Pak::validateIndex() const {
+        auto pathTableSize = index.size() - entryCount * recordSize;
+        uint64_t previousHash = 0;
+        for (size_t i = 0; i < entryCount; i++) {
+            auto *record = index.data() + i * recordSize;
+            auto hash = readUInt64(record);
+            if (hash < previousHash)
+                return false;
+            previousHash = hash;
+
+            size_t pathOffset = readUInt32(record + 24);
+            size_t pathLength = readUInt32(record + 28);
+            if (pathOffset > pathTableSize || pathLength > pathTableSize - pathOffset)
+                return false;
+        }
+        return true;
+    }
+
+    void Pak::loadLegacyHeader() {
+        // All chunks except the last one are full, the chunk size is stored in the encoded header.
+        chunkSize = chunks.size() > 1 ? static_cast<long>(chunks.at(0)->getSize()) : -1;
+
+        size_t totalSize = 0;
+        for (auto &chunk: chunks)
+            totalSize += chunk->getSize();
+
+        // Scan for the end of the json wrapper
+        size_t dataBegin = 0;
+        std::string headerStr;
+        int scope = -1;
+        std::vector<char> block(4096);
+        auto offset = PAK_HEADER_MAGIC_LEGACY.size();
+        while (dataBegin == 0) {
+            if (offset >= totalSize)
+                throw std::runtime_error("Failed to load header (Invalid length)");
+
+            auto count = std::min(block.size(), totalSize - offset);
+            readData(offset, block.data(), count);
+
+            for (size_t i = 0; i < count; i++) {
+                auto c = block.at(i);
+                headerStr += c;
+
+                if (c == '{') {
+                    if (scope == -1)
+                        scope = 1;
+                    else
+                        scope++;
+                } else if (c == '}') {
+                    scope--;
+                }
+
+                if (scope == 0) {
+                    dataBegin = offset + i + 1;
+                    break;
+                }
             }
+
+            offset += count;
         }
 
         auto headerWrap = nlohmann::json::parse(headerStr);
@@ -299,7 +421,7 @@ namespace engine {
 
         if (encrypted) {
             try {
-                headerStr = engine::AES::decrypt(key, {}, headerStr);
+                headerStr = engine::AES::decrypt(key, iv, headerStr);
             } catch (const std::exception &e) {
                 std::string error = "Failed to decrypt pak header (Wrong Key?): " + std::string(e.what());
                 throw std::runtime_error(error);
@@ -313,32 +435,153 @@ namespace engine {
         compressed = headerJson["compressed"];
         chunkSize = headerJson["chunkSize"];
 
+        std::map<std::string, HeaderEntry> headerEntries;
         for (auto &pair: headerJson.value<std::map<std::string, nlohmann::json>>("entries", {})) {
             auto &path = pair.first;
             auto &entry = pair.second;
             size_t offset = entry["offset"];
             size_t size = entry["size"];
             std::string hash = entry["hash"];
-            entries[path] = {dataBegin + offset, size, hash};
+            headerEntries[path] = {offset, size, hexToBinary(hash), compressed ? GZIP : STORE};
         }
+
+        // Convert the entries to the in memory index of the current format
+        auto indexStr = buildIndex(headerEntries);
+        index = std::vector<char>(indexStr.begin(), indexStr.end());
+        entryCount = headerEntries.size();
+        recordSize = PAK_RECORD_SIZE;
+        dataOffset = dataBegin;
     }
 
-    size_t Pak::getRelativeOffset(size_t globalOffset) {
-        if (chunkSize <= 0)
-            return globalOffset;
+    void Pak::prefetch(const std::string &path) const {
+        HeaderEntry hEntry;
+        if (!findEntry(path, hEntry))
+            return;
 
-        if (globalOffset < chunkSize) {
-            return globalOffset;
-        } else {
-            auto rChunk = globalOffset % chunkSize; // The relative offset ( Remainder )
-            return rChunk;
+        auto globalOffset = hEntry.offset;
+        auto length = hEntry.size;
+        while (length > 0) {
+            auto &chunk = getChunkForOffset(globalOffset);
+            auto relativeOffset = getRelativeOffset(globalOffset);
+
+            auto count = length;
+            if (chunkSize > 0)
+                count = std::min(length, static_cast<size_t>(chunkSize) - relativeOffset);
+
+            chunk.prefetch(relativeOffset, count);
+
+            globalOffset += count;
+            length -= count;
         }
     }
 
-    std::istream &Pak::getStreamForOffset(size_t globalOffset) {
+    bool Pak::exists(const std::string &path) const {
+        HeaderEntry entry;
+        return findEntry(path, entry);
+    }
+
+    std::string Pak::getHash(const std::string &path) const {
+        HeaderEntry entry;
+        if (!findEntry(path, entry))
+            return {};
+        return entry.hash;
+    }
+
+    std::string Pak::computeHash(const std::vector<char> &data, bool parallel) const {
+        return hashData(data.data(), data.size(), hashType, treeHash, parallel);
+    }
+
+    std::vector<std::string> Pak::getPaths() const {
+        auto *paths = index.data() + entryCount * recordSize;
+        std::vector<std::string> ret;
+        ret.reserve(entryCount);
+        for (size_t i = 0; i < entryCount; i++) {
+            auto *record = index.data() + i * recordSize;
+            ret.emplace_back(paths + readUInt32(record + 24), readUInt32(record + 28));
+        }
+        return ret;
+    }
+
+    bool Pak::findEntry(const std::string &path, HeaderEntry &entry) const {
+        auto hash = hashPath(path);
+        auto *records = index.data();
+        auto *paths = index.data() + entryCount * recordSize;
+
+        // Binary search for the first record with the path hash
+        size_t low = 0;
+        size_t high = entryCount;
+        while (low < high) {
+            auto mid = low + (high - low) / 2;
+            if (readUInt64(records + mid * recordSize) < hash)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+
+        for (auto i = low; i < entryCount; i++) {
+            auto *record = records + i * recordSize;
+            if (readUInt64(record) != hash)
+                break;
+            auto pathOffset = readUInt32(record + 24);
+            auto pathLength = readUInt32(record + 28);
+            if (pathLength == path.size()
+                && path.compare(0, pathLength, paths + pathOffset, pathLength) == 0) {
+                entry.offset = dataOffset + readUInt64(record + 8);
+                entry.size = readUInt64(record + 16);
+                entry.hash = std::string(record + 32, SHA256_SIZE);
+                if (recordSize >= PAK_RECORD_SIZE) {
+                    entry.decompressedSize = readUInt64(record + 64);
+                    auto codecAndFlags = readUInt32(record + 72);
+                    entry.codec = static_cast<Codec>(codecAndFlags & 0xffff);
+                    entry.verify = (codecAndFlags >> 16) & PAK_ENTRY_FLAG_VERIFY;
+                    entry.blockSize = readUInt32(record + 76);
+                } else {
+                    entry.decompressedSize = 0;
+                    entry.codec = compressed ? GZIP : STORE;
+                    entry.blockSize = 0;
+                    entry.verify = false;
+                }
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Pak::readData(size_t globalOffset, char *buffer, size_t length) const {
+        while (length > 0) {
+            auto &chunk = getChunkForOffset(globalOffset);
+            auto relativeOffset = getRelativeOffset(globalOffset);
+
+            auto count = length;
+            if (chunkSize > 0)
+                count = std::min(length, static_cast<size_t>(chunkSize) - relativeOffset);
+
+            if (chunk.read(relativeOffset, buffer, count) != count)
+                throw std::runtime_error("Failed to read pak data");
+
+            buffer += count;
+            globalOffset += count;
+            length -= count;
+        }
+    }
+
+    void Pak::readDecrypted(size_t globalOffset, char *buffer, size_t length) const {
+        readData(globalOffset, buffer, length);
+        if (ctr)
+            AES::ctr(key, counter, globalOffset, buffer, length);
+    }
+
+    size_t Pak::getRelativeOffset(size_t globalOffset) const {
+        if (chunkSize <= 0)
+            return globalOffset;
+        return globalOffset % chunkSize;
+    }
+
+    PakChunk &Pak::getChunkForOffset(size_t globalOffset) const {
         if (chunkSize <= 0)
-            return *streams.at(0);
+            return *chunks.at(0);
         auto nChunk = globalOffset / chunkSize;
-        return *streams.at(nChunk);
+        return *chunks.at(nChunk);
     }
-}
\ No newline at end of file
+}
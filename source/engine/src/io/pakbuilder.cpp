@@ -0,0 +1,486 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "io/pakbuilder.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <atomic>
+#include <set>
+
+#include "io/readfile.hpp"
+#include "async/threadpool.hpp"
+#include "compression/zstd.hpp"
+
+#include "pakformat.hpp"
+
+namespace engine {
+    using namespace PakFormat;
+
+    // Upper bound for the summed size of the dictionary training samples, zstd recommends about 100 times the capacity
+    static const size_t PAK_DICTIONARY_SAMPLE_BUDGET = 100 * PAK_DICTIONARY_CAPACITY;
+
+    /**
+     * Writes at global pak offsets into the chunk streams.
+     */
+    class ChunkWriter {
+    public:
+        ChunkWriter(const PakBuilder::ChunkOpener &openChunk, long chunkSize)
+                : openChunk(openChunk), chunkSize(chunkSize) {}
+
+        void write(size_t globalOffset, const char *data, size_t length) {
+            while (length > 0) {
+                size_t chunkIndex = 0;
+                auto relativeOffset = globalOffset;
+                auto count = length;
+                if (chunkSize > 0) {
+                    chunkIndex = globalOffset / chunkSize;
+                    relativeOffset = globalOffset % chunkSize;
+                    count = std::min(length, static_cast<size_t>(chunkSize) - relativeOffset);
+                }
+
+                auto &stream = getStream(chunkIndex);
+                stream.seekp(static_cast<std::streamoff>(relativeOffset));
+                stream.write(data, static_cast<std::streamsize>(count));
+                if (!stream)
+                    throw std::runtime_error("Failed to write pak chunk " + std::to_string(chunkIndex));
+
+                data += count;
+                globalOffset += count;
+                length -= count;
+            }
+        }
+
+        void flush() {
+            for (auto &stream: streams) {
+                stream->flush();
+                if (!*stream)
+                    throw std::runtime_error("Failed to write pak chunk");
+            }
+        }
+
+        size_t getChunkCount() const {
+            return streams.size();
+        }
+
+    private:
+        std::ostream &getStream(size_t chunkIndex) {
+            while (streams.size() <= chunkIndex) {
+                auto stream = openChunk(streams.size());
+                if (stream == nullptr)
+                    throw std::runtime_error("Failed to open pak chunk " + std::to_string(streams.size()));
+                streams.emplace_back(std::move(stream));
+            }
+            return *streams.at(chunkIndex);
+        }
+
+        const PakBuilder::ChunkOpener &openChunk;
+        long chunkSize;
+        std::vector<std::unique_ptr<std::ostream>> streams;
+    };
+
+    struct ProcessedEntry {
+        std::vector<char> data;
+        Pak::Codec codec = Pak::STORE;
+        size_t blockSize = 0;
+        size_t decompressedSize = 0;
+        std::string hash;
+    };
+
+    static ProcessedEntry processEntry(const std::vector<char> &data,
+                                       bool compress,
+                                       const ZStd::Dictionary *dictionary,
+                                       Pak::HashType hashType) {
+        ProcessedEntry ret;
+        // The entries are already processed in parallel
+        ret.hash = hashData(data.data(), data.size(), hashType, true, false);
+        ret.decompressedSize = data.size();
+
+        // Stored entries can be read partially without blocks
+        if (compress && data.size() >= PAK_BLOCK_MIN_ENTRY_SIZE) {
+            if (compressBlocks(data, PAK_BLOCK_SIZE, ret.data)) {
+                ret.codec = Pak::LZ4;
+                ret.blockSize = PAK_BLOCK_SIZE;
+            } else {
+                ret.data = data;
+            }
+        } else if (compress) {
+            ret.codec = compressEntry(data, dictionary, ret.data);
+        } else {
+            ret.data = data;
+        }
+
+        return ret;
+    }
+
+    PakBuilder::PakBuilder(long chunkSize, bool compressData)
+            : chunkSize(chunkSize), compressData(compressData), encrypt(false) {}
+
+    PakBuilder::PakBuilder(long chunkSize, bool compressData, AES::Key key, AES::InitializationVector iv)
+            : chunkSize(chunkSize), compressData(compressData), encrypt(true), key(std::move(key)), iv(iv) {}
+
+    void PakBuilder::addEntry(const std::string &path, size_t size, EntryLoader loader) {
+        entries[path] = {size, std::move(loader), false};
+    }
+
+    void PakBuilder::addEntry(const std::string &path, std::vector<char> data) {
+        auto size = data.size();
+        auto shared = std::make_shared<std::vector<char>>(std::move(data));
+        addEntry(path, size, [shared]() { return *shared; });
+    }
+
+    void PakBuilder::addFile(const std::string &path, const std::string &filePath) {
+        addEntry(path, std::filesystem::file_size(filePath), [filePath]() { return readFile(filePath); });
+    }
+
+    void PakBuilder::addDirectory(const std::string &directory, bool recursive) {
+        auto add = [this, &directory](const std::filesystem::directory_entry &file) {
+            if (file.is_regular_file()) {
+                auto path = "/" + std::filesystem::relative(file.path(), directory).generic_string();
+                addFile(path, file.path().string());
+            }
+        };
+        if (recursive) {
+            for (auto &file: std::filesystem::recursive_directory_iterator(directory))
+                add(file);
+        } else {
+            for (auto &file: std::filesystem::directory_iterator(directory))
+                add(file);
+        }
+    }
+
+    size_t PakBuilder::removeUnchanged(const Pak &base) {
+        std::vector<std::map<std::string, Entry>::iterator> candidates;
+        std::vector<std::string> baseHashes;
+        for (auto it = entries.begin(); it != entries.end(); it++) {
+            auto hash = base.getHash(it->first);
+            if (!hash.empty()) {
+                candidates.emplace_back(it);
+                baseHashes.emplace_back(std::move(hash));
+            }
+        }
+
+        std::vector<char> unchanged(candidates.size(), 0);
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+        std::exception_ptr error;
+
+        auto work = [&]() {
+            try {
+                for (auto i = next++; i < candidates.size(); i = next++) {
+                    auto &entry = candidates.at(i)->second;
+                    if (entry.size != base.getSize(candidates.at(i)->first))
+                        continue;
+                    unchanged.at(i) = base.computeHash(entry.loader(), false) == baseHashes.at(i);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (error == nullptr)
+                    error = std::current_exception();
+                next = candidates.size();
+            }
+        };
+
+        auto &pool = ThreadPool::getPool();
+        std::vector<std::shared_ptr<Task>> tasks;
+        for (unsigned int i = 0; i < std::min<size_t>(threadCount, candidates.size()); i++)
+            tasks.emplace_back(pool.addTask(work));
+        for (auto &task: tasks)
+            task->wait();
+
+        if (error != nullptr)
+            std::rethrow_exception(error);
+
+        size_t ret = 0;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (unchanged.at(i)) {
+                entries.erase(candidates.at(i));
+                ret++;
+            }
+        }
+        return ret;
+    }
+
+    void PakBuilder::setVerify(const std::string &path, bool verify) {
+        auto it = entries.find(path);
+        if (it == entries.end())
+            throw std::runtime_error("Pak builder entry not found: " + path);
+        it->second.verify = verify;
+    }
+
+    void PakBuilder::setHashType(Pak::HashType type) {
+        hashType = type;
+    }
+
+    void PakBuilder::setOrder(std::vector<std::string> paths) {
+        order = std::move(paths);
+    }
+
+    void PakBuilder::setThreadCount(unsigned int threads) {
+        threadCount = std::max(1u, threads);
+    }
+
+    void PakBuilder::setBufferLimit(size_t bytes) {
+        bufferLimit = bytes;
+    }
+
+    void PakBuilder::setProgressCallback(ProgressCallback callback) {
+        progressCallback = std::move(callback);
+    }
+
+    std::vector<std::string> PakBuilder::getOrderedPaths() const {
+        std::vector<std::string> ret;
+        ret.reserve(entries.size());
+
+        std::set<std::string> ordered;
+        for (auto &path: order) {
+            if (entries.find(path) != entries.end() && ordered.insert(path).second)
+                ret.emplace_back(path);
+        }
+
+        for (auto &pair: entries) {
+            if (ordered.find(pair.first) == ordered.end())
+                ret.emplace_back(pair.first);
+        }
+
+        return ret;
+    }
+
+    size_t PakBuilder::build(const ChunkOpener &openChunk) const {
+        if (chunkSize > 0 && chunkSize < static_cast<long>(PAK_HEADER_SIZE))
+            throw std::runtime_error("Pak chunk size must be at least the header size");
+
+        auto paths = getOrderedPaths();
+
+        // A new nonce per build so that paks encrypted with the same key never reuse the key stream
+        auto nonce = generateNonce();
+        auto counter = getCounterBlock(nonce);
+
+        std::vector<const Entry *> sources;
+        sources.reserve(paths.size());
+        size_t pathTableSize = 0;
+        size_t totalBytes = 0;
+        for (auto &path: paths) {
+            sources.emplace_back(&entries.at(path));
+            pathTableSize += path.size();
+            totalBytes += sources.back()->size;
+        }
+
+        // Train the dictionary on a bounded set of the small entries
+        std::unique_ptr<ZStd::Dictionary> dictionary;
+        if (compressData) {
+            std::vector<std::vector<char>> samples;
+            size_t sampleBytes = 0;
+            for (auto *source: sources) {
+                if (source->size < PAK_MIN_COMPRESS_SIZE || source->size > PAK_SMALL_ENTRY_SIZE)
+                    continue;
+                if (sampleBytes + source->size > PAK_DICTIONARY_SAMPLE_BUDGET)
+                    break;
+                samples.emplace_back(source->loader());
+                sampleBytes += samples.back().size();
+            }
+            if (samples.size() >= PAK_DICTIONARY_MIN_SAMPLES) {
+                auto dictionaryData = ZStd::trainDictionary(samples, PAK_DICTIONARY_CAPACITY);
+                if (!dictionaryData.empty()) {
+                    dictionary = std::make_unique<ZStd::Dictionary>(dictionaryData);
+                }
+            }
+        }
+
+        // The index size only depends on the paths, so the data can be written before the index is known
+        auto indexSize = getIndexSize(paths.size(), pathTableSize);
+        auto dataOffset = PAK_HEADER_SIZE + indexSize;
+
+        ChunkWriter writer(openChunk, chunkSize);
+
+        // Reserve the header and index, streams cannot seek past their end
+        std::vector<char> zeros(std::min(dataOffset, static_cast<size_t>(1024 * 1024)), 0);
+        for (size_t offset = 0; offset < dataOffset; offset += zeros.size()) {
+            writer.write(offset, zeros.data(), std::min(zeros.size(), dataOffset - offset));
+        }
+
+        // The data is written while the workers process the following entries
+        auto writeData = [&](size_t globalOffset, std::vector<char> &data) {
+            if (encrypt)
+                AES::ctr(key, counter, globalOffset, data.data(), data.size(), false);
+            writer.write(globalOffset, data.data(), data.size());
+        };
+
+        size_t currentOffset = 0;
+        size_t dictionarySize = 0;
+        if (dictionary != nullptr) {
+            auto d = dictionary->getData();
+            dictionarySize = d.size();
+            writeData(dataOffset + currentOffset, d);
+            currentOffset += d.size();
+        }
+
+        // Workers claim entries in order and the results are written in the same order,
+        // a worker only claims a new entry while the buffered input bytes are below the limit.
+        std::mutex mutex;
+        std::condition_variable condition;
+        size_t nextClaim = 0;
+        size_t nextWrite = 0;
+        size_t bufferedBytes = 0;
+        std::map<size_t, ProcessedEntry> processed;
+        std::exception_ptr error;
+
+        auto work = [&]() {
+            while (true) {
+                size_t index;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [&]() {
+                        return error != nullptr
+                               || nextClaim >= sources.size()
+                               || nextClaim == nextWrite
+                               || bufferedBytes + sources.at(nextClaim)->size <= bufferLimit;
+                    });
+                    if (error != nullptr || nextClaim >= sources.size())
+                        return;
+                    index = nextClaim++;
+                    bufferedBytes += sources.at(index)->size;
+                }
+
+                try {
+                    auto result = processEntry(sources.at(index)->loader(), compressData, dictionary.get(), hashType);
+                    if (result.decompressedSize != sources.at(index)->size)
+                        throw std::runtime_error("Pak entry size changed during build: " + paths.at(index));
+                    std::lock_guard<std::mutex> lock(mutex);
+                    processed[index] = std::move(result);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (error == nullptr)
+                        error = std::current_exception();
+                }
+                condition.notify_all();
+            }
+        };
+
+        auto &pool = ThreadPool::getPool();
+        std::vector<std::shared_ptr<Task>> tasks;
+        for (unsigned int i = 0; i < std::min<size_t>(threadCount, sources.size()); i++)
+            tasks.emplace_back(pool.addTask(work));
+
+        std::map<std::string, Pak::HeaderEntry> headerEntries;
+        Progress progress{0, paths.size(), 0, totalBytes};
+        try {
+            while (nextWrite < sources.size()) {
+                ProcessedEntry entry;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [&]() {
+                        return error != nullptr || processed.find(nextWrite) != processed.end();
+                    });
+                    if (error != nullptr)
+                        break;
+                    auto it = processed.find(nextWrite);
+                    entry = std::move(it->second);
+                    processed.erase(it);
+                }
+
+                writeData(dataOffset + currentOffset, entry.data);
+
+                auto &hEntry = headerEntries[paths.at(nextWrite)];
+                hEntry.offset = currentOffset;
+                hEntry.size = entry.data.size();
+                hEntry.hash = entry.hash;
+                hEntry.codec = entry.codec;
+                hEntry.decompressedSize = entry.decompressedSize;
+                hEntry.blockSize = entry.blockSize;
+                hEntry.verify = sources.at(nextWrite)->verify;
+
+                currentOffset += entry.data.size();
+
+                progress.entries++;
+                progress.bytes += entry.decompressedSize;
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    bufferedBytes -= sources.at(nextWrite)->size;
+                    nextWrite++;
+                }
+                condition.notify_all();
+
+                if (progressCallback)
+                    progressCallback(progress);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (error == nullptr)
+                error = std::current_exception();
+        }
+
+        condition.notify_all();
+        for (auto &task: tasks)
+            task->wait();
+
+        if (error != nullptr)
+            std::rethrow_exception(error);
+
+        auto indexStr = buildIndex(headerEntries);
+        if (indexStr.size() != indexSize)
+            throw std::runtime_error("Invalid pak index size");
+
+        uint32_t flags = PAK_FLAG_TREE_HASH;
+        if (encrypt)
+            flags |= PAK_FLAG_ENCRYPTED | PAK_FLAG_CTR;
+        if (hashType == Pak::XXH3)
+            flags |= PAK_FLAG_HASH_XXH3;
+
+        auto hdr = PAK_HEADER_MAGIC;
+        writeUInt32(hdr, flags);
+        writeUInt32(hdr, PAK_RECORD_SIZE);
+        writeUInt64(hdr, chunkSize > 0 ? chunkSize : 0);
+        writeUInt64(hdr, headerEntries.size());
+        writeUInt64(hdr, indexStr.size());
+        writeUInt64(hdr, dataOffset);
+        writeUInt64(hdr, 0);
+        writeUInt64(hdr, dictionarySize);
+        writeUInt64(hdr, encrypt ? nonce : 0);
+
+        hdr += indexStr;
+
+        if (encrypt) {
+            // Everything following the header is encrypted with the key stream at its global offset
+            AES::ctr(key, counter, PAK_HEADER_SIZE, &hdr[PAK_HEADER_SIZE], indexStr.size());
+        }
+
+        writer.write(0, hdr.data(), hdr.size());
+        writer.flush();
+
+        return writer.getChunkCount();
+    }
+
+    std::vector<std::string> PakBuilder::build(const std::string &prefix) const {
+        std::vector<std::string> ret;
+        build([&prefix, &ret](size_t chunkIndex) -> std::unique_ptr<std::ostream> {
+            auto path = prefix + "." + std::to_string(chunkIndex) + ".pak";
+            auto stream = std::make_unique<std::ofstream>(path, std::ios::binary | std::ios::trunc);
+            if (!*stream)
+                throw std::runtime_error("Failed to open pak chunk file " + path);
+            ret.emplace_back(path);
+            return stream;
+        });
+        return ret;
+    }
+}
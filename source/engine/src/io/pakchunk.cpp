@@ -0,0 +1,155 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "io/pakchunk.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace engine {
+    StreamPakChunk::StreamPakChunk(std::unique_ptr<std::istream> stream)
+            : stream(std::move(stream)) {}
+
+    size_t StreamPakChunk::read(size_t offset, char *buffer, size_t length) {
+        std::lock_guard<std::mutex> guard(mutex);
+        stream->clear();
+        stream->seekg(static_cast<std::streamoff>(offset));
+        stream->read(buffer, static_cast<std::streamsize>(length));
+        return static_cast<size_t>(stream->gcount());
+    }
+
+    size_t StreamPakChunk::getSize() {
+        std::lock_guard<std::mutex> guard(mutex);
+        stream->clear();
+        stream->seekg(0, std::ios::end);
+        auto ret = stream->tellg();
+        if (ret < 0)
+            throw std::runtime_error("Failed to determine pak chunk size");
+        return static_cast<size_t>(ret);
+    }
+
+#ifdef _WIN32
+    FilePakChunk::FilePakChunk(const std::string &path) {
+        handle = CreateFileA(path.c_str(),
+                             GENERIC_READ,
+                             FILE_SHARE_READ,
+                             nullptr,
+                             OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL,
+                             nullptr);
+        if (handle == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Failed to open pak chunk " + path);
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(handle, &fileSize)) {
+            CloseHandle(handle);
+            throw std::runtime_error("Failed to determine pak chunk size " + path);
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+    }
+
+    FilePakChunk::~FilePakChunk() {
+        CloseHandle(handle);
+    }
+
+    size_t FilePakChunk::read(size_t offset, char *buffer, size_t length) {
+        size_t ret = 0;
+        while (ret < length) {
+            OVERLAPPED overlapped{};
+            auto position = static_cast<uint64_t>(offset + ret);
+            overlapped.Offset = static_cast<DWORD>(position & 0xffffffff);
+            overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+            auto count = static_cast<DWORD>(std::min<size_t>(length - ret, std::numeric_limits<DWORD>::max()));
+            DWORD bytesRead = 0;
+            if (!ReadFile(handle, buffer + ret, count, &bytesRead, &overlapped)) {
+                if (GetLastError() == ERROR_HANDLE_EOF)
+                    break;
+                throw std::runtime_error("Failed to read pak chunk");
+            }
+            if (bytesRead == 0)
+                break;
+            ret += bytesRead;
+        }
+        return ret;
+    }
+
+    void FilePakChunk::prefetch(size_t offset, size_t length) {
+        // There is no non blocking read ahead hint for regular file handles
+    }
+#else
+    FilePakChunk::FilePakChunk(const std::string &path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Failed to open pak chunk " + path);
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to determine pak chunk size " + path);
+        }
+        size = static_cast<size_t>(st.st_size);
+    }
+
+    FilePakChunk::~FilePakChunk() {
+        ::close(fd);
+    }
+
+    size_t FilePakChunk::read(size_t offset, char *buffer, size_t length) {
+        size_t ret = 0;
+        while (ret < length) {
+            auto count = std::min<size_t>(length - ret, std::numeric_limits<ssize_t>::max());
+            auto bytesRead = ::pread(fd, buffer + ret, count, static_cast<off_t>(offset + ret));
+            if (bytesRead < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Failed to read pak chunk");
+            }
+            if (bytesRead == 0)
+                break;
+            ret += static_cast<size_t>(bytesRead);
+        }
+        return ret;
+    }
+
+    void FilePakChunk::prefetch(size_t offset, size_t length) {
+        // Failures are ignored because the hint is optional
+#if defined(POSIX_FADV_WILLNEED)
+        posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+#elif defined(F_RDADVISE)
+        radvisory advisory{};
+        advisory.ra_offset = static_cast<off_t>(offset);
+        advisory.ra_count = static_cast<int>(std::min<size_t>(length, std::numeric_limits<int>::max()));
+        fcntl(fd, F_RDADVISE, &advisory);
+#endif
+    }
+#endif
+
+    size_t FilePakChunk::getSize() {
+        return size;
+    }
+}
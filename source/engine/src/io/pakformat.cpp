@@ -0,0 +1,277 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pakformat.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+#include "async/threadpool.hpp"
+#include "compression/lz4.hpp"
+#include "crypto/sha.hpp"
+#include "crypto/xxhash.hpp"
+
+namespace engine {
+    namespace PakFormat {
+        uint64_t hashPath(const std::string &path) {
+            // FNV-1a
+            uint64_t hash = 14695981039346656037ULL;
+            for (auto c: path) {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        void writeUInt32(std::string &dst, uint32_t value) {
+            for (int i = 0; i < 4; i++)
+                dst += static_cast<char>((value >> (i * 8)) & 0xff);
+        }
+
+        void writeUInt64(std::string &dst, uint64_t value) {
+            for (int i = 0; i < 8; i++)
+                dst += static_cast<char>((value >> (i * 8)) & 0xff);
+        }
+
+        uint32_t readUInt32(const char *src) {
+            uint32_t ret = 0;
+            for (int i = 0; i < 4; i++)
+                ret |= static_cast<uint32_t>(static_cast<unsigned char>(src[i])) << (i * 8);
+            return ret;
+        }
+
+        uint64_t readUInt64(const char *src) {
+            uint64_t ret = 0;
+            for (int i = 0; i < 8; i++)
+                ret |= static_cast<uint64_t>(static_cast<unsigned char>(src[i])) << (i * 8);
+            return ret;
+        }
+
+        std::string hexToBinary(const std::string &hex) {
+            std::string ret(hex.size() / 2, 0);
+            for (size_t i = 0; i < ret.size(); i++) {
+                ret[i] = static_cast<char>(std::stoi(hex.substr(i * 2, 2), nullptr, 16));
+            }
+            return ret;
+        }
+
+        uint64_t generateNonce() {
+            std::random_device device;
+            return (static_cast<uint64_t>(device()) << 32) | static_cast<uint32_t>(device());
+        }
+
+        AES::InitializationVector getCounterBlock(uint64_t nonce) {
+            AES::InitializationVector ret{};
+            for (int i = 0; i < 8; i++)
+                ret[i] = static_cast<char>((nonce >> ((7 - i) * 8)) & 0xff);
+            return ret;
+        }
+
+        std::string buildIndex(const std::map<std::string, Pak::HeaderEntry> &entries) {
+            std::vector<std::pair<uint64_t, const std::string *>> order;
+            order.reserve(entries.size());
+            for (auto &pair: entries) {
+                order.emplace_back(hashPath(pair.first), &pair.first);
+            }
+            std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) {
+                if (a.first != b.first)
+                    return a.first < b.first;
+                return *a.second < *b.second;
+            });
+
+            std::string records;
+            std::string paths;
+            records.reserve(order.size() * PAK_RECORD_SIZE);
+            for (auto &pair: order) {
+                auto &path = *pair.second;
+                auto &entry = entries.at(path);
+
+                if (paths.size() > std::numeric_limits<uint32_t>::max()
+                    || path.size() > std::numeric_limits<uint32_t>::max())
+                    throw std::runtime_error("Pak path table too large");
+
+                if (entry.hash.size() != SHA256_SIZE)
+                    throw std::runtime_error("Invalid pak entry hash");
+
+                uint32_t entryFlags = 0;
+                if (entry.verify)
+                    entryFlags |= PAK_ENTRY_FLAG_VERIFY;
+
+                writeUInt64(records, pair.first);
+                writeUInt64(records, entry.offset);
+                writeUInt64(records, entry.size);
+                writeUInt32(records, static_cast<uint32_t>(paths.size()));
+                writeUInt32(records, static_cast<uint32_t>(path.size()));
+                records += entry.hash;
+                writeUInt64(records, entry.decompressedSize);
+                writeUInt32(records, static_cast<uint32_t>(entry.codec) | entryFlags << 16);
+                writeUInt32(records, static_cast<uint32_t>(entry.blockSize));
+
+                paths += path;
+            }
+
+            return records + paths;
+        }
+
+        Pak::Codec compressEntry(const std::vector<char> &data,
+                                        const ZStd::Dictionary *dictionary,
+                                        std::vector<char> &output) {
+            if (data.size() < PAK_MIN_COMPRESS_SIZE) {
+                output = data;
+                return Pak::STORE;
+            }
+
+            auto codec = Pak::LZ4;
+            output = LZ4::compress(data);
+
+            if (data.size() <= PAK_SMALL_ENTRY_SIZE) {
+                auto zstd = dictionary == nullptr
+                            ? ZStd::compress(data)
+                            : dictionary->compress(data.data(), data.size());
+                if (static_cast<float>(zstd.size()) <= static_cast<float>(output.size()) * PAK_ZSTD_MAX_RATIO) {
+                    codec = Pak::ZSTD;
+                    output = std::move(zstd);
+                }
+            }
+
+            if (static_cast<float>(output.size()) > static_cast<float>(data.size()) * PAK_STORE_MIN_RATIO) {
+                output = data;
+                return Pak::STORE;
+            }
+
+            return codec;
+        }
+
+        bool compressBlocks(const std::vector<char> &data, size_t blockSize, std::vector<char> &output) {
+            std::vector<std::vector<char>> blocks;
+            size_t compressedSize = 0;
+            for (size_t offset = 0; offset < data.size(); offset += blockSize) {
+                auto length = std::min(blockSize, data.size() - offset);
+                blocks.emplace_back(LZ4::compress(data.data() + offset, length));
+                compressedSize += blocks.back().size();
+            }
+
+            if (static_cast<float>(compressedSize) > static_cast<float>(data.size()) * PAK_STORE_MIN_RATIO)
+                return false;
+
+            std::string table;
+            size_t blockEnd = 0;
+            for (auto &block: blocks) {
+                blockEnd += block.size();
+                writeUInt64(table, blockEnd);
+            }
+
+            std::string tableSize;
+            writeUInt64(tableSize, table.size());
+
+            output.clear();
+            output.reserve(tableSize.size() + table.size() + blockEnd);
+            output.insert(output.end(), tableSize.begin(), tableSize.end());
+            output.insert(output.end(), table.begin(), table.end());
+            for (auto &block: blocks)
+                output.insert(output.end(), block.begin(), block.end());
+
+            return true;
+        }
+
+        // The tree hash inputs are prefixed with distinct tags so that a leaf can never be taken for the root
+        static const char HASH_TAG_LEAF = 0;
+        static const char HASH_TAG_ROOT = 1;
+
+        static std::string hashLeaf(const char *data, size_t length, Pak::HashType type) {
+            switch (type) {
+                case Pak::SHA256: {
+                    auto digest = SHA::sha256Digest(data, length);
+                    return {digest.begin(), digest.end()};
+                }
+                case Pak::XXH3: {
+                    auto digest = XXHash::xxh3(data, length);
+                    return {digest.begin(), digest.end()};
+                }
+                default:
+                    throw std::runtime_error("Invalid pak hash type");
+            }
+        }
+
+        static std::string hashNode(char tag, const char *data, size_t length, Pak::HashType type) {
+            switch (type) {
+                case Pak::SHA256: {
+                    auto digest = SHA::sha256Digest(tag, data, length);
+                    return {digest.begin(), digest.end()};
+                }
+                case Pak::XXH3: {
+                    auto digest = XXHash::xxh3(tag, data, length);
+                    return {digest.begin(), digest.end()};
+                }
+                default:
+                    throw std::runtime_error("Invalid pak hash type");
+            }
+        }
+
+        std::string hashData(const char *data, size_t length, Pak::HashType type, bool tree, bool parallel) {
+            std::string ret;
+            if (!tree) {
+                ret = hashLeaf(data, length, type);
+            } else if (length <= PAK_HASH_LEAF_SIZE) {
+                ret = hashNode(HASH_TAG_LEAF, data, length, type);
+            } else {
+                auto leafCount = (length + PAK_HASH_LEAF_SIZE - 1) / PAK_HASH_LEAF_SIZE;
+                std::vector<std::string> leaves(leafCount);
+                auto hashLeaves = [&](size_t begin, size_t step) {
+                    for (auto i = begin; i < leafCount; i += step) {
+                        auto offset = i * PAK_HASH_LEAF_SIZE;
+                        leaves.at(i) = hashNode(HASH_TAG_LEAF,
+                                                data + offset,
+                                                std::min(PAK_HASH_LEAF_SIZE, length - offset),
+                                                type);
+                    }
+                };
+
+                size_t taskCount = 1;
+                if (parallel)
+                    taskCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), leafCount);
+
+                std::vector<std::shared_ptr<Task>> tasks;
+                for (size_t i = 1; i < taskCount; i++) {
+                    tasks.emplace_back(ThreadPool::getPool().addTask([&hashLeaves, i, taskCount]() {
+                        hashLeaves(i, taskCount);
+                    }));
+                }
+                hashLeaves(0, taskCount);
+                for (auto &task: tasks)
+                    task->wait();
+
+                // The root hashes the leaf digests followed by the total length
+                std::string concatenated;
+                for (auto &leaf: leaves)
+                    concatenated += leaf;
+                writeUInt64(concatenated, length);
+                ret = hashNode(HASH_TAG_ROOT, concatenated.data(), concatenated.size(), type);
+            }
+            ret.resize(SHA256_SIZE, 0);
+            return ret;
+        }
+
+        size_t getIndexSize(size_t entryCount, size_t pathTableSize) {
+            return entryCount * PAK_RECORD_SIZE + pathTableSize;
+        }
+    }
+}
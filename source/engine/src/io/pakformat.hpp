@@ -0,0 +1,133 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_PAKFORMAT_HPP
+#define MANA_PAKFORMAT_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include "io/pak.hpp"
+
+namespace engine {
+    /**
+     * Encoding helpers shared by the pak reader and builder.
+     */
+    namespace PakFormat {
+        static const size_t SHA256_SIZE = 32;
+
+        // Entries smaller than this are stored uncompressed
+        static const size_t PAK_MIN_COMPRESS_SIZE = 64;
+
+        // Entries up to this size are used to train the zstd dictionary and are compressed with zstd if it is worth it
+        static const size_t PAK_SMALL_ENTRY_SIZE = 128 * 1024;
+
+        static const size_t PAK_DICTIONARY_CAPACITY = 112 * 1024;
+
+        // Training is skipped for fewer samples because the dictionary would not pay for itself
+        static const size_t PAK_DICTIONARY_MIN_SAMPLES = 32;
+
+        // Zstd is only selected when it produces at most this fraction of the lz4 size, lz4 decompresses several times faster
+        static const float PAK_ZSTD_MAX_RATIO = 0.8f;
+
+        // Compressed data larger than this fraction of the input is stored uncompressed
+        static const float PAK_STORE_MIN_RATIO = 0.95f;
+
+        // Entries of at least this size are stored as independently decodable blocks to allow partial reads
+        static const size_t PAK_BLOCK_MIN_ENTRY_SIZE = 1024 * 1024;
+
+        // Larger than the lz4 window so splitting costs practically no ratio
+        static const size_t PAK_BLOCK_SIZE = 256 * 1024;
+
+        // Entries larger than this are tree hashed if PAK_FLAG_TREE_HASH is set
+        static const size_t PAK_HASH_LEAF_SIZE = 1024 * 1024;
+
+        uint64_t hashPath(const std::string &path);
+
+        void writeUInt32(std::string &dst, uint32_t value);
+
+        void writeUInt64(std::string &dst, uint64_t value);
+
+        uint32_t readUInt32(const char *src);
+
+        uint64_t readUInt64(const char *src);
+
+        std::string hexToBinary(const std::string &hex);
+
+        /**
+         * @return A random nonce for the aes ctr counter blocks of a pak.
+         */
+        uint64_t generateNonce();
+
+        /**
+         * Get the initial aes ctr counter block of a pak, the nonce is stored in the upper half
+         * and the key stream offset advances the block index in the lower half.
+         *
+         * @param nonce
+         * @return
+         */
+        AES::InitializationVector getCounterBlock(uint64_t nonce);
+
+        /**
+         * Hash the data with the hash of the pak.
+         *
+         * @param data
+         * @param length
+         * @param type
+         * @param tree If true the data is hashed as a tree with tagged leaf and root inputs,
+         *              data larger than the leaf size is hashed as the hash of the concatenated leaf hashes and the length
+         * @param parallel If true the leaves are hashed on the engine thread pool
+         * @return The binary digest zero padded to the record hash size
+         */
+        std::string hashData(const char *data, size_t length, Pak::HashType type, bool tree, bool parallel);
+
+        /**
+         * Build the sorted index records and path table for the entries.
+         *
+         * @param entries The entries with offsets relative to the data offset
+         * @return
+         */
+        std::string buildIndex(const std::map<std::string, Pak::HeaderEntry> &entries);
+
+        /**
+         * @param entryCount
+         * @param pathTableSize The summed length of all entry paths
+         * @return The number of bytes of the unencrypted index
+         */
+        size_t getIndexSize(size_t entryCount, size_t pathTableSize);
+
+        /**
+         * Compress the entry with the codec that gives the best tradeoff between ratio and decompression speed.
+         */
+        Pak::Codec compressEntry(const std::vector<char> &data,
+                                 const ZStd::Dictionary *dictionary,
+                                 std::vector<char> &output);
+
+        /**
+         * Compress each block of the entry independently with lz4 and prepend the block table.
+         *
+         * @return False if the blocks do not compress well, in which case the entry should be stored
+         */
+        bool compressBlocks(const std::vector<char> &data, size_t blockSize, std::vector<char> &output);
+    }
+}
+
+#endif //MANA_PAKFORMAT_HPP
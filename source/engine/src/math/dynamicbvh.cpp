@@ -0,0 +1,508 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "math/dynamicbvh.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace engine {
+    // The tree is rebuilt when the reinsertions have increased its cost by this factor
+    static const float REBUILD_THRESHOLD = 1.5f;
+
+    // The minimum number of changes between two checks of the tree cost
+    static const size_t REBUILD_CHECK_INTERVAL = 64;
+
+    DynamicBVH::DynamicBVH(float margin) : margin(margin) {}
+
+    int DynamicBVH::insert(const AABB &bounds, size_t userData) {
+        if (bounds.empty())
+            throw std::runtime_error("Cannot insert empty bounds");
+
+        auto leaf = allocateNode();
+        nodes[leaf].bounds = {bounds.min - Vec3f(margin), bounds.max + Vec3f(margin)};
+        nodes[leaf].userData = userData;
+        insertLeaf(leaf);
+        leafCount++;
+
+        checkRebuild();
+
+        return leaf;
+    }
+
+    void DynamicBVH::remove(int proxy) {
+        removeLeaf(proxy);
+        freeNode(proxy);
+        leafCount--;
+    }
+
+    bool DynamicBVH::update(int proxy, const AABB &bounds) {
+        if (bounds.empty())
+            throw std::runtime_error("Cannot update to empty bounds");
+
+        auto &node = nodes.at(proxy);
+        if (node.bounds.contains(bounds)) {
+            // Shrink the leaf when the object became much smaller than the fattened box
+            auto fat = AABB(bounds.min - Vec3f(margin * 4), bounds.max + Vec3f(margin * 4));
+            if (fat.contains(node.bounds))
+                return false;
+        }
+
+        removeLeaf(proxy);
+        nodes[proxy].bounds = {bounds.min - Vec3f(margin), bounds.max + Vec3f(margin)};
+        insertLeaf(proxy);
+
+        checkRebuild();
+
+        return true;
+    }
+
+    void DynamicBVH::rebuild() {
+        std::vector<int> leaves;
+        leaves.reserve(leafCount);
+        for (int i = 0; i < static_cast<int>(nodes.size()); i++) {
+            auto &node = nodes[i];
+            if (node.height < 0)
+                continue;
+            if (node.isLeaf()) {
+                leaves.emplace_back(i);
+            } else {
+                freeNode(i);
+            }
+        }
+
+        root = leaves.empty() ? NULL_NODE : buildTopDown(leaves, 0, leaves.size());
+        if (root != NULL_NODE)
+            nodes[root].parent = NULL_NODE;
+
+        changesSinceRebuild = 0;
+        rebuildCost = getCost();
+    }
+
+    void DynamicBVH::clear() {
+        nodes.clear();
+        root = NULL_NODE;
+        freeList = NULL_NODE;
+        leafCount = 0;
+        changesSinceRebuild = 0;
+        rebuildCost = 0;
+    }
+
+    size_t DynamicBVH::getUserData(int proxy) const {
+        return nodes.at(proxy).userData;
+    }
+
+    const AABB &DynamicBVH::getBounds(int proxy) const {
+        return nodes.at(proxy).bounds;
+    }
+
+    float DynamicBVH::getCost() const {
+        float ret = 0;
+        for (auto &node: nodes) {
+            if (node.height > 0)
+                ret += node.bounds.surfaceArea();
+        }
+        return ret;
+    }
+
+    void DynamicBVH::queryAABB(const AABB &bounds, const std::function<void(int)> &callback) const {
+        if (root == NULL_NODE)
+            return;
+
+        std::vector<int> stack{root};
+        while (!stack.empty()) {
+            auto index = stack.back();
+            stack.pop_back();
+
+            auto &node = nodes[index];
+            if (!node.bounds.intersects(bounds))
+                continue;
+
+            if (node.isLeaf()) {
+                callback(index);
+            } else {
+                stack.emplace_back(node.left);
+                stack.emplace_back(node.right);
+            }
+        }
+    }
+
+    void DynamicBVH::querySphere(const BoundingSphere &sphere, const std::function<void(int)> &callback) const {
+        if (root == NULL_NODE || sphere.empty())
+            return;
+
+        std::vector<int> stack{root};
+        while (!stack.empty()) {
+            auto index = stack.back();
+            stack.pop_back();
+
+            auto &node = nodes[index];
+            if (!sphere.intersects(node.bounds))
+                continue;
+
+            if (node.isLeaf()) {
+                callback(index);
+            } else {
+                stack.emplace_back(node.left);
+                stack.emplace_back(node.right);
+            }
+        }
+    }
+
+    void DynamicBVH::queryFrustum(const Frustum &frustum, const std::function<void(int)> &callback) const {
+        if (root == NULL_NODE)
+            return;
+
+        std::vector<int> stack{root};
+        while (!stack.empty()) {
+            auto index = stack.back();
+            stack.pop_back();
+
+            auto &node = nodes[index];
+            if (!frustum.intersects(node.bounds))
+                continue;
+
+            if (node.isLeaf()) {
+                callback(index);
+            } else if (frustum.contains(node.bounds)) {
+                // The whole subtree is visible, skip the remaining plane tests
+                reportLeaves(index, callback);
+            } else {
+                stack.emplace_back(node.left);
+                stack.emplace_back(node.right);
+            }
+        }
+    }
+
+    void DynamicBVH::queryRay(const Vec3f &origin,
+                              const Vec3f &direction,
+                              float maxDistance,
+                              const std::function<float(int, float)> &callback) const {
+        if (root == NULL_NODE)
+            return;
+
+        Vec3f inverse(1 / direction.x, 1 / direction.y, 1 / direction.z);
+
+        // Returns the distance at which the ray enters the box or a negative value if it misses the box
+        auto intersect = [&](const AABB &box) {
+            float t1 = (box.min.x - origin.x) * inverse.x;
+            float t2 = (box.max.x - origin.x) * inverse.x;
+            float enter = std::min(t1, t2);
+            float leave = std::max(t1, t2);
+
+            t1 = (box.min.y - origin.y) * inverse.y;
+            t2 = (box.max.y - origin.y) * inverse.y;
+            enter = std::max(enter, std::min(t1, t2));
+            leave = std::min(leave, std::max(t1, t2));
+
+            t1 = (box.min.z - origin.z) * inverse.z;
+            t2 = (box.max.z - origin.z) * inverse.z;
+            enter = std::max(enter, std::min(t1, t2));
+            leave = std::min(leave, std::max(t1, t2));
+
+            enter = std::max(enter, 0.0f);
+            if (enter > leave || enter > maxDistance)
+                return -1.0f;
+            return enter;
+        };
+
+        std::vector<std::pair<float, int>> stack;
+        auto distance = intersect(nodes[root].bounds);
+        if (distance >= 0)
+            stack.emplace_back(distance, root);
+
+        while (!stack.empty()) {
+            auto entry = stack.back();
+            stack.pop_back();
+
+            if (entry.first > maxDistance)
+                continue;
+
+            auto &node = nodes[entry.second];
+            if (node.isLeaf()) {
+                maxDistance = std::min(maxDistance, callback(entry.second, entry.first));
+                continue;
+            }
+
+            auto left = intersect(nodes[node.left].bounds);
+            auto right = intersect(nodes[node.right].bounds);
+
+            // Push the closer child last so that it is visited first
+            if (left >= 0 && right >= 0) {
+                if (left < right) {
+                    stack.emplace_back(right, node.right);
+                    stack.emplace_back(left, node.left);
+                } else {
+                    stack.emplace_back(left, node.left);
+                    stack.emplace_back(right, node.right);
+                }
+            } else if (left >= 0) {
+                stack.emplace_back(left, node.left);
+            } else if (right >= 0) {
+                stack.emplace_back(right, node.right);
+            }
+        }
+    }
+
+    int DynamicBVH::allocateNode() {
+        int ret;
+        if (freeList == NULL_NODE) {
+            ret = static_cast<int>(nodes.size());
+            nodes.emplace_back();
+        } else {
+            ret = freeList;
+            freeList = nodes[ret].parent;
+            nodes[ret] = Node();
+        }
+        return ret;
+    }
+
+    void DynamicBVH::freeNode(int node) {
+        nodes[node].parent = freeList;
+        nodes[node].left = NULL_NODE;
+        nodes[node].right = NULL_NODE;
+        nodes[node].height = -1;
+        freeList = node;
+    }
+
+    void DynamicBVH::insertLeaf(int leaf) {
+        if (root == NULL_NODE) {
+            root = leaf;
+            nodes[leaf].parent = NULL_NODE;
+            return;
+        }
+
+        auto bounds = nodes[leaf].bounds;
+
+        // Descend towards the sibling with the lowest surface area cost
+        int index = root;
+        while (!nodes[index].isLeaf()) {
+            auto &node = nodes[index];
+
+            float area = node.bounds.surfaceArea();
+            float combinedArea = AABB::merge(node.bounds, bounds).surfaceArea();
+
+            // The cost of creating a new parent for this node and the leaf
+            float cost = 2 * combinedArea;
+
+            // The minimum cost of pushing the leaf further down the tree
+            float inheritanceCost = 2 * (combinedArea - area);
+
+            auto childCost = [&](int child) {
+                auto &childBounds = nodes[child].bounds;
+                float ret = AABB::merge(childBounds, bounds).surfaceArea() + inheritanceCost;
+                if (!nodes[child].isLeaf())
+                    ret -= childBounds.surfaceArea();
+                return ret;
+            };
+
+            float leftCost = childCost(node.left);
+            float rightCost = childCost(node.right);
+
+            if (cost < leftCost && cost < rightCost)
+                break;
+
+            index = leftCost < rightCost ? node.left : node.right;
+        }
+
+        int sibling = index;
+        int oldParent = nodes[sibling].parent;
+
+        int newParent = allocateNode();
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].bounds = AABB::merge(bounds, nodes[sibling].bounds);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].left = sibling;
+        nodes[newParent].right = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+
+        if (oldParent == NULL_NODE) {
+            root = newParent;
+        } else if (nodes[oldParent].left == sibling) {
+            nodes[oldParent].left = newParent;
+        } else {
+            nodes[oldParent].right = newParent;
+        }
+
+        refitAncestors(nodes[leaf].parent);
+    }
+
+    void DynamicBVH::removeLeaf(int leaf) {
+        if (leaf == root) {
+            root = NULL_NODE;
+            return;
+        }
+
+        int parent = nodes[leaf].parent;
+        int grandParent = nodes[parent].parent;
+        int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+        if (grandParent == NULL_NODE) {
+            root = sibling;
+            nodes[sibling].parent = NULL_NODE;
+            freeNode(parent);
+        } else {
+            if (nodes[grandParent].left == parent)
+                nodes[grandParent].left = sibling;
+            else
+                nodes[grandParent].right = sibling;
+            nodes[sibling].parent = grandParent;
+            freeNode(parent);
+
+            refitAncestors(grandParent);
+        }
+    }
+
+    void DynamicBVH::refitAncestors(int node) {
+        while (node != NULL_NODE) {
+            node = balance(node);
+
+            auto &n = nodes[node];
+            n.height = 1 + std::max(nodes[n.left].height, nodes[n.right].height);
+            n.bounds = AABB::merge(nodes[n.left].bounds, nodes[n.right].bounds);
+
+            node = n.parent;
+        }
+    }
+
+    int DynamicBVH::balance(int a) {
+        auto &nodeA = nodes[a];
+        if (nodeA.isLeaf() || nodeA.height < 2)
+            return a;
+
+        int b = nodeA.left;
+        int c = nodeA.right;
+        auto &nodeB = nodes[b];
+        auto &nodeC = nodes[c];
+
+        int difference = nodeC.height - nodeB.height;
+
+        // Rotate the higher child up, the lower grandchild becomes the child of a
+        auto rotate = [this, a](int up, int other, bool upIsRight) {
+            auto &nodeA = nodes[a];
+            auto &nodeUp = nodes[up];
+            auto &nodeOther = nodes[other];
+
+            int f = nodeUp.left;
+            int g = nodeUp.right;
+
+            nodeUp.left = a;
+            nodeUp.parent = nodeA.parent;
+            nodeA.parent = up;
+
+            if (nodeUp.parent == NULL_NODE) {
+                root = up;
+            } else if (nodes[nodeUp.parent].left == a) {
+                nodes[nodeUp.parent].left = up;
+            } else {
+                nodes[nodeUp.parent].right = up;
+            }
+
+            int keep = nodes[f].height > nodes[g].height ? f : g;
+            int move = keep == f ? g : f;
+
+            nodeUp.right = keep;
+            if (upIsRight)
+                nodeA.right = move;
+            else
+                nodeA.left = move;
+            nodes[move].parent = a;
+
+            nodeA.bounds = AABB::merge(nodeOther.bounds, nodes[move].bounds);
+            nodeA.height = 1 + std::max(nodeOther.height, nodes[move].height);
+            nodeUp.bounds = AABB::merge(nodeA.bounds, nodes[keep].bounds);
+            nodeUp.height = 1 + std::max(nodeA.height, nodes[keep].height);
+        };
+
+        if (difference > 1) {
+            rotate(c, b, true);
+            return c;
+        }
+
+        if (difference < -1) {
+            rotate(b, c, false);
+            return b;
+        }
+
+        return a;
+    }
+
+    int DynamicBVH::buildTopDown(std::vector<int> &leaves, size_t begin, size_t end) {
+        if (end - begin == 1)
+            return leaves[begin];
+
+        AABB centroids;
+        for (auto i = begin; i < end; i++) {
+            centroids.extend(nodes[leaves[i]].bounds.center());
+        }
+
+        // Split at the median along the axis with the largest centroid extent
+        auto extent = centroids.max - centroids.min;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        auto key = [this, axis](int leaf) {
+            auto center = nodes[leaf].bounds.center();
+            return axis == 0 ? center.x : axis == 1 ? center.y : center.z;
+        };
+
+        auto mid = begin + (end - begin) / 2;
+        std::nth_element(leaves.begin() + static_cast<long>(begin),
+                         leaves.begin() + static_cast<long>(mid),
+                         leaves.begin() + static_cast<long>(end),
+                         [&key](int lhs, int rhs) { return key(lhs) < key(rhs); });
+
+        int left = buildTopDown(leaves, begin, mid);
+        int right = buildTopDown(leaves, mid, end);
+
+        int ret = allocateNode();
+        auto &node = nodes[ret];
+        node.left = left;
+        node.right = right;
+        node.bounds = AABB::merge(nodes[left].bounds, nodes[right].bounds);
+        node.height = 1 + std::max(nodes[left].height, nodes[right].height);
+        nodes[left].parent = ret;
+        nodes[right].parent = ret;
+        return ret;
+    }
+
+    void DynamicBVH::checkRebuild() {
+        if (++changesSinceRebuild < std::max(REBUILD_CHECK_INTERVAL, leafCount))
+            return;
+
+        changesSinceRebuild = 0;
+        if (getCost() > rebuildCost * REBUILD_THRESHOLD)
+            rebuild();
+    }
+
+    void DynamicBVH::reportLeaves(int node, const std::function<void(int)> &callback) const {
+        std::vector<int> stack{node};
+        while (!stack.empty()) {
+            auto index = stack.back();
+            stack.pop_back();
+
+            auto &n = nodes[index];
+            if (n.isLeaf()) {
+                callback(index);
+            } else {
+                stack.emplace_back(n.left);
+                stack.emplace_back(n.right);
+            }
+        }
+    }
+}
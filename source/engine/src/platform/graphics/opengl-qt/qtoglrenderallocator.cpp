@@ -23,7 +23,11 @@
 #include "qtoglrendertarget.hpp"
 #include "qtogltexturebuffer.hpp"
 #include "qtoglmeshbuffer.hpp"
+#include "qtoglinstancebuffer.hpp"
+#include "qtoglshaderbuffer.hpp"
+#include "qtoglstoragebuffer.hpp"
 #include "qtoglshaderprogram.hpp"
+#include "qtogltypeconverter.hpp"
 
 namespace engine {
     namespace opengl {
@@ -380,7 +384,101 @@ namespace engine {
 
         std::unique_ptr<MeshBuffer>
         QtOGLRenderAllocator::createCustomMeshBuffer(const RenderAllocator::CustomMeshDefinition &mesh) {
-            throw std::runtime_error("Not Implemented");
+            auto ret = std::make_unique<QtOGLMeshBuffer>();
+
+            ret->elementType = getElementType(mesh.primitive);
+            ret->indexed = mesh.indexed;
+            ret->instanced = false;
+
+            size_t stride = mesh.getVertexSize();
+            if (stride == 0)
+                throw std::runtime_error("Invalid vertex layout");
+            if (mesh.dataLength % stride != 0)
+                throw std::runtime_error("Data length is not a multiple of the vertex size");
+
+            if (mesh.indexed)
+                ret->elementCount = mesh.indices.size();
+            else
+                ret->elementCount = mesh.dataLength / stride;
+
+            glGenVertexArrays(1, &ret->VAO);
+            glGenBuffers(1, &ret->VBO);
+
+            glBindVertexArray(ret->VAO);
+
+            glBindBuffer(GL_ARRAY_BUFFER, ret->VBO);
+            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.dataLength), mesh.data, GL_STATIC_DRAW);
+
+            if (mesh.indexed) {
+                glGenBuffers(1, &ret->EBO);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ret->EBO);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * mesh.indices.size(), mesh.indices.data(),
+                             GL_STATIC_DRAW);
+            }
+
+            size_t offset = 0;
+            int location = 0;
+            for (auto &attr: mesh.vertex) {
+                if (attr.location >= 0)
+                    location = attr.location;
+
+                auto type = QtOGLTypeConverter::convert(attr.type);
+
+                glEnableVertexAttribArray(location);
+
+                bool integer = attr.type != RenderAllocator::CustomMeshDefinition::FLOAT
+                               && attr.type != RenderAllocator::CustomMeshDefinition::DOUBLE
+                               && attr.type != RenderAllocator::CustomMeshDefinition::HALF_FLOAT;
+                if (integer && !attr.normalized) {
+                    glVertexAttribIPointer(location, attr.count, type, stride, (void *) offset);
+                } else {
+                    glVertexAttribPointer(location,
+                                          attr.count,
+                                          type,
+                                          attr.normalized ? GL_TRUE : GL_FALSE,
+                                          stride,
+                                          (void *) offset);
+                }
+
+                offset += attr.count * RenderAllocator::CustomMeshDefinition::getTypeSize(attr.type);
+                location++;
+            }
+
+            if (mesh.instanced) {
+                Mat4f instance = MatrixMath::identity(); // Default instancing offset is identity.
+
+                glGenBuffers(1, &ret->instanceVBO);
+                glBindBuffer(GL_ARRAY_BUFFER, ret->instanceVBO);
+                glBufferData(GL_ARRAY_BUFFER, sizeof(Mat4f), &instance, GL_STATIC_DRAW);
+
+                // instanceMatrix attribute
+                for (GLuint i = 0; i < 4; i++) {
+                    glEnableVertexAttribArray(5 + i);
+                    glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(Mat4f), (void *) (i * Mat4f::ROW_SIZE));
+                    glVertexAttribDivisor(5 + i, 1);
+                }
+            }
+
+            glBindVertexArray(0);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+            checkGLError("QtOGLRenderAllocator::createCustomMeshBuffer");
+
+            return ret;
+        }
+
+        std::unique_ptr<InstanceBuffer> QtOGLRenderAllocator::createInstanceBuffer() {
+            return std::make_unique<QtOGLInstanceBuffer>();
+        }
+
+        std::unique_ptr<ShaderBuffer> QtOGLRenderAllocator::createShaderBuffer() {
+            return std::make_unique<QtOGLShaderBuffer>();
+        }
+
+        std::unique_ptr<StorageBuffer> QtOGLRenderAllocator::createStorageBuffer(StorageBuffer::Format format) {
+            return std::make_unique<QtOGLStorageBuffer>(format);
         }
 
         std::unique_ptr<ShaderProgram> QtOGLRenderAllocator::createShaderProgram(const ShaderSource &vertexShader,
@@ -45,6 +45,12 @@ namespace engine {
             std::unique_ptr<MeshBuffer> createInstancedMeshBuffer(const Mesh &mesh,
                                                                   const std::vector<Transform> &offsets) override;
 
+            std::unique_ptr<InstanceBuffer> createInstanceBuffer() override;
+
+            std::unique_ptr<ShaderBuffer> createShaderBuffer() override;
+
+            std::unique_ptr<StorageBuffer> createStorageBuffer(StorageBuffer::Format format) override;
+
             std::unique_ptr<ShaderProgram> createShaderProgram(const ShaderSource &vertexShader,
                                                                const ShaderSource &fragmentShader) override;
 
@@ -28,6 +28,8 @@
 #include "qtoglshaderprogram.hpp"
 #include "qtogltexturebuffer.hpp"
 #include "qtoglmeshbuffer.hpp"
+#include "qtoglinstancebuffer.hpp"
+#include "qtoglstoragebuffer.hpp"
 #include "qtoglrendertarget.hpp"
 
 #include "qtoglcheckerror.hpp"
@@ -37,33 +39,6 @@
 
 namespace engine {
     namespace opengl {
-        static GLuint getTextureSlot(int slot) {
-            switch (slot) {
-                case 0:
-                    return GL_TEXTURE0;
-                case 1:
-                    return GL_TEXTURE1;
-                case 2:
-                    return GL_TEXTURE2;
-                case 3:
-                    return GL_TEXTURE3;
-                case 4:
-                    return GL_TEXTURE4;
-                case 5:
-                    return GL_TEXTURE5;
-                case 6:
-                    return GL_TEXTURE6;
-                case 7:
-                    return GL_TEXTURE7;
-                case 8:
-                    return GL_TEXTURE8;
-                case 9:
-                    return GL_TEXTURE9;
-                default:
-                    throw std::runtime_error("Maximum 10 texture slots");
-            }
-        }
-
         void QtOGLRenderer::renderBegin(RenderTarget &target, const RenderOptions &options) {
             glClearColor((float) options.clearColorValue.r() / (float) 255,
                          (float) options.clearColorValue.g() / (float) 255,
@@ -72,6 +47,9 @@ namespace engine {
 
             glClearDepth(options.clearDepthValue);
 
+            invalidateState();
+            prepareClear();
+
             if (options.multiSample)
                 glEnable(GL_MULTISAMPLE);
             else
@@ -114,69 +92,57 @@ namespace engine {
         void QtOGLRenderer::addCommand(RenderCommand &command) {
             drawCalls++;
 
-            //Bind textures
-            for (int i = 0; i < command.textures.size(); i++) {
-                auto &texture = dynamic_cast<const QtOGLTextureBuffer &>(command.textures.at(i).get());
-                glActiveTexture(getTextureSlot(i));
-                glBindTexture(QtOGLTypeConverter::convert(texture.getAttributes().textureType), texture.handle);
-            }
+            bindTextures(command);
 
             //Bind shader program
             auto &shader = dynamic_cast<QtOGLShaderProgram &>(command.shader.get());
             shader.activate();
 
-            glDepthFunc(QtOGLTypeConverter::convert(command.properties.depthTestMode));
-            if (command.properties.depthTestWrite)
-                glDepthMask(GL_TRUE);
-            else
-                glDepthMask(GL_FALSE);
-
-            //Setup per model depth, stencil, culling and blend states
-            if (command.properties.enableDepthTest) {
-                glEnable(GL_DEPTH_TEST);
-            } else {
-                glDisable(GL_DEPTH_TEST);
-            }
-
-            glStencilMask(QtOGLTypeConverter::convertPrimitive(command.properties.stencilTestMask));
-            glStencilFunc(QtOGLTypeConverter::convert(command.properties.stencilMode),
-                          QtOGLTypeConverter::convertPrimitive(command.properties.stencilReference),
-                          QtOGLTypeConverter::convertPrimitive(command.properties.stencilFunctionMask));
-            glStencilOp(QtOGLTypeConverter::convert(command.properties.stencilFail),
-                        QtOGLTypeConverter::convert(command.properties.stencilDepthFail),
-                        QtOGLTypeConverter::convert(command.properties.stencilPass));
-
-            if (command.properties.enableStencilTest) {
-                glEnable(GL_STENCIL_TEST);
-            } else {
-                glDisable(GL_STENCIL_TEST);
-            }
-
-            glCullFace(QtOGLTypeConverter::convert(command.properties.faceCullMode));
-            if (command.properties.faceCullClockwiseWinding)
-                glFrontFace(GL_CW);
-            else
-                glFrontFace(GL_CCW);
-
-            if (command.properties.enableFaceCulling) {
-                glEnable(GL_CULL_FACE);
-            } else {
-                glDisable(GL_CULL_FACE);
-            }
-
-            glBlendFunc(QtOGLTypeConverter::convert(command.properties.blendSourceMode),
-                        QtOGLTypeConverter::convert(command.properties.blendDestinationMode));
-
-            if (command.properties.enableBlending) {
-                glEnable(GL_BLEND);
-            } else {
-                glDisable(GL_BLEND);
-            }
+            applyProperties(command.properties);
 
             //Bind VAO and draw.
             auto &mesh = dynamic_cast<const QtOGLMeshBuffer &>(command.mesh.get());
             glBindVertexArray(mesh.VAO);
-            if (mesh.indexed) {
+            if (command.instances != nullptr) {
+                if (mesh.instanceVBO == 0)
+                    throw std::runtime_error("Instanced render commands require a mesh buffer with instance attributes");
+
+                auto &instances = dynamic_cast<const QtOGLInstanceBuffer &>(*command.instances);
+                if (command.instanceOffset + command.instanceCount > instances.count)
+                    throw std::runtime_error("Instance range out of bounds");
+
+                // Point the instance matrix attributes at the requested range of the instance buffer
+                glBindBuffer(GL_ARRAY_BUFFER, instances.VBO);
+                for (GLuint i = 0; i < 4; i++) {
+                    glVertexAttribPointer(5 + i,
+                                          4,
+                                          GL_FLOAT,
+                                          GL_FALSE,
+                                          sizeof(Mat4f),
+                                          (void *) (command.instanceOffset * sizeof(Mat4f) + i * Mat4f::ROW_SIZE));
+                }
+
+                if (mesh.indexed)
+                    glDrawElementsInstanced(mesh.elementType,
+                                            mesh.elementCount,
+                                            GL_UNSIGNED_INT,
+                                            0,
+                                            command.instanceCount);
+                else
+                    glDrawArraysInstanced(mesh.elementType, 0, mesh.elementCount, command.instanceCount);
+
+                // Restore the instance attributes of the mesh buffer
+                glBindBuffer(GL_ARRAY_BUFFER, mesh.instanceVBO);
+                for (GLuint i = 0; i < 4; i++) {
+                    glVertexAttribPointer(5 + i,
+                                          4,
+                                          GL_FLOAT,
+                                          GL_FALSE,
+                                          sizeof(Mat4f),
+                                          (void *) (i * Mat4f::ROW_SIZE));
+                }
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            } else if (mesh.indexed) {
                 if (mesh.instanced)
                     glDrawElementsInstanced(mesh.elementType,
                                             mesh.elementCount,
@@ -196,21 +162,17 @@ namespace engine {
             }
             glBindVertexArray(0);
 
-            //Unbind textures
-            for (int y = 0; y < 10; y++) {
-                glActiveTexture(getTextureSlot(y));
-                glBindTexture(GL_TEXTURE_2D, 0);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-            }
+            checkGLError("QtOGLRenderer::addCommand");
+        }
+
+        void QtOGLRenderer::renderFinish() {
+            unbindTextures();
 
             //Reset Stencil mask
             glStencilMask(0xFF);
             glStencilFunc(GL_ALWAYS, 0, 0xFF);
+            invalidateState();
 
-            checkGLError("QtOGLRenderer::addCommand");
-        }
-
-        void QtOGLRenderer::renderFinish() {
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
             checkGLError("QtOGLRenderer::renderFinish");
         }
@@ -239,6 +201,7 @@ namespace engine {
                 throw std::runtime_error("Render Target framebuffer is not complete: " + std::to_string(ret));
             }
 
+            prepareClear();
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -246,6 +209,178 @@ namespace engine {
             checkGLError("OGLRenderer::renderClear");
         }
 
+        void QtOGLRenderer::invalidateState() {
+            state.valid = false;
+            state.activeTextureSlot = UNKNOWN;
+            for (auto &texture: state.textures)
+                texture = UNKNOWN;
+        }
+
+        void QtOGLRenderer::applyProperties(const RenderProperties &properties) {
+            auto &current = state.properties;
+            bool force = !state.valid;
+
+            if (force || properties.depthTestMode != current.depthTestMode)
+                glDepthFunc(QtOGLTypeConverter::convert(properties.depthTestMode));
+
+            if (force || properties.depthTestWrite != current.depthTestWrite) {
+                if (properties.depthTestWrite)
+                    glDepthMask(GL_TRUE);
+                else
+                    glDepthMask(GL_FALSE);
+            }
+
+            //Setup per model depth, stencil, culling and blend states
+            if (force || properties.enableDepthTest != current.enableDepthTest) {
+                if (properties.enableDepthTest) {
+                    glEnable(GL_DEPTH_TEST);
+                } else {
+                    glDisable(GL_DEPTH_TEST);
+                }
+            }
+
+            if (force || properties.stencilTestMask != current.stencilTestMask)
+                glStencilMask(QtOGLTypeConverter::convertPrimitive(properties.stencilTestMask));
+
+            if (force
+                || properties.stencilMode != current.stencilMode
+                || properties.stencilReference != current.stencilReference
+                || properties.stencilFunctionMask != current.stencilFunctionMask)
+                glStencilFunc(QtOGLTypeConverter::convert(properties.stencilMode),
+                              QtOGLTypeConverter::convertPrimitive(properties.stencilReference),
+                              QtOGLTypeConverter::convertPrimitive(properties.stencilFunctionMask));
+
+            if (force
+                || properties.stencilFail != current.stencilFail
+                || properties.stencilDepthFail != current.stencilDepthFail
+                || properties.stencilPass != current.stencilPass)
+                glStencilOp(QtOGLTypeConverter::convert(properties.stencilFail),
+                            QtOGLTypeConverter::convert(properties.stencilDepthFail),
+                            QtOGLTypeConverter::convert(properties.stencilPass));
+
+            if (force || properties.enableStencilTest != current.enableStencilTest) {
+                if (properties.enableStencilTest) {
+                    glEnable(GL_STENCIL_TEST);
+                } else {
+                    glDisable(GL_STENCIL_TEST);
+                }
+            }
+
+            if (force || properties.faceCullMode != current.faceCullMode)
+                glCullFace(QtOGLTypeConverter::convert(properties.faceCullMode));
+
+            if (force || properties.faceCullClockwiseWinding != current.faceCullClockwiseWinding) {
+                if (properties.faceCullClockwiseWinding)
+                    glFrontFace(GL_CW);
+                else
+                    glFrontFace(GL_CCW);
+            }
+
+            if (force || properties.enableFaceCulling != current.enableFaceCulling) {
+                if (properties.enableFaceCulling) {
+                    glEnable(GL_CULL_FACE);
+                } else {
+                    glDisable(GL_CULL_FACE);
+                }
+            }
+
+            if (force
+                || properties.blendSourceMode != current.blendSourceMode
+                || properties.blendDestinationMode != current.blendDestinationMode)
+                glBlendFunc(QtOGLTypeConverter::convert(properties.blendSourceMode),
+                            QtOGLTypeConverter::convert(properties.blendDestinationMode));
+
+            if (force || properties.enableBlending != current.enableBlending) {
+                if (properties.enableBlending) {
+                    glEnable(GL_BLEND);
+                } else {
+                    glDisable(GL_BLEND);
+                }
+            }
+
+            current = properties;
+            state.valid = true;
+        }
+
+        void QtOGLRenderer::bindTextures(const RenderCommand &command) {
+            auto &textures = command.textures;
+            auto &buffers = command.storageBuffers;
+            if (textures.size() + buffers.size() > MAX_TEXTURE_SLOTS)
+                throw std::runtime_error("Maximum " + std::to_string(MAX_TEXTURE_SLOTS) + " texture slots");
+
+            for (unsigned int i = 0; i < MAX_TEXTURE_SLOTS; i++) {
+                GLuint type = GL_TEXTURE_2D;
+                GLuint handle = 0;
+                if (i < textures.size()) {
+                    auto &texture = dynamic_cast<const QtOGLTextureBuffer &>(textures.at(i).get());
+                    type = QtOGLTypeConverter::convert(texture.getAttributes().textureType);
+                    handle = texture.handle;
+                } else if (i < textures.size() + buffers.size()) {
+                    auto &buffer = dynamic_cast<const QtOGLStorageBuffer &>(buffers.at(i - textures.size()).get());
+                    type = GL_TEXTURE_BUFFER;
+                    handle = buffer.texture;
+                }
+
+                auto &boundType = state.textureTypes[i];
+                auto &boundHandle = state.textures[i];
+                if (boundHandle == handle && (handle == 0 || boundType == type))
+                    continue;
+
+                setActiveTextureSlot(i);
+                if (boundHandle == UNKNOWN) {
+                    glBindTexture(GL_TEXTURE_2D, 0);
+                    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+                    glBindTexture(GL_TEXTURE_BUFFER, 0);
+                } else if (boundHandle != 0 && (handle == 0 || boundType != type)) {
+                    glBindTexture(boundType, 0);
+                }
+                if (handle != 0)
+                    glBindTexture(type, handle);
+
+                boundType = type;
+                boundHandle = handle;
+            }
+
+            setActiveTextureSlot(SCRATCH_TEXTURE_SLOT);
+        }
+
+        void QtOGLRenderer::unbindTextures() {
+            for (unsigned int i = 0; i < MAX_TEXTURE_SLOTS; i++) {
+                if (state.textures[i] == 0)
+                    continue;
+
+                setActiveTextureSlot(i);
+                if (state.textures[i] == UNKNOWN) {
+                    glBindTexture(GL_TEXTURE_2D, 0);
+                    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+                    glBindTexture(GL_TEXTURE_BUFFER, 0);
+                } else {
+                    glBindTexture(state.textureTypes[i], 0);
+                }
+                state.textures[i] = 0;
+            }
+
+            setActiveTextureSlot(SCRATCH_TEXTURE_SLOT);
+        }
+
+        void QtOGLRenderer::setActiveTextureSlot(unsigned int slot) {
+            if (state.activeTextureSlot != slot) {
+                glActiveTexture(GL_TEXTURE0 + slot);
+                state.activeTextureSlot = slot;
+            }
+        }
+
+        void QtOGLRenderer::prepareClear() {
+            if (!state.valid || !state.properties.depthTestWrite) {
+                glDepthMask(GL_TRUE);
+                state.properties.depthTestWrite = true;
+            }
+            if (!state.valid || state.properties.stencilTestMask != 0xFF) {
+                glStencilMask(0xFF);
+                state.properties.stencilTestMask = 0xFF;
+            }
+        }
+
         void QtOGLRenderer::debugDrawCallRecordStart() {
             drawCalls = 0;
         }
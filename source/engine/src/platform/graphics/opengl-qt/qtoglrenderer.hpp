@@ -45,7 +45,39 @@ namespace engine {
             unsigned long debugDrawCallRecordStop() override;
 
         private:
+            static const unsigned int MAX_TEXTURE_SLOTS = 16;
+
+            // Texture uploads bind on this unit so that they do not change the cached slot bindings
+            static const unsigned int SCRATCH_TEXTURE_SLOT = MAX_TEXTURE_SLOTS;
+
+            static const unsigned int UNKNOWN = ~0u;
+
+            // The shadow copy of the GL state set by the renderer, state changes are only emitted on a difference.
+            struct StateCache {
+                bool valid = false; // If false the render properties are set unconditionally by the next command
+                RenderProperties properties;
+                unsigned int activeTextureSlot = UNKNOWN;
+                unsigned int textureTypes[MAX_TEXTURE_SLOTS]{};
+                unsigned int textures[MAX_TEXTURE_SLOTS]{}; // UNKNOWN if the binding of the slot is not known
+            };
+
             unsigned long drawCalls = 0;
+
+            StateCache state;
+
+            // Forget the cached state, called when GL code outside of the renderer may have changed the state.
+            void invalidateState();
+
+            void applyProperties(const RenderProperties &properties);
+
+            void bindTextures(const RenderCommand &command);
+
+            void unbindTextures();
+
+            void setActiveTextureSlot(unsigned int slot);
+
+            // Enable the depth and stencil writes which are required by glClear
+            void prepareClear();
         };
     }
 }
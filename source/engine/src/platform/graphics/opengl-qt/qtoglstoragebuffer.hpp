@@ -0,0 +1,97 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_QTOGLSTORAGEBUFFER_HPP
+#define MANA_QTOGLSTORAGEBUFFER_HPP
+
+#include "platform/graphics/storagebuffer.hpp"
+
+#include "qtoglcheckerror.hpp"
+
+#include "qtopenglinclude.hpp"
+
+#include <QOpenGLFunctions_4_5_Core>
+
+namespace engine {
+    namespace opengl {
+        /**
+         * A storage buffer implemented as a buffer texture.
+         */
+        class QtOGLStorageBuffer : public StorageBuffer, public QOpenGLFunctions_4_5_Core {
+        public:
+            GLuint buffer;
+            GLuint texture;
+
+            Format format;
+
+            size_t size;
+            size_t capacity; // The size of the buffer storage in bytes
+
+            explicit QtOGLStorageBuffer(Format format) : buffer(0), texture(0), format(format), size(0), capacity(0) {
+                QOpenGLFunctions_4_5_Core::initializeOpenGLFunctions();
+
+                glGenBuffers(1, &buffer);
+                glGenTextures(1, &texture);
+
+                // The texture references the buffer object so reallocating the buffer storage does not require rebinding
+                glBindTexture(GL_TEXTURE_BUFFER, texture);
+                glTexBuffer(GL_TEXTURE_BUFFER, format == R32UI ? GL_R32UI : GL_RGBA32F, buffer);
+                glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+                checkGLError("QtOGLStorageBuffer");
+            }
+
+            QtOGLStorageBuffer(const QtOGLStorageBuffer &copy) = delete;
+
+            QtOGLStorageBuffer &operator=(const QtOGLStorageBuffer &copy) = delete;
+
+            ~QtOGLStorageBuffer() override {
+                glDeleteTextures(1, &texture);
+                glDeleteBuffers(1, &buffer);
+            }
+
+            void upload(const uint8_t *data, size_t dataSize) override {
+                size = dataSize;
+                if (size == 0)
+                    return;
+
+                glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+                if (size > capacity) {
+                    capacity = size;
+                    glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(size), data, GL_DYNAMIC_DRAW);
+                } else {
+                    glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(size), data);
+                }
+                glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+                checkGLError("QtOGLStorageBuffer::upload");
+            }
+
+            size_t getSize() const override {
+                return size;
+            }
+
+            Format getFormat() const override {
+                return format;
+            }
+        };
+    }
+}
+
+#endif //MANA_QTOGLSTORAGEBUFFER_HPP
@@ -21,6 +21,8 @@
 #include "qtoglcheckerror.hpp"
 #include "qtogltypeconverter.hpp"
 
+#include "asset/compressedimage.hpp"
+
 using namespace engine;
 using namespace engine::opengl;
 
@@ -51,7 +53,9 @@ QtOGLTextureBuffer::QtOGLTextureBuffer(Attributes attributes) : TextureBuffer(at
     }
     checkGLError("QtOGLTextureBuffer::QtOGLTextureBuffer()");
 
-    if (attributes.textureType == TEXTURE_2D) {
+    if (CompressedImage::isBlockCompressed(attributes.format)) {
+        //Storage for block compressed textures is allocated when uploading the compressed image
+    } else if (attributes.textureType == TEXTURE_2D) {
         GLuint texInternalFormat = QtOGLTypeConverter::convert(attributes.format);
         GLuint texFormat = GL_RGBA;
 
@@ -110,7 +114,9 @@ QtOGLTextureBuffer::QtOGLTextureBuffer(Attributes attributes) : TextureBuffer(at
     }
     checkGLError("QtOGLTextureBuffer::QtOGLTextureBuffer()");
 
-    if (type != GL_TEXTURE_2D_MULTISAMPLE && attributes.generateMipmap) {
+    if (type != GL_TEXTURE_2D_MULTISAMPLE
+        && attributes.generateMipmap
+        && !CompressedImage::isBlockCompressed(attributes.format)) {
         glGenerateMipmap(type);
         glTexParameteri(type, GL_TEXTURE_MIN_FILTER,
                         QtOGLTypeConverter::convert(attributes.mipmapFilter));
@@ -285,6 +291,76 @@ void QtOGLTextureBuffer::upload(const Image<unsigned char> &buffer) {
     checkGLError("QtOGLTextureBuffer::upload(unsigned char)");
 }
 
+void QtOGLTextureBuffer::upload(const CompressedImage &image) {
+    uploadMipLevels(image, 0);
+}
+
+void QtOGLTextureBuffer::uploadMipLevels(const CompressedImage &image, int baseLevel) {
+    auto levelCount = static_cast<int>(image.levels.size());
+    if (levelCount == 0)
+        throw std::runtime_error("Compressed image has no levels");
+    if (baseLevel < 0 || baseLevel >= levelCount)
+        throw std::runtime_error("Invalid compressed image base level");
+
+    int endLevel = levelCount;
+
+    bool resident = uploadedLevel >= 0
+                    && attributes.textureType == TEXTURE_2D
+                    && attributes.format == image.format
+                    && attributes.size == image.size;
+
+    attributes.format = image.format;
+    attributes.size = image.size;
+
+    setTextureType(TextureBuffer::TEXTURE_2D);
+
+    if (resident && baseLevel <= uploadedLevel) {
+        //The levels starting at the current base level are already uploaded
+        endLevel = uploadedLevel;
+    } else if (resident) {
+        //Recreate the texture to release the memory of the levels below the new base level
+        glDeleteTextures(1, &handle);
+        glGenTextures(1, &handle);
+        glBindTexture(GL_TEXTURE_2D, handle);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, QtOGLTypeConverter::convert(attributes.wrapping));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, QtOGLTypeConverter::convert(attributes.wrapping));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, QtOGLTypeConverter::convert(attributes.filterMag));
+    }
+
+    glBindTexture(GL_TEXTURE_2D, handle);
+    for (int level = baseLevel; level < endLevel; level++) {
+        auto size = image.getLevelSize(level);
+        auto &data = image.levels.at(level);
+        if (data.size() != CompressedImage::getDataSize(image.format, size))
+            throw std::runtime_error("Invalid compressed image level size");
+        glCompressedTexImage2D(GL_TEXTURE_2D,
+                               level,
+                               QtOGLTypeConverter::convert(attributes.format),
+                               size.x,
+                               size.y,
+                               0,
+                               static_cast<GLsizei>(data.size()),
+                               data.data());
+    }
+
+    //The mip chain is precomputed, limit sampling to the uploaded levels instead of generating mipmaps.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    if (baseLevel < levelCount - 1) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        QtOGLTypeConverter::convert(attributes.mipmapFilter));
+    } else {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        QtOGLTypeConverter::convert(attributes.filterMin));
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    uploadedLevel = baseLevel;
+
+    checkGLError("QtOGLTextureBuffer::uploadMipLevels");
+}
+
 engine::Image<ColorRGBA> QtOGLTextureBuffer::download() {
     if (attributes.textureType != TEXTURE_2D)
         throw std::runtime_error("TextureBuffer not texture 2d");
@@ -374,7 +450,9 @@ void QtOGLTextureBuffer::setTextureType(TextureType t) {
                         QtOGLTypeConverter::convert(attributes.filterMag));
         checkGLError("QtOGLTextureBuffer::QtOGLTextureBuffer()");
 
-        if (attributes.textureType == TEXTURE_2D) {
+        if (CompressedImage::isBlockCompressed(attributes.format)) {
+            //Storage for block compressed textures is allocated when uploading the compressed image
+        } else if (attributes.textureType == TEXTURE_2D) {
             GLuint texInternalFormat = QtOGLTypeConverter::convert(attributes.format);
             GLuint texFormat = GL_RGBA;
 
@@ -418,7 +496,7 @@ void QtOGLTextureBuffer::setTextureType(TextureType t) {
         }
         checkGLError("QtOGLTextureBuffer::QtOGLTextureBuffer()");
 
-        if (attributes.generateMipmap) {
+        if (attributes.generateMipmap && !CompressedImage::isBlockCompressed(attributes.format)) {
             glGenerateMipmap(type);
             glTexParameteri(type, GL_TEXTURE_MIN_FILTER,
                             QtOGLTypeConverter::convert(attributes.mipmapFilter));
@@ -52,6 +52,10 @@ namespace engine {
 
             void upload(const Image<unsigned char> &buffer) override;
 
+            void upload(const CompressedImage &image) override;
+
+            void uploadMipLevels(const CompressedImage &image, int baseLevel) override;
+
             Image<ColorRGBA> download() override;
 
             void upload(CubeMapFace face, const Image<ColorRGBA> &buffer) override;
@@ -63,6 +67,8 @@ namespace engine {
             Image<ColorRGBA> downloadCubeMap() override;
 
         private:
+            int uploadedLevel = -1; // The base level of the uploaded compressed image, -1 if no compressed image is uploaded
+
             void setTextureType(TextureType type);
         };
     }
@@ -202,6 +202,14 @@ namespace engine {
                         return GL_COMPRESSED_RGB;
                     case TextureBuffer::RGBA_COMPRESSED:
                         return GL_COMPRESSED_RGBA;
+                    case TextureBuffer::BC1:
+                        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+                    case TextureBuffer::BC3:
+                        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+                    case TextureBuffer::BC5:
+                        return GL_COMPRESSED_RG_RGTC2;
+                    case TextureBuffer::BC7:
+                        return GL_COMPRESSED_RGBA_BPTC_UNORM;
                     case TextureBuffer::R8:
                         return GL_R8;
                     case TextureBuffer::RG8:
@@ -330,6 +338,30 @@ namespace engine {
                 }
                 throw std::runtime_error("Invalid mipmap filtering");
             }
+
+            GLenum convert(RenderAllocator::CustomMeshDefinition::AttributeType type) {
+                switch (type) {
+                    case RenderAllocator::CustomMeshDefinition::UNSIGNED_BYTE:
+                        return GL_UNSIGNED_BYTE;
+                    case RenderAllocator::CustomMeshDefinition::SIGNED_BYTE:
+                        return GL_BYTE;
+                    case RenderAllocator::CustomMeshDefinition::UNSIGNED_SHORT:
+                        return GL_UNSIGNED_SHORT;
+                    case RenderAllocator::CustomMeshDefinition::SIGNED_SHORT:
+                        return GL_SHORT;
+                    case RenderAllocator::CustomMeshDefinition::UNSIGNED_INT:
+                        return GL_UNSIGNED_INT;
+                    case RenderAllocator::CustomMeshDefinition::SIGNED_INT:
+                        return GL_INT;
+                    case RenderAllocator::CustomMeshDefinition::HALF_FLOAT:
+                        return GL_HALF_FLOAT;
+                    case RenderAllocator::CustomMeshDefinition::FLOAT:
+                        return GL_FLOAT;
+                    case RenderAllocator::CustomMeshDefinition::DOUBLE:
+                        return GL_DOUBLE;
+                }
+                throw std::runtime_error("Invalid attribute type");
+            }
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_OGLINSTANCEBUFFER_HPP
+#define MANA_OGLINSTANCEBUFFER_HPP
+
+#include <algorithm>
+
+#include "platform/graphics/instancebuffer.hpp"
+
+#include "oglcheckerror.hpp"
+
+#include "openglinclude.hpp"
+
+namespace engine {
+    namespace opengl {
+        class OGLInstanceBuffer : public InstanceBuffer {
+        public:
+            GLuint VBO;
+
+            size_t count;
+            size_t capacity; // The number of matrices the storage of the buffer can hold
+
+            explicit OGLInstanceBuffer() : VBO(0), count(0), capacity(0) {
+                glGenBuffers(1, &VBO);
+            }
+
+            OGLInstanceBuffer(const OGLInstanceBuffer &copy) = delete;
+
+            OGLInstanceBuffer &operator=(const OGLInstanceBuffer &copy) = delete;
+
+            ~OGLInstanceBuffer() override {
+                glDeleteBuffers(1, &VBO);
+            }
+
+            void upload(const std::vector<Mat4f> &matrices) override {
+                count = matrices.size();
+                if (count == 0)
+                    return;
+
+                glBindBuffer(GL_ARRAY_BUFFER, VBO);
+                if (count > capacity) {
+                    capacity = std::max(count, capacity * 2);
+                }
+                // Orphan the storage so that the driver does not wait for draws reading the previous contents
+                glBufferData(GL_ARRAY_BUFFER,
+                             static_cast<GLsizeiptr>(sizeof(Mat4f) * capacity),
+                             nullptr,
+                             GL_STREAM_DRAW);
+                glBufferSubData(GL_ARRAY_BUFFER,
+                                0,
+                                static_cast<GLsizeiptr>(sizeof(Mat4f) * count),
+                                matrices.data());
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+                checkGLError("OGLInstanceBuffer::upload");
+            }
+
+            size_t getCount() const override {
+                return count;
+            }
+        };
+    }
+}
+
+#endif //MANA_OGLINSTANCEBUFFER_HPP
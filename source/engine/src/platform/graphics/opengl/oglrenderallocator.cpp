@@ -25,7 +25,11 @@
 #include "oglrendertarget.hpp"
 #include "ogltexturebuffer.hpp"
 #include "oglmeshbuffer.hpp"
+#include "oglinstancebuffer.hpp"
+#include "oglshaderbuffer.hpp"
+#include "oglstoragebuffer.hpp"
 #include "oglshaderprogram.hpp"
+#include "ogltypeconverter.hpp"
 
 namespace engine {
     namespace opengl {
@@ -380,6 +384,18 @@ namespace engine {
             return ret;
         }
 
+        std::unique_ptr<InstanceBuffer> OGLRenderAllocator::createInstanceBuffer() {
+            return std::make_unique<OGLInstanceBuffer>();
+        }
+
+        std::unique_ptr<ShaderBuffer> OGLRenderAllocator::createShaderBuffer() {
+            return std::make_unique<OGLShaderBuffer>();
+        }
+
+        std::unique_ptr<StorageBuffer> OGLRenderAllocator::createStorageBuffer(StorageBuffer::Format format) {
+            return std::make_unique<OGLStorageBuffer>(format);
+        }
+
         std::unique_ptr<ShaderProgram> OGLRenderAllocator::createShaderProgram(const ShaderSource &vertexShader,
                                                                                const ShaderSource &fragmentShader) {
             auto language = vertexShader.getLanguage();
@@ -394,7 +410,89 @@ namespace engine {
 
         std::unique_ptr<MeshBuffer>
         OGLRenderAllocator::createCustomMeshBuffer(const RenderAllocator::CustomMeshDefinition &mesh) {
-            throw std::runtime_error("Not Implemented");
+            auto ret = std::make_unique<OGLMeshBuffer>();
+
+            ret->elementType = getElementType(mesh.primitive);
+            ret->indexed = mesh.indexed;
+            ret->instanced = false;
+
+            size_t stride = mesh.getVertexSize();
+            if (stride == 0)
+                throw std::runtime_error("Invalid vertex layout");
+            if (mesh.dataLength % stride != 0)
+                throw std::runtime_error("Data length is not a multiple of the vertex size");
+
+            if (mesh.indexed)
+                ret->elementCount = mesh.indices.size();
+            else
+                ret->elementCount = mesh.dataLength / stride;
+
+            glGenVertexArrays(1, &ret->VAO);
+            glGenBuffers(1, &ret->VBO);
+
+            glBindVertexArray(ret->VAO);
+
+            glBindBuffer(GL_ARRAY_BUFFER, ret->VBO);
+            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.dataLength), mesh.data, GL_STATIC_DRAW);
+
+            if (mesh.indexed) {
+                glGenBuffers(1, &ret->EBO);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ret->EBO);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * mesh.indices.size(), mesh.indices.data(),
+                             GL_STATIC_DRAW);
+            }
+
+            size_t offset = 0;
+            int location = 0;
+            for (auto &attr: mesh.vertex) {
+                if (attr.location >= 0)
+                    location = attr.location;
+
+                auto type = OGLTypeConverter::convert(attr.type);
+
+                glEnableVertexAttribArray(location);
+
+                bool integer = attr.type != RenderAllocator::CustomMeshDefinition::FLOAT
+                               && attr.type != RenderAllocator::CustomMeshDefinition::DOUBLE
+                               && attr.type != RenderAllocator::CustomMeshDefinition::HALF_FLOAT;
+                if (integer && !attr.normalized) {
+                    glVertexAttribIPointer(location, attr.count, type, stride, (void *) offset);
+                } else {
+                    glVertexAttribPointer(location,
+                                          attr.count,
+                                          type,
+                                          attr.normalized ? GL_TRUE : GL_FALSE,
+                                          stride,
+                                          (void *) offset);
+                }
+
+                offset += attr.count * RenderAllocator::CustomMeshDefinition::getTypeSize(attr.type);
+                location++;
+            }
+
+            if (mesh.instanced) {
+                Mat4f instance = MatrixMath::identity(); // Default instancing offset is identity.
+
+                glGenBuffers(1, &ret->instanceVBO);
+                glBindBuffer(GL_ARRAY_BUFFER, ret->instanceVBO);
+                glBufferData(GL_ARRAY_BUFFER, sizeof(Mat4f), &instance, GL_STATIC_DRAW);
+
+                // instanceMatrix attribute
+                for (GLuint i = 0; i < 4; i++) {
+                    glEnableVertexAttribArray(5 + i);
+                    glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(Mat4f), (void *) (i * Mat4f::ROW_SIZE));
+                    glVertexAttribDivisor(5 + i, 1);
+                }
+            }
+
+            glBindVertexArray(0);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+            checkGLError("OGLRenderAllocator::createCustomMeshBuffer");
+
+            return ret;
         }
 
         std::unique_ptr<ShaderProgram> OGLRenderAllocator::createShaderProgram(const ShaderSource &vertexShader,
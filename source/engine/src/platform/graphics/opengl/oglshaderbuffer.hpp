@@ -0,0 +1,74 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_OGLSHADERBUFFER_HPP
+#define MANA_OGLSHADERBUFFER_HPP
+
+#include "platform/graphics/shaderbuffer.hpp"
+
+#include "oglcheckerror.hpp"
+
+#include "openglinclude.hpp"
+
+namespace engine {
+    namespace opengl {
+        class OGLShaderBuffer : public ShaderBuffer {
+        public:
+            GLuint UBO;
+
+            size_t size;
+            size_t capacity; // The size of the buffer storage in bytes
+
+            explicit OGLShaderBuffer() : UBO(0), size(0), capacity(0) {
+                glGenBuffers(1, &UBO);
+            }
+
+            OGLShaderBuffer(const OGLShaderBuffer &copy) = delete;
+
+            OGLShaderBuffer &operator=(const OGLShaderBuffer &copy) = delete;
+
+            ~OGLShaderBuffer() override {
+                glDeleteBuffers(1, &UBO);
+            }
+
+            void upload(const uint8_t *data, size_t dataSize) override {
+                size = dataSize;
+                if (size == 0)
+                    return;
+
+                glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+                if (size > capacity) {
+                    capacity = size;
+                    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(size), data, GL_DYNAMIC_DRAW);
+                } else {
+                    glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(size), data);
+                }
+                glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+                checkGLError("OGLShaderBuffer::upload");
+            }
+
+            size_t getSize() const override {
+                return size;
+            }
+        };
+    }
+}
+
+#endif //MANA_OGLSHADERBUFFER_HPP
@@ -20,11 +20,13 @@
 #ifdef BUILD_ENGINE_RENDERER_OPENGL
 
 #include <stdexcept>
+#include <vector>
 
 #include "math/rotation.hpp"
 #include "math/matrixmath.hpp"
 
 #include "oglshaderprogram.hpp"
+#include "oglshaderbuffer.hpp"
 #include "oglcheckerror.hpp"
 
 namespace engine {
@@ -122,181 +124,67 @@ namespace engine {
         }
 
         bool OGLShaderProgram::setTexture(const std::string &name, int slot) {
-            //Samplers do not appear to get merged into the global struct when cross compiling
-            auto it = locations.find(name);
-            if (it != locations.end())
-                return setTexture(it->second, slot);
-            GLint location = glGetUniformLocation(programID, name.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setTexture(location, slot);
+            return setTexture(getTextureLocation(name), slot);
         }
 
         bool OGLShaderProgram::setBool(const std::string &name, bool value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setBool(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setBool(location, value);
+            return setBool(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setInt(const std::string &name, int value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setInt(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setInt(location, value);
+            return setInt(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setFloat(const std::string &name, float value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setFloat(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setFloat(location, value);
+            return setFloat(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setVec2(const std::string &name, const Vec2b &value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setVec2(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setVec2(location, value);
+            return setVec2(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setVec2(const std::string &name, const Vec2i &value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setVec2(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setVec2(location, value);
+            return setVec2(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setVec2(const std::string &name, const Vec2f &value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setVec2(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setVec2(location, value);
+            return setVec2(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setVec3(const std::string &name, const Vec3b &value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setVec3(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setVec3(location, value);
+            return setVec3(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setVec3(const std::string &name, const Vec3i &value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setVec3(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setVec3(location, value);
+            return setVec3(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setVec3(const std::string &name, const Vec3f &value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setVec3(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setVec3(location, value);
+            return setVec3(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setVec4(const std::string &name, const Vec4b &value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setVec4(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setVec4(location, value);
+            return setVec4(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setVec4(const std::string &name, const Vec4i &value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setVec4(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setVec4(location, value);
+            return setVec4(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setVec4(const std::string &name, const Vec4f &value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setVec4(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setVec4(location, value);
+            return setVec4(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setMat2(const std::string &name, const Mat2f &value) {
-            std::string prefixName = prefix + name;
             throw std::runtime_error("Not Implemented");
         }
 
         bool OGLShaderProgram::setMat3(const std::string &name, const Mat3f &value) {
-            std::string prefixName = prefix + name;
             throw std::runtime_error("Not Implemented");
         }
 
         bool OGLShaderProgram::setMat4(const std::string &name, const Mat4f &value) {
-            std::string prefixName = prefix + name;
-            auto it = locations.find(prefixName);
-            if (it != locations.end())
-                return setMat4(it->second, value);
-            GLint location = glGetUniformLocation(programID, prefixName.c_str());
-            checkGLError();
-            if (location >= 0)
-                locations[name] = location;
-            return setMat4(location, value);
+            return setMat4(getLocation(name), value);
         }
 
         bool OGLShaderProgram::setTexture(int location, int slot) {
@@ -446,6 +334,92 @@ namespace engine {
                 return true;
             }
         }
+
+        ShaderBufferLayout OGLShaderProgram::getShaderBufferLayout(const std::string &name) {
+            ShaderBufferLayout ret;
+
+            GLuint index = glGetUniformBlockIndex(programID, name.c_str());
+            if (index == GL_INVALID_INDEX)
+                return ret;
+
+            GLint size;
+            GLint memberCount;
+            glGetActiveUniformBlockiv(programID, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+            glGetActiveUniformBlockiv(programID, index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+
+            std::vector<GLint> members(memberCount);
+            glGetActiveUniformBlockiv(programID, index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, members.data());
+
+            std::vector<GLuint> indices(members.begin(), members.end());
+            std::vector<GLint> offsets(memberCount);
+            std::vector<GLint> arraySizes(memberCount);
+            std::vector<GLint> arrayStrides(memberCount);
+            glGetActiveUniformsiv(programID, memberCount, indices.data(), GL_UNIFORM_OFFSET, offsets.data());
+            glGetActiveUniformsiv(programID, memberCount, indices.data(), GL_UNIFORM_SIZE, arraySizes.data());
+            glGetActiveUniformsiv(programID, memberCount, indices.data(), GL_UNIFORM_ARRAY_STRIDE, arrayStrides.data());
+
+            GLint maxNameLength;
+            glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+            std::vector<GLchar> nameBuffer(maxNameLength + 1);
+
+            for (GLint i = 0; i < memberCount; i++) {
+                GLsizei length = 0;
+                glGetActiveUniformName(programID, indices.at(i), maxNameLength + 1, &length, nameBuffer.data());
+
+                std::string member(nameBuffer.data(), length);
+                auto offset = static_cast<size_t>(offsets.at(i));
+                ret.offsets[member] = offset;
+
+                // Arrays of basic types are reported once with the name of the first element eg. "values[0]"
+                if (arraySizes.at(i) > 1 && member.size() > 3 && member.compare(member.size() - 3, 3, "[0]") == 0) {
+                    auto base = member.substr(0, member.size() - 3);
+                    for (GLint y = 1; y < arraySizes.at(i); y++) {
+                        ret.offsets[base + "[" + std::to_string(y) + "]"] = offset + y * arrayStrides.at(i);
+                    }
+                }
+            }
+
+            checkGLError("OGLShaderProgram::getShaderBufferLayout");
+
+            ret.size = static_cast<size_t>(size);
+            return ret;
+        }
+
+        bool OGLShaderProgram::setShaderBuffer(const std::string &name, ShaderBuffer &buffer, int binding) {
+            auto it = blockIndices.find(name);
+            if (it == blockIndices.end())
+                it = blockIndices.emplace(name, glGetUniformBlockIndex(programID, name.c_str())).first;
+            if (it->second == GL_INVALID_INDEX)
+                return false;
+
+            auto &shaderBuffer = dynamic_cast<OGLShaderBuffer &>(buffer);
+            glUniformBlockBinding(programID, it->second, binding);
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding, shaderBuffer.UBO);
+            checkGLError();
+            return true;
+        }
+
+        GLint OGLShaderProgram::getLocation(const std::string &name) {
+            auto it = locations.find(name);
+            if (it != locations.end())
+                return it->second;
+            GLint location = glGetUniformLocation(programID, (prefix + name).c_str());
+            checkGLError();
+            // Missing uniforms are cached as well so that they are not queried on every call
+            locations[name] = location;
+            return location;
+        }
+
+        GLint OGLShaderProgram::getTextureLocation(const std::string &name) {
+            //Samplers do not appear to get merged into the global struct when cross compiling
+            auto it = textureLocations.find(name);
+            if (it != textureLocations.end())
+                return it->second;
+            GLint location = glGetUniformLocation(programID, name.c_str());
+            checkGLError();
+            textureLocations[name] = location;
+            return location;
+        }
     }
 }
 
@@ -21,7 +21,7 @@
 #define MANA_OGLSHADERPROGRAM_HPP
 
 #include <string>
-#include <map>
+#include <unordered_map>
 #include <functional>
 
 #include "platform/graphics/shaderprogram.hpp"
@@ -120,10 +120,22 @@ namespace engine {
 
             bool setMat4(int location, const Mat4f &value) override;
 
+            ShaderBufferLayout getShaderBufferLayout(const std::string &name) override;
+
+            bool setShaderBuffer(const std::string &name, ShaderBuffer &buffer, int binding) override;
+
         private:
             GLuint programID;
             std::string prefix;
-            std::map<std::string, GLint> locations;
+
+            // The resolved locations keyed by the unprefixed name, -1 if the program does not declare the uniform
+            std::unordered_map<std::string, GLint> locations;
+            std::unordered_map<std::string, GLint> textureLocations;
+            std::unordered_map<std::string, GLuint> blockIndices;
+
+            GLint getLocation(const std::string &name);
+
+            GLint getTextureLocation(const std::string &name);
         };
     }
 }
@@ -23,6 +23,8 @@
 #include "oglcheckerror.hpp"
 #include "ogltypeconverter.hpp"
 
+#include "asset/compressedimage.hpp"
+
 using namespace engine;
 using namespace engine::opengl;
 
@@ -51,7 +53,9 @@ OGLTextureBuffer::OGLTextureBuffer(Attributes attributes) : TextureBuffer(attrib
     }
     checkGLError("OGLTextureBuffer::OGLTextureBuffer()");
 
-    if (attributes.textureType == TEXTURE_2D) {
+    if (CompressedImage::isBlockCompressed(attributes.format)) {
+        //Storage for block compressed textures is allocated when uploading the compressed image
+    } else if (attributes.textureType == TEXTURE_2D) {
         GLuint texInternalFormat = OGLTypeConverter::convert(attributes.format);
         GLuint texFormat = GL_RGBA;
 
@@ -110,7 +114,9 @@ OGLTextureBuffer::OGLTextureBuffer(Attributes attributes) : TextureBuffer(attrib
     }
     checkGLError("OGLTextureBuffer::OGLTextureBuffer()");
 
-    if (type != GL_TEXTURE_2D_MULTISAMPLE && attributes.generateMipmap) {
+    if (type != GL_TEXTURE_2D_MULTISAMPLE
+        && attributes.generateMipmap
+        && !CompressedImage::isBlockCompressed(attributes.format)) {
         glGenerateMipmap(type);
         glTexParameteri(type, GL_TEXTURE_MIN_FILTER,
                         OGLTypeConverter::convert(attributes.mipmapFilter));
@@ -285,6 +291,76 @@ void OGLTextureBuffer::upload(const Image<unsigned char> &buffer) {
     checkGLError("OGLTextureBuffer::upload(unsigned char)");
 }
 
+void OGLTextureBuffer::upload(const CompressedImage &image) {
+    uploadMipLevels(image, 0);
+}
+
+void OGLTextureBuffer::uploadMipLevels(const CompressedImage &image, int baseLevel) {
+    auto levelCount = static_cast<int>(image.levels.size());
+    if (levelCount == 0)
+        throw std::runtime_error("Compressed image has no levels");
+    if (baseLevel < 0 || baseLevel >= levelCount)
+        throw std::runtime_error("Invalid compressed image base level");
+
+    int endLevel = levelCount;
+
+    bool resident = uploadedLevel >= 0
+                    && attributes.textureType == TEXTURE_2D
+                    && attributes.format == image.format
+                    && attributes.size == image.size;
+
+    attributes.format = image.format;
+    attributes.size = image.size;
+
+    setTextureType(TextureBuffer::TEXTURE_2D);
+
+    if (resident && baseLevel <= uploadedLevel) {
+        //The levels starting at the current base level are already uploaded
+        endLevel = uploadedLevel;
+    } else if (resident) {
+        //Recreate the texture to release the memory of the levels below the new base level
+        glDeleteTextures(1, &handle);
+        glGenTextures(1, &handle);
+        glBindTexture(GL_TEXTURE_2D, handle);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, OGLTypeConverter::convert(attributes.wrapping));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, OGLTypeConverter::convert(attributes.wrapping));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, OGLTypeConverter::convert(attributes.filterMag));
+    }
+
+    glBindTexture(GL_TEXTURE_2D, handle);
+    for (int level = baseLevel; level < endLevel; level++) {
+        auto size = image.getLevelSize(level);
+        auto &data = image.levels.at(level);
+        if (data.size() != CompressedImage::getDataSize(image.format, size))
+            throw std::runtime_error("Invalid compressed image level size");
+        glCompressedTexImage2D(GL_TEXTURE_2D,
+                               level,
+                               OGLTypeConverter::convert(attributes.format),
+                               size.x,
+                               size.y,
+                               0,
+                               static_cast<GLsizei>(data.size()),
+                               data.data());
+    }
+
+    //The mip chain is precomputed, limit sampling to the uploaded levels instead of generating mipmaps.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    if (baseLevel < levelCount - 1) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        OGLTypeConverter::convert(attributes.mipmapFilter));
+    } else {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        OGLTypeConverter::convert(attributes.filterMin));
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    uploadedLevel = baseLevel;
+
+    checkGLError("OGLTextureBuffer::uploadMipLevels");
+}
+
 engine::Image<ColorRGBA> OGLTextureBuffer::download() {
     if (attributes.textureType != TEXTURE_2D)
         throw std::runtime_error("TextureBuffer not texture 2d");
@@ -374,7 +450,9 @@ void OGLTextureBuffer::setTextureType(TextureType t) {
                         OGLTypeConverter::convert(attributes.filterMag));
         checkGLError("OGLTextureBuffer::OGLTextureBuffer()");
 
-        if (attributes.textureType == TEXTURE_2D) {
+        if (CompressedImage::isBlockCompressed(attributes.format)) {
+            //Storage for block compressed textures is allocated when uploading the compressed image
+        } else if (attributes.textureType == TEXTURE_2D) {
             GLuint texInternalFormat = OGLTypeConverter::convert(attributes.format);
             GLuint texFormat = GL_RGBA;
 
@@ -418,7 +496,7 @@ void OGLTextureBuffer::setTextureType(TextureType t) {
         }
         checkGLError("OGLTextureBuffer::OGLTextureBuffer()");
 
-        if (attributes.generateMipmap) {
+        if (attributes.generateMipmap && !CompressedImage::isBlockCompressed(attributes.format)) {
             glGenerateMipmap(type);
             glTexParameteri(type, GL_TEXTURE_MIN_FILTER,
                             OGLTypeConverter::convert(attributes.mipmapFilter));
@@ -21,6 +21,7 @@
 #define MANA_OGLTYPECONVERTER_HPP
 
 #include "platform/graphics/rendercommand.hpp"
+#include "platform/graphics/renderallocator.hpp"
 
 #include "openglinclude.hpp"
 
@@ -54,6 +55,8 @@ namespace engine {
             GLint convert(TextureBuffer::TextureFiltering filtering);
 
             GLint convert(TextureBuffer::MipMapFiltering filtering);
+
+            GLenum convert(RenderAllocator::CustomMeshDefinition::AttributeType type);
         }
     }
 }
@@ -25,6 +25,7 @@
 #include "async/threadpool.hpp"
 #include "platform/graphics/shadercompiler.hpp"
 #include "platform/graphics/shadercompiler.hpp"
+#include "asset/vertexpacking.hpp"
 
 static const char *SHADER_VERT = R"###(
 float4x4 MODEL_MATRIX;
@@ -169,6 +170,18 @@ namespace engine {
         });
     }
 
+    /**
+     * Allocate a mesh buffer which only stores the position and uv of the 2d mesh.
+     *
+     * @param allocator
+     * @param mesh
+     * @return
+     */
+    static std::unique_ptr<MeshBuffer> createMeshBuffer(RenderAllocator &allocator, const Mesh &mesh) {
+        auto packed = VertexPacking::pack(mesh, VertexPacking::POSITION_UV);
+        return allocator.createCustomMeshBuffer(packed.getDefinition());
+    }
+
     Renderer2D::Renderer2D(RenderDevice &device)
             : renderDevice(device) {
         vs = ShaderSource(SHADER_VERT, "main", VERTEX, HLSL_SHADER_MODEL_4);
@@ -232,7 +245,7 @@ namespace engine {
                           float rotation) {
         Mesh mesh = getPlane(dstRect.dimensions, center, srcRect);
 
-        MeshBuffer &buffer = **allocatedMeshes.insert(renderDevice.getAllocator().createMeshBuffer(mesh)).first;
+        MeshBuffer &buffer = **allocatedMeshes.insert(createMeshBuffer(renderDevice.getAllocator(), mesh)).first;
 
         Mat4f modelMatrix = MatrixMath::identity();
         modelMatrix = modelMatrix * MatrixMath::translate(Vec3f(
@@ -274,7 +287,7 @@ namespace engine {
         else
             mesh = getSquare(rectangle.dimensions, center);
 
-        MeshBuffer &buffer = **allocatedMeshes.insert(renderDevice.getAllocator().createMeshBuffer(mesh)).first;
+        MeshBuffer &buffer = **allocatedMeshes.insert(createMeshBuffer(renderDevice.getAllocator(), mesh)).first;
 
         Mat4f modelMatrix = MatrixMath::identity();
         modelMatrix = modelMatrix * MatrixMath::translate(Vec3f(
@@ -307,7 +320,7 @@ namespace engine {
                           float rotation) {
         Mesh mesh = getLine(start, end, center);
 
-        auto it = allocatedMeshes.insert(renderDevice.getAllocator().createMeshBuffer(mesh));
+        auto it = allocatedMeshes.insert(createMeshBuffer(renderDevice.getAllocator(), mesh));
 
         MeshBuffer &buffer = **it.first;
 
@@ -336,7 +349,7 @@ namespace engine {
                 Vertex(Vec3f(point.x, point.y, 0))
         });
 
-        MeshBuffer &buffer = **allocatedMeshes.insert(renderDevice.getAllocator().createMeshBuffer(mesh)).first;
+        MeshBuffer &buffer = **allocatedMeshes.insert(createMeshBuffer(renderDevice.getAllocator(), mesh)).first;
 
         Mat4f modelMatrix = MatrixMath::identity();
         modelMatrix = camera.projection() * camera.view() * modelMatrix;
@@ -377,7 +390,7 @@ namespace engine {
 
             Mesh mesh = getPlane(Vec2f(w, h), Vec2f(), Rectf(Vec2f(), Vec2f(w, h)));
 
-            MeshBuffer &buffer = **allocatedMeshes.insert(renderDevice.getAllocator().createMeshBuffer(mesh)).first;
+            MeshBuffer &buffer = **allocatedMeshes.insert(createMeshBuffer(renderDevice.getAllocator(), mesh)).first;
 
             Mat4f modelMatrix = MatrixMath::identity();
             modelMatrix = modelMatrix * MatrixMath::translate(Vec3f(xpos, ypos, 0));
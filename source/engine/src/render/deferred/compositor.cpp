@@ -17,6 +17,8 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <set>
+
 #include "render/deferred/compositor.hpp"
 
 static const char *SHADER_VERT = R"###(#version 460 core
@@ -24,9 +26,8 @@ static const char *SHADER_VERT = R"###(#version 460 core
 #define MAX_COLOR 15
 
 struct Layer {
-    int MSAA_SAMPLES;
-    sampler2DMS color;
-    sampler2DMS depth;
+    sampler2D color;
+    sampler2D depth;
     int has_depth;
 };
 
@@ -63,9 +64,8 @@ static const char *SHADER_FRAG = R"###(#version 460 core
 #define MAX_COLOR 15
 
 struct Layer {
-    int MSAA_SAMPLES;
-    sampler2DMS color;
-    sampler2DMS depth;
+    sampler2D color;
+    sampler2D depth;
     int has_depth;
 };
 
@@ -85,26 +85,21 @@ vec4 blend(vec4 colorA, vec4 colorB)
     return vec4((colorB.rgb * colorB.a + colorA.rgb * (1.0 - colorB.a)).rgb, 1);
 }
 
-vec4 msaaAverage(sampler2DMS color, vec2 uv)
+// The layer textures are resolved before compositing
+vec4 fetch(sampler2D tex, vec2 uv)
 {
-    vec4 ret;
-    ivec2 size = textureSize(color);
-    ivec2 pos = ivec2(size.x * uv.x, size.y * uv.y);
-    for(int i = 0; i < globals.layer.MSAA_SAMPLES; i++)
-    {
-        ret += texelFetch(color, pos, i);
-    }
-    return ret / globals.layer.MSAA_SAMPLES;
+    ivec2 size = textureSize(tex, 0);
+    return texelFetch(tex, ivec2(size.x * uv.x, size.y * uv.y), 0);
 }
 
 void main()
 {
-    vec4 color = msaaAverage(globals.layer.color, fUv);
+    vec4 color = fetch(globals.layer.color, fUv);
     float depth = 0;
 
     if (globals.layer.has_depth != 0)
     {
-        depth = msaaAverage(globals.layer.depth, fUv).r;
+        depth = fetch(globals.layer.depth, fUv).r;
     }
 
     fragColor = color;
@@ -142,6 +137,8 @@ namespace engine {
         if (layers.empty())
             return;
 
+        resolveBuffers(buffer, layers);
+
         shader->activate();
 
         for (auto &layer: layers) {
@@ -149,6 +146,64 @@ namespace engine {
         }
     }
 
+    void Compositor::resolveBuffers(GeometryBuffer &buffer, const std::vector<Layer> &pLayers) {
+        std::set<std::string> names;
+        for (auto &layer: pLayers) {
+            names.insert(layer.color);
+            if (!layer.depth.empty())
+                names.insert(layer.depth);
+        }
+
+        auto &allocator = device.getAllocator();
+        auto size = buffer.getSize();
+
+        if (resolveTarget == nullptr || resolveTarget->getSize() != size) {
+            resolveTarget = allocator.createRenderTarget(size, 1);
+            resolvedBuffers.clear();
+        }
+
+        for (auto &name: names) {
+            auto &source = buffer.getBuffer(name);
+            auto &sourceAttributes = source.getAttributes();
+
+            // Buffers which are not multisampled, like the fixed buffers, are sampled directly
+            if (sourceAttributes.textureType != TextureBuffer::TEXTURE_2D_MULTISAMPLE) {
+                resolvedBuffers.erase(name);
+                continue;
+            }
+
+            auto &resolved = resolvedBuffers[name];
+            if (resolved == nullptr || resolved->getAttributes().format != sourceAttributes.format) {
+                TextureBuffer::Attributes attributes;
+                attributes.size = size;
+                attributes.format = sourceAttributes.format;
+                attributes.filterMin = TextureBuffer::NEAREST;
+                attributes.filterMag = TextureBuffer::NEAREST;
+                attributes.generateMipmap = false;
+                resolved = allocator.createTextureBuffer(attributes);
+            }
+
+            if (sourceAttributes.format == TextureBuffer::DEPTH_STENCIL) {
+                buffer.attachDepthStencil(name);
+                resolveTarget->attachDepthStencil(*resolved);
+                resolveTarget->blitDepth(buffer.getRenderTarget(), {}, {}, size, size);
+                resolveTarget->detachDepthStencil();
+            } else {
+                buffer.attachColor({name});
+                resolveTarget->attachColor(0, *resolved);
+                resolveTarget->blitColor(buffer.getRenderTarget(), {}, {}, size, size, TextureBuffer::NEAREST, 0, 0);
+                resolveTarget->detachColor(0);
+            }
+        }
+    }
+
+    TextureBuffer &Compositor::getResolvedBuffer(GeometryBuffer &buffer, const std::string &name) {
+        auto it = resolvedBuffers.find(name);
+        if (it == resolvedBuffers.end())
+            return buffer.getBuffer(name);
+        return *it->second;
+    }
+
     void Compositor::drawLayer(RenderTarget &screen,
                                GeometryBuffer &buffer,
                                const Compositor::Layer &layer) {
@@ -158,17 +213,15 @@ namespace engine {
 
         std::vector<std::reference_wrapper<TextureBuffer>> textures;
 
-        textures.emplace_back(buffer.getBuffer(layer.color));
+        textures.emplace_back(getResolvedBuffer(buffer, layer.color));
         assert(shader->setTexture(prefix + ".color", 0));
 
         assert(shader->setInt(prefix + ".has_depth", !layer.depth.empty()));
         if (!layer.depth.empty()) {
-            textures.emplace_back(buffer.getBuffer(layer.depth));
+            textures.emplace_back(getResolvedBuffer(buffer, layer.depth));
             assert(shader->setTexture(prefix + ".depth", 1));
         }
 
-        assert(shader->setInt("globals.layer.MSAA_SAMPLES", textures.at(0).get().getAttributes().samples));
-
         RenderCommand command(*shader, buffer.getScreenQuad());
         command.textures = textures;
 
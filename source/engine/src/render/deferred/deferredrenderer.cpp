@@ -27,17 +27,23 @@ namespace engine {
             : passes(),
               geometryBuffer(device.getAllocator()),
               compositor(device, {}),
-              assetRenderManager(assetRenderManager) {}
+              assetRenderManager(assetRenderManager),
+              instanceBuffer(device.getAllocator().createInstanceBuffer()) {}
 
     DeferredRenderer::~DeferredRenderer() = default;
 
     void DeferredRenderer::render(RenderTarget &target,
                                   Scene &scene) {
+        batchDeferredNodes(scene);
+
         for (auto &pass: passOrder) {
             passes.at(pass)->render(geometryBuffer, scene, assetRenderManager);
         }
 
         compositor.presentLayers(target, geometryBuffer);
+
+        // Apply the texture coverage reported by the passes
+        assetRenderManager.getTextureStreamer().update();
     }
 
     GeometryBuffer &DeferredRenderer::getGeometryBuffer() {
@@ -52,4 +58,47 @@ namespace engine {
         passes.clear();
         passOrder.clear();
     }
+
+    void DeferredRenderer::batchDeferredNodes(Scene &scene) {
+        meshIds.clear();
+        materialIds.clear();
+        batchIds.clear();
+        scene.deferredBatches.clear();
+
+        // Assign the nodes to batches in order of first appearance
+        nodeBatches.resize(scene.deferred.size());
+        for (size_t i = 0; i < scene.deferred.size(); i++) {
+            auto &node = scene.deferred.at(i);
+            auto meshId = meshIds.emplace(node.mesh.getPath(), meshIds.size()).first->second;
+            auto materialId = materialIds.emplace(node.material.getPath(), materialIds.size()).first->second;
+
+            auto key = (static_cast<uint64_t>(meshId) << 32) | materialId;
+            auto it = batchIds.emplace(key, scene.deferredBatches.size());
+            if (it.second)
+                scene.deferredBatches.emplace_back(Scene::DeferredBatch{0, 0});
+
+            scene.deferredBatches.at(it.first->second).count++;
+            nodeBatches.at(i) = it.first->second;
+        }
+
+        size_t offset = 0;
+        for (auto &batch: scene.deferredBatches) {
+            batch.offset = offset;
+            offset += batch.count;
+            batch.count = 0;
+        }
+
+        // Store the nodes contiguously per batch
+        scene.deferredBatchNodes.resize(scene.deferred.size());
+        instanceMatrices.resize(scene.deferred.size());
+        for (size_t i = 0; i < scene.deferred.size(); i++) {
+            auto &batch = scene.deferredBatches.at(nodeBatches.at(i));
+            auto index = batch.offset + batch.count++;
+            scene.deferredBatchNodes.at(index) = i;
+            instanceMatrices.at(index) = scene.deferred.at(i).transform.model();
+        }
+
+        instanceBuffer->upload(instanceMatrices);
+        scene.deferredInstances = instanceBuffer.get();
+    }
 }
\ No newline at end of file
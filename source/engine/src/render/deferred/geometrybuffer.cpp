@@ -19,6 +19,8 @@
 
 #include "render/deferred/geometrybuffer.hpp"
 
+#include "asset/vertexpacking.hpp"
+
 namespace engine {
     GeometryBuffer::GeometryBuffer(RenderAllocator &allocator, Vec2i size, int samples)
             : renderAllocator(allocator), size(size), samples(samples) {
@@ -39,7 +41,9 @@ namespace engine {
                                     Vertex({-1, -1, 0}, {0, 0})
                             });
 
-        screenQuad = allocator.createMeshBuffer(quadMesh);
+        // The screen quad shaders only read position and uv
+        auto packedQuad = VertexPacking::pack(quadMesh, VertexPacking::POSITION_UV);
+        screenQuad = allocator.createCustomMeshBuffer(packedQuad.getDefinition());
     }
 
     GeometryBuffer::~GeometryBuffer() {
@@ -80,7 +84,7 @@ namespace engine {
     void GeometryBuffer::addBuffer(const std::string &name, TextureBuffer::ColorFormat format) {
         auto it = buffers.find(name);
         if (it != buffers.end()) {
-            if (it->second->getAttributes().format != format)
+            if (fixedBuffers.find(name) != fixedBuffers.end() || it->second->getAttributes().format != format)
                 throw std::runtime_error("Buffer with different format already exists " + name);
             return;
         }
@@ -93,6 +97,22 @@ namespace engine {
         formats[name] = format;
     }
 
+    void GeometryBuffer::addBuffer(const std::string &name, const TextureBuffer::Attributes &attributes) {
+        auto it = buffers.find(name);
+        if (it != buffers.end()) {
+            auto &existing = it->second->getAttributes();
+            if (fixedBuffers.find(name) == fixedBuffers.end()
+                || existing.textureType != attributes.textureType
+                || existing.size != attributes.size
+                || existing.format != attributes.format)
+                throw std::runtime_error("Buffer with different attributes already exists " + name);
+            return;
+        }
+
+        buffers[name] = renderAllocator.createTextureBuffer(attributes);
+        fixedBuffers.insert(name);
+    }
+
     TextureBuffer &GeometryBuffer::getBuffer(const std::string &name) {
         return *buffers.at(name);
     }
@@ -142,6 +162,8 @@ namespace engine {
 
         //Reallocate objects
         for (auto &buf: buffers) {
+            if (fixedBuffers.find(buf.first) != fixedBuffers.end())
+                continue;
             TextureBuffer::Attributes attr;
             attr.textureType = TextureBuffer::TEXTURE_2D_MULTISAMPLE;
             attr.size = size;
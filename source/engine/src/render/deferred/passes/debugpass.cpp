@@ -22,6 +22,8 @@
 #include "render/deferred/deferredrenderer.hpp"
 #include "render/shader/shaderinclude.hpp"
 
+#include <limits>
+
 #include "math/rotation.hpp"
 #include "async/threadpool.hpp"
 #include "platform/graphics/shadercompiler.hpp"
@@ -576,6 +578,9 @@ namespace engine {
                                       false,
                                       false));
 
+        //The normal texture is sampled at the vertices, request all mip levels.
+        auto &textureStreamer = assetRenderManager.getTextureStreamer();
+
         shaderNormals->activate();
         for (Scene::DeferredDrawNode &deferredCommand: scene.deferred) {
             if (!shaderNormals->setFloat("globals.scale", 0.1f))
@@ -591,6 +596,8 @@ namespace engine {
             if (!deferredCommand.material.get().normalTexture.empty()) {
                 shaderNormals->setBool("globals.hasNormalTexture", true);
                 shaderNormals->setTexture("normal", 0);
+                textureStreamer.request(deferredCommand.material.get().normalTexture,
+                                        std::numeric_limits<float>::max());
                 command.textures.emplace_back(
                         assetRenderManager.get<TextureBuffer>(deferredCommand.material.get().normalTexture));
             } else {
@@ -19,6 +19,8 @@
 
 #include "render/deferred/passes/forwardpass.hpp"
 
+#include <limits>
+
 #include "render/forward/forwardrenderer.hpp"
 
 namespace engine {
@@ -38,6 +40,15 @@ namespace engine {
     void ForwardPass::render(GeometryBuffer &gBuffer, Scene &scene, AssetRenderManager &assetRenderManager) {
         gBuffer.attachColor({COLOR});
         gBuffer.attachDepthStencil(DEPTH);
+
+        //The screen coverage of forward textures is unknown, request all mip levels.
+        auto &textureStreamer = assetRenderManager.getTextureStreamer();
+        for (auto &node: scene.forward) {
+            for (auto &texture: node.textures) {
+                textureStreamer.request(texture.getPath(), std::numeric_limits<float>::max());
+            }
+        }
+
         ForwardRenderer::renderScene(device.getRenderer(), gBuffer.getRenderTarget(), scene);
     }
 }
\ No newline at end of file
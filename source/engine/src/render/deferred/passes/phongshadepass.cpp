@@ -17,173 +17,317 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <cstring>
+
 #include "platform/graphics/shadercompiler.hpp"
 #include "render/shader/shaderinclude.hpp"
 #include "render/deferred/passes/phongshadepass.hpp"
 #include "render/deferred/deferredrenderer.hpp"
 #include "math/rotation.hpp"
+#include "render/deferred/passes/shadowpass.hpp"
+#include "render/deferred/passes/prepass.hpp"
+#include "math/matrixmath.hpp"
 #include "async/threadpool.hpp"
 
-const char *SHADER_VERT_LIGHTING = R"###(
-struct VS_INPUT
-{
-    float3 position : POSITION0;
-    float3 normal : NORMAL;
-    float2 uv : TEXCOORD0;
-    float3 tangent: TANGENT;
-    float3 bitangent: BINORMAL;
-    float4 instanceRow0 : POSITION1;
-    float4 instanceRow1 : POSITION2;
-    float4 instanceRow2 : POSITION3;
-    float4 instanceRow3 : POSITION4;
-};
-
-struct VS_OUTPUT
-{
-    float3  fPos : POSITION;
-    float3  fNorm : NORMAL;
-    float2  fUv : TEXCOORD0;
-    float4 vPos : SV_Position;
-};
+static const char *SHADER_VERT_LIGHTING = R"###(#version 460
 
-VS_OUTPUT main(const VS_INPUT v)
+layout (location = 0) in vec3 vPosition;
+layout (location = 2) in vec2 vUv;
+
+layout (location = 0) out vec2 fUv;
+
+void main()
 {
-    VS_OUTPUT ret;
+    fUv = vUv;
+    gl_Position = vec4(vPosition, 1);
+}
+)###";
 
-    ret.fPos = v.position;
-    ret.fNorm = v.normal;
-    ret.fUv = v.uv;
+static const char *SHADER_FRAG_LIGHTING = R"###(#version 460
 
-    ret.vPos = float4(v.position, 1);
+#include "phong.glsl"
+#include "gbuffer.glsl"
 
-    return ret;
+layout (location = 0) in vec2 fUv;
+
+layout (location = 0) out vec4 phong_ambient;
+layout (location = 1) out vec4 phong_diffuse;
+layout (location = 2) out vec4 phong_specular;
+layout (location = 3) out vec4 phong_combined;
+
+layout (location = 0) uniform sampler2DMS normal;
+layout (location = 1) uniform sampler2DMS diffuse;
+layout (location = 2) uniform sampler2DMS material;
+layout (location = 3) uniform sampler2DMS depth;
+
+layout (location = 9) uniform vec3 VIEW_POS;
+
+// The point and spot lights are assigned to view frustum clusters by LightClustering
+layout (location = 10) uniform usamplerBuffer CLUSTERS;
+layout (location = 11) uniform samplerBuffer LIGHTS;
+layout (location = 12) uniform mat4 VIEW;
+layout (location = 13) uniform ivec3 CLUSTER_GRID;
+layout (location = 14) uniform vec2 CLUSTER_DEPTH; // The scale and bias of the logarithmic depth slices
+
+// The shadow maps rendered by the ShadowPass, each tile is stored as SHADOW_TILE_TEXELS texels in SHADOW_TILES
+layout (location = 15) uniform sampler2D SHADOW_ATLAS;
+layout (location = 16) uniform samplerBuffer SHADOW_TILES;
+layout (location = 17) uniform int SHADOW_CASCADE_LIGHT; // The index of the directional light with cascades or -1
+layout (location = 18) uniform int SHADOW_CASCADE_TILE;
+layout (location = 19) uniform vec4 SHADOW_CASCADE_SPLITS;
+
+layout (location = 20) uniform mat4 INVERSE_VIEW_PROJECTION;
+layout (location = 21) uniform int PER_SAMPLE; // Set for the edge pixels marked in the stencil buffer
+
+const int LIGHT_TEXELS = 7;
+const int SHADOW_TILE_TEXELS = 6;
+const float SHADOW_NORMAL_OFFSET = 1.5; // In shadow map texels
+const float SHADOW_DEPTH_BIAS = 0.0005; // Applied to orthographic tiles only, the depth of perspective tiles is not linear
+
+int getCluster(vec3 worldPosition)
+{
+    float depth = max(-(VIEW * vec4(worldPosition, 1)).z, 0.0001);
+    int slice = clamp(int(floor(log(depth) * CLUSTER_DEPTH.x - CLUSTER_DEPTH.y)), 0, CLUSTER_GRID.z - 1);
+    ivec2 tile = clamp(ivec2(fUv * CLUSTER_GRID.xy), ivec2(0), CLUSTER_GRID.xy - 1);
+    return (slice * CLUSTER_GRID.y + tile.y) * CLUSTER_GRID.x + tile.x;
 }
-)###";
 
-const char *SHADER_FRAG_LIGHTING = R"###(
-#include "phong.hlsl"
-
-struct PS_INPUT {
-    float3 fPos: POSITION;
-    float3 fNorm: NORMAL;
-    float2 fUv: TEXCOORD0;
-};
-
-struct PS_OUTPUT {
-    float4 phong_ambient: SV_TARGET0;
-    float4 phong_diffuse: SV_TARGET1;
-    float4 phong_specular: SV_TARGET2;
-    float4 phong_combined: SV_TARGET3;
-};
-
-Texture2DMS<float4> position;
-Texture2DMS<float4> normal;
-Texture2DMS<float4> tangent;
-Texture2DMS<float4> texNormal;
-Texture2DMS<float4> diffuse;
-Texture2DMS<float4> ambient;
-Texture2DMS<float4> specular;
-Texture2DMS<float4> shininess;
-Texture2DMS<float4> depth;
-
-float3 VIEW_POS;
-
-float4 averageMsaa(Texture2DMS<float4> tex, int2 coord, int samples)
+// Returns the lit fraction of the 3x3 shadow map texels around the projected position
+float sampleShadowTile(int tile, vec3 worldPosition, vec3 worldNormal, vec3 lightPosition)
 {
-    float4 ret;
-    for (int i = 0; i < samples; i++) {
-        ret += tex.Load(coord, i);
+    int base = tile * SHADOW_TILE_TEXELS;
+    mat4 matrix = mat4(texelFetch(SHADOW_TILES, base),
+                       texelFetch(SHADOW_TILES, base + 1),
+                       texelFetch(SHADOW_TILES, base + 2),
+                       texelFetch(SHADOW_TILES, base + 3));
+    vec4 bounds = texelFetch(SHADOW_TILES, base + 4);
+    vec4 texelScale = texelFetch(SHADOW_TILES, base + 5);
+
+    // Offset the position along the normal by the world space size of a texel to avoid self shadowing
+    bool perspective = texelScale.y != 0;
+    float texelSize = perspective ? texelScale.x * length(worldPosition - lightPosition) : texelScale.x;
+    vec4 coord = matrix * vec4(worldPosition + worldNormal * texelSize * SHADOW_NORMAL_OFFSET, 1);
+    if (coord.w <= 0)
+        return 1;
+    coord.xyz /= coord.w;
+    if (coord.z >= 1)
+        return 1;
+
+    float depth = perspective ? coord.z : coord.z - SHADOW_DEPTH_BIAS;
+
+    // Clamp the filter to the tile so that the neighbouring tiles of the atlas are not sampled
+    vec2 texel = 1.0 / vec2(textureSize(SHADOW_ATLAS, 0));
+    vec2 minCoord = bounds.xy + texel * 0.5;
+    vec2 maxCoord = bounds.zw - texel * 0.5;
+
+    float lit = 0;
+    for (int x = -1; x <= 1; x++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            vec2 uv = clamp(coord.xy + vec2(x, y) * texel, minCoord, maxCoord);
+            lit += depth > texture(SHADOW_ATLAS, uv).r ? 0.0 : 1.0;
+        }
     }
-    return ret / samples;
+    return lit / 9;
 }
 
-float4 averageMsaaDepth(Texture2DMS<float4> tex, Texture2DMS<float4> depthTexture, int2 coord, int samples)
+float getDirectionalShadow(vec3 worldPosition, vec3 worldNormal)
 {
-    float4 ret;
-    int nSample = 0;
-    for (int i = 0; i < samples; i++) {
-        if (depthTexture.Load(coord, i).r < 1) {
-            ret += tex.Load(coord, i);
-            nSample++;
-        }
+    float depth = -(VIEW * vec4(worldPosition, 1)).z;
+    for (int i = 0; i < 4; i++)
+    {
+        if (depth < SHADOW_CASCADE_SPLITS[i])
+            return sampleShadowTile(SHADOW_CASCADE_TILE + i, worldPosition, worldNormal, vec3(0));
+    }
+    return 1;
+}
+
+float getLocalShadow(int tile, bool point, vec3 lightPosition, vec3 worldPosition, vec3 worldNormal)
+{
+    if (point)
+    {
+        // The cube faces are stored as +x, -x, +y, -y, +z, -z, select the face of the major axis
+        vec3 direction = worldPosition - lightPosition;
+        vec3 absDirection = abs(direction);
+        if (absDirection.x >= absDirection.y && absDirection.x >= absDirection.z)
+            tile += direction.x > 0 ? 0 : 1;
+        else if (absDirection.y >= absDirection.z)
+            tile += direction.y > 0 ? 2 : 3;
+        else
+            tile += direction.z > 0 ? 4 : 5;
     }
-    return ret / nSample;
+    return sampleShadowTile(tile, worldPosition, worldNormal, lightPosition);
 }
 
-LightComponents getAveragedLightComponents(int2 coord, int samples)
+LightComponents calculateLight(int cluster, vec3 fPos, vec3 fNorm, vec4 fDiffuse, vec4 fSpecular, float shininess, vec3 viewPosition)
 {
-    //Per pixel lighting, this could produce artifacts where two primitives overlap a pixel and different samples belong to different primitives.
-    float3 fragPosition = averageMsaaDepth(position, depth, coord, samples).xyz;
-    float3 fragNormal = averageMsaaDepth(normal, depth, coord, samples).xyz;
-    float3 fragTangent = averageMsaaDepth(tangent, depth, coord, samples).xyz;
-    float4 fragDiffuse = averageMsaa(diffuse, coord, samples);
-    float4 fragSpecular = averageMsaa(specular, coord, samples);
-    float fragShininess = averageMsaa(shininess, coord, samples).r;
-    float3 fragTexNormal = averageMsaaDepth(texNormal, depth, coord, samples).xyz;
-
-    if (length(fragTexNormal) > 0)
+    mat3 lightTransformation = mat3(1);
+
+    LightComponents ret = LightComponents(vec3(0), vec3(0), vec3(0));
+
+    for (int i = 0; i < DIRECTIONAL_LIGHTS_COUNT; i++)
     {
-        // Calculate lighting in tangent space, does not output correct value
-        float3x3 TBN = transpose(float3x3(cross(fragNormal, normalize(fragTangent - dot(fragTangent, fragNormal) * fragNormal)), fragTangent, fragNormal));
-
-        return mana_calculate_light(fragPosition * TBN,
-                                    fragTexNormal,
-                                    fragDiffuse,
-                                    fragSpecular,
-                                    fragShininess,
-                                    VIEW_POS * TBN,
-                                    TBN);
+        LightComponents comp = mana_calculate_directional_light(DIRECTIONAL_LIGHTS[i], fPos, fNorm, fDiffuse, fSpecular, shininess, viewPosition, lightTransformation);
+        float shadow = i == SHADOW_CASCADE_LIGHT ? getDirectionalShadow(fPos, fNorm) : 1.0;
+
+        ret.ambient += comp.ambient;
+        ret.diffuse += comp.diffuse * shadow;
+        ret.specular += comp.specular * shadow;
     }
-    else
+
+    int offset = int(texelFetch(CLUSTERS, cluster * 2).r);
+    int count = int(texelFetch(CLUSTERS, cluster * 2 + 1).r);
+    for (int i = 0; i < count; i++)
     {
-        // Calculate lighting in world space
-        return mana_calculate_light(fragPosition,
-                                fragNormal,
-                                fragDiffuse,
-                                fragSpecular,
-                                fragShininess,
-                                VIEW_POS,
-                                float3x3(1));
+        int base = int(texelFetch(CLUSTERS, offset + i).r) * LIGHT_TEXELS;
+        vec4 positionType = texelFetch(LIGHTS, base);
+        vec4 directionCutOff = texelFetch(LIGHTS, base + 1);
+        vec4 attenuation = texelFetch(LIGHTS, base + 2);
+        vec3 ambient = texelFetch(LIGHTS, base + 3).rgb;
+        vec3 diffuse = texelFetch(LIGHTS, base + 4).rgb;
+        vec3 specular = texelFetch(LIGHTS, base + 5).rgb;
+        int shadowTile = int(texelFetch(LIGHTS, base + 6).r);
+
+        LightComponents comp;
+        if (positionType.w == 0)
+        {
+            PointLight light = PointLight(positionType.xyz, attenuation.x, attenuation.y, attenuation.z, ambient, diffuse, specular);
+            comp = mana_calculate_point_light(light, fPos, fNorm, fDiffuse, fSpecular, shininess, viewPosition, lightTransformation);
+        }
+        else
+        {
+            SpotLight light = SpotLight(positionType.xyz, directionCutOff.xyz, directionCutOff.w, attenuation.w, attenuation.x, attenuation.y, attenuation.z, ambient, diffuse, specular);
+            comp = mana_calculate_spot_light(light, fPos, fNorm, fDiffuse, fSpecular, shininess, viewPosition, lightTransformation);
+        }
+
+        float shadow = shadowTile >= 0 ? getLocalShadow(shadowTile, positionType.w == 0, positionType.xyz, fPos, fNorm) : 1.0;
+
+        ret.ambient += comp.ambient;
+        ret.diffuse += comp.diffuse * shadow;
+        ret.specular += comp.specular * shadow;
     }
+
+    return ret;
 }
 
-//Returns a float between 0 and 1 indicating how many samples are covered for the given fragment coordinates
-float getSampleCoverage(int2 coord, int samples)
+// Shade a single sample of the geometry buffer
+LightComponents shadeSample(ivec2 coord, int sampleIndex, float sampleDepth)
 {
+    vec2 uv = (vec2(coord) + 0.5) / vec2(textureSize(depth));
+
+    vec3 fragPosition = reconstructPosition(uv, sampleDepth, INVERSE_VIEW_PROJECTION);
+    vec3 fragNormal = decodeNormal(texelFetch(normal, coord, sampleIndex).xy);
+    vec4 fragDiffuse = texelFetch(diffuse, coord, sampleIndex);
+    vec4 fragMaterial = texelFetch(material, coord, sampleIndex);
+
+    return calculateLight(getCluster(fragPosition),
+                          fragPosition,
+                          fragNormal,
+                          fragDiffuse,
+                          vec4(fragMaterial.rgb, 1),
+                          decodeShininess(fragMaterial.a),
+                          VIEW_POS);
+}
+
+void main() {
+    ivec2 coord = ivec2(fUv * textureSize(depth));
+    int samples = textureSamples(depth);
+
+    // The samples of simple pixels are equal and shaded once, edge pixels are shaded for each covered sample
+    int shadedSamples = PER_SAMPLE != 0 ? samples : 1;
+
+    LightComponents comp = LightComponents(vec3(0), vec3(0), vec3(0));
     int coveredSamples = 0;
-    for (int i = 0; i < samples; i++)
+    for (int i = 0; i < shadedSamples; i++)
     {
-        float sampleDepth = depth.Load(coord, i);
+        float sampleDepth = texelFetch(depth, coord, i).r;
         if (sampleDepth < 1)
         {
+            LightComponents sampleComp = shadeSample(coord, i, sampleDepth);
+            comp.ambient += sampleComp.ambient;
+            comp.diffuse += sampleComp.diffuse;
+            comp.specular += sampleComp.specular;
             coveredSamples++;
         }
     }
-    float ret = coveredSamples;
-    return ret / samples;
+
+    // Pixels without geometry keep the cleared value
+    if (coveredSamples == 0)
+        discard;
+
+    comp.ambient /= coveredSamples;
+    comp.diffuse /= coveredSamples;
+    comp.specular /= coveredSamples;
+
+    //Use coverage value as alpha
+    float coverage = float(coveredSamples) / shadedSamples;
+
+    phong_ambient = vec4(comp.ambient, coverage);
+    phong_diffuse = vec4(comp.diffuse, coverage);
+    phong_specular = vec4(comp.specular, coverage);
+
+    phong_combined = phong_ambient + phong_diffuse + phong_specular;
+    phong_combined.a = coverage;
 }
+)###";
 
-PS_OUTPUT main(PS_INPUT v) {
-    PS_OUTPUT ret;
+static const char *SHADER_FRAG_EDGES = R"###(#version 460
 
-    uint2 size;
-    int samples;
-    position.GetDimensions(size.x, size.y, samples);
-    int2 coord = v.fUv * size;
+#include "gbuffer.glsl"
 
-    LightComponents comp = getAveragedLightComponents(coord, samples);
+layout (location = 0) in vec2 fUv;
 
-    //Use coverage value as alpha
-    float coverage = getSampleCoverage(coord, samples);
+layout (location = 0) uniform sampler2DMS normal;
+layout (location = 1) uniform sampler2DMS diffuse;
+layout (location = 2) uniform sampler2DMS material;
+layout (location = 3) uniform sampler2DMS depth;
 
-    ret.phong_ambient = float4(comp.ambient, coverage);
-    ret.phong_diffuse = float4(comp.diffuse, coverage);
-    ret.phong_specular = float4(comp.specular, coverage);
+layout (location = 4) uniform mat4 INVERSE_PROJECTION;
 
-    ret.phong_combined = ret.phong_ambient + ret.phong_diffuse + ret.phong_specular;
-    ret.phong_combined.a = coverage;
+const float EDGE_DEPTH_THRESHOLD = 0.01; // Relative to the view depth of the first sample
+const float EDGE_NORMAL_THRESHOLD = 0.99; // The minimum cosine between the normals of the samples
+const float EDGE_COLOR_THRESHOLD = 0.02;
 
-    return ret;
+float getViewDepth(float sampleDepth)
+{
+    vec4 position = INVERSE_PROJECTION * vec4(0, 0, sampleDepth * 2.0 - 1.0, 1);
+    return -position.z / position.w;
+}
+
+bool differs(vec4 a, vec4 b)
+{
+    return any(greaterThan(abs(a - b), vec4(EDGE_COLOR_THRESHOLD)));
+}
+
+// Pixels whose samples are equal are discarded, the remaining edge pixels are marked in the stencil buffer
+void main()
+{
+    ivec2 coord = ivec2(fUv * textureSize(depth));
+    int samples = textureSamples(depth);
+
+    float firstDepth = texelFetch(depth, coord, 0).r;
+    bool firstCovered = firstDepth < 1;
+    float firstViewDepth = getViewDepth(firstDepth);
+    vec3 firstNormal = decodeNormal(texelFetch(normal, coord, 0).xy);
+    vec4 firstDiffuse = texelFetch(diffuse, coord, 0);
+    vec4 firstMaterial = texelFetch(material, coord, 0);
+
+    for (int i = 1; i < samples; i++)
+    {
+        float sampleDepth = texelFetch(depth, coord, i).r;
+        if ((sampleDepth < 1) != firstCovered)
+            return;
+        if (!firstCovered)
+            continue;
+        if (abs(getViewDepth(sampleDepth) - firstViewDepth) > EDGE_DEPTH_THRESHOLD * firstViewDepth
+            || dot(decodeNormal(texelFetch(normal, coord, i).xy), firstNormal) < EDGE_NORMAL_THRESHOLD
+            || differs(texelFetch(diffuse, coord, i), firstDiffuse)
+            || differs(texelFetch(material, coord, i), firstMaterial))
+            return;
+    }
+
+    discard;
 }
 )###";
 
@@ -195,25 +339,89 @@ namespace engine {
     const char *PhongShadePass::SPECULAR = "phong_specular";
     const char *PhongShadePass::COMBINED = "phong_combined";
 
+    template<typename T>
+    static void writeBuffer(std::vector<uint8_t> &buffer, size_t offset, const T &value) {
+        std::memcpy(buffer.data() + offset, &value, sizeof(T));
+    }
+
     PhongShadePass::PhongShadePass(RenderDevice &device)
             : renderDevice(device) {
         vertexShader = ShaderSource(SHADER_VERT_LIGHTING,
                                     "main",
                                     VERTEX,
-                                    HLSL_SHADER_MODEL_4);
+                                    GLSL_460);
         fragmentShader = ShaderSource(SHADER_FRAG_LIGHTING,
                                       "main",
                                       FRAGMENT,
-                                      HLSL_SHADER_MODEL_4);
+                                      GLSL_460);
+
+        edgeFragmentShader = ShaderSource(SHADER_FRAG_EDGES,
+                                          "main",
+                                          FRAGMENT,
+                                          GLSL_460);
 
         vertexShader.preprocess(ShaderInclude::getShaderIncludeCallback(),
-                                ShaderInclude::getShaderMacros(HLSL_SHADER_MODEL_4));
+                                ShaderInclude::getShaderMacros(GLSL_460));
         fragmentShader.preprocess(ShaderInclude::getShaderIncludeCallback(),
-                                  ShaderInclude::getShaderMacros(HLSL_SHADER_MODEL_4));
+                                  ShaderInclude::getShaderMacros(GLSL_460));
+        edgeFragmentShader.preprocess(ShaderInclude::getShaderIncludeCallback(),
+                                      ShaderInclude::getShaderMacros(GLSL_460));
 
         auto &allocator = device.getAllocator();
 
         shader = allocator.createShaderProgram(vertexShader, fragmentShader);
+        edgeShader = allocator.createShaderProgram(vertexShader, edgeFragmentShader);
+
+        edgeShader->activate();
+        for (int i = 0; i < 4; i++)
+            edgeShader->setTexture(i, i);
+
+        shader->activate();
+        for (int i = 0; i < 4; i++)
+            shader->setTexture(i, i);
+
+        // Resolve the offsets of the light block members once so that updating the lights does not build any names
+        auto layout = shader->getShaderBufferLayout("MANA_LIGHTS");
+        if (layout.size == 0)
+            throw std::runtime_error("Phong shader does not declare the light block");
+
+        lightData.resize(layout.size);
+        lightBuffer = allocator.createShaderBuffer();
+
+        // Point and spot lights are clustered, their arrays in the block stay empty
+        auto maxLights = std::stoul(ShaderInclude::getShaderMacros(GLSL_460).at("MAX_LIGHTS"));
+        for (size_t i = 0; i < maxLights; i++) {
+            auto index = "[" + std::to_string(i) + "].";
+
+            LightOffsets directional;
+            directional.direction = layout.getOffset("DIRECTIONAL_LIGHTS" + index + "direction");
+            directional.ambient = layout.getOffset("DIRECTIONAL_LIGHTS" + index + "ambient");
+            directional.diffuse = layout.getOffset("DIRECTIONAL_LIGHTS" + index + "diffuse");
+            directional.specular = layout.getOffset("DIRECTIONAL_LIGHTS" + index + "specular");
+            directionalOffsets.emplace_back(directional);
+        }
+
+        directionalCountOffset = layout.getOffset("DIRECTIONAL_LIGHTS_COUNT");
+
+        lightStorage = allocator.createStorageBuffer(StorageBuffer::RGBA32F);
+        clusterStorage = allocator.createStorageBuffer(StorageBuffer::R32UI);
+
+        // Passes without a shadow pass sample a placeholder atlas so that the storage buffer slots do not change
+        TextureBuffer::Attributes atlasAttributes;
+        atlasAttributes.size = Vec2i(1, 1);
+        atlasAttributes.format = TextureBuffer::DEPTH_STENCIL;
+        atlasAttributes.filterMin = TextureBuffer::NEAREST;
+        atlasAttributes.filterMag = TextureBuffer::NEAREST;
+        atlasAttributes.generateMipmap = false;
+        defaultShadowAtlas = allocator.createTextureBuffer(atlasAttributes);
+        shadowTileStorage = allocator.createStorageBuffer(StorageBuffer::RGBA32F);
+
+        // The storage buffers are bound to the slots following the 4 geometry buffer textures and the shadow atlas
+        shader->setTexture(15, 4);
+        shader->setTexture(10, 5);
+        shader->setTexture(11, 6);
+        shader->setTexture(16, 7);
+        shader->setVec3(13, Vec3i(LightClustering::TILES_X, LightClustering::TILES_Y, LightClustering::SLICES));
     }
 
     void PhongShadePass::prepareBuffer(GeometryBuffer &gBuffer) {
@@ -224,88 +432,132 @@ namespace engine {
     }
 
     void PhongShadePass::render(GeometryBuffer &gBuffer, Scene &scene, AssetRenderManager &assetRenderManager) {
-        int dirCount = 0;
-        int pointCount = 0;
-        int spotCount = 0;
+        size_t dirCount = 0;
+        int cascadeLight = -1;
+        int cascadeTile = -1;
+
+        // Directional lights exceeding the capacity of the block are ignored
+        for (size_t i = 0; i < scene.lights.size(); i++) {
+            auto &light = scene.lights.at(i);
+            if (light.type != LIGHT_DIRECTIONAL || dirCount >= directionalOffsets.size())
+                continue;
+            if (i < scene.lightShadows.size() && scene.lightShadows.at(i) >= 0) {
+                cascadeLight = static_cast<int>(dirCount);
+                cascadeTile = scene.lightShadows.at(i);
+            }
+            auto &offsets = directionalOffsets.at(dirCount++);
+            writeBuffer(lightData, offsets.direction, light.direction);
+            writeBuffer(lightData, offsets.ambient, light.ambient);
+            writeBuffer(lightData, offsets.diffuse, light.diffuse);
+            writeBuffer(lightData, offsets.specular, light.specular);
+        }
 
-        shader->activate();
+        writeBuffer(lightData, directionalCountOffset, static_cast<int>(dirCount));
 
-        for (auto &light: scene.lights) {
-            std::string name;
-            switch (light.type) {
-                case LIGHT_DIRECTIONAL:
-                    name = "DIRECTIONAL_LIGHTS[" + std::to_string(dirCount++) + "].";
-                    shader->setVec3(name + "direction", light.direction);
-                    shader->setVec3(name + "ambient", light.ambient);
-                    shader->setVec3(name + "diffuse", light.diffuse);
-                    shader->setVec3(name + "specular", light.specular);
-                    break;
-                case LIGHT_POINT:
-                    name = "POINT_LIGHTS[" + std::to_string(pointCount++) + "].";
-                    shader->setVec3(name + "position", light.transform.getPosition());
-                    shader->setFloat(name + "constantValue", light.constant);
-                    shader->setFloat(name + "linearValue", light.linear);
-                    shader->setFloat(name + "quadraticValue", light.quadratic);
-                    shader->setVec3(name + "ambient", light.ambient);
-                    shader->setVec3(name + "diffuse", light.diffuse);
-                    shader->setVec3(name + "specular", light.specular);
-                    break;
-                case LIGHT_SPOT:
-                    name = "SPOT_LIGHTS[" + std::to_string(spotCount++) + "].";
-                    shader->setVec3(name + "position", light.transform.getPosition());
-                    shader->setVec3(name + "direction", light.direction);
-                    shader->setFloat(name + "cutOff", cosf(degreesToRadians(light.cutOff)));
-                    shader->setFloat(name + "outerCutOff", cosf(degreesToRadians(light.outerCutOff)));
-                    shader->setFloat(name + "constantValue", light.constant);
-                    shader->setFloat(name + "linearValue", light.linear);
-                    shader->setFloat(name + "quadraticValue", light.quadratic);
-                    shader->setVec3(name + "ambient", light.ambient);
-                    shader->setVec3(name + "diffuse", light.diffuse);
-                    shader->setVec3(name + "specular", light.specular);
-                    break;
-            }
+        clustering.update(scene.camera, scene.lights, scene.lightShadows, ThreadPool::getPool());
+
+        auto &clusterLights = clustering.getLightData();
+        auto &clusterData = clustering.getClusterData();
+        lightStorage->upload(reinterpret_cast<const uint8_t *>(clusterLights.data()),
+                             clusterLights.size() * sizeof(float));
+        clusterStorage->upload(reinterpret_cast<const uint8_t *>(clusterData.data()),
+                               clusterData.size() * sizeof(uint32_t));
+
+        shadowTileData.clear();
+        for (auto &tile: scene.shadowTiles) {
+            shadowTileData.insert(shadowTileData.end(), std::begin(tile.matrix.data), std::end(tile.matrix.data));
+            shadowTileData.insert(shadowTileData.end(), {tile.bounds.x, tile.bounds.y, tile.bounds.z, tile.bounds.w});
+            shadowTileData.insert(shadowTileData.end(), {tile.texelSize, tile.perspective ? 1.0f : 0.0f, 0, 0});
         }
+        shadowTileStorage->upload(reinterpret_cast<const uint8_t *>(shadowTileData.data()),
+                                  shadowTileData.size() * sizeof(float));
+
+        float splits[4] = {0, 0, 0, 0};
+        for (size_t i = 0; i < scene.shadowCascadeSplits.size() && i < 4; i++)
+            splits[i] = scene.shadowCascadeSplits.at(i);
+        Vec4f cascadeSplits(splits[0], splits[1], splits[2], splits[3]);
+
+        lightBuffer->upload(lightData.data(), lightData.size());
 
-        shader->setInt("DIRECTIONAL_LIGHTS_COUNT", dirCount);
-        shader->setInt("POINT_LIGHTS_COUNT", pointCount);
-        shader->setInt("SPOT_LIGHTS_COUNT", spotCount);
+        shader->activate();
+        shader->setShaderBuffer("MANA_LIGHTS", *lightBuffer, 0);
+        shader->setVec3(9, scene.camera.transform.getPosition());
+        shader->setMat4(12, scene.camera.view());
+        shader->setMat4(20, MatrixMath::inverse(scene.camera.projection() * scene.camera.view()));
+        shader->setVec2(14, clustering.getSliceParameters());
+        shader->setInt(17, cascadeLight);
+        shader->setInt(18, cascadeTile);
+        shader->setVec4(19, cascadeSplits);
 
-        shader->setTexture("position", 0);
-        shader->setTexture("normal", 1);
-        shader->setTexture("tangent", 2);
-        shader->setTexture("texNormal", 3);
-        shader->setTexture("diffuse", 4);
-        shader->setTexture("ambient", 5);
-        shader->setTexture("specular", 6);
-        shader->setTexture("shininess", 7);
-        shader->setTexture("depth", 8);
+        auto &ren = renderDevice.getRenderer();
 
-        shader->setVec3("VIEW_POS", scene.camera.transform.getPosition());
+        std::vector<std::reference_wrapper<TextureBuffer>> gBufferTextures = {
+                gBuffer.getBuffer(PrePass::NORMAL),
+                gBuffer.getBuffer(PrePass::DIFFUSE),
+                gBuffer.getBuffer(PrePass::MATERIAL),
+                gBuffer.getBuffer(PrePass::DEPTH)
+        };
+
+        // The stencil buffer of the geometry buffer target marks the pixels which are shaded per sample.
+        // The depth texture is sampled by the shaders and is therefore not attached.
+        gBuffer.detachDepthStencil();
+
+        bool multiSample = gBuffer.getSamples() > 1;
+        if (multiSample) {
+            RenderCommand edgeCommand(*edgeShader, gBuffer.getScreenQuad());
+            edgeCommand.textures = gBufferTextures;
+            edgeCommand.properties.enableDepthTest = false;
+            edgeCommand.properties.enableStencilTest = true;
+            edgeCommand.properties.stencilMode = STENCIL_ALWAYS;
+            edgeCommand.properties.stencilReference = 1;
+            edgeCommand.properties.stencilPass = STENCIL_REPLACE;
+            edgeCommand.properties.enableFaceCulling = false;
+            edgeCommand.properties.enableBlending = false;
+
+            edgeShader->activate();
+            edgeShader->setMat4(4, MatrixMath::inverse(scene.camera.projection()));
+
+            gBuffer.attachColor({});
+
+            ren.renderBegin(gBuffer.getRenderTarget(),
+                            RenderOptions({}, gBuffer.getSize(), true, {}, 1, false, false, true));
+            ren.addCommand(edgeCommand);
+            ren.renderFinish();
+        }
 
         RenderCommand command(*shader, gBuffer.getScreenQuad());
 
-        command.textures.emplace_back(gBuffer.getBuffer("position"));
-        command.textures.emplace_back(gBuffer.getBuffer("normal"));
-        command.textures.emplace_back(gBuffer.getBuffer("tangent"));
-        command.textures.emplace_back(gBuffer.getBuffer("texture_normal"));
-        command.textures.emplace_back(gBuffer.getBuffer("diffuse"));
-        command.textures.emplace_back(gBuffer.getBuffer("ambient"));
-        command.textures.emplace_back(gBuffer.getBuffer("specular"));
-        command.textures.emplace_back(gBuffer.getBuffer("shininess_id"));
-        command.textures.emplace_back(gBuffer.getBuffer("depth"));
+        command.textures = gBufferTextures;
+        command.textures.emplace_back(scene.shadowTiles.empty()
+                                      ? *defaultShadowAtlas
+                                      : gBuffer.getBuffer(ShadowPass::SHADOW_ATLAS));
+
+        command.storageBuffers.emplace_back(*clusterStorage);
+        command.storageBuffers.emplace_back(*lightStorage);
+        command.storageBuffers.emplace_back(*shadowTileStorage);
 
         command.properties.enableDepthTest = false;
-        command.properties.enableStencilTest = false;
+        command.properties.enableStencilTest = multiSample;
+        command.properties.stencilMode = STENCIL_EQUAL;
+        command.properties.stencilReference = 0;
         command.properties.enableFaceCulling = false;
         command.properties.enableBlending = false;
 
-        auto &ren = renderDevice.getRenderer();
-
         gBuffer.attachColor({"phong_ambient", "phong_diffuse", "phong_specular", "phong_combined"});
-        gBuffer.detachDepthStencil();
 
-        ren.renderBegin(gBuffer.getRenderTarget(), RenderOptions({}, gBuffer.getSize()));
+        // The stencil buffer is kept so that the edge pixels can be shaded by a second draw
+        ren.renderBegin(gBuffer.getRenderTarget(),
+                        RenderOptions({}, gBuffer.getSize(), true, {}, 1, true, false, false));
+
+        shader->setInt(21, 0);
         ren.addCommand(command);
+
+        if (multiSample) {
+            shader->setInt(21, 1);
+            command.properties.stencilReference = 1;
+            ren.addCommand(command);
+        }
+
         ren.renderFinish();
     }
 }
\ No newline at end of file
@@ -18,20 +18,26 @@
  */
 
 #include <sstream>
+#include <cmath>
+#include <array>
 
 #include "render/deferred/passes/prepass.hpp"
 #include "render/deferred/deferredrenderer.hpp"
 #include "platform/graphics/shadercompiler.hpp"
 #include "render/shader/shaderinclude.hpp"
 #include "asset/assetimporter.hpp"
+#include "render/drawsort.hpp"
+#include "math/matrixmath.hpp"
 
 static const char *SHADER_VERT_GEOMETRY = R"###(#version 460
 
-layout (location = 0) in vec3 vPosition;
-layout (location = 1) in vec3 vNormal;
+#include "vertexpacking.glsl"
+
+// The meshes are drawn in the VertexPacking::COMPACT layout
+layout (location = 0) in vec4 vPosition;
+layout (location = 1) in vec2 vNormal;
 layout (location = 2) in vec2 vUv;
-layout (location = 3) in vec3 vTangent;
-layout (location = 4) in vec3 vBitangent;
+layout (location = 3) in vec2 vTangent;
 layout (location = 5) in vec4 vInstanceRow0;
 layout (location = 6) in vec4 vInstanceRow1;
 layout (location = 7) in vec4 vInstanceRow2;
@@ -42,6 +48,7 @@ layout(location = 1) out vec3 fNorm;
 layout(location = 2) out vec3 fTan;
 layout(location = 3) out vec2 fUv;
 layout(location = 4) out vec4 vPos;
+layout(location = 5) out vec3 fBitan;
 
 layout(location = 0) uniform mat4 MANA_M;
 layout(location = 1) uniform mat4 MANA_MVP;
@@ -65,16 +72,25 @@ layout(location = 13) uniform sampler2D normal;
 
 layout(location = 14) uniform mat4 TRANSFORM_ROTATION;
 
+layout(location = 15) uniform vec3 POSITION_OFFSET;
+layout(location = 16) uniform vec3 POSITION_SCALE;
+
 void main()
 {
     mat4 instanceMatrix = mat4(vInstanceRow0, vInstanceRow1, vInstanceRow2, vInstanceRow3);
 
-    vPos = (instanceMatrix * MANA_MVP) * vec4(vPosition, 1);
-    fPos = ((instanceMatrix * MANA_M) * vec4(vPosition, 1)).xyz;
+    vec3 position = dequantizePosition(vPosition, POSITION_OFFSET, POSITION_SCALE);
+    vec3 normal = octDecode(vNormal);
+    vec3 tangent = octDecode(vTangent);
+
+    vPos = MANA_MVP * instanceMatrix * vec4(position, 1);
+    fPos = (MANA_M * instanceMatrix * vec4(position, 1)).xyz;
     fUv = vUv;
 
-    fNorm = normalize(vNormal);
-    fTan = normalize(vTangent);
+    mat3 normalMatrix = transpose(inverse(mat3(MANA_M * instanceMatrix)));
+    fNorm = normalMatrix * normal;
+    fTan = normalMatrix * tangent;
+    fBitan = normalMatrix * decodeBitangent(normal, tangent, vPosition);
 
     gl_Position = vPos;
 }
@@ -82,20 +98,18 @@ void main()
 
 static const char *SHADER_FRAG_GEOMETRY = R"###(#version 460
 
+#include "gbuffer.glsl"
+
 layout(location = 0) in vec3 fPos;
 layout(location = 1) in vec3 fNorm;
 layout(location = 2) in vec3 fTan;
 layout(location = 3) in vec2 fUv;
 layout(location = 4) in vec4 vPos;
+layout(location = 5) in vec3 fBitan;
 
-layout(location = 0) out vec4 oPosition;
-layout(location = 1) out vec4 oNormal;
-layout(location = 2) out vec4 oTangent;
-layout(location = 3) out vec4 oTexNormal;
-layout(location = 4) out vec4 oDiffuse;
-layout(location = 5) out vec4 oAmbient;
-layout(location = 6) out vec4 oSpecular;
-layout(location = 7) out vec4 oShininess;
+layout(location = 0) out vec4 oNormal;
+layout(location = 1) out vec4 oDiffuse;
+layout(location = 2) out vec4 oMaterial;
 
 layout(location = 0) uniform mat4 MANA_M;
 layout(location = 1) uniform mat4 MANA_MVP;
@@ -118,26 +132,25 @@ layout(location = 12) uniform sampler2D emissive;
 layout(location = 13) uniform sampler2D normal;
 
 void main() {
-    oPosition = vec4(fPos, 1);
     oDiffuse = texture(diffuse, fUv) + diffuseColor;
-    oAmbient = texture(ambient, fUv) + ambientColor;
-    oSpecular = texture(specular, fUv) + specularColor;
-    oShininess.r = texture(shininess, fUv).r + shininessColor;
 
-    mat3 normalMatrix = transpose(inverse(mat3(MANA_M)));
-    oNormal = vec4(normalize(normalMatrix * fNorm), 1);
-    oTangent = vec4(normalize(normalMatrix * fTan), 1);
+    vec3 specularValue = (texture(specular, fUv) + specularColor).rgb;
+    float shininessValue = texture(shininess, fUv).r + shininessColor;
+    oMaterial = vec4(specularValue, encodeShininess(shininessValue));
 
+    vec3 norm = normalize(fNorm);
     if (hasTextureNormal != 0)
     {
-        vec3 texNormal = texture(normal, fUv).xyz;
-        texNormal = normalize(texNormal * 2.0 - 1.0);
-        oTexNormal = vec4(texNormal, 1);
-    }
-    else
-    {
-        oTexNormal = vec4(0, 0, 0, 0);
+        // Resolve the normal map here so that the geometry buffer only stores the world space normal
+        vec3 tangent = normalize(fTan - dot(fTan, norm) * norm);
+        vec3 bitangent = cross(norm, tangent);
+        if (dot(bitangent, fBitan) < 0.0)
+            bitangent = -bitangent;
+
+        vec3 texNormal = normalize(texture(normal, fUv).xyz * 2.0 - 1.0);
+        norm = normalize(mat3(tangent, bitangent, norm) * texNormal);
     }
+    oNormal = vec4(encodeNormal(norm), 0, 1);
 }
 )###";
 
@@ -152,14 +165,9 @@ namespace engine {
     }
 
     const char *PrePass::DEPTH = "depth";
-    const char *PrePass::POSITION = "position";
     const char *PrePass::NORMAL = "normal";
-    const char *PrePass::TANGENT = "tangent";
-    const char *PrePass::TEXTURE_NORMAL = "texture_normal";
     const char *PrePass::DIFFUSE = "diffuse";
-    const char *PrePass::AMBIENT = "ambient";
-    const char *PrePass::SPECULAR = "specular";
-    const char *PrePass::SHININESS_ID = "shininess_id";
+    const char *PrePass::MATERIAL = "material";
 
     PrePass::PrePass(RenderDevice &device)
             : renderDevice(device) {
@@ -192,139 +200,181 @@ namespace engine {
 
     void PrePass::prepareBuffer(GeometryBuffer &gBuffer) {
         gBuffer.addBuffer(DEPTH, TextureBuffer::ColorFormat::DEPTH_STENCIL);
-        gBuffer.addBuffer(POSITION, TextureBuffer::ColorFormat::RGBA32F);
-        gBuffer.addBuffer(NORMAL, TextureBuffer::ColorFormat::RGBA32F);
-        gBuffer.addBuffer(TANGENT, TextureBuffer::ColorFormat::RGBA32F);
-        gBuffer.addBuffer(TEXTURE_NORMAL, TextureBuffer::ColorFormat::RGBA32F);
+        gBuffer.addBuffer(NORMAL, TextureBuffer::ColorFormat::RG16);
         gBuffer.addBuffer(DIFFUSE, TextureBuffer::ColorFormat::RGBA);
-        gBuffer.addBuffer(AMBIENT, TextureBuffer::ColorFormat::RGBA);
-        gBuffer.addBuffer(SPECULAR, TextureBuffer::ColorFormat::RGBA);
-        gBuffer.addBuffer(SHININESS_ID, TextureBuffer::ColorFormat::RGBA32F);
+        gBuffer.addBuffer(MATERIAL, TextureBuffer::ColorFormat::RGBA);
     }
 
     void PrePass::render(GeometryBuffer &gBuffer, Scene &scene, AssetRenderManager &assetRenderManager) {
         auto &ren = renderDevice.getRenderer();
 
-        Mat4f model, view, projection;
+        Mat4f view, projection;
         view = scene.camera.view();
         projection = scene.camera.projection();
 
+        // The model matrices are supplied per instance by the batches
         shader->activate();
+        shader->setMat4(0, MatrixMath::identity());
+        shader->setMat4(1, projection * view);
 
         // Draw deferred geometry
         gBuffer.attachColor({
-                                    POSITION,
                                     NORMAL,
-                                    TANGENT,
-                                    TEXTURE_NORMAL,
                                     DIFFUSE,
-                                    AMBIENT,
-                                    SPECULAR,
-                                    SHININESS_ID
+                                    MATERIAL
                             });
         gBuffer.attachDepthStencil(DEPTH);
 
         //Clear geometry buffer
         ren.renderBegin(gBuffer.getRenderTarget(), RenderOptions({}, gBuffer.getRenderTarget().getSize()));
 
+        auto &textureStreamer = assetRenderManager.getTextureStreamer();
+        int screenHeight = gBuffer.getRenderTarget().getSize().y;
+
+        // Key the batches by texture set, material, mesh and depth so that state only changes on key transitions
+        drawItems.clear();
+        drawStates.clear();
+        textureSetIds.clear();
+        materialIds.clear();
+        meshIds.clear();
+
+        auto cameraPosition = scene.camera.transform.getPosition();
+        for (size_t i = 0; i < scene.deferredBatches.size(); i++) {
+            auto &command = scene.deferred.at(scene.deferredBatchNodes.at(scene.deferredBatches.at(i).offset));
+            auto &material = command.material.get();
+
+            std::array<AssetPath, 6> textureSet = {material.diffuseTexture,
+                                                   material.ambientTexture,
+                                                   material.specularTexture,
+                                                   material.shininessTexture,
+                                                   material.emissiveTexture,
+                                                   material.normalTexture};
+
+            auto textureSetId = static_cast<uint32_t>(textureSetIds.size());
+            auto materialId = static_cast<uint32_t>(materialIds.size());
+            auto meshId = static_cast<uint32_t>(meshIds.size());
+
+            DrawState state{};
+            state.textureSet = textureSetIds.emplace(textureSet, textureSetId).first->second;
+            state.material = materialIds.emplace(command.material.getPath(), materialId).first->second;
+            auto mesh = meshIds.emplace(command.mesh.getPath(), meshId).first->second;
+
+            auto offset = command.transform.getPosition() - cameraPosition;
+            auto depth = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+
+            drawStates.emplace_back(state);
+            // All geometry is drawn with the same shader program
+            drawItems.emplace_back(DrawSort::DrawItem{
+                    DrawSort::makeKey(0,
+                                      state.textureSet,
+                                      state.material,
+                                      mesh,
+                                      DrawSort::getDepthBucket(depth,
+                                                               scene.camera.nearClip,
+                                                               scene.camera.farClip)),
+                    static_cast<uint32_t>(i)});
+        }
+
+        DrawSort::sort(drawItems, drawScratch);
+
         std::vector<std::reference_wrapper<TextureBuffer>> textures;
         textures.reserve(6);
 
         bool firstCommand = true;
+        DrawState currentState{};
         Material shaderMaterial;
 
         // Rasterize the geometry and store the geometry + shading data in the geometry buffer.
-        for (auto &command: scene.deferred) {
-            textures.clear();
-
-            if (command.material.get().diffuseTexture.empty()) {
-                if (firstCommand || shaderMaterial.diffuse != command.material.get().diffuse) {
-                    shaderMaterial.diffuse = command.material.get().diffuse;
-                    shader->setVec4(3, scaleColor(command.material.get().diffuse));
+        for (auto &item: drawItems) {
+            auto &batch = scene.deferredBatches.at(item.index);
+            auto &command = scene.deferred.at(scene.deferredBatchNodes.at(batch.offset));
+            auto &state = drawStates.at(item.index);
+            auto &material = command.material.get();
+
+            if (firstCommand || state.material != currentState.material) {
+                // Textured channels use a zero color so that the texture value is passed through
+                auto diffuse = material.diffuseTexture.empty() ? material.diffuse : ColorRGBA();
+                auto ambient = material.ambientTexture.empty() ? material.ambient : ColorRGBA();
+                auto specular = material.specularTexture.empty() ? material.specular : ColorRGBA();
+                auto emissive = material.emissiveTexture.empty() ? material.emissive : ColorRGBA();
+                auto shininess = material.shininessTexture.empty() ? material.shininess : 0;
+
+                if (firstCommand || shaderMaterial.diffuse != diffuse) {
+                    shaderMaterial.diffuse = diffuse;
+                    shader->setVec4(3, scaleColor(diffuse));
                 }
-                textures.emplace_back(*defaultTexture);
-            } else {
-                if (firstCommand || shaderMaterial.diffuse != ColorRGBA()) {
-                    shaderMaterial.diffuse = ColorRGBA();
-                    shader->setVec4(3, Vec4f());
+                if (firstCommand || shaderMaterial.ambient != ambient) {
+                    shaderMaterial.ambient = ambient;
+                    shader->setVec4(4, scaleColor(ambient));
                 }
-                textures.emplace_back(assetRenderManager.get<TextureBuffer>(command.material.get().diffuseTexture));
-            }
-
-            if (command.material.get().ambientTexture.empty()) {
-                if (firstCommand || shaderMaterial.ambient != command.material.get().ambient) {
-                    shaderMaterial.ambient = command.material.get().ambient;
-                    shader->setVec4(4, scaleColor(command.material.get().ambient));
+                if (firstCommand || shaderMaterial.specular != specular) {
+                    shaderMaterial.specular = specular;
+                    shader->setVec4(5, scaleColor(specular));
                 }
-                textures.emplace_back(*defaultTexture);
-            } else {
-                if (firstCommand || shaderMaterial.ambient != ColorRGBA()) {
-                    shaderMaterial.ambient = ColorRGBA();
-                    shader->setVec4(4, Vec4f());
+                if (firstCommand || shaderMaterial.shininess != shininess) {
+                    shaderMaterial.shininess = shininess;
+                    shader->setFloat(6, shininess);
                 }
-                textures.emplace_back(assetRenderManager.get<TextureBuffer>(command.material.get().ambientTexture));
-            }
-
-            if (command.material.get().specularTexture.empty()) {
-                if (firstCommand || shaderMaterial.specular != command.material.get().specular) {
-                    shaderMaterial.specular = command.material.get().specular;
-                    shader->setVec4(5, scaleColor(command.material.get().specular));
+                if (firstCommand || shaderMaterial.emissive != emissive) {
+                    shaderMaterial.emissive = emissive;
+                    shader->setVec4(7, scaleColor(emissive));
                 }
-                textures.emplace_back(*defaultTexture);
-            } else {
-                if (firstCommand || shaderMaterial.specular != ColorRGBA()) {
-                    shaderMaterial.specular = ColorRGBA();
-                    shader->setVec4(5, Vec4f());
+                if (firstCommand || shaderMaterial.normalTexture.empty() != material.normalTexture.empty()) {
+                    shaderMaterial.normalTexture = material.normalTexture;
+                    shader->setInt(2, !material.normalTexture.empty());
                 }
-                textures.emplace_back(assetRenderManager.get<TextureBuffer>(command.material.get().specularTexture));
             }
 
-            if (command.material.get().shininessTexture.empty()) {
-                if (firstCommand || shaderMaterial.shininess != command.material.get().shininess) {
-                    shaderMaterial.shininess = command.material.get().shininess;
-                    shader->setFloat(6, command.material.get().shininess);
+            if (firstCommand || state.textureSet != currentState.textureSet) {
+                textures.clear();
+                for (auto *texture: {&material.diffuseTexture,
+                                     &material.ambientTexture,
+                                     &material.specularTexture,
+                                     &material.shininessTexture,
+                                     &material.emissiveTexture}) {
+                    if (texture->empty())
+                        textures.emplace_back(*defaultTexture);
+                    else
+                        textures.emplace_back(assetRenderManager.get<TextureBuffer>(*texture));
                 }
-                textures.emplace_back(*defaultTexture);
-            } else {
-                if (firstCommand || shaderMaterial.shininess != 0) {
-                    shaderMaterial.shininess = 0;
-                    shader->setFloat(6, 0);
+                if (!material.normalTexture.empty()) {
+                    textures.emplace_back(assetRenderManager.get<TextureBuffer>(material.normalTexture));
                 }
-                textures.emplace_back(assetRenderManager.get<TextureBuffer>(command.material.get().shininessTexture));
             }
 
-            if (command.material.get().emissiveTexture.empty()) {
-                if (firstCommand || shaderMaterial.emissive != command.material.get().emissive) {
-                    shaderMaterial.emissive = command.material.get().emissive;
-                    shader->setVec4(7, scaleColor(command.material.get().emissive));
-                }
-                textures.emplace_back(*defaultTexture);
-            } else {
-                if (firstCommand || shaderMaterial.emissive != ColorRGBA()) {
-                    shaderMaterial.emissive = ColorRGBA();
-                    shader->setVec4(7, Vec4f());
+            currentState = state;
+
+            // Report the screen coverage of the material textures to select the resident mip levels
+            float baseRadius = getMeshRadius(command.mesh);
+            for (size_t i = batch.offset; i < batch.offset + batch.count; i++) {
+                auto &node = scene.deferred.at(scene.deferredBatchNodes.at(i));
+                auto &scale = node.transform.getScale();
+                float radius = baseRadius
+                               * std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+                float projectedSize = scene.camera.projectedSize(node.transform.getPosition(),
+                                                                 radius,
+                                                                 static_cast<float>(screenHeight));
+                for (auto *texture: {&material.diffuseTexture,
+                                     &material.ambientTexture,
+                                     &material.specularTexture,
+                                     &material.shininessTexture,
+                                     &material.emissiveTexture,
+                                     &material.normalTexture}) {
+                    if (!texture->empty())
+                        textureStreamer.request(*texture, projectedSize);
                 }
-                textures.emplace_back(assetRenderManager.get<TextureBuffer>(command.material.get().emissiveTexture));
-            }
-
-            if (firstCommand
-                || !(shaderMaterial.normalTexture == command.material.get().normalTexture)) {
-                shaderMaterial.normalTexture = command.material.get().normalTexture;
-                shader->setInt(2, !command.material.get().normalTexture.empty());
             }
 
-            if (!command.material.get().normalTexture.empty()) {
-                textures.emplace_back(assetRenderManager.get<TextureBuffer>(command.material.get().normalTexture));
-            }
-
-            model = command.transform.model();
-
-            shader->setMat4(0, model);
-            shader->setMat4(1, projection * view * model);
+            auto &mesh = assetRenderManager.getPackedMesh(command.mesh.getPath());
+            shader->setVec3(15, mesh.positionOffset);
+            shader->setVec3(16, mesh.positionScale);
 
-            RenderCommand c(*shader, command.mesh.getRenderObject<MeshBuffer>());
+            RenderCommand c(*shader, *mesh.buffer);
             c.textures = textures;
             c.properties.enableFaceCulling = true;
+            c.instances = scene.deferredInstances;
+            c.instanceOffset = batch.offset;
+            c.instanceCount = batch.count;
             ren.addCommand(c);
 
             firstCommand = false;
@@ -332,4 +382,20 @@ namespace engine {
 
         ren.renderFinish();
     }
-}
\ No newline at end of file
+
+    float PrePass::getMeshRadius(AssetHandle<Mesh> &mesh) {
+        auto it = meshRadius.find(mesh.getPath());
+        if (it != meshRadius.end())
+            return it->second;
+
+        float radius = 0;
+        for (auto &vertex: mesh.get().vertices) {
+            auto p = vertex.position();
+            radius = std::max(radius, p.x * p.x + p.y * p.y + p.z * p.z);
+        }
+        radius = std::sqrt(radius);
+
+        meshRadius[mesh.getPath()] = radius;
+        return radius;
+    }
+}
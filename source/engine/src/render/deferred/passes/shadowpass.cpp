@@ -17,14 +17,631 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
 #include "render/deferred/passes/shadowpass.hpp"
+#include "platform/graphics/shadercompiler.hpp"
+#include "render/shader/shaderinclude.hpp"
+#include "math/matrixmath.hpp"
+#include "math/rotation.hpp"
+
+static const char *SHADER_VERT_CASTER = R"###(#version 460
+
+#include "vertexpacking.glsl"
+
+// The casters are drawn in the VertexPacking::COMPACT layout
+layout (location = 0) in vec4 vPosition;
+layout (location = 5) in vec4 vInstanceRow0;
+layout (location = 6) in vec4 vInstanceRow1;
+layout (location = 7) in vec4 vInstanceRow2;
+layout (location = 8) in vec4 vInstanceRow3;
+
+layout (location = 0) uniform mat4 LIGHT_VP;
+layout (location = 1) uniform vec3 POSITION_OFFSET;
+layout (location = 2) uniform vec3 POSITION_SCALE;
+
+void main()
+{
+    mat4 instanceMatrix = mat4(vInstanceRow0, vInstanceRow1, vInstanceRow2, vInstanceRow3);
+    vec3 position = dequantizePosition(vPosition, POSITION_OFFSET, POSITION_SCALE);
+    gl_Position = LIGHT_VP * instanceMatrix * vec4(position, 1);
+}
+)###";
+
+static const char *SHADER_FRAG_CASTER = R"###(#version 460
+
+void main() {}
+)###";
+
+static const char *SHADER_VERT_TILE = R"###(#version 460
+
+layout (location = 0) in vec3 vPosition;
+
+void main()
+{
+    gl_Position = vec4(vPosition.xy, 1, 1);
+}
+)###";
+
+static const char *SHADER_FRAG_TILE = R"###(#version 460
+
+layout (location = 0) uniform sampler2D STATIC_ATLAS;
+layout (location = 1) uniform int COPY_STATIC;
+
+void main()
+{
+    // The tiles have the same position in both atlases so the fragment coordinate addresses the cached texel
+    gl_FragDepth = COPY_STATIC != 0 ? texelFetch(STATIC_ATLAS, ivec2(gl_FragCoord.xy), 0).r : 1.0;
+}
+)###";
 
 namespace engine {
+    using namespace ShaderCompiler;
+
+    const char *ShadowPass::SHADOW_ATLAS = "shadow_atlas";
+
+    const int ShadowPass::CASCADE_COUNT = 4;
+    const int ShadowPass::LOCAL_TILE_COUNT = 16;
+    const float ShadowPass::CASTER_DISTANCE = 100;
+    const int ShadowPass::STATIC_FRAMES = 30;
+
+    // The weight of the logarithmic split scheme, the remainder of the cascade splits is distributed uniformly
+    static const float CASCADE_SPLIT_LAMBDA = 0.75f;
+
+    // The cascade centers are snapped to a grid with a step of 1 / CASCADE_GRID_DIVISIONS of the cascade size
+    static const int CASCADE_GRID_DIVISIONS = 16;
+
+    // The near plane of the point and spot light projections
+    static const float LOCAL_NEAR_CLIP = 0.05f;
+
+    static size_t hashCombine(size_t seed, size_t value) {
+        return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+    }
+
+    static size_t hashMatrix(const Mat4f &matrix) {
+        size_t ret = 0;
+        for (auto value: matrix.data) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            ret = hashCombine(ret, bits);
+        }
+        return ret;
+    }
+
+    static float dot(const Vec3f &a, const Vec3f &b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    static Vec3f cross(const Vec3f &a, const Vec3f &b) {
+        return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+
+    static Vec3f unitVector(const Vec3f &v) {
+        float length = std::sqrt(dot(v, v));
+        return length > 0 ? v / length : v;
+    }
+
+    static Vec3f getUp(const Vec3f &forward) {
+        return std::abs(forward.y) > 0.99f ? Vec3f(0, 0, 1) : Vec3f(0, 1, 0);
+    }
+
+    // A right handed view matrix at eye looking along the forward direction
+    static Mat4f lookAt(const Vec3f &eye, const Vec3f &forward, const Vec3f &up) {
+        auto f = unitVector(forward);
+        auto s = unitVector(cross(f, up));
+        auto u = cross(s, f);
+
+        Mat4f ret = MatrixMath::identity();
+        ret.set(0, 0, s.x);
+        ret.set(1, 0, s.y);
+        ret.set(2, 0, s.z);
+        ret.set(0, 1, u.x);
+        ret.set(1, 1, u.y);
+        ret.set(2, 1, u.z);
+        ret.set(0, 2, -f.x);
+        ret.set(1, 2, -f.y);
+        ret.set(2, 2, -f.z);
+        ret.set(3, 0, -dot(s, eye));
+        ret.set(3, 1, -dot(u, eye));
+        ret.set(3, 2, dot(f, eye));
+        return ret;
+    }
+
+    // The world space corners of the part of the camera frustum between the view depths begin and end
+    static std::array<Vec3f, 8> getFrustumCorners(const Camera &camera, float begin, float end) {
+        auto inverseView = MatrixMath::inverse(camera.view());
+
+        std::array<Vec3f, 8> ret;
+        size_t index = 0;
+        for (auto depth: {begin, end}) {
+            float halfWidth, halfHeight;
+            float centerX = 0, centerY = 0;
+            if (camera.type == PERSPECTIVE) {
+                halfHeight = depth * std::tan(degreesToRadians(camera.fov) / 2);
+                halfWidth = halfHeight * camera.aspectRatio;
+            } else {
+                halfWidth = (camera.right - camera.left) / 2;
+                halfHeight = (camera.top - camera.bottom) / 2;
+                centerX = (camera.right + camera.left) / 2;
+                centerY = (camera.top + camera.bottom) / 2;
+            }
+            for (auto x: {-1.0f, 1.0f}) {
+                for (auto y: {-1.0f, 1.0f}) {
+                    auto corner = inverseView * Vec4f(centerX + x * halfWidth, centerY + y * halfHeight, -depth, 1);
+                    ret[index++] = Vec3f(corner.x, corner.y, corner.z);
+                }
+            }
+        }
+        return ret;
+    }
+
+    // Map the clip space of a tile to its atlas texture coordinates and the depth range
+    static Mat4f getAtlasMatrix(const Vec4f &bounds) {
+        Mat4f ret = MatrixMath::identity();
+        ret.set(0, 0, (bounds.z - bounds.x) / 2);
+        ret.set(1, 1, (bounds.w - bounds.y) / 2);
+        ret.set(2, 2, 0.5f);
+        ret.set(3, 0, (bounds.x + bounds.z) / 2);
+        ret.set(3, 1, (bounds.y + bounds.w) / 2);
+        ret.set(3, 2, 0.5f);
+        return ret;
+    }
+
+    static TextureBuffer::Attributes getAtlasAttributes(const Vec2i &size) {
+        TextureBuffer::Attributes ret;
+        ret.textureType = TextureBuffer::TEXTURE_2D;
+        ret.size = size;
+        ret.format = TextureBuffer::DEPTH_STENCIL;
+        ret.wrapping = TextureBuffer::CLAMP_TO_EDGE;
+        ret.filterMin = TextureBuffer::NEAREST;
+        ret.filterMag = TextureBuffer::NEAREST;
+        ret.generateMipmap = false;
+        return ret;
+    }
+
+    ShadowPass::ShadowPass(RenderDevice &device, int cascadeSize)
+            : renderDevice(device),
+              cascadeSize(cascadeSize),
+              atlasSize(cascadeSize * 4, cascadeSize * 2),
+              tileCaches(CASCADE_COUNT + LOCAL_TILE_COUNT) {
+        if (cascadeSize < 2)
+            throw std::runtime_error("Invalid cascade size");
+
+        casterVertexShader = ShaderSource(SHADER_VERT_CASTER, "main", VERTEX, GLSL_460);
+        casterFragmentShader = ShaderSource(SHADER_FRAG_CASTER, "main", FRAGMENT, GLSL_460);
+        tileVertexShader = ShaderSource(SHADER_VERT_TILE, "main", VERTEX, GLSL_460);
+        tileFragmentShader = ShaderSource(SHADER_FRAG_TILE, "main", FRAGMENT, GLSL_460);
+
+        for (auto *source: {&casterVertexShader, &casterFragmentShader, &tileVertexShader, &tileFragmentShader}) {
+            source->preprocess(ShaderInclude::getShaderIncludeCallback(),
+                               ShaderInclude::getShaderMacros(GLSL_460));
+        }
+
+        auto &allocator = device.getAllocator();
+
+        casterShader = allocator.createShaderProgram(casterVertexShader, casterFragmentShader);
+        tileShader = allocator.createShaderProgram(tileVertexShader, tileFragmentShader);
+
+        tileShader->activate();
+        tileShader->setTexture(0, 0);
+
+        staticAtlas = allocator.createTextureBuffer(getAtlasAttributes(atlasSize));
+        renderTarget = allocator.createRenderTarget(atlasSize, 1);
+        instanceBuffer = allocator.createInstanceBuffer();
+    }
+
+    ShadowPass::~ShadowPass() {
+        renderTarget->detachDepthStencil();
+    }
+
     void ShadowPass::prepareBuffer(GeometryBuffer &gBuffer) {
-        RenderPass::prepareBuffer(gBuffer);
+        gBuffer.addBuffer(SHADOW_ATLAS, getAtlasAttributes(atlasSize));
     }
 
     void ShadowPass::render(GeometryBuffer &gBuffer, Scene &scene, AssetRenderManager &assetRenderManager) {
-        RenderPass::render(gBuffer, scene, assetRenderManager);
+        frame++;
+        renderedTiles = 0;
+
+        scene.shadowTiles.clear();
+        scene.shadowCascadeSplits.clear();
+        scene.lightShadows.assign(scene.lights.size(), -1);
+
+        updateCasters(scene);
+        addViews(scene);
+
+        if (views.empty())
+            return;
+
+        staticDraws.clear();
+        dynamicDraws.clear();
+        instanceMatrices.clear();
+
+        std::vector<uint8_t> renderStatic(views.size());
+        std::vector<uint8_t> compose(views.size());
+        std::vector<size_t> staticNodes;
+        std::vector<size_t> dynamicNodes;
+
+        for (size_t i = 0; i < views.size(); i++) {
+            auto &view = views.at(i);
+
+            staticNodes.clear();
+            dynamicNodes.clear();
+
+            auto addCaster = [this, &staticNodes, &dynamicNodes](const Caster &caster) {
+                if (caster.unchangedFrames >= STATIC_FRAMES)
+                    staticNodes.emplace_back(caster.node);
+                else
+                    dynamicNodes.emplace_back(caster.node);
+            };
+
+            casterTree.queryFrustum(Frustum(view.viewProjection), [this, &addCaster](int proxy) {
+                addCaster(casters.at(static_cast<int>(casterTree.getUserData(proxy))));
+            });
+            for (auto node: unboundedCasters) {
+                addCaster(casters.at(scene.shadowCasters.at(node).id));
+            }
+
+            // The query order depends on the layout of the tree, the static set is identified by the sorted ids
+            std::sort(staticNodes.begin(), staticNodes.end(), [&scene](size_t a, size_t b) {
+                return scene.shadowCasters.at(a).id < scene.shadowCasters.at(b).id;
+            });
+
+            auto staticHash = view.key;
+            for (auto node: staticNodes) {
+                staticHash = hashCombine(staticHash, static_cast<size_t>(scene.shadowCasters.at(node).id));
+            }
+
+            auto &cache = tileCaches.at(view.tile);
+            renderStatic[i] = !cache.valid || cache.staticHash != staticHash;
+            compose[i] = renderStatic[i] || cache.hasDynamic || !dynamicNodes.empty();
+
+            if (renderStatic[i])
+                addDraws(scene, i, staticNodes, staticDraws);
+            if (compose[i])
+                addDraws(scene, i, dynamicNodes, dynamicDraws);
+
+            cache.valid = true;
+            cache.staticHash = staticHash;
+            cache.hasDynamic = !dynamicNodes.empty();
+        }
+
+        instanceBuffer->upload(instanceMatrices);
+
+        auto &screenQuad = gBuffer.getScreenQuad();
+
+        // Redraw the cached tiles whose static casters or light changed
+        if (std::find(renderStatic.begin(), renderStatic.end(), 1) != renderStatic.end()) {
+            renderTarget->attachDepthStencil(*staticAtlas);
+            size_t drawIndex = 0;
+            for (size_t i = 0; i < views.size(); i++) {
+                if (renderStatic[i])
+                    renderTile(scene, assetRenderManager, screenQuad, i, false, staticDraws, drawIndex);
+            }
+        }
+
+        // Copy the cached tiles into the atlas and draw the dynamic casters on top
+        if (std::find(compose.begin(), compose.end(), 1) != compose.end()) {
+            renderTarget->attachDepthStencil(gBuffer.getBuffer(SHADOW_ATLAS));
+            size_t drawIndex = 0;
+            for (size_t i = 0; i < views.size(); i++) {
+                if (!compose[i])
+                    continue;
+                renderTile(scene, assetRenderManager, screenQuad, i, true, dynamicDraws, drawIndex);
+                renderedTiles++;
+            }
+        }
+
+        renderTarget->detachDepthStencil();
+    }
+
+    AABB ShadowPass::getDirectionalCasterBounds(const Camera &camera, const Light &light) {
+        AABB ret;
+
+        auto direction = unitVector(light.direction);
+        float nearDepth = std::max(camera.nearClip, 0.0001f);
+        float shadowEnd = std::min(camera.farClip, light.shadowDistance);
+        if (shadowEnd <= nearDepth)
+            return ret;
+
+        for (auto &corner: getFrustumCorners(camera, nearDepth, shadowEnd)) {
+            ret.extend(corner);
+            ret.extend(corner - direction * CASTER_DISTANCE);
+        }
+        return ret;
+    }
+
+    void ShadowPass::updateCasters(Scene &scene) {
+        unboundedCasters.clear();
+
+        for (size_t i = 0; i < scene.shadowCasters.size(); i++) {
+            auto &node = scene.shadowCasters.at(i);
+            auto model = node.transform.model();
+
+            bool changed = true;
+            auto it = casters.find(node.id);
+            if (it == casters.end()) {
+                it = casters.emplace(node.id, Caster()).first;
+            } else {
+                changed = !std::equal(std::begin(model.data), std::end(model.data), std::begin(it->second.model.data))
+                          || !(it->second.mesh == node.mesh.getPath());
+            }
+
+            auto &caster = it->second;
+            caster.node = i;
+            caster.frame = frame;
+
+            if (changed) {
+                caster.model = model;
+                caster.mesh = node.mesh.getPath();
+                caster.unchangedFrames = 0;
+
+                auto bounds = node.bounds.empty() ? AABB() : node.bounds.transform(model);
+                if (bounds.empty()) {
+                    if (caster.proxy >= 0)
+                        casterTree.remove(caster.proxy);
+                    caster.proxy = -1;
+                } else if (caster.proxy < 0) {
+                    caster.proxy = casterTree.insert(bounds, static_cast<size_t>(node.id));
+                } else {
+                    casterTree.update(caster.proxy, bounds);
+                }
+            } else if (caster.unchangedFrames < STATIC_FRAMES) {
+                caster.unchangedFrames++;
+            }
+
+            if (caster.proxy < 0)
+                unboundedCasters.emplace_back(i);
+        }
+
+        // Remove the casters which are no longer part of the scene
+        for (auto it = casters.begin(); it != casters.end();) {
+            if (it->second.frame == frame) {
+                it++;
+                continue;
+            }
+            if (it->second.proxy >= 0)
+                casterTree.remove(it->second.proxy);
+            it = casters.erase(it);
+        }
+    }
+
+    void ShadowPass::addViews(Scene &scene) {
+        views.clear();
+
+        auto addView = [this, &scene](const Mat4f &viewProjection, int tile, float texelSize, bool perspective) {
+            auto offset = getTileOffset(tile);
+            auto size = static_cast<float>(getTileSize(tile));
+            auto width = static_cast<float>(atlasSize.x);
+            auto height = static_cast<float>(atlasSize.y);
+            Vec4f bounds(static_cast<float>(offset.x) / width,
+                         static_cast<float>(offset.y) / height,
+                         (static_cast<float>(offset.x) + size) / width,
+                         (static_cast<float>(offset.y) + size) / height);
+
+            views.emplace_back(ShadowView{viewProjection, hashMatrix(viewProjection), tile});
+            scene.shadowTiles.emplace_back(Scene::ShadowTile{getAtlasMatrix(bounds) * viewProjection,
+                                                             bounds,
+                                                             texelSize,
+                                                             perspective});
+        };
+
+        auto &camera = scene.camera;
+
+        // Cascades of the first shadow casting directional light
+        for (size_t i = 0; i < scene.lights.size(); i++) {
+            auto &light = scene.lights.at(i);
+            if (!light.castShadows || light.type != LIGHT_DIRECTIONAL)
+                continue;
+
+            auto direction = unitVector(light.direction);
+            float nearDepth = std::max(camera.nearClip, 0.0001f);
+            float shadowEnd = std::min(camera.farClip, light.shadowDistance);
+            if (dot(direction, direction) == 0 || shadowEnd <= nearDepth)
+                continue;
+
+            // The cascades share the light rotation so that snapping to the texel grid keeps them stable
+            auto lightView = lookAt(Vec3f(0), direction, getUp(direction));
+
+            scene.lightShadows.at(i) = static_cast<int>(views.size());
+
+            // The grid step in texels
+            int cascadeGridStep = std::max(1, cascadeSize / CASCADE_GRID_DIVISIONS);
+
+            float begin = nearDepth;
+            for (int cascade = 0; cascade < CASCADE_COUNT; cascade++) {
+                float fraction = static_cast<float>(cascade + 1) / CASCADE_COUNT;
+                float end = CASCADE_SPLIT_LAMBDA * nearDepth * std::pow(shadowEnd / nearDepth, fraction)
+                            + (1 - CASCADE_SPLIT_LAMBDA) * (nearDepth + (shadowEnd - nearDepth) * fraction);
+
+                // Fit a sphere so that the extent of the cascade does not change when the camera rotates
+                auto corners = getFrustumCorners(camera, begin, end);
+                Vec3f center(0);
+                for (auto &corner: corners)
+                    center += corner;
+                center /= static_cast<float>(corners.size());
+
+                float radius = 0;
+                for (auto &corner: corners) {
+                    auto offset = corner - center;
+                    radius = std::max(radius, dot(offset, offset));
+                }
+
+                // The center is snapped to a coarse grid so that the cascade matrix and its cached tile stay the same
+                // while the camera moves inside a grid cell. The radius is extended by the largest distance
+                // between the snapped and the actual center so that the frustum slice stays covered.
+                float stepFraction = 2.0f * static_cast<float>(cascadeGridStep) / static_cast<float>(cascadeSize);
+                radius = std::sqrt(radius) / (1 - std::sqrt(3.0f) / 2 * stepFraction);
+                radius = std::ceil(radius * 16) / 16;
+
+                auto lightCenter = lightView * Vec4f(center.x, center.y, center.z, 1);
+                float texel = radius * 2 / static_cast<float>(cascadeSize);
+                float step = texel * static_cast<float>(cascadeGridStep);
+                float x = std::round(lightCenter.x / step) * step;
+                float y = std::round(lightCenter.y / step) * step;
+                float z = std::round(lightCenter.z / step) * step;
+
+                auto projection = MatrixMath::ortho(x - radius,
+                                                    x + radius,
+                                                    y - radius,
+                                                    y + radius,
+                                                    -z - radius - CASTER_DISTANCE,
+                                                    -z + radius);
+                addView(projection * lightView, cascade, texel, false);
+                scene.shadowCascadeSplits.emplace_back(end);
+
+                begin = end;
+            }
+
+            break;
+        }
+
+        // Point and spot lights, lights which do not fit into the remaining tiles are not shadowed
+        std::vector<size_t> localLights;
+        std::vector<Mat4f> localMatrices;
+        std::vector<float> localTexelSizes;
+        for (size_t i = 0; i < scene.lights.size(); i++) {
+            auto &light = scene.lights.at(i);
+            if (!light.castShadows || light.type == LIGHT_DIRECTIONAL)
+                continue;
+
+            auto range = light.getRange();
+            if (!std::isfinite(range))
+                range = light.shadowDistance;
+            if (range <= LOCAL_NEAR_CLIP)
+                continue;
+
+            auto &position = light.transform.getPosition();
+            if (light.type == LIGHT_SPOT) {
+                auto direction = unitVector(light.direction);
+                if (dot(direction, direction) == 0 || localMatrices.size() + 1 > LOCAL_TILE_COUNT)
+                    continue;
+                float fov = std::min(light.outerCutOff * 2 + 2, 170.0f);
+                localLights.emplace_back(i);
+                localMatrices.emplace_back(MatrixMath::perspective(fov, 1, LOCAL_NEAR_CLIP, range)
+                                           * lookAt(position, direction, getUp(direction)));
+                localTexelSizes.emplace_back(2 * std::tan(degreesToRadians(fov) / 2)
+                                             / static_cast<float>(getTileSize(CASCADE_COUNT)));
+            } else {
+                if (localMatrices.size() + 6 > LOCAL_TILE_COUNT)
+                    continue;
+                localLights.emplace_back(i);
+                auto projection = MatrixMath::perspective(90, 1, LOCAL_NEAR_CLIP, range);
+                for (auto &face: {Vec3f(1, 0, 0), Vec3f(-1, 0, 0),
+                                  Vec3f(0, 1, 0), Vec3f(0, -1, 0),
+                                  Vec3f(0, 0, 1), Vec3f(0, 0, -1)}) {
+                    localMatrices.emplace_back(projection * lookAt(position, face, getUp(face)));
+                    localTexelSizes.emplace_back(2 / static_cast<float>(getTileSize(CASCADE_COUNT)));
+                }
+            }
+        }
+
+        // Keep the tiles of views which did not change so that their cached maps are reused
+        std::vector<int> assigned(localMatrices.size(), -1);
+        std::vector<bool> used(LOCAL_TILE_COUNT);
+        for (size_t i = 0; i < localMatrices.size(); i++) {
+            auto it = localTiles.find(hashMatrix(localMatrices.at(i)));
+            if (it != localTiles.end() && !used.at(it->second)) {
+                assigned.at(i) = it->second;
+                used.at(it->second) = true;
+            }
+        }
+
+        size_t freeTile = 0;
+        localTiles.clear();
+        for (size_t i = 0; i < localMatrices.size(); i++) {
+            if (assigned.at(i) < 0) {
+                while (used.at(freeTile))
+                    freeTile++;
+                assigned.at(i) = static_cast<int>(freeTile);
+                used.at(freeTile) = true;
+            }
+            localTiles[hashMatrix(localMatrices.at(i))] = assigned.at(i);
+        }
+
+        size_t matrixIndex = 0;
+        for (auto lightIndex: localLights) {
+            scene.lightShadows.at(lightIndex) = static_cast<int>(views.size());
+            size_t faces = scene.lights.at(lightIndex).type == LIGHT_POINT ? 6 : 1;
+            for (size_t face = 0; face < faces; face++, matrixIndex++) {
+                addView(localMatrices.at(matrixIndex),
+                        CASCADE_COUNT + assigned.at(matrixIndex),
+                        localTexelSizes.at(matrixIndex),
+                        true);
+            }
+        }
+    }
+
+    void ShadowPass::addDraws(Scene &scene, size_t view, std::vector<size_t> &nodes, std::vector<CasterDraw> &draws) {
+        // Group the casters by mesh so that each mesh is drawn once per tile
+        std::sort(nodes.begin(), nodes.end(), [&scene](size_t a, size_t b) {
+            return scene.shadowCasters.at(a).mesh.getPath() < scene.shadowCasters.at(b).mesh.getPath();
+        });
+
+        for (size_t i = 0; i < nodes.size(); i++) {
+            auto &node = scene.shadowCasters.at(nodes.at(i));
+            if (i == 0 || !(node.mesh.getPath() == scene.shadowCasters.at(draws.back().node).mesh.getPath()))
+                draws.emplace_back(CasterDraw{view, nodes.at(i), instanceMatrices.size(), 0});
+            instanceMatrices.emplace_back(casters.at(node.id).model);
+            draws.back().count++;
+        }
+    }
+
+    void ShadowPass::renderTile(Scene &scene,
+                                AssetRenderManager &assetRenderManager,
+                                MeshBuffer &screenQuad,
+                                size_t view,
+                                bool copyStatic,
+                                const std::vector<CasterDraw> &draws,
+                                size_t &drawIndex) {
+        auto &ren = renderDevice.getRenderer();
+
+        auto tile = views.at(view).tile;
+        auto size = getTileSize(tile);
+        ren.renderBegin(*renderTarget,
+                        RenderOptions(getTileOffset(tile), {size, size}, false, {}, 1, false, false, false));
+
+        // Clearing would affect the whole atlas, the tile is reset by a quad on the far plane instead
+        tileShader->activate();
+        tileShader->setInt(1, copyStatic);
+
+        RenderCommand tileCommand(*tileShader, screenQuad);
+        if (copyStatic)
+            tileCommand.textures.emplace_back(*staticAtlas);
+        tileCommand.properties.depthTestMode = DEPTH_TEST_ALWAYS;
+        ren.addCommand(tileCommand);
+
+        casterShader->activate();
+        casterShader->setMat4(0, views.at(view).viewProjection);
+
+        for (; drawIndex < draws.size() && draws.at(drawIndex).view == view; drawIndex++) {
+            auto &draw = draws.at(drawIndex);
+            auto &mesh = assetRenderManager.getPackedMesh(scene.shadowCasters.at(draw.node).mesh.getPath());
+            casterShader->setVec3(1, mesh.positionOffset);
+            casterShader->setVec3(2, mesh.positionScale);
+
+            RenderCommand command(*casterShader, *mesh.buffer);
+            command.instances = instanceBuffer.get();
+            command.instanceOffset = draw.offset;
+            command.instanceCount = draw.count;
+            ren.addCommand(command);
+        }
+
+        ren.renderFinish();
+    }
+
+    Vec2i ShadowPass::getTileOffset(int tile) const {
+        if (tile < CASCADE_COUNT)
+            return {(tile % 2) * cascadeSize, (tile / 2) * cascadeSize};
+        auto local = tile - CASCADE_COUNT;
+        auto localSize = cascadeSize / 2;
+        return {cascadeSize * 2 + (local % 4) * localSize, (local / 4) * localSize};
+    }
+
+    int ShadowPass::getTileSize(int tile) const {
+        return tile < CASCADE_COUNT ? cascadeSize : cascadeSize / 2;
     }
-}
\ No newline at end of file
+}
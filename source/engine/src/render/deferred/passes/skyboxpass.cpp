@@ -22,8 +22,7 @@
 #include "render/shader/shaderinclude.hpp"
 
 #include "asset/assetimporter.hpp"
-
-#include <sstream>
+#include "io/memorystreambuf.hpp"
 
 static const char *SHADER_VERT = R"###(
 struct VS_INPUT
@@ -167,7 +166,7 @@ namespace engine {
 
         defaultTexture = allocator.createTextureBuffer(attributes);
 
-        std::stringstream cubeStream((std::string(CUBE_OBJ)));
+        MemoryStream cubeStream(CUBE_OBJ.data(), CUBE_OBJ.size());
         Mesh skyboxMesh = AssetImporter::import(cubeStream, ".obj").get<Mesh>("Cube");
         meshBuffer = allocator.createMeshBuffer(skyboxMesh);
     }
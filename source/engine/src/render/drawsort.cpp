@@ -0,0 +1,84 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "render/drawsort.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace engine {
+    namespace DrawSort {
+        static uint64_t clampField(uint32_t value, int bits) {
+            return std::min<uint64_t>(value, (1ull << bits) - 1);
+        }
+
+        uint64_t makeKey(uint32_t shader, uint32_t textureSet, uint32_t material, uint32_t mesh, uint32_t depthBucket) {
+            return clampField(shader, 6) << 58
+                   | clampField(textureSet, 16) << 42
+                   | clampField(material, 10) << 32
+                   | clampField(mesh, 16) << 16
+                   | clampField(depthBucket, 16);
+        }
+
+        uint32_t getDepthBucket(float depth, float nearClip, float farClip) {
+            if (!(depth > nearClip))
+                return 0;
+            if (depth >= farClip)
+                return 0xFFFF;
+            auto ret = std::log(depth / nearClip) / std::log(farClip / nearClip) * 0xFFFF;
+            return static_cast<uint32_t>(ret);
+        }
+
+        void sort(std::vector<DrawItem> &items, std::vector<DrawItem> &scratch) {
+            if (items.size() < 2)
+                return;
+
+            // Build the histograms of all 8 byte positions in a single pass
+            std::vector<size_t> histograms(8 * 256);
+            for (auto &item: items) {
+                for (int digit = 0; digit < 8; digit++) {
+                    histograms[digit * 256 + ((item.key >> (digit * 8)) & 0xFF)]++;
+                }
+            }
+
+            scratch.resize(items.size());
+
+            for (int digit = 0; digit < 8; digit++) {
+                auto *histogram = histograms.data() + digit * 256;
+
+                // All keys share this byte, the pass would not change the order
+                if (histogram[(items.front().key >> (digit * 8)) & 0xFF] == items.size())
+                    continue;
+
+                size_t offset = 0;
+                for (int i = 0; i < 256; i++) {
+                    auto count = histogram[i];
+                    histogram[i] = offset;
+                    offset += count;
+                }
+
+                for (auto &item: items) {
+                    scratch[histogram[(item.key >> (digit * 8)) & 0xFF]++] = item;
+                }
+
+                items.swap(scratch);
+            }
+        }
+    }
+}
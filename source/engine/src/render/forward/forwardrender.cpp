@@ -22,6 +22,47 @@
 #include "math/rotation.hpp"
 
 namespace engine {
+    // The uniform names of the members of a light array element
+    struct LightUniformNames {
+        LightUniformNames(const std::string &array, size_t index) {
+            auto prefix = array + "[" + std::to_string(index) + "].";
+            position = prefix + "position";
+            direction = prefix + "direction";
+            cutOff = prefix + "cutOff";
+            outerCutOff = prefix + "outerCutOff";
+            constantValue = prefix + "constantValue";
+            linearValue = prefix + "linearValue";
+            quadraticValue = prefix + "quadraticValue";
+            ambient = prefix + "ambient";
+            diffuse = prefix + "diffuse";
+            specular = prefix + "specular";
+        }
+
+        std::string position;
+        std::string direction;
+        std::string cutOff;
+        std::string outerCutOff;
+        std::string constantValue;
+        std::string linearValue;
+        std::string quadraticValue;
+        std::string ambient;
+        std::string diffuse;
+        std::string specular;
+    };
+
+    // Build the names once instead of for every light of every draw
+    static const LightUniformNames &getLightNames(std::vector<LightUniformNames> &names,
+                                                  const std::string &array,
+                                                  size_t index) {
+        while (names.size() <= index)
+            names.emplace_back(array, names.size());
+        return names.at(index);
+    }
+
+    static std::vector<LightUniformNames> directionalNames;
+    static std::vector<LightUniformNames> pointNames;
+    static std::vector<LightUniformNames> spotNames;
+
     void ForwardRenderer::renderScene(Renderer &ren, RenderTarget &target, Scene &scene) {
         // Clear forward color and depth textures
         ren.renderBegin(target, RenderOptions({},
@@ -52,43 +93,41 @@ namespace engine {
             int pointCount = 0;
             int spotCount = 0;
 
-            int i = 0;
             for (auto &light: scene.lights) {
-                std::string name;
                 switch (light.type) {
-                    case LIGHT_DIRECTIONAL:
-                        name = "DIRECTIONAL_LIGHTS[" + std::to_string(i++) + "].";
-                        shader.setVec3(name + "direction", light.direction);
-                        shader.setVec3(name + "ambient", light.ambient);
-                        shader.setVec3(name + "diffuse", light.diffuse);
-                        shader.setVec3(name + "specular", light.specular);
-                        dirCount++;
+                    case LIGHT_DIRECTIONAL: {
+                        auto &names = getLightNames(directionalNames, "DIRECTIONAL_LIGHTS", dirCount++);
+                        shader.setVec3(names.direction, light.direction);
+                        shader.setVec3(names.ambient, light.ambient);
+                        shader.setVec3(names.diffuse, light.diffuse);
+                        shader.setVec3(names.specular, light.specular);
                         break;
-                    case LIGHT_POINT:
-                        name = "POINT_LIGHTS[" + std::to_string(i++) + "].";
-                        shader.setVec3(name + "position", light.transform.getPosition());
-                        shader.setFloat(name + "constantValue", light.constant);
-                        shader.setFloat(name + "linearValue", light.linear);
-                        shader.setFloat(name + "quadraticValue", light.quadratic);
-                        shader.setVec3(name + "ambient", light.ambient);
-                        shader.setVec3(name + "diffuse", light.diffuse);
-                        shader.setVec3(name + "specular", light.specular);
-                        pointCount++;
+                    }
+                    case LIGHT_POINT: {
+                        auto &names = getLightNames(pointNames, "POINT_LIGHTS", pointCount++);
+                        shader.setVec3(names.position, light.transform.getPosition());
+                        shader.setFloat(names.constantValue, light.constant);
+                        shader.setFloat(names.linearValue, light.linear);
+                        shader.setFloat(names.quadraticValue, light.quadratic);
+                        shader.setVec3(names.ambient, light.ambient);
+                        shader.setVec3(names.diffuse, light.diffuse);
+                        shader.setVec3(names.specular, light.specular);
                         break;
-                    case LIGHT_SPOT:
-                        name = "SPOT_LIGHTS[" + std::to_string(i++) + "].";
-                        shader.setVec3(name + "position", light.transform.getPosition());
-                        shader.setVec3(name + "direction", light.direction);
-                        shader.setFloat(name + "cutOff", cosf(degreesToRadians(light.cutOff)));
-                        shader.setFloat(name + "outerCutOff", cosf(degreesToRadians(light.outerCutOff)));
-                        shader.setFloat(name + "constantValue", light.constant);
-                        shader.setFloat(name + "linearValue", light.linear);
-                        shader.setFloat(name + "quadraticValue", light.quadratic);
-                        shader.setVec3(name + "ambient", light.ambient);
-                        shader.setVec3(name + "diffuse", light.diffuse);
-                        shader.setVec3(name + "specular", light.specular);
-                        spotCount++;
+                    }
+                    case LIGHT_SPOT: {
+                        auto &names = getLightNames(spotNames, "SPOT_LIGHTS", spotCount++);
+                        shader.setVec3(names.position, light.transform.getPosition());
+                        shader.setVec3(names.direction, light.direction);
+                        shader.setFloat(names.cutOff, cosf(degreesToRadians(light.cutOff)));
+                        shader.setFloat(names.outerCutOff, cosf(degreesToRadians(light.outerCutOff)));
+                        shader.setFloat(names.constantValue, light.constant);
+                        shader.setFloat(names.linearValue, light.linear);
+                        shader.setFloat(names.quadraticValue, light.quadratic);
+                        shader.setVec3(names.ambient, light.ambient);
+                        shader.setVec3(names.diffuse, light.diffuse);
+                        shader.setVec3(names.specular, light.specular);
                         break;
+                    }
                 }
             }
 
@@ -0,0 +1,115 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "render/frustumculling.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace engine {
+    namespace FrustumCulling {
+        // The number of nodes tested by one task
+        static const size_t BATCH_SIZE = 512;
+
+        template<typename T>
+        static void cullBatch(const Frustum &frustum, T *nodes, size_t count, uint8_t *visible) {
+            std::vector<float> x(count), y(count), z(count), radius(count);
+            std::vector<Mat4f> models(count);
+
+            for (size_t i = 0; i < count; i++) {
+                models[i] = nodes[i].transform.model();
+                auto sphere = nodes[i].boundingSphere.transform(models[i]);
+                if (sphere.empty()) {
+                    x[i] = y[i] = z[i] = 0;
+                    radius[i] = std::numeric_limits<float>::infinity();
+                } else {
+                    x[i] = sphere.center.x;
+                    y[i] = sphere.center.y;
+                    z[i] = sphere.center.z;
+                    radius[i] = sphere.radius;
+                }
+            }
+
+            testSpheres(frustum, x.data(), y.data(), z.data(), radius.data(), count, visible);
+
+            // Refine the remaining nodes with the tighter bounding box
+            for (size_t i = 0; i < count; i++) {
+                if (visible[i] && !nodes[i].bounds.empty())
+                    visible[i] = frustum.intersects(nodes[i].bounds.transform(models[i]));
+            }
+        }
+
+        template<typename T>
+        static size_t cullNodes(const Frustum &frustum, std::vector<T> &nodes, ThreadPool &pool) {
+            if (nodes.empty())
+                return 0;
+
+            std::vector<uint8_t> visible(nodes.size());
+
+            std::vector<std::shared_ptr<Task>> tasks;
+            for (size_t begin = BATCH_SIZE; begin < nodes.size(); begin += BATCH_SIZE) {
+                auto count = std::min(BATCH_SIZE, nodes.size() - begin);
+                tasks.emplace_back(pool.addTask([&frustum, &nodes, &visible, begin, count]() {
+                    cullBatch(frustum, nodes.data() + begin, count, visible.data() + begin);
+                }));
+            }
+
+            // The calling thread handles the first batch instead of waiting idle
+            cullBatch(frustum, nodes.data(), std::min(BATCH_SIZE, nodes.size()), visible.data());
+
+            for (auto &task: tasks)
+                task->wait();
+
+            size_t end = 0;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                if (!visible[i])
+                    continue;
+                if (end != i)
+                    nodes[end] = std::move(nodes[i]);
+                end++;
+            }
+
+            auto ret = nodes.size() - end;
+            nodes.erase(nodes.begin() + static_cast<long>(end), nodes.end());
+            return ret;
+        }
+
+        size_t cull(Scene &scene, ThreadPool &pool) {
+            Frustum frustum(scene.camera.projection() * scene.camera.view());
+            return cullNodes(frustum, scene.deferred, pool) + cullNodes(frustum, scene.forward, pool);
+        }
+
+        void testSpheres(const Frustum &frustum,
+                         const float *x,
+                         const float *y,
+                         const float *z,
+                         const float *radius,
+                         size_t count,
+                         uint8_t *visible) {
+            std::fill(visible, visible + count, 1);
+            // Plane major order without early outs keeps the inner loop branch free
+            for (auto &plane: frustum.planes) {
+                for (size_t i = 0; i < count; i++) {
+                    float distance = plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w;
+                    visible[i] &= static_cast<uint8_t>(distance >= -radius[i]);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,177 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "render/lightclustering.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace engine {
+    const int LightClustering::TILES_X = 16;
+    const int LightClustering::TILES_Y = 9;
+    const int LightClustering::SLICES = 24;
+    const int LightClustering::CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+    const size_t LightClustering::MAX_LIGHTS_PER_CLUSTER = 256;
+    const size_t LightClustering::LIGHT_TEXELS = 7;
+
+    static void writeTexel(float *texel, const Vec3f &xyz, float w) {
+        texel[0] = xyz.x;
+        texel[1] = xyz.y;
+        texel[2] = xyz.z;
+        texel[3] = w;
+    }
+
+    // Solve the projection of a view space coordinate at depth z for the coordinate which maps to the ndc value
+    static float unprojectAxis(const Mat4f &projection, int axis, float ndc, float z) {
+        float w = projection.get(2, 3) * z + projection.get(3, 3);
+        return (ndc * w - projection.get(2, axis) * z - projection.get(3, axis)) / projection.get(axis, axis);
+    }
+
+    void LightClustering::update(const Camera &camera,
+                                 const std::vector<Light> &lights,
+                                 const std::vector<int> &lightShadows,
+                                 ThreadPool &pool) {
+        auto view = camera.view();
+        auto projection = camera.projection();
+
+        float nearDepth = std::max(camera.nearClip, 0.0001f);
+        float farDepth = std::max(camera.farClip, nearDepth * 1.001f);
+        float logRange = std::log(farDepth / nearDepth);
+        sliceParameters = Vec2f(static_cast<float>(SLICES) / logRange,
+                                static_cast<float>(SLICES) * std::log(nearDepth) / logRange);
+
+        sliceDepths.resize(SLICES + 1);
+        for (int i = 0; i <= SLICES; i++)
+            sliceDepths[i] = nearDepth * std::pow(farDepth / nearDepth, static_cast<float>(i) / SLICES);
+
+        lightData.clear();
+        lightBounds.clear();
+        lightCount = 0;
+
+        for (size_t i = 0; i < lights.size(); i++) {
+            auto &light = lights.at(i);
+            if (light.type == LIGHT_DIRECTIONAL)
+                continue;
+
+            auto position = light.transform.getPosition();
+            auto center = view * Vec4f(position.x, position.y, position.z, 1);
+            lightBounds.emplace_back(Vec3f(center.x, center.y, center.z), light.getRange());
+
+            lightData.resize(lightData.size() + LIGHT_TEXELS * 4);
+            float *texel = lightData.data() + lightCount * LIGHT_TEXELS * 4;
+            writeTexel(texel, position, light.type == LIGHT_SPOT ? 1.0f : 0.0f);
+            writeTexel(texel + 4, light.direction, std::cos(degreesToRadians(light.cutOff)));
+            texel[8] = light.constant;
+            texel[9] = light.linear;
+            texel[10] = light.quadratic;
+            texel[11] = std::cos(degreesToRadians(light.outerCutOff));
+            writeTexel(texel + 12, light.ambient, 0);
+            writeTexel(texel + 16, light.diffuse, 0);
+            writeTexel(texel + 20, light.specular, 0);
+            texel[24] = i < lightShadows.size() ? static_cast<float>(lightShadows.at(i)) : -1.0f;
+            texel[25] = 0;
+            texel[26] = 0;
+            texel[27] = 0;
+
+            lightCount++;
+        }
+
+        clusterCounts.assign(CLUSTER_COUNT, 0);
+        clusterLights.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+
+        if (lightCount > 0) {
+            std::vector<std::shared_ptr<Task>> tasks;
+            for (int slice = 1; slice < SLICES; slice++) {
+                tasks.emplace_back(pool.addTask([this, slice, &projection]() {
+                    assignSlice(slice, projection);
+                }));
+            }
+
+            // The calling thread handles the first slice instead of waiting idle
+            assignSlice(0, projection);
+
+            for (auto &task: tasks)
+                task->wait();
+        }
+
+        // Compact the per cluster lists into the offset / count table followed by the indices
+        clusterData.resize(CLUSTER_COUNT * 2);
+        auto offset = static_cast<uint32_t>(clusterData.size());
+        for (int i = 0; i < CLUSTER_COUNT; i++) {
+            auto count = clusterCounts[i];
+            clusterData[i * 2] = offset;
+            clusterData[i * 2 + 1] = count;
+            offset += count;
+        }
+
+        clusterData.resize(offset);
+        for (int i = 0; i < CLUSTER_COUNT; i++) {
+            auto begin = clusterLights.begin() + static_cast<long>(i * MAX_LIGHTS_PER_CLUSTER);
+            std::copy(begin, begin + clusterCounts[i], clusterData.begin() + clusterData[i * 2]);
+        }
+    }
+
+    void LightClustering::assignSlice(int slice, const Mat4f &projection) {
+        float sliceBegin = sliceDepths[slice];
+        float sliceEnd = sliceDepths[slice + 1];
+
+        // The view looks down the negative z axis
+        std::vector<uint32_t> candidates;
+        for (size_t i = 0; i < lightBounds.size(); i++) {
+            auto &sphere = lightBounds[i];
+            float depth = -sphere.center.z;
+            if (depth + sphere.radius >= sliceBegin && depth - sphere.radius <= sliceEnd)
+                candidates.emplace_back(static_cast<uint32_t>(i));
+        }
+
+        if (candidates.empty())
+            return;
+
+        for (int y = 0; y < TILES_Y; y++) {
+            float ndcBottom = -1 + 2 * static_cast<float>(y) / TILES_Y;
+            float ndcTop = -1 + 2 * static_cast<float>(y + 1) / TILES_Y;
+            for (int x = 0; x < TILES_X; x++) {
+                float ndcLeft = -1 + 2 * static_cast<float>(x) / TILES_X;
+                float ndcRight = -1 + 2 * static_cast<float>(x + 1) / TILES_X;
+
+                AABB bounds;
+                for (auto depth: {sliceBegin, sliceEnd}) {
+                    for (auto ndcX: {ndcLeft, ndcRight}) {
+                        for (auto ndcY: {ndcBottom, ndcTop}) {
+                            bounds.extend(Vec3f(unprojectAxis(projection, 0, ndcX, -depth),
+                                             unprojectAxis(projection, 1, ndcY, -depth),
+                                             -depth));
+                        }
+                    }
+                }
+
+                auto cluster = (slice * TILES_Y + y) * TILES_X + x;
+                auto *indices = clusterLights.data() + cluster * MAX_LIGHTS_PER_CLUSTER;
+                auto &count = clusterCounts[cluster];
+                for (auto index: candidates) {
+                    if (count >= MAX_LIGHTS_PER_CLUSTER)
+                        break;
+                    if (lightBounds[index].intersects(bounds))
+                        indices[count++] = index;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef MANA_GLSL_GBUFFER_HPP
+#define MANA_GLSL_GBUFFER_HPP
+
+/**
+ * Encoding of the compact geometry buffer written by the PrePass.
+ */
+static const char *GLSL_GBUFFER = R"###(
+// Octahedral normal encoding into the [0, 1] range of a RG16 target
+vec2 encodeNormal(vec3 normal)
+{
+    vec3 n = normal / (abs(normal.x) + abs(normal.y) + abs(normal.z));
+    vec2 ret = n.xy;
+    if (n.z < 0.0)
+        ret = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return ret * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 value)
+{
+    vec2 v = value * 2.0 - 1.0;
+    vec3 n = vec3(v.x, v.y, 1.0 - abs(v.x) - abs(v.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// The shininess is stored logarithmically in a unorm8 channel, covering exponents up to 2047
+float encodeShininess(float shininess)
+{
+    return clamp(log2(max(shininess, 0.0) + 1.0) / 11.0, 0.0, 1.0);
+}
+
+float decodeShininess(float value)
+{
+    return exp2(value * 11.0) - 1.0;
+}
+
+// Reconstruct the world space position from the window space depth
+vec3 reconstructPosition(vec2 uv, float depth, mat4 inverseViewProjection)
+{
+    vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
+)###";
+
+#endif //MANA_GLSL_GBUFFER_HPP
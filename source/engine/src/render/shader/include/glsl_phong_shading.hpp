@@ -28,10 +28,6 @@ struct DirectionalLight {
     vec3 specular;
 };
 
-DirectionalLight DIRECTIONAL_LIGHTS[MAX_LIGHTS];
-
-int DIRECTIONAL_LIGHTS_COUNT;
-
 struct PointLight {
     vec3 position;
     float constantValue;
@@ -42,10 +38,6 @@ struct PointLight {
     vec3 specular;
 };
 
-PointLight POINT_LIGHTS[MAX_LIGHTS];
-
-int POINT_LIGHTS_COUNT;
-
 struct SpotLight {
     vec3 position;
     vec3 direction;
@@ -59,9 +51,15 @@ struct SpotLight {
     vec3 specular;
 };
 
-SpotLight SPOT_LIGHTS[MAX_LIGHTS];
-
-int SPOT_LIGHTS_COUNT;
+// The light data is uploaded as a single block, the member offsets are queried with getShaderBufferLayout("MANA_LIGHTS")
+layout(std140) uniform MANA_LIGHTS {
+    DirectionalLight DIRECTIONAL_LIGHTS[MAX_LIGHTS];
+    PointLight POINT_LIGHTS[MAX_LIGHTS];
+    SpotLight SPOT_LIGHTS[MAX_LIGHTS];
+    int DIRECTIONAL_LIGHTS_COUNT;
+    int POINT_LIGHTS_COUNT;
+    int SPOT_LIGHTS_COUNT;
+};
 
 struct LightComponents
 {
@@ -70,104 +68,122 @@ struct LightComponents
     vec3 specular;
 };
 
-LightComponents mana_calculate_light_directional(vec3 fPos, vec3 fNorm, vec4 diffuseColor, vec4 specularColor, float roughness, vec3 viewPosition, mat3 lightTransformation)
+LightComponents mana_calculate_directional_light(DirectionalLight light, vec3 fPos, vec3 fNorm, vec4 diffuseColor, vec4 specularColor, float roughness, vec3 viewPosition, mat3 lightTransformation)
 {
-    LightComponents ret;
+    vec3 ambient = light.ambient * vec3(diffuseColor.xyz);
 
-    for (int i = 0; i < DIRECTIONAL_LIGHTS_COUNT; i++)
-    {
-        vec3 ambient = DIRECTIONAL_LIGHTS[i].ambient * vec3(diffuseColor.xyz);
+    vec3 norm = normalize(fNorm);
+    vec3 lightDir = normalize(-light.direction);
 
-        vec3 norm = normalize(fNorm);
-        vec3 lightDir = normalize(-DIRECTIONAL_LIGHTS[i].direction);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse =  light.diffuse * vec3((diff * diffuseColor).xyz);
 
-        float diff = max(dot(norm, lightDir), 0.0);
-        vec3 diffuse =  DIRECTIONAL_LIGHTS[i].diffuse * vec3((diff * diffuseColor).xyz);
+    vec3 viewDir = normalize(viewPosition - fPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), roughness);
+    vec3 specular = light.specular * vec3((spec * specularColor).xyz);
 
-        vec3 viewDir = normalize(viewPosition - fPos);
-        vec3 reflectDir = reflect(-lightDir, norm);
-        float spec = pow(max(dot(viewDir, reflectDir), 0.0), roughness);
-        vec3 specular = DIRECTIONAL_LIGHTS[i].specular * vec3((spec * specularColor).xyz);
+    return LightComponents(ambient, diffuse, specular);
+}
 
-        ret.ambient += ambient;
-        ret.diffuse += diffuse;
-        ret.specular += specular;
+LightComponents mana_calculate_light_directional(vec3 fPos, vec3 fNorm, vec4 diffuseColor, vec4 specularColor, float roughness, vec3 viewPosition, mat3 lightTransformation)
+{
+    LightComponents ret = LightComponents(vec3(0), vec3(0), vec3(0));
+
+    for (int i = 0; i < DIRECTIONAL_LIGHTS_COUNT; i++)
+    {
+        LightComponents comp = mana_calculate_directional_light(DIRECTIONAL_LIGHTS[i], fPos, fNorm, diffuseColor, specularColor, roughness, viewPosition, lightTransformation);
+        ret.ambient += comp.ambient;
+        ret.diffuse += comp.diffuse;
+        ret.specular += comp.specular;
     }
 
     return ret;
 }
 
-LightComponents mana_calculate_light_point(vec3 fPos, vec3 fNorm, vec4 diffuseColor, vec4 specularColor, float shininess, vec3 viewPosition, mat3 lightTransformation)
+LightComponents mana_calculate_point_light(PointLight light, vec3 fPos, vec3 fNorm, vec4 diffuseColor, vec4 specularColor, float shininess, vec3 viewPosition, mat3 lightTransformation)
 {
-    LightComponents ret;
+    vec3 position = lightTransformation * light.position;
+    float distance    = length(position - fPos);
+    float attenuation = 1.0 / (light.constantValue + light.linearValue * distance + light.quadraticValue * (distance * distance));
 
-    for (int i = 0; i < POINT_LIGHTS_COUNT; i++)
-    {
-        vec3 position = lightTransformation * POINT_LIGHTS[i].position;
-        float distance    = length(position - fPos);
-        float attenuation = 1.0 / (POINT_LIGHTS[i].constantValue + POINT_LIGHTS[i].linearValue * distance + POINT_LIGHTS[i].quadraticValue * (distance * distance));
-
-        vec3 ambient = POINT_LIGHTS[i].ambient * vec3(diffuseColor.xyz);
+    vec3 ambient = light.ambient * vec3(diffuseColor.xyz);
 
-        vec3 norm = normalize(fNorm);
-        vec3 lightDir = normalize(position - fPos);
+    vec3 norm = normalize(fNorm);
+    vec3 lightDir = normalize(position - fPos);
 
-        float diff = max(dot(norm, lightDir), 0.0);
-        vec3 diffuse =  POINT_LIGHTS[i].diffuse * vec3((diff * diffuseColor).xyz);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse =  light.diffuse * vec3((diff * diffuseColor).xyz);
 
-        vec3 viewDir = normalize(viewPosition - fPos);
-        vec3 reflectDir = reflect(-lightDir, norm);
-        float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-        vec3 specular = POINT_LIGHTS[i].specular * vec3((spec * specularColor).xyz);
+    vec3 viewDir = normalize(viewPosition - fPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    vec3 specular = light.specular * vec3((spec * specularColor).xyz);
 
-        ambient  *= attenuation;
-        diffuse  *= attenuation;
-        specular *= attenuation;
-
-        ret.ambient += ambient;
-        ret.diffuse += diffuse;
-        ret.specular += specular;
-    }
+    ambient  *= attenuation;
+    diffuse  *= attenuation;
+    specular *= attenuation;
 
-    return ret;
+    return LightComponents(ambient, diffuse, specular);
 }
 
-LightComponents mana_calculate_light_spot(vec3 fPos, vec3 fNorm, vec4 diffuseColor, vec4 specularColor, float roughness, vec3 viewPosition, mat3 lightTransformation)
+LightComponents mana_calculate_spot_light(SpotLight light, vec3 fPos, vec3 fNorm, vec4 diffuseColor, vec4 specularColor, float roughness, vec3 viewPosition, mat3 lightTransformation)
 {
-    LightComponents ret;
+    vec3 position = lightTransformation * light.position;
+    vec3 lightDir = normalize(position - fPos);
 
-    for (int i = 0; i < SPOT_LIGHTS_COUNT; i++)
-    {
-        vec3 position = lightTransformation * SPOT_LIGHTS[i].position;
-        vec3 lightDir = normalize(position - fPos);
+    vec3 ambient = light.ambient * diffuseColor.rgb;
+
+    vec3 norm = normalize(fNorm);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = light.diffuse * diff * diffuseColor.rgb;
 
-        vec3 ambient = SPOT_LIGHTS[i].ambient * diffuseColor.rgb;
+    vec3 viewDir = normalize(viewPosition - fPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), roughness);
+    vec3 specular = light.specular * spec * specularColor.rgb;
 
-        vec3 norm = normalize(fNorm);
-        float diff = max(dot(norm, lightDir), 0.0);
-        vec3 diffuse = SPOT_LIGHTS[i].diffuse * diff * diffuseColor.rgb;
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = (light.cutOff - light.outerCutOff);
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
 
-        vec3 viewDir = normalize(viewPosition - fPos);
-        vec3 reflectDir = reflect(-lightDir, norm);
-        float spec = pow(max(dot(viewDir, reflectDir), 0.0), roughness);
-        vec3 specular = SPOT_LIGHTS[i].specular * spec * specularColor.rgb;
+    diffuse  *= intensity;
+    specular *= intensity;
 
-        float theta = dot(lightDir, normalize(-SPOT_LIGHTS[i].direction));
-        float epsilon = (SPOT_LIGHTS[i].cutOff - SPOT_LIGHTS[i].outerCutOff);
-        float intensity = clamp((theta - SPOT_LIGHTS[i].outerCutOff) / epsilon, 0.0, 1.0);
+    float distance    = length(position - fPos);
+    float attenuation = 1.0 / (light.constantValue + light.linearValue * distance + light.quadraticValue * (distance * distance));
+
+    diffuse   *= attenuation;
+    specular *= attenuation;
+
+    return LightComponents(ambient, diffuse, specular);
+}
+
+LightComponents mana_calculate_light_point(vec3 fPos, vec3 fNorm, vec4 diffuseColor, vec4 specularColor, float shininess, vec3 viewPosition, mat3 lightTransformation)
+{
+    LightComponents ret = LightComponents(vec3(0), vec3(0), vec3(0));
 
-        diffuse  *= intensity;
-        specular *= intensity;
+    for (int i = 0; i < POINT_LIGHTS_COUNT; i++)
+    {
+        LightComponents comp = mana_calculate_point_light(POINT_LIGHTS[i], fPos, fNorm, diffuseColor, specularColor, shininess, viewPosition, lightTransformation);
+        ret.ambient += comp.ambient;
+        ret.diffuse += comp.diffuse;
+        ret.specular += comp.specular;
+    }
 
-        float distance    = length(position - fPos);
-        float attenuation = 1.0 / (SPOT_LIGHTS[i].constantValue + SPOT_LIGHTS[i].linearValue * distance + SPOT_LIGHTS[i].quadraticValue * (distance * distance));
+    return ret;
+}
 
-        diffuse   *= attenuation;
-        specular *= attenuation;
+LightComponents mana_calculate_light_spot(vec3 fPos, vec3 fNorm, vec4 diffuseColor, vec4 specularColor, float roughness, vec3 viewPosition, mat3 lightTransformation)
+{
+    LightComponents ret = LightComponents(vec3(0), vec3(0), vec3(0));
 
-        ret.ambient += ambient;
-        ret.diffuse += diffuse;
-        ret.specular += specular;
+    for (int i = 0; i < SPOT_LIGHTS_COUNT; i++)
+    {
+        LightComponents comp = mana_calculate_spot_light(SPOT_LIGHTS[i], fPos, fNorm, diffuseColor, specularColor, roughness, viewPosition, lightTransformation);
+        ret.ambient += comp.ambient;
+        ret.diffuse += comp.diffuse;
+        ret.specular += comp.specular;
     }
 
     return ret;
@@ -179,7 +195,7 @@ LightComponents mana_calculate_light(vec3 fPos, vec3 fNorm, vec4 fDiffuse, vec4
     LightComponents pointLight = mana_calculate_light_point(fPos, fNorm, fDiffuse, fSpecular, roughness, viewPosition, lightTransformation);
     LightComponents spotLight = mana_calculate_light_spot(fPos, fNorm, fDiffuse, fSpecular, roughness, viewPosition, lightTransformation);
 
-    LightComponents ret;
+    LightComponents ret = LightComponents(vec3(0), vec3(0), vec3(0));
     ret.ambient = dirLight.ambient + pointLight.ambient + spotLight.ambient;
     ret.diffuse = dirLight.diffuse + pointLight.diffuse + spotLight.diffuse;
     ret.specular = dirLight.specular + pointLight.specular + spotLight.specular;
@@ -0,0 +1,47 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_GLSL_VERTEXPACKING_HPP
+#define MANA_GLSL_VERTEXPACKING_HPP
+
+/**
+ * Decoding of the VertexPacking::COMPACT layout.
+ */
+static const char *GLSL_VERTEXPACKING = R"###(
+vec3 octDecode(vec2 value)
+{
+    vec3 n = vec3(value.x, value.y, 1.0 - abs(value.x) - abs(value.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+vec3 dequantizePosition(vec4 position, vec3 offset, vec3 scale)
+{
+    return offset + position.xyz * scale;
+}
+
+vec3 decodeBitangent(vec3 normal, vec3 tangent, vec4 position)
+{
+    return cross(normal, tangent) * (position.w * 2.0 - 1.0);
+}
+)###";
+
+#endif //MANA_GLSL_VERTEXPACKING_HPP
@@ -29,6 +29,8 @@
 #include "render/shader/include/hlsl_pi.hpp"
 #include "render/shader/include/glsl_noise.hpp"
 #include "render/shader/include/hlsl_noise.hpp"
+#include "render/shader/include/glsl_vertexpacking.hpp"
+#include "render/shader/include/glsl_gbuffer.hpp"
 
 static std::string includeCallback(const char *n) {
     std::string name(n);
@@ -48,6 +50,10 @@ static std::string includeCallback(const char *n) {
         return HLSL_PI;
     } else if (name == "pi.glsl") {
         return GLSL_PI;
+    } else if (name == "vertexpacking.glsl") {
+        return GLSL_VERTEXPACKING;
+    } else if (name == "gbuffer.glsl") {
+        return GLSL_GBUFFER;
     } else {
         throw std::runtime_error("Invalid name: " + name);
     }
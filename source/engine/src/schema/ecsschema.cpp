@@ -178,6 +178,9 @@ namespace engine {
         component.light.diffuse << message["diffuse"];
         component.light.specular << message["specular"];
 
+        component.light.castShadows = message.value<bool>("castShadows", false);
+        component.light.shadowDistance = message.value<float>("shadowDistance", 100);
+
         switch (component.light.type) {
             case LIGHT_POINT:
                 component.light.constant = message["constant"];
@@ -205,6 +208,8 @@ namespace engine {
         message["ambient"] << component.light.ambient;
         message["diffuse"] << component.light.diffuse;
         message["specular"] << component.light.specular;
+        message["castShadows"] = component.light.castShadows;
+        message["shadowDistance"] = component.light.shadowDistance;
 
         switch (component.light.type) {
             case engine::LIGHT_POINT:
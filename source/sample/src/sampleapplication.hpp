@@ -44,22 +44,9 @@ using namespace engine;
 // the use of pak splitting is for example when a filesystem does not support large files or
 // cloud storage with file size limits.
 static void createPackFromDirectory(const std::string &dir, long chunkSize) {
-    auto entries = Pak::readEntries(dir);
-    auto chunks = Pak::createPak(entries, chunkSize);
-
-    auto cs = dir + ".";
-    auto ce = ".pak";
-
-    int ci = 0;
-    for (auto &c: chunks) {
-        auto fileName = cs;
-        fileName += std::to_string(ci);
-        fileName += ce;
-
-        std::ofstream fs(fileName);
-        fs.write(chunks.at(ci).data(), chunks.at(ci).size());
-        ci++;
-    }
+    PakBuilder builder(chunkSize);
+    builder.addDirectory(dir);
+    builder.build(dir);
 }
 
 static std::unique_ptr<PakArchive> loadPackArchive(const std::string &pakName, Archive &archive) {
@@ -113,6 +100,7 @@ protected:
         drawLoadingScreen(0.1);
         renderSystem->getRenderer().addRenderPass(std::move(std::make_unique<PrePass>(*renderDevice)));
         drawLoadingScreen(0.2);
+        renderSystem->getRenderer().addRenderPass(std::move(std::make_unique<ShadowPass>(*renderDevice)));
         renderSystem->getRenderer().addRenderPass(
                 std::move(std::make_unique<PhongShadePass>(*renderDevice)));
         drawLoadingScreen(0.3);
@@ -145,12 +133,9 @@ protected:
                 {"Wireframe",      DebugPass::WIREFRAME,     "",             DEPTH_TEST_ALWAYS},
                 {"Lights",         DebugPass::LIGHTS,        "",             DEPTH_TEST_ALWAYS},
                 {"Depth",          PrePass::DEPTH,           "",             DEPTH_TEST_ALWAYS},
-                {"Position",       PrePass::POSITION,        "",             DEPTH_TEST_ALWAYS},
                 {"Normal",         PrePass::NORMAL,          "",             DEPTH_TEST_ALWAYS},
                 {"Diffuse",        PrePass::DIFFUSE,         "",             DEPTH_TEST_ALWAYS},
-                {"Ambient",        PrePass::AMBIENT,         "",             DEPTH_TEST_ALWAYS},
-                {"Specular",       PrePass::SPECULAR,        "",             DEPTH_TEST_ALWAYS},
-                {"Shininess",      PrePass::SHININESS_ID,    "",             DEPTH_TEST_ALWAYS}
+                {"Material",       PrePass::MATERIAL,        "",             DEPTH_TEST_ALWAYS}
         };
 
         renderSystem->getRenderer().getCompositor().setLayers(layers);